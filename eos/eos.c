@@ -11,8 +11,12 @@
 #include "eos_params.h"
 #include "eos_ethemis.h"  /* Thermal anomaly detection for E-THEMIS */
 #include "eos_mise.h"     /* Spectral anomaly detection for MISE */
+#include "eos_mask.h"
+#include "eos_score_map.h"
 #include "eos_pims.h"     /* Time-series anomaly detection for PIMS */
 #include "eos_data.h"
+#include "eos_thread.h"
+#include "eos_simd.h"
 
 static I32 EOS_IS_INITIALIZED = EOS_FALSE;
 static EosInitParams init_params;
@@ -20,6 +24,8 @@ static EosInitParams init_params;
 static U64 _eos_ethemis_detect_anomaly_mreq(const EosInitParams* params);
 static U64 _eos_mise_detect_anomaly_mreq(const EosInitParams* params);
 static U64 _eos_pims_detect_anomaly_mreq(const EosInitParams* params);
+static U32 _eos_mise_alg_enabled(const EosInitParams* params,
+                                 EosMiseAlgorithm alg);
 
 /*
  * This function should compute the maximum memory required by any public
@@ -74,6 +80,18 @@ EosStatus eos_init(const EosInitParams* params,
 
     if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
 
+    if (params->mise_workers > EOS_MAX_WORKERS) {
+        eos_logf(EOS_LOG_ERROR, "At most %d MISE workers are supported.",
+                 EOS_MAX_WORKERS);
+        return EOS_PARAM_ERROR;
+    }
+
+    if ((params->mise_algorithms >> EOS_MISE_N_ALGS) != 0) {
+        eos_logf(EOS_LOG_ERROR, "Invalid MISE algorithm mask 0x%x.",
+                 params->mise_algorithms);
+        return EOS_PARAM_ERROR;
+    }
+
     if (EOS_IS_INITIALIZED) {
         eos_log(EOS_LOG_INFO, "Tearing down prior EOS initialization.");
         status = eos_teardown();
@@ -81,6 +99,7 @@ EosStatus eos_init(const EosInitParams* params,
     }
 
     log_init(log_function);
+    eos_simd_init();
 
     required_nbytes = eos_memory_requirement(params);
     status = memory_init(initial_memory_ptr, initial_memory_size, required_nbytes);
@@ -135,6 +154,16 @@ static U64 _eos_ethemis_detect_anomaly_mreq(const EosInitParams* params) {
 EosStatus eos_ethemis_detect_anomaly(const EosEthemisParams* params,
                                      const EosEthemisObservation* observation,
                                      EosEthemisDetectionResult* result) {
+    const EosScoreMap* band_map[EOS_ETHEMIS_N_BANDS] = {NULL, NULL, NULL};
+    return eos_ethemis_detect_anomaly_map(params, observation, result,
+                                          band_map);
+}
+
+EosStatus eos_ethemis_detect_anomaly_map(
+        const EosEthemisParams* params,
+        const EosEthemisObservation* observation,
+        EosEthemisDetectionResult* result,
+        const EosScoreMap* const band_map[EOS_ETHEMIS_N_BANDS]) {
     EosStatus status;
     EosEthemisBand band;
     status = _eos_before();
@@ -144,15 +173,22 @@ EosStatus eos_ethemis_detect_anomaly(const EosEthemisParams* params,
     if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(band_map != NULL)) { return EOS_ASSERT_ERROR; }
 
     status = ethemis_params_check(params);
     if (status != EOS_SUCCESS) { return status; }
 
     for (band = EOS_ETHEMIS_BAND_1; band < EOS_ETHEMIS_N_BANDS; band++) {
+        status = eos_mask_check(observation->band_mask[band],
+                                &(observation->band_shape[band]));
+        if (status != EOS_SUCCESS) { return status; }
+        status = eos_score_map_check(band_map[band]);
+        if (status != EOS_SUCCESS) { return status; }
         status = eos_ethemis_detect_anomaly_band(
             observation->band_shape[band], observation->band_data[band],
+            observation->band_mask[band],
             params->band_threshold[band], &(result->n_results[band]),
-            result->band_results[band]
+            result->band_results[band], band_map[band]
         );
         if (status != EOS_SUCCESS) {
             return status;
@@ -170,12 +206,93 @@ static U64 _eos_mise_detect_anomaly_mreq(const EosInitParams* params) {
 
     // No local variables allocated
 
-    // Call to `eos_mise_detect_anomaly_rx`
-    call_size = eos_lmax(call_size, eos_mise_detect_anomaly_rx_mreq(params));
+    // Only the algorithms enabled at initialization can be called
+    if (_eos_mise_alg_enabled(params, EOS_MISE_RX)) {
+        // Call to `eos_mise_detect_anomaly_rx`
+        call_size = eos_lmax(call_size,
+                             eos_mise_detect_anomaly_rx_mreq(params));
+        // Call to `eos_mise_detect_anomaly_rx_background`
+        call_size = eos_lmax(call_size,
+            eos_mise_detect_anomaly_rx_background_mreq(params));
+        // Call to `eos_mise_detect_anomaly_rx_pooled`
+        call_size = eos_lmax(call_size,
+            eos_mise_detect_anomaly_rx_pooled_mreq(params));
+        // Call to `eos_mise_rx_job_step`
+        call_size = eos_lmax(call_size, mise_rx_job_step_mreq(params));
+    }
+    if (_eos_mise_alg_enabled(params, EOS_MISE_LOCAL_RX)) {
+        // Call to `eos_mise_detect_anomaly_local_rx`
+        call_size = eos_lmax(call_size,
+                             eos_mise_detect_anomaly_local_rx_mreq(params));
+    }
+    if (_eos_mise_alg_enabled(params, EOS_MISE_PCA_RX)) {
+        // Call to `eos_mise_detect_anomaly_pca_rx`
+        call_size = eos_lmax(call_size,
+                             eos_mise_detect_anomaly_pca_rx_mreq(params));
+    }
+    if (_eos_mise_alg_enabled(params, EOS_MISE_SEGMENTED_RX)) {
+        // Call to `eos_mise_detect_anomaly_segmented_rx`
+        call_size = eos_lmax(call_size,
+            eos_mise_detect_anomaly_segmented_rx_mreq(params));
+    }
+    if (_eos_mise_alg_enabled(params, EOS_MISE_MATCHED_FILTER)
+            || _eos_mise_alg_enabled(params, EOS_MISE_ACE)) {
+        // Call to `mise_detect_targets`
+        call_size = eos_lmax(call_size, mise_detect_targets_mreq(params));
+    }
+    if (_eos_mise_alg_enabled(params, EOS_MISE_SAM)) {
+        // Call to `mise_classify_sam`
+        call_size = eos_lmax(call_size, mise_classify_sam_mreq(params));
+    }
 
     return base_size + call_size;
 }
 
+/* Whether the MISE algorithm was enabled at initialization (see
+ * EosInitParams.mise_algorithms) */
+static U32 _eos_mise_alg_enabled(const EosInitParams* params,
+                                 EosMiseAlgorithm alg) {
+    return params->mise_algorithms == 0
+        || (params->mise_algorithms & (1u << alg)) != 0;
+}
+
+/* Check that the memory for the MISE algorithm was reserved by eos_init */
+static EosStatus _eos_mise_alg_check(EosMiseAlgorithm alg) {
+    if (!_eos_mise_alg_enabled(&init_params, alg)) {
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d was not enabled by eos_init.", alg);
+        return EOS_PARAM_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
+/* Check that the layout of the MISE data is one of EosMiseLayout */
+static EosStatus _eos_mise_layout_check(EosMiseLayout layout) {
+    if ((U32) layout >= EOS_MISE_N_LAYOUTS) {
+        eos_logf(EOS_LOG_ERROR, "Invalid MISE data layout %d.",
+                 (int) layout);
+        return EOS_PARAM_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Check that the top results of the additional workers were reserved by
+ * eos_init: with more than one worker, each worker keeps its own heap of
+ * n_results detections (see EosInitParams.mise_max_results)
+ */
+static EosStatus _eos_mise_results_check(U32 n_results) {
+    if (init_params.mise_workers > 1
+            && n_results > init_params.mise_max_results) {
+        eos_logf(EOS_LOG_ERROR,
+                 "%u MISE results requested; at most %u were reserved by "
+                 "eos_init for %u workers.", n_results,
+                 init_params.mise_max_results, init_params.mise_workers);
+        return EOS_PARAM_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
 static U64 _eos_pims_detect_anomaly_mreq(const EosInitParams* params) {
     U64 base_size = 0;
     U64 call_size = 0;
@@ -189,32 +306,696 @@ static U64 _eos_pims_detect_anomaly_mreq(const EosInitParams* params) {
 EosStatus eos_mise_detect_anomaly(const EosMiseParams* params,
                                   const EosMiseObservation* observation,
                                   EosMiseDetectionResult* result) {
+    return eos_mise_detect_anomaly_map(params, observation, result, NULL);
+}
+
+/*
+ * Run the MISE algorithm on an observation whose parameters were checked
+ * (see eos_mise_detect_anomaly_map)
+ */
+static EosStatus _eos_mise_detect(const EosMiseParams* params,
+                                  const EosMiseObservation* observation,
+                                  EosMiseDetectionResult* result,
+                                  const EosScoreMap* map) {
+    EosStatus status = EOS_SUCCESS;
+    MiseSampling sampling;
+
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+    /* Local RX scores a row at a time with a single heap */
+    if (params->alg != EOS_MISE_LOCAL_RX) {
+        status = _eos_mise_results_check(result->n_results);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    if (params->alg == EOS_MISE_RX) {
+        sampling.mode = params->background_sampling;
+        sampling.step = params->background_sample_step;
+        sampling.seed = params->background_sample_seed;
+        status = eos_mise_detect_anomaly_rx_sampled(
+                    observation->shape,   observation->data,
+                    observation->layout,  observation->mask,
+                    eos_umax(init_params.mise_workers, 1), &sampling,
+                    params->precision,
+                    &(result->n_results), result->results, map);
+        if (status != EOS_SUCCESS) {
+            return status;
+        }
+    } else if (params->alg == EOS_MISE_LOCAL_RX) {
+        /* The sliding window is updated a whole row at a time */
+        if (observation->mask != NULL) {
+            eos_log(EOS_LOG_ERROR, "Local RX does not support pixel masks.");
+            return EOS_PARAM_ERROR;
+        }
+        status = eos_mise_detect_anomaly_local_rx(
+                    observation->shape,   observation->data,
+                    observation->layout,  params->local_rx_window_rows,
+                    &(result->n_results), result->results, map);
+        if (status != EOS_SUCCESS) {
+            return status;
+        }
+    } else if (params->alg == EOS_MISE_PCA_RX) {
+        if (params->pca_rx_components > observation->shape.bands) {
+            eos_logf(EOS_LOG_ERROR,
+                     "Cannot use %u principal components of %u bands.",
+                     params->pca_rx_components, observation->shape.bands);
+            return EOS_PARAM_ERROR;
+        }
+        sampling.mode = params->background_sampling;
+        sampling.step = params->background_sample_step;
+        sampling.seed = params->background_sample_seed;
+        status = eos_mise_detect_anomaly_pca_rx(
+                    observation->shape,   observation->data,
+                    observation->layout,  observation->mask,
+                    eos_umax(init_params.mise_workers, 1), &sampling,
+                    params->pca_rx_components, params->pca_rx_complement,
+                    NULL, &(result->n_results), result->results, map);
+        if (status != EOS_SUCCESS) {
+            return status;
+        }
+    } else if (params->alg == EOS_MISE_SEGMENTED_RX) {
+        if (params->segmented_rx_clusters > init_params.mise_max_clusters) {
+            eos_logf(EOS_LOG_ERROR,
+                     "Cannot use %u background clusters (at most %u).",
+                     params->segmented_rx_clusters,
+                     init_params.mise_max_clusters);
+            return EOS_PARAM_ERROR;
+        }
+        sampling.mode = params->background_sampling;
+        sampling.step = params->background_sample_step;
+        sampling.seed = params->background_sample_seed;
+        status = eos_mise_detect_anomaly_segmented_rx(
+                    observation->shape,   observation->data,
+                    observation->layout,  observation->mask,
+                    eos_umax(init_params.mise_workers, 1), &sampling,
+                    params->segmented_rx_clusters,
+                    params->segmented_rx_iterations,
+                    &(result->n_results), result->results, map);
+        if (status != EOS_SUCCESS) {
+            return status;
+        }
+    } else if (params->alg == EOS_MISE_MATCHED_FILTER
+            || params->alg == EOS_MISE_ACE) {
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d needs a target library; use "
+                 "eos_mise_detect_targets.", params->alg);
+        return EOS_PARAM_ERROR;
+    } else if (params->alg == EOS_MISE_SAM) {
+        eos_log(EOS_LOG_ERROR,
+                "The spectral angle mapper needs a library index; use "
+                "eos_mise_classify_sam.");
+        return EOS_PARAM_ERROR;
+    } else {
+        /* algorithm not yet implemented */
+        eos_logf(EOS_LOG_ERROR, 
+                 "MISE algorithm %d not yet implemented", params->alg);
+        return EOS_PARAM_ERROR;
+    }
+    return status;
+}
+
+EosStatus eos_mise_detect_anomaly_map(const EosMiseParams* params,
+                                      const EosMiseObservation* observation,
+                                      EosMiseDetectionResult* result,
+                                      const EosScoreMap* map) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_score_map_check(map);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = _eos_mise_detect(params, observation, result, map);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_detect_anomaly_batch(const EosMiseParams* params,
+                                const uint32_t n_observations,
+                                const EosMiseObservation* observations,
+                                EosMiseDetectionResult* results) {
+    EosStatus status;
+    MiseSampling sampling;
+    U32 i;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_observations == 0 || observations != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_observations == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    /* The parameters are shared, so they are checked once */
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (!params->batch_pooled_background) {
+        for (i = 0; i < n_observations; i++) {
+            status = _eos_mise_detect(params, &(observations[i]),
+                                      &(results[i]), NULL);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+        _eos_after();
+        return status;
+    }
+
+    /* only the global background can be pooled across observations */
+    if (params->alg != EOS_MISE_RX) {
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not support a pooled background",
+                 params->alg);
+        return EOS_PARAM_ERROR;
+    }
+    for (i = 0; i < n_observations; i++) {
+        status = _eos_mise_layout_check(observations[i].layout);
+        if (status != EOS_SUCCESS) { return status; }
+        status = eos_mask_check(observations[i].mask,
+                                &(observations[i].shape));
+        if (status != EOS_SUCCESS) { return status; }
+        status = _eos_mise_results_check(results[i].n_results);
+        if (status != EOS_SUCCESS) { return status; }
+        if (observations[i].shape.bands != observations[0].shape.bands) {
+            eos_log(EOS_LOG_ERROR,
+                    "Observations with a pooled background must have the "
+                    "same bands.");
+            return EOS_VALUE_ERROR;
+        }
+    }
+
+    sampling.mode = params->background_sampling;
+    sampling.step = params->background_sample_step;
+    sampling.seed = params->background_sample_seed;
+    status = eos_mise_detect_anomaly_rx_pooled(n_observations, observations,
+                eos_umax(init_params.mise_workers, 1), &sampling,
+                params->precision, results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_detect_targets(const EosMiseParams* params,
+                                  const EosMiseObservation* observation,
+                                  const EosMiseTargetLibrary* library,
+                                  EosMiseDetectionResult* results) {
+    EosStatus status;
+    MiseSampling sampling;
+    U32 i;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library->n_targets == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    if (params->alg != EOS_MISE_MATCHED_FILTER
+            && params->alg != EOS_MISE_ACE) {
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not detect targets.", params->alg);
+        return EOS_PARAM_ERROR;
+    }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (library->n_targets > init_params.mise_max_targets) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Library has %u targets; at most %u were reserved by "
+                 "eos_init.", library->n_targets,
+                 init_params.mise_max_targets);
+        return EOS_PARAM_ERROR;
+    }
+    if (library->n_targets > 0
+            && library->bands != observation->shape.bands) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Library has %u bands, but the observation has %u.",
+                 library->bands, observation->shape.bands);
+        return EOS_VALUE_ERROR;
+    }
+    for (i = 0; i < library->n_targets; i++) {
+        status = _eos_mise_results_check(results[i].n_results);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    sampling.mode = params->background_sampling;
+    sampling.step = params->background_sample_step;
+    sampling.seed = params->background_sample_seed;
+    status = mise_detect_targets(observation->shape, observation->data,
+                observation->layout, observation->mask,
+                eos_umax(init_params.mise_workers, 1),
+                &sampling, params->alg, library, results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_sam_index_request(const uint32_t n_targets,
+                                     const uint32_t bands,
+                                     EosMiseSamIndexRequest* req) {
+    // Only computes sizes, so the library need not be initialized
+    return mise_sam_index_request(n_targets, bands, req);
+}
+
+EosStatus eos_mise_sam_index_build(const EosMiseTargetLibrary* library,
+                                   const uint32_t coarse_step,
+                                   EosMiseSamIndex* index) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = mise_sam_index_build(library, coarse_step, index);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_classify_sam(const EosMiseParams* params,
+                                const EosMiseObservation* observation,
+                                const EosMiseSamIndex* index,
+                                EosMiseDetectionResult* results) {
+    EosStatus status;
+    U32 i;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->n_targets == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    if (params->alg != EOS_MISE_SAM) {
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not classify with a library index.",
+                 params->alg);
+        return EOS_PARAM_ERROR;
+    }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (index->n_targets > init_params.mise_max_targets
+            || observation->shape.bands > init_params.mise_max_bands) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Index has %u targets of %u bands; at most %u targets of "
+                 "%u bands were reserved by eos_init.", index->n_targets,
+                 observation->shape.bands, init_params.mise_max_targets,
+                 init_params.mise_max_bands);
+        return EOS_PARAM_ERROR;
+    }
+    if (index->n_targets > 0 && index->bands != observation->shape.bands) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Index has %u bands, but the observation has %u.",
+                 index->bands, observation->shape.bands);
+        return EOS_VALUE_ERROR;
+    }
+    for (i = 0; i < index->n_targets; i++) {
+        status = _eos_mise_results_check(results[i].n_results);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    status = mise_classify_sam(observation->shape, observation->data,
+                observation->layout, observation->mask,
+                eos_umax(init_params.mise_workers, 1),
+                params->sam_max_angle, index, results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_stream_state_request(const uint32_t bands,
+                                        EosMiseStreamStateRequest* req) {
+    // Only computes sizes, so the library need not be initialized
+    return mise_stream_state_request(bands, req);
+}
+
+EosStatus eos_mise_stream_begin(const uint32_t cols, const uint32_t bands,
+                                EosMiseStreamState* state) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (bands > init_params.mise_max_bands) {
+        eos_logf(EOS_LOG_ERROR, "At most %u MISE bands are supported.",
+                 init_params.mise_max_bands);
+        return EOS_PARAM_ERROR;
+    }
+
+    status = mise_stream_begin(cols, bands, state);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_stream_push_rows(EosMiseStreamState* state,
+                                    const uint32_t n_rows,
+                                    const uint16_t* rows) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    status = _eos_mise_layout_check(state->layout);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = mise_stream_push_rows(state, n_rows, rows);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_stream_finalize(const EosMiseParams* params,
+                                   const EosMiseStreamState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result) {
     EosStatus status;
     status = _eos_before();
     if (status != EOS_SUCCESS) { return status; }
 
     // Assert that parameters are not NULL
     if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
 
     status = mise_params_check(params);
     if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    /* The streamed background was accumulated over every pixel */
+    if (observation->mask != NULL) {
+        eos_log(EOS_LOG_ERROR,
+                "Streamed observations do not support pixel masks.");
+        return EOS_PARAM_ERROR;
+    }
+
+    if (observation->shape.rows != state->shape.rows
+        || observation->shape.cols != state->shape.cols
+        || observation->shape.bands != state->shape.bands) {
+        eos_log(EOS_LOG_ERROR,
+                "Observation shape does not match the streamed rows.");
+        return EOS_VALUE_ERROR;
+    }
+    status = _eos_mise_results_check(result->n_results);
+    if (status != EOS_SUCCESS) { return status; }
 
     if (params->alg == EOS_MISE_RX) {
-        status = eos_mise_detect_anomaly_rx(
+        status = eos_mise_detect_anomaly_rx_moments(
                     observation->shape,   observation->data,
+                    observation->layout,
+                    eos_umax(init_params.mise_workers, 1),
+                    state->moments, state->moments + state->shape.bands,
+                    params->precision,
                     &(result->n_results), result->results);
         if (status != EOS_SUCCESS) {
             return status;
         }
     } else {
-        /* algorithm not yet implemented */
-        eos_logf(EOS_LOG_ERROR, 
-                 "MISE algorithm %d not yet implemented", params->alg);
+        /* only the global background can be accumulated while streaming */
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not support streaming", params->alg);
+        return EOS_PARAM_ERROR;
+    }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_background_state_request(const uint32_t bands,
+                                    EosMiseBackgroundStateRequest* req) {
+    // Only computes sizes, so the library need not be initialized
+    return mise_background_state_request(bands, req);
+}
+
+EosStatus eos_mise_background_init(const uint32_t bands,
+                                   EosMiseBackgroundState* state) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (bands > init_params.mise_max_bands) {
+        eos_logf(EOS_LOG_ERROR, "At most %u MISE bands are supported.",
+                 init_params.mise_max_bands);
+        return EOS_PARAM_ERROR;
+    }
+
+    status = mise_background_init(bands, state);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_detect_anomaly_background(const EosMiseParams* params,
+                                   EosMiseBackgroundState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result) {
+    EosStatus status;
+    MiseSampling sampling;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    status = mise_background_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (observation->shape.bands != state->bands) {
+        eos_log(EOS_LOG_ERROR,
+                "Observation bands do not match the background.");
+        return EOS_VALUE_ERROR;
+    }
+    status = _eos_mise_results_check(result->n_results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (params->alg == EOS_MISE_RX) {
+        sampling.mode = params->background_sampling;
+        sampling.step = params->background_sample_step;
+        sampling.seed = params->background_sample_seed;
+        status = eos_mise_detect_anomaly_rx_background(
+                    observation->shape,   observation->data,
+                    observation->layout,  observation->mask,
+                    eos_umax(init_params.mise_workers, 1),
+                    params->background_forgetting,
+                    params->background_drift_tolerance, &sampling,
+                    state, &(result->n_results), result->results);
+        if (status != EOS_SUCCESS) {
+            return status;
+        }
+    } else {
+        /* only the global background is carried across observations */
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not support a persistent background",
+                 params->alg);
+        return EOS_PARAM_ERROR;
+    }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_pca_basis_state_request(const uint32_t bands,
+                                    const uint32_t n_components,
+                                    EosMisePcaBasisStateRequest* req) {
+    // Only computes sizes, so the library need not be initialized
+    return mise_pca_basis_state_request(bands, n_components, req);
+}
+
+EosStatus eos_mise_pca_basis_init(const uint32_t bands,
+                                  const uint32_t n_components,
+                                  EosMisePcaBasisState* state) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (bands > init_params.mise_max_bands) {
+        eos_logf(EOS_LOG_ERROR, "At most %u MISE bands are supported.",
+                 init_params.mise_max_bands);
+        return EOS_PARAM_ERROR;
+    }
+    if (n_components == 0 || n_components > bands) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Cannot use %u principal components of %u bands.",
+                 n_components, bands);
         return EOS_PARAM_ERROR;
     }
 
+    status = mise_pca_basis_init(bands, n_components, state);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_detect_anomaly_pca_basis(const EosMiseParams* params,
+                                   EosMisePcaBasisState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result) {
+    EosStatus status;
+    MiseSampling sampling;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (params->alg != EOS_MISE_PCA_RX) {
+        /* only PCA RX has a principal basis to carry */
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not support a principal basis",
+                 params->alg);
+        return EOS_PARAM_ERROR;
+    }
+    if (observation->shape.bands != state->bands
+            || params->pca_rx_components != state->n_components) {
+        eos_log(EOS_LOG_ERROR,
+                "Observation bands or components do not match the basis.");
+        return EOS_VALUE_ERROR;
+    }
+    status = _eos_mise_results_check(result->n_results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    sampling.mode = params->background_sampling;
+    sampling.step = params->background_sample_step;
+    sampling.seed = params->background_sample_seed;
+    status = eos_mise_detect_anomaly_pca_rx(
+                observation->shape,   observation->data, observation->layout,
+                observation->mask,
+                eos_umax(init_params.mise_workers, 1), &sampling,
+                params->pca_rx_components, params->pca_rx_complement,
+                state, &(result->n_results), result->results, NULL);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_rx_job_state_request(const uint32_t bands,
+                                        EosMiseRxJobStateRequest* req) {
+    // Only computes sizes, so the library need not be initialized
+    return mise_rx_job_state_request(bands, req);
+}
+
+EosStatus eos_mise_rx_job_begin(const EosMiseParams* params,
+                                const EosMiseObservation* observation,
+                                EosMiseDetectionResult* result,
+                                EosMiseRxJobState* state) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Assert that parameters are not NULL
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(observation != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(result != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = mise_params_check(params);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_alg_check(params->alg);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _eos_mise_layout_check(observation->layout);
+    if (status != EOS_SUCCESS) { return status; }
+    status = eos_mask_check(observation->mask, &(observation->shape));
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (observation->shape.bands > init_params.mise_max_bands) {
+        eos_logf(EOS_LOG_ERROR, "At most %u MISE bands are supported.",
+                 init_params.mise_max_bands);
+        return EOS_PARAM_ERROR;
+    }
+    if (params->alg != EOS_MISE_RX) {
+        /* only the global background is accumulated a part at a time */
+        eos_logf(EOS_LOG_ERROR,
+                 "MISE algorithm %d does not support resumable detection",
+                 params->alg);
+        return EOS_PARAM_ERROR;
+    }
+
+    status = mise_rx_job_begin(params, observation, result, state);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_rx_job_step(EosMiseRxJobState* state,
+                               const uint64_t budget) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* EOS_IN_PROGRESS is not an error: the job continues on the next call */
+    status = mise_rx_job_step(state, budget);
+    if (status != EOS_SUCCESS && status != EOS_IN_PROGRESS) {
+        return status;
+    }
+
     _eos_after();
     return status;
 }
@@ -245,6 +1026,45 @@ EosStatus eos_load_mise(const void* data, const U64 size,
     return status;
 }
 
+EosStatus eos_load_mise_reduced(const void* data, const U64 size,
+                                const EosMiseBandReduction* reduction,
+                                EosMiseObservation* obs) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = load_mise_reduced(data, size, reduction, obs);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_load_mise_stream(const void* data, const U64 size,
+                               const EosMiseBandReduction* reduction,
+                               EosMiseObservation* obs,
+                               EosMiseStreamState* state) {
+    EosStatus status;
+    status = _eos_before();
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = load_mise_stream(data, size, reduction,
+                              init_params.mise_max_bands, obs, state);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _eos_after();
+    return status;
+}
+
+EosStatus eos_mise_reduced_bands(const uint32_t bands,
+                                 const EosMiseBandReduction* reduction,
+                                 uint32_t* reduced_bands) {
+    // Only computes the band count, so the library need not be initialized
+    return mise_reduced_bands(bands, reduction, reduced_bands);
+}
+
 EosStatus eos_load_pims(const void* data, const U64 size,
                        EosPimsObservationsFile* obs_file) {
     EosStatus status;
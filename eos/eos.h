@@ -32,12 +32,228 @@ EosStatus eos_mise_detect_anomaly(const EosMiseParams* params,
                                   const EosMiseObservation* observation,
                                   EosMiseDetectionResult* result);
 
+/**
+ * Detection that also writes the score of every pixel to a score map (see
+ * EosScoreMap), for context products. The map is written in the given
+ * format to a caller buffer that holds either the whole map or, with a map
+ * function, a block of rows at a time that is passed to the function in row
+ * order (e.g., to compress or downlink the map incrementally). For E-THEMIS,
+ * the score of a pixel is its value, and each band has its own map (NULL for
+ * none). The map is written even if no results are requested.
+ */
+EosStatus eos_ethemis_detect_anomaly_map(
+        const EosEthemisParams* params,
+        const EosEthemisObservation* observation,
+        EosEthemisDetectionResult* result,
+        const EosScoreMap* const band_map[EOS_ETHEMIS_N_BANDS]);
+
+EosStatus eos_mise_detect_anomaly_map(const EosMiseParams* params,
+                                      const EosMiseObservation* observation,
+                                      EosMiseDetectionResult* result,
+                                      const EosScoreMap* map);
+
+/**
+ * MISE detection of a batch of observations (e.g., the small cubes of one
+ * pass), with the parameters checked once for all of them. Each result holds
+ * the capacity and then the detections of the observation at the same index.
+ * With `params->batch_pooled_background` (EOS_MISE_RX only), the
+ * observations, which must have the same bands, are scored against a single
+ * background pooled from all of their sampled valid pixels, which is
+ * estimated and factored only once; otherwise each observation is processed
+ * as by `eos_mise_detect_anomaly`.
+ */
+EosStatus eos_mise_detect_anomaly_batch(const EosMiseParams* params,
+                                const uint32_t n_observations,
+                                const EosMiseObservation* observations,
+                                EosMiseDetectionResult* results);
+
+/**
+ * MISE detection of the known targets of a spectral library (e.g., thermal
+ * emission signatures of specific ices or salts) with
+ * `params->alg` EOS_MISE_MATCHED_FILTER or EOS_MISE_ACE. The library, which
+ * must have the observation's bands and at most
+ * `EosInitParams.mise_max_targets` targets, is whitened against the
+ * background once, and all pixels are scored against all targets in a single
+ * pass. `results` holds one result per target, each with its own capacity,
+ * and receives the top detections of that target. The background is
+ * estimated as for EOS_MISE_RX (with the same sampling and mask).
+ */
+EosStatus eos_mise_detect_targets(const EosMiseParams* params,
+                                  const EosMiseObservation* observation,
+                                  const EosMiseTargetLibrary* library,
+                                  EosMiseDetectionResult* results);
+
+/**
+ * Lightweight MISE classification with the spectral angle mapper
+ * (`params->alg` EOS_MISE_SAM), for triage when there is no time for a
+ * background estimate. The library is first built into a normalized index
+ * (once, e.g., at startup), in caller buffers with the sizes given by
+ * `eos_mise_sam_index_request`. Every `coarse_step`-th band is used by a
+ * coarse pre-filter that skips the full angle for targets that cannot be
+ * the nearest (0 or 1 to use all bands). Each pixel is then assigned to the
+ * target with the smallest spectral angle, if it is at most
+ * `params->sam_max_angle`. `results` holds one result per target, as for
+ * `eos_mise_detect_targets`, and receives the top pixels of that class,
+ * scored by the cosine of their angle.
+ */
+EosStatus eos_mise_sam_index_request(const uint32_t n_targets,
+                                     const uint32_t bands,
+                                     EosMiseSamIndexRequest* req);
+
+EosStatus eos_mise_sam_index_build(const EosMiseTargetLibrary* library,
+                                   const uint32_t coarse_step,
+                                   EosMiseSamIndex* index);
+
+EosStatus eos_mise_classify_sam(const EosMiseParams* params,
+                                const EosMiseObservation* observation,
+                                const EosMiseSamIndex* index,
+                                EosMiseDetectionResult* results);
+
+/**
+ * Streaming MISE detection, for observations acquired one or more rows at a
+ * time: begin the observation, push rows as they are read out (accumulating
+ * the background statistics), then finalize to score the complete
+ * observation. Only the background factorization and scoring are left to
+ * the finalize step.
+ *
+ * The caller provides the state's moments buffer, with the number of values
+ * given by `eos_mise_stream_state_request` (which, like the other state size
+ * requests, may be called before `eos_init`). The observation passed to
+ * `eos_mise_stream_finalize` must hold the same rows that were pushed (e.g.,
+ * the acquisition buffer the rows were pushed from). Each block of pushed
+ * rows is stored in the layout `state->layout`, which is BIP unless set
+ * after `eos_mise_stream_begin`; the observation may use any layout,
+ * but no pixel mask, since every pushed pixel is in the background.
+ */
+EosStatus eos_mise_stream_state_request(const uint32_t bands,
+                                        EosMiseStreamStateRequest* req);
+
+EosStatus eos_mise_stream_begin(const uint32_t cols, const uint32_t bands,
+                                EosMiseStreamState* state);
+
+EosStatus eos_mise_stream_push_rows(EosMiseStreamState* state,
+                                    const uint32_t n_rows,
+                                    const uint16_t* rows);
+
+EosStatus eos_mise_stream_finalize(const EosMiseParams* params,
+                                   const EosMiseStreamState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result);
+
+/**
+ * MISE detection against a background carried across observations, for
+ * consecutive observations of similar terrain: each observation is merged
+ * into the background (with the previous observations' weight scaled by
+ * `params->background_forgetting`), and the background is factored again
+ * only when it has drifted from the last factorization by more than
+ * `params->background_drift_tolerance`. Pixels are scored against the
+ * factored background.
+ *
+ * The caller provides the state's arrays, with the number of values given by
+ * `eos_mise_background_state_request`, and starts an empty background with
+ * `eos_mise_background_init`.
+ */
+EosStatus eos_mise_background_state_request(const uint32_t bands,
+                                    EosMiseBackgroundStateRequest* req);
+
+EosStatus eos_mise_background_init(const uint32_t bands,
+                                   EosMiseBackgroundState* state);
+
+EosStatus eos_mise_detect_anomaly_background(const EosMiseParams* params,
+                                   EosMiseBackgroundState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result);
+
+/**
+ * PCA RX detection (`params->alg` EOS_MISE_PCA_RX) with the principal basis
+ * carried across observations: the eigensolver for each observation starts
+ * from the `params->pca_rx_components` components found for the previous
+ * one, so it converges in fewer iterations while the background changes
+ * slowly. The number of iterations used is left in `state->n_iterations`.
+ *
+ * The caller provides the state's basis, with the number of values given by
+ * `eos_mise_pca_basis_state_request`, and starts without a basis with
+ * `eos_mise_pca_basis_init`.
+ */
+EosStatus eos_mise_pca_basis_state_request(const uint32_t bands,
+                                    const uint32_t n_components,
+                                    EosMisePcaBasisStateRequest* req);
+
+EosStatus eos_mise_pca_basis_init(const uint32_t bands,
+                                  const uint32_t n_components,
+                                  EosMisePcaBasisState* state);
+
+EosStatus eos_mise_detect_anomaly_pca_basis(const EosMiseParams* params,
+                                   EosMisePcaBasisState* state,
+                                   const EosMiseObservation* observation,
+                                   EosMiseDetectionResult* result);
+
+/**
+ * MISE RX detection in bounded slices of work, for callers that must return
+ * to other tasks within a fixed time (e.g., a flight software scheduler
+ * without threads). `eos_mise_rx_job_begin` records the observation, and
+ * each call to `eos_mise_rx_job_step` does about `budget` pixels of work (at
+ * least one row of the background, one column of the factorization of the
+ * background, or one pixel of scoring), returning EOS_IN_PROGRESS until the
+ * results are complete. A rank-deficient background is instead
+ * pseudo-inverted in a step of its own, whose work in pixels is given by
+ * the request's `pseudo_inverse_pixels`. The results are identical
+ * to those of `eos_mise_detect_anomaly` with the same parameters.
+ *
+ * The caller provides the state's arrays, with the number of values given by
+ * `eos_mise_rx_job_state_request`. The observation's data and mask and the
+ * results array must not change until the job ends; the result's
+ * `n_results` is set when the last step returns EOS_SUCCESS.
+ */
+EosStatus eos_mise_rx_job_state_request(const uint32_t bands,
+                                        EosMiseRxJobStateRequest* req);
+
+EosStatus eos_mise_rx_job_begin(const EosMiseParams* params,
+                                const EosMiseObservation* observation,
+                                EosMiseDetectionResult* result,
+                                EosMiseRxJobState* state);
+
+EosStatus eos_mise_rx_job_step(EosMiseRxJobState* state,
+                               const uint64_t budget);
+
 EosStatus eos_load_etm(const void* data, const uint64_t size,
                        EosEthemisObservation* obs);
 
 EosStatus eos_load_mise(const void* data, const uint64_t size,
                         EosMiseObservation* obs);
 
+/*
+ * Load a MISE observation, selecting and binning its bands while decoding
+ * (see EosMiseBandReduction). The observation's data must hold rows * cols *
+ * reduced bands values, where the number of reduced bands for the file's
+ * band count is given by `eos_mise_reduced_bands`. Since the MISE memory
+ * requirement grows with the square of `mise_max_bands`, the library may be
+ * initialized with the reduced band count, which `eos_mise_reduced_bands`
+ * computes without requiring initialization.
+ */
+EosStatus eos_load_mise_reduced(const void* data, const uint64_t size,
+                                const EosMiseBandReduction* reduction,
+                                EosMiseObservation* obs);
+
+EosStatus eos_mise_reduced_bands(const uint32_t bands,
+                                 const EosMiseBandReduction* reduction,
+                                 uint32_t* reduced_bands);
+
+/*
+ * Load a MISE observation as `eos_load_mise_reduced` does (with a NULL
+ * reduction to keep all bands), accumulating its background moments into the
+ * stream state as each row is decoded. The loader starts the stream itself,
+ * so the state only needs its moments buffer, with the size given by
+ * `eos_mise_stream_state_request` for the library's maximum bands. Passing
+ * the state and the loaded observation to `eos_mise_stream_finalize` then
+ * gives the results of `eos_mise_detect_anomaly` (RX, without a mask)
+ * without its separate pass over the data to estimate the background.
+ */
+EosStatus eos_load_mise_stream(const void* data, const uint64_t size,
+                               const EosMiseBandReduction* reduction,
+                               EosMiseObservation* obs,
+                               EosMiseStreamState* state);
+
 EosStatus eos_load_pims(const void* data, const uint64_t size,
                         EosPimsObservationsFile* obs_file);
 
@@ -6,6 +6,8 @@
 #include "eos_data.h"
 #include "eos_log.h"
 #include "eos_util.h"
+#include "eos_simd.h"
+#include "eos_mise.h"
 
 #ifndef INFINITY
     #define INFINITY (1.0/0.0)
@@ -81,6 +83,7 @@ EosStatus _load_etm_v1(const void* data, const U64 size,
             return EOS_ETM_LOAD_ERROR;
         }
         obs->band_shape[i] = shape;
+        obs->band_mask[i] = NULL;
 
         band_data_bytes = band_size * sizeof(U16);
         if (band_data_bytes + band_data_offset > size) {
@@ -152,13 +155,91 @@ EosStatus load_etm(const void* data, const U64 size, EosEthemisObservation* obs)
 
 /******** MISE ********/
 
+/*
+ * Number of bands left after applying the reduction to an observation with
+ * the given number of bands. A NULL reduction keeps all bands.
+ */
+EosStatus mise_reduced_bands(U32 bands, const EosMiseBandReduction* reduction,
+                             U32* reduced_bands) {
+    U32 i, kept;
+
+    if (eos_assert(reduced_bands != NULL)) { return EOS_ASSERT_ERROR; }
+
+    if (reduction == NULL) {
+        *reduced_bands = bands;
+        return EOS_SUCCESS;
+    }
+
+    if (reduction->bin_factor == 0) {
+        eos_log(EOS_LOG_ERROR, "MISE band binning factor must be positive.");
+        return EOS_PARAM_ERROR;
+    }
+
+    kept = bands;
+    if (reduction->n_selected_bands > 0) {
+        if (eos_assert(reduction->selected_bands != NULL)) {
+            return EOS_ASSERT_ERROR;
+        }
+        for (i = 0; i < reduction->n_selected_bands; i++) {
+            if (i > 0 && reduction->selected_bands[i]
+                    <= reduction->selected_bands[i - 1]) {
+                eos_log(EOS_LOG_ERROR,
+                        "Selected MISE bands must be in increasing order.");
+                return EOS_PARAM_ERROR;
+            }
+            if (reduction->selected_bands[i] >= bands) {
+                eos_logf(EOS_LOG_ERROR,
+                         "Selected MISE band %d, but there are only %d bands",
+                         reduction->selected_bands[i], bands);
+                return EOS_MISE_LOAD_ERROR;
+            }
+        }
+        kept = reduction->n_selected_bands;
+    }
+
+    *reduced_bands = (kept + reduction->bin_factor - 1) / reduction->bin_factor;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Decode the (big-endian) bands of one pixel into the reduced bands, each
+ * the rounded mean of its group of kept bands
+ */
+static void _reduce_mise_pixel(const U8* pixel,
+                               const EosMiseBandReduction* reduction,
+                               U32 kept, EosEndianness system, U16* out) {
+    U32 i, g, band, count;
+    U32 sum;
+    U16 value;
+
+    for (i = 0, g = 0; g < kept; i++) {
+        sum = 0;
+        for (count = 0; count < reduction->bin_factor && g < kept;
+             count++, g++) {
+            band = (reduction->n_selected_bands > 0) ?
+                   reduction->selected_bands[g] : g;
+            memcpy(&value, &(pixel[band * sizeof(U16)]), sizeof(U16));
+            correct_endianness_U16(EOS_BIG_ENDIAN, system, &value);
+            sum += value;
+        }
+        out[i] = (U16) ((sum + count / 2) / count);
+    }
+}
+
 EosStatus _load_mise_v1(const void* data, const U64 size,
-                        EosMiseObservation* obs, U32 header_bytes) {
+                        const EosMiseBandReduction* reduction,
+                        U32 max_bands, EosMiseObservation* obs,
+                        EosMiseStreamState* state, U32 header_bytes) {
+    EosStatus status;
     EosEndianness system;
     U32 header[MISE_HEADER_ENTRIES];
     U32 full_header_bytes;
     U32 n_data_values, data_bytes;
-    U32 i;
+    U32 n_pixels, bands, kept, reduced_bands;
+    U32 i, row, col;
+    U64 row_bytes, row_values;
+    const U8* src;
+    U16* dst;
 
     if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(obs != NULL)) { return EOS_ASSERT_ERROR; }
@@ -184,15 +265,22 @@ EosStatus _load_mise_v1(const void* data, const U64 size,
     obs->timestamp = header[1];
     obs->shape.cols = header[2];
     obs->shape.rows = header[3];
-    obs->shape.bands = header[4];
-    if (obs->shape.bands != EOS_MISE_N_BANDS) {
+    bands = header[4];
+    if (bands != EOS_MISE_N_BANDS) {
         eos_logf(EOS_LOG_INFO,
                  "Read %d MISE bands (expecting %d)",
-                 obs->shape.bands, EOS_MISE_N_BANDS);
+                 bands, EOS_MISE_N_BANDS);
     }
 
-    /* Copy the file data */
-    n_data_values = obs->shape.cols * obs->shape.rows * obs->shape.bands;
+    status = mise_reduced_bands(bands, reduction, &reduced_bands);
+    if (status != EOS_SUCCESS) { return status; }
+    obs->shape.bands = reduced_bands;
+    obs->layout = EOS_MISE_BIP;
+    obs->mask = NULL;
+
+    /* Check the size of the file data */
+    n_pixels = obs->shape.cols * obs->shape.rows;
+    n_data_values = n_pixels * bands;
     data_bytes = n_data_values * sizeof(U16);
     if (full_header_bytes + data_bytes > size) {
         eos_logf(EOS_LOG_ERROR,
@@ -201,17 +289,62 @@ EosStatus _load_mise_v1(const void* data, const U64 size,
                  full_header_bytes + data_bytes, size);
         return EOS_MISE_LOAD_ERROR;
     }
-    memcpy(obs->data, 
-           const_byte_offset(data, full_header_bytes),
-           data_bytes);
-    for (i = 0; i < data_bytes / sizeof(U16) ; i++) {
-        correct_endianness_U16(EOS_BIG_ENDIAN, system, &(obs->data[i]));
+
+    if (state != NULL) {
+        if (reduced_bands > max_bands) {
+            eos_logf(EOS_LOG_ERROR, "At most %u MISE bands are supported.",
+                     max_bands);
+            return EOS_PARAM_ERROR;
+        }
+        status = mise_stream_begin(obs->shape.cols, reduced_bands, state);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    /* Decode a row at a time, so that the moments of each row are
+     * accumulated while it is still in cache */
+    row_bytes = (U64) obs->shape.cols * bands * sizeof(U16);
+    row_values = (U64) obs->shape.cols * reduced_bands;
+    kept = (reduction == NULL || reduction->n_selected_bands == 0) ?
+           bands : reduction->n_selected_bands;
+    for (row = 0; row < obs->shape.rows; row++) {
+        src = (const U8*) const_byte_offset(data, full_header_bytes
+                                                  + row * row_bytes);
+        dst = &(obs->data[row * row_values]);
+        if (reduction == NULL || (reduction->bin_factor == 1
+                                  && reduction->n_selected_bands == 0)) {
+            eos_decode_u16_be(row_values, src, dst);
+        } else {
+            /* Reduce the bands of each pixel as it is decoded, so only the
+             * reduced observation is ever written */
+            for (col = 0; col < obs->shape.cols; col++) {
+                _reduce_mise_pixel(&(src[col * bands * sizeof(U16)]),
+                                   reduction, kept, system,
+                                   &(dst[(U64) col * reduced_bands]));
+            }
+        }
+        if (state != NULL) {
+            status = mise_stream_push_rows(state, 1, dst);
+            if (status != EOS_SUCCESS) { return status; }
+        }
     }
 
     return EOS_SUCCESS;
 }
 
-EosStatus load_mise(const void* data, const U64 size, EosMiseObservation* obs) {
+/*
+ * Load a MISE observation, reducing its bands as given by reduction (NULL
+ * to keep all bands). The observation's data must hold rows * cols *
+ * reduced bands values (see mise_reduced_bands).
+ *
+ * If state is not NULL, the background moments of the observation are also
+ * accumulated into it (see mise_stream_begin) as each row is decoded, so RX
+ * can be finalized without another pass over the data. Its moments buffer
+ * must be sized for max_bands bands, at least the reduced bands.
+ */
+EosStatus load_mise_stream(const void* data, const U64 size,
+                           const EosMiseBandReduction* reduction,
+                           U32 max_bands, EosMiseObservation* obs,
+                           EosMiseStreamState* state) {
     U32 header_str_bytes;
     U32 padding_bytes;
     U32 header_start_bytes;
@@ -239,13 +372,24 @@ EosStatus load_mise(const void* data, const U64 size, EosMiseObservation* obs) {
 
     switch (version) {
         case 0x01:
-            return _load_mise_v1(data, size, obs, header_start_bytes);
+            return _load_mise_v1(data, size, reduction, max_bands, obs,
+                                 state, header_start_bytes);
         default:
             eos_logf(EOS_LOG_ERROR, "Unknown MISE version %d", version);
             return EOS_MISE_VERSION_ERROR;
     }
 }
 
+EosStatus load_mise_reduced(const void* data, const U64 size,
+                            const EosMiseBandReduction* reduction,
+                            EosMiseObservation* obs) {
+    return load_mise_stream(data, size, reduction, 0, obs, NULL);
+}
+
+EosStatus load_mise(const void* data, const U64 size, EosMiseObservation* obs) {
+    return load_mise_reduced(data, size, NULL, obs);
+}
+
 /******** PIMS ********/
 
 /* Reads in only NUM_MODES, MAX_BINS, and NUM_OBS from the file. */
@@ -24,6 +24,15 @@
 
 EosStatus load_etm(const void* data, const U64 size, EosEthemisObservation* obs);
 EosStatus load_mise(const void* data, const U64 size, EosMiseObservation* obs);
+EosStatus load_mise_reduced(const void* data, const U64 size,
+                            const EosMiseBandReduction* reduction,
+                            EosMiseObservation* obs);
+EosStatus load_mise_stream(const void* data, const U64 size,
+                           const EosMiseBandReduction* reduction,
+                           U32 max_bands, EosMiseObservation* obs,
+                           EosMiseStreamState* state);
+EosStatus mise_reduced_bands(U32 bands, const EosMiseBandReduction* reduction,
+                             U32* reduced_bands);
 EosStatus load_pims(const void* data, const U64 size, EosPimsObservationsFile* file);
 
 EosStatus read_pims_observation_attributes(const void* data, const U64 size, U32* num_modes, U32* max_bins, U32* num_obs);
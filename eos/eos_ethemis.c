@@ -3,19 +3,30 @@
 #include "eos_ethemis.h"
 #include "eos_heap.h"
 #include "eos_log.h"
+#include "eos_mask.h"
+#include "eos_score_map.h"
+#include "eos_util.h"
 
+/*
+ * Return the top n_results pixels of a band at or above the threshold. Only
+ * the valid pixels selected by the mask (NULL for all) are visited. If a
+ * score map is given (NULL for none), the value of every visited pixel is
+ * also written to it, whether or not it reaches the threshold.
+ */
 EosStatus eos_ethemis_detect_anomaly_band(const EosObsShape shape,
-        const U16* data, const U16 threshold,
-        U32* n_results, EosPixelDetection* results) {
+        const U16* data, const EosPixelMask* mask, const U16 threshold,
+        U32* n_results, EosPixelDetection* results, const EosScoreMap* map) {
 
     EosStatus status;
     EosPixelDetection det;
     EosDetectionHeap heap;
+    EosMaskRegion region;
+    U32 block, block_rows, block_end, row_start, row_end;
 
     if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
 
-    // If we are asked to compute 0 results, just return success
-    if (*n_results == 0) {
+    // If we are asked to compute 0 results (and no map), just return success
+    if (*n_results == 0 && map == NULL) {
         return EOS_SUCCESS;
     }
 
@@ -29,21 +40,44 @@ EosStatus eos_ethemis_detect_anomaly_band(const EosObsShape shape,
     // pointers aren't NULL (it's ok if they were NULL if either the
     // observation size or n_results were zero)
     if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(results != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
 
     // Initialize heap with results array
     heap.capacity = *n_results;
     heap.size = 0;
     heap.data = results;
 
-    for (det.row = 0; det.row < shape.rows; det.row++) {
-        for (det.col = 0; det.col < shape.cols; det.col++) {
-            det.score = data[det.row*shape.cols + det.col];
-            if (det.score >= (F64)threshold) {
-                status = detection_heap_push(&heap, det);
-                if (status != EOS_SUCCESS) { return status; }
+    // Visit the region of interest a block of score map rows at a time (a
+    // single block without a map)
+    region = eos_mask_region(mask, &shape);
+    block_rows = eos_score_map_block_rows(map, shape.rows);
+    for (block = 0; block < shape.rows; block = block_end) {
+        block_end = block + eos_umin(block_rows, shape.rows - block);
+        row_start = eos_umax(region.row_start, block);
+        row_end = eos_umin(region.row_end, block_end);
+        eos_score_map_clear(map, (U64) (block_end - block) * shape.cols);
+
+        for (det.row = row_start; det.row < row_end; det.row++) {
+            for (det.col = eos_mask_next(mask, shape.cols, det.row,
+                                         region.col_start, region.col_end);
+                    det.col < region.col_end;
+                    det.col = eos_mask_next(mask, shape.cols, det.row,
+                                            det.col + 1, region.col_end)) {
+                det.score = data[det.row*shape.cols + det.col];
+                eos_score_map_store(map,
+                    (U64) (det.row - block) * shape.cols + det.col,
+                    det.score);
+                if (det.score >= (F64)threshold) {
+                    status = detection_heap_push(&heap, det);
+                    if (status != EOS_SUCCESS) { return status; }
+                }
             }
         }
+
+        status = eos_score_map_emit(map, block, block_end - block);
+        if (status != EOS_SUCCESS) { return status; }
     }
 
     status = detection_heap_sort(&heap);
@@ -54,4 +88,3 @@ EosStatus eos_ethemis_detect_anomaly_band(const EosObsShape shape,
 
     return status;
 }
-
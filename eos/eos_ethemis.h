@@ -4,7 +4,7 @@
 #include "eos_types.h"
 
 EosStatus eos_ethemis_detect_anomaly_band(const EosObsShape shape,
-    const U16* data, const U16 threshold,
-    U32* n_results, EosPixelDetection* results);
+    const U16* data, const EosPixelMask* mask, const U16 threshold,
+    U32* n_results, EosPixelDetection* results, const EosScoreMap* map);
 
 #endif
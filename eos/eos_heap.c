@@ -1,6 +1,6 @@
 /*
  * Methods to support maintenance of a detection heap structure,
- * sorted so that the smallest score detection is always on top.
+ * sorted so that the lowest-ranked detection is always on top.
  * (Heap stores the top 'size' detections)
  */
 #include <stdlib.h>
@@ -8,6 +8,24 @@
 #include "eos_heap.h"
 #include "eos_log.h"
 
+/*
+ * Returns true if detection a ranks below detection b. Detections are
+ * ordered by score, and detections with equal scores are ordered so that the
+ * earlier pixel (in row-major order) ranks higher. Since this is a total
+ * order, the top detections kept by the heap do not depend on the order in
+ * which detections are pushed.
+ */
+static U32 _detection_less(const EosPixelDetection* a,
+                           const EosPixelDetection* b) {
+    if (a->score != b->score) {
+        return a->score < b->score;
+    }
+    if (a->row != b->row) {
+        return a->row > b->row;
+    }
+    return a->col > b->col;
+}
+
 /*
  * Bubbles the last element in a heap up to maintain the heap property
  */
@@ -23,7 +41,7 @@ EosStatus detection_heap_bubble_up(EosDetectionHeap* heap) {
     for (j = 0; j <= heap->capacity; j++) {
         if (i <= 0) { break; }
         parent = (i - 1) / 2;
-        if (heap->data[parent].score > heap->data[i].score) {
+        if (_detection_less(&heap->data[i], &heap->data[parent])) {
             EosPixelDetection tmp = heap->data[parent];
             heap->data[parent] = heap->data[i];
             heap->data[i] = tmp;
@@ -54,12 +72,11 @@ EosStatus detection_heap_sift_down(EosDetectionHeap* heap) {
         if ((2*i + 1) >= heap->size) { break; }
         child = 2*i + 1;
         swap = i;
-        if (heap->data[swap].score > heap->data[child].score) {
+        if (_detection_less(&heap->data[child], &heap->data[swap])) {
             swap = child;
         }
         if (((child + 1) < heap->size)
-            && (heap->data[swap].score >
-                heap->data[child +1].score)) {
+            && _detection_less(&heap->data[child + 1], &heap->data[swap])) {
             swap = child + 1;
         }
         if (swap == i) { break; }
@@ -82,8 +99,8 @@ EosStatus detection_heap_push(EosDetectionHeap* heap,
     if (heap->capacity == 0) { return EOS_SUCCESS; }
     if (heap->capacity == heap->size) {
         // Heap already full, either replace an element or ignore
-        if (det.score > heap->data[0].score) {
-            // score larger than that of smallest element, so swap and sift down
+        if (_detection_less(&heap->data[0], &det)) {
+            // ranks above the smallest element, so swap and sift down
             heap->data[0] = det;
             status = detection_heap_sift_down(heap);
             if (status != EOS_SUCCESS) { return status; }
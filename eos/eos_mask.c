@@ -0,0 +1,159 @@
+/*
+ * Methods to visit the valid pixels of an observation (see EosPixelMask).
+ * The valid bitmask is scanned a word at a time, so runs of 64 invalid pixels
+ * (e.g., space or limb pixels) are skipped with a single comparison.
+ */
+#include <stdlib.h>
+
+#include "eos_mask.h"
+#include "eos_log.h"
+#include "eos_util.h"
+
+/* Index of the lowest set bit of the nonzero word x */
+static U32 _ctz64(U64 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (U32) __builtin_ctzll(x);
+#else
+    U32 n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* Number of set bits in x */
+static U32 _popcount64(U64 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (U32) __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (U32) ((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/*
+ * Check that the region of interest of the mask lies within the observation
+ * (a NULL mask is always valid)
+ */
+EosStatus eos_mask_check(const EosPixelMask* mask, const EosObsShape* shape) {
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+    if (mask == NULL) { return EOS_SUCCESS; }
+
+    if (mask->row_start > shape->rows
+            || mask->rows > shape->rows - mask->row_start
+            || mask->col_start > shape->cols
+            || mask->cols > shape->cols - mask->col_start) {
+        eos_logf(EOS_LOG_ERROR,
+                 "Region of interest (%u + %u rows, %u + %u cols) is outside "
+                 "the %u x %u observation.",
+                 mask->row_start, mask->rows, mask->col_start, mask->cols,
+                 shape->rows, shape->cols);
+        return EOS_PARAM_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
+/* Region of interest of the mask (the whole observation for NULL) */
+EosMaskRegion eos_mask_region(const EosPixelMask* mask,
+                              const EosObsShape* shape) {
+    EosMaskRegion region;
+
+    region.row_start = 0;
+    region.row_end = shape->rows;
+    region.col_start = 0;
+    region.col_end = shape->cols;
+    if (mask == NULL) { return region; }
+
+    region.row_start = eos_umin(mask->row_start, shape->rows);
+    if (mask->rows > 0) {
+        region.row_end = eos_umin(region.row_start + mask->rows, shape->rows);
+    }
+    region.col_start = eos_umin(mask->col_start, shape->cols);
+    if (mask->cols > 0) {
+        region.col_end = eos_umin(region.col_start + mask->cols, shape->cols);
+    }
+    return region;
+}
+
+/* Whether some pixels within the region of interest may be invalid */
+U32 eos_mask_has_bitmask(const EosPixelMask* mask) {
+    return mask != NULL && mask->valid != NULL;
+}
+
+/*
+ * Column of the first valid pixel at or after col in the given row, or
+ * col_end if there is none before col_end
+ */
+U32 eos_mask_next(const EosPixelMask* mask, U32 cols, U32 row, U32 col,
+                  U32 col_end) {
+    const U64 row_offset = (U64) row * cols;
+    U64 p, end, word;
+
+    if (!eos_mask_has_bitmask(mask) || col >= col_end) {
+        return col;
+    }
+
+    p = row_offset + col;
+    end = row_offset + col_end;
+    while (p < end) {
+        word = mask->valid[p / 64] >> (p % 64);
+        if (word != 0) {
+            p += _ctz64(word);
+            return (p < end) ? (U32) (p - row_offset) : col_end;
+        }
+        p = (p / 64 + 1) * 64;
+    }
+    return col_end;
+}
+
+/* Number of set bits in [start, end) of the bitmask */
+static U64 _count_bits(const U64* valid, U64 start, U64 end) {
+    U64 count = 0;
+    U64 word, first, last;
+
+    if (start >= end) { return 0; }
+    first = start / 64;
+    last = (end - 1) / 64;
+
+    word = valid[first] & (~0ull << (start % 64));
+    for (; first < last; first++) {
+        count += _popcount64(word);
+        word = valid[first + 1];
+    }
+    if (end % 64 != 0) {
+        word &= ~0ull >> (64 - end % 64);
+    }
+    return count + _popcount64(word);
+}
+
+/* Number of valid pixels of the observation selected by the mask */
+U64 eos_mask_count(const EosPixelMask* mask, const EosObsShape* shape) {
+    const EosMaskRegion region = eos_mask_region(mask, shape);
+    U64 count = 0;
+    U32 row;
+
+    if (region.row_start >= region.row_end
+            || region.col_start >= region.col_end) {
+        return 0;
+    }
+    if (!eos_mask_has_bitmask(mask)) {
+        return (U64) (region.row_end - region.row_start)
+            * (region.col_end - region.col_start);
+    }
+
+    /* Full-width regions are contiguous in the bitmask */
+    if (region.col_start == 0 && region.col_end == shape->cols) {
+        return _count_bits(mask->valid, (U64) region.row_start * shape->cols,
+                           (U64) region.row_end * shape->cols);
+    }
+    for (row = region.row_start; row < region.row_end; row++) {
+        count += _count_bits(mask->valid,
+                             (U64) row * shape->cols + region.col_start,
+                             (U64) row * shape->cols + region.col_end);
+    }
+    return count;
+}
@@ -0,0 +1,25 @@
+#ifndef JPL_EOS_MASK
+#define JPL_EOS_MASK
+
+#include "eos_types.h"
+
+/*
+ * Region of interest of a mask, clipped to the observation: rows
+ * [row_start, row_end) and columns [col_start, col_end)
+ */
+typedef struct {
+    U32 row_start;
+    U32 row_end;
+    U32 col_start;
+    U32 col_end;
+} EosMaskRegion;
+
+EosStatus eos_mask_check(const EosPixelMask* mask, const EosObsShape* shape);
+EosMaskRegion eos_mask_region(const EosPixelMask* mask,
+                              const EosObsShape* shape);
+U32 eos_mask_has_bitmask(const EosPixelMask* mask);
+U32 eos_mask_next(const EosPixelMask* mask, U32 cols, U32 row, U32 col,
+                  U32 col_end);
+U64 eos_mask_count(const EosPixelMask* mask, const EosObsShape* shape);
+
+#endif
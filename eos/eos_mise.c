@@ -9,28 +9,78 @@
 #include "eos_types.h"
 #include "eos_util.h"
 #include "eos_log.h"
+#include "eos_thread.h"
+#include "eos_simd.h"
+#include "eos_mask.h"
+#include "eos_score_map.h"
+
+#if defined(__SSE2__) && !defined(EOS_NO_SIMD)
+#include <emmintrin.h>
+#define MISE_SSE2_MOMENTS
+#endif
+
+/* Element strides between rows, columns, and bands of an observation */
+typedef struct {
+    U64 row;
+    U64 col;
+    U64 band;
+} MiseStrides;
+
+/* Strides of an observation of the given shape stored in the given layout */
+static MiseStrides _mise_strides(const EosObsShape* shape,
+                                 EosMiseLayout layout) {
+    MiseStrides strides;
+
+    switch (layout) {
+        case EOS_MISE_BIL:
+            strides.row = (U64) shape->cols * shape->bands;
+            strides.col = 1;
+            strides.band = shape->cols;
+            break;
+        case EOS_MISE_BSQ:
+            strides.row = shape->cols;
+            strides.col = 1;
+            strides.band = (U64) shape->rows * shape->cols;
+            break;
+        default:
+            strides.row = (U64) shape->cols * shape->bands;
+            strides.col = shape->bands;
+            strides.band = 1;
+            break;
+    }
+    return strides;
+}
+
+/* Offset of the first band of the pixel with the given (row-major) index */
+static U64 _pixel_offset(const MiseStrides* strides, U32 cols, U64 pixel) {
+    return (pixel / cols) * strides->row + (pixel % cols) * strides->col;
+}
 
 /*
- * Given a BIP array of U16 data, compute the mean pixel and store in mp.
+ * Given an array of U16 data, compute the mean pixel and store in mp.
  * (If the input observation has zero size, the mean will contain all zeros.)
+ * Band-interleaved data is summed a pixel at a time, and BIL and BSQ data a
+ * band at a time over runs of contiguous pixels.
  *
- * :param data: pixel data in BIP format
+ * :param data: pixel data in the given layout
  * :param shape: pointer to observation shape struct
+ * :param layout: order of the bands of the data (see EosMiseLayout)
  * :param mp: array for storing pixel mean; must have pre-allocated space for
  *            at least shape->bands values
  *
  * :return: status indicating whether an error occurred
  */
 EosStatus compute_mean_pixel(const U16* data, const EosObsShape* shape,
-                             F64 mp[]) {
+                             EosMiseLayout layout, F64 mp[]) {
 
-    U32 i, b;
+    U32 i, b, row, col;
 
     if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(mp != NULL)) { return EOS_ASSERT_ERROR; }
 
     const U32 n_pixels = shape->rows * shape->cols;
+    const MiseStrides strides = _mise_strides(shape, layout);
 
     /* Initialize to zero */
     memset(mp, 0, sizeof(F64) * shape->bands);
@@ -40,10 +90,22 @@ EosStatus compute_mean_pixel(const U16* data, const EosObsShape* shape,
         return EOS_SUCCESS;
     }
 
-    for (i = 0; i < n_pixels; i++) {
-        const U16* next_pixel = &(data[i * shape->bands]); /* BIP format */
+    if (layout == EOS_MISE_BIP) {
+        for (i = 0; i < n_pixels; i++) {
+            const U16* next_pixel = &(data[i * shape->bands]);
+            for (b = 0; b < shape->bands; b++) {
+                mp[b] += next_pixel[b];
+            }
+        }
+    } else {
         for (b = 0; b < shape->bands; b++) {
-            mp[b] += next_pixel[b];
+            for (row = 0; row < shape->rows; row++) {
+                const U16* run = &(data[b * strides.band
+                                        + row * strides.row]);
+                for (col = 0; col < shape->cols; col++) {
+                    mp[b] += run[col];
+                }
+            }
         }
     }
     for (b = 0; b < shape->bands; b++) {
@@ -54,18 +116,19 @@ EosStatus compute_mean_pixel(const U16* data, const EosObsShape* shape,
 }
 
 /*
- * Given a BIP array of U16 data and its mean pixel, compute the sample
+ * Given an array of U16 data and its mean pixel, compute the sample
  * covariance matrix (with DOF=N-1) and store in cov.
  *
- * :param data: pixel data in BIP format
+ * :param data: pixel data in the given layout
  * :param shape: pointer to observation shape struct
+ * :param layout: order of the bands of the data (see EosMiseLayout)
  * :param mean_pixel: array containing the mean pixel value for each band
  * :param cov: destination of the covariance matrix
  *
  * :return: status indicating whether an error occurred
  */
 EosStatus compute_covariance(const U16* data, const EosObsShape* shape,
-                             F64 mean_pixel[], F64* cov) {
+                             EosMiseLayout layout, F64 mean_pixel[], F64* cov) {
 
     U32 i, b1, b2;
 
@@ -76,6 +139,7 @@ EosStatus compute_covariance(const U16* data, const EosObsShape* shape,
 
     const U32 n_pixels = shape->rows * shape->cols;
     const U32 cov_size = shape->bands * shape->bands;
+    const MiseStrides strides = _mise_strides(shape, layout);
     F64 mean_sub[shape->bands];   /* mean-subtracted pixel */
 
     if (n_pixels <= 1) {
@@ -87,9 +151,10 @@ EosStatus compute_covariance(const U16* data, const EosObsShape* shape,
     memset(cov, 0, sizeof(F64) * cov_size);
 
     for (i = 0; i < n_pixels; i++) {
-        const U16* next_pixel = &(data[i * shape->bands]); /* BIP format */
+        const U16* next_pixel =
+            &(data[_pixel_offset(&strides, shape->cols, i)]);
         for (b1 = 0; b1 < shape->bands; b1++) {
-            mean_sub[b1] = next_pixel[b1] - mean_pixel[b1];
+            mean_sub[b1] = next_pixel[b1 * strides.band] - mean_pixel[b1];
         }
         /* cov = 1/(n-1) * sum_i (x_i - mean x) (x_i - mean x)'
          * where x_i is a vector of b band observations */
@@ -107,6 +172,655 @@ EosStatus compute_covariance(const U16* data, const EosObsShape* shape,
     return EOS_SUCCESS;
 }
 
+/*
+ * Index of entry (i, j), i <= j, in a row-major packed upper triangle of an
+ * n x n symmetric matrix (row i holds entries j = i, ..., n - 1)
+ */
+static U32 _packed_index(U32 n, U32 i, U32 j) {
+    return i * (2*n - i + 1) / 2 + (j - i);
+}
+
+/*
+ * Offset of row i of a symmetric matrix stored densely or as a packed upper
+ * triangle (the layout of the packed second moments; see _packed_index),
+ * such that entry (i, j), i <= j, is A[_sym_row(n, packed, i) + j]. The
+ * Jacobi solver only touches the upper triangle, so it runs unchanged on
+ * either storage.
+ */
+static U64 _sym_row(U32 n, U32 packed, U32 i) {
+    if (packed) {
+        return (U64) i * (2 * (U64) n - i - 1) / 2;
+    }
+    return (U64) n * i;
+}
+
+/*
+ * Add the outer-product row xi * x[0..n-1] into the U64 accumulator row.
+ * With SSE2, eight U16 products are formed at a time with widening 16-bit
+ * multiplies (low and high halves) and then widened again to U64 lanes; the
+ * result is identical to the scalar loop.
+ */
+static void _moment_row_update(U64* row, U32 xi, const U16* x, U32 n) {
+    U32 j = 0;
+#ifdef MISE_SSE2_MOMENTS
+    const __m128i vxi = _mm_set1_epi16((I16) xi);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v, lo, hi, p0, p1;
+    __m128i* r;
+
+    for (; j + 8 <= n; j += 8) {
+        v = _mm_loadu_si128((const __m128i*) &(x[j]));
+        lo = _mm_mullo_epi16(v, vxi);
+        hi = _mm_mulhi_epu16(v, vxi);
+        p0 = _mm_unpacklo_epi16(lo, hi); /* four U32 products */
+        p1 = _mm_unpackhi_epi16(lo, hi);
+        r = (__m128i*) &(row[j]);
+        _mm_storeu_si128(r, _mm_add_epi64(
+            _mm_loadu_si128(r), _mm_unpacklo_epi32(p0, zero)));
+        _mm_storeu_si128(r + 1, _mm_add_epi64(
+            _mm_loadu_si128(r + 1), _mm_unpackhi_epi32(p0, zero)));
+        _mm_storeu_si128(r + 2, _mm_add_epi64(
+            _mm_loadu_si128(r + 2), _mm_unpacklo_epi32(p1, zero)));
+        _mm_storeu_si128(r + 3, _mm_add_epi64(
+            _mm_loadu_si128(r + 3), _mm_unpackhi_epi32(p1, zero)));
+    }
+#endif
+    /* The product of two U16 values fits in a U32 */
+    for (; j < n; j++) {
+        row[j] += xi * x[j];
+    }
+}
+
+/*
+ * Add the raw moments of n_pixels consecutive BIP pixels to sum and sum_sq.
+ * The pixels are processed in blocks that fit in cache, and each block is
+ * swept once per block of triangle rows so that the portion of sum_sq being
+ * updated stays resident while the pixel block is re-read from cache.
+ */
+static void _bip_moments_add(const U16* data, U64 n_pixels, U32 bands,
+                             U64* sum, U64* sum_sq) {
+    U64 p, p0, p1;
+    U32 i, i0, i1;
+
+    for (p0 = 0; p0 < n_pixels; p0 += MISE_MOMENT_PIXEL_BLOCK) {
+        p1 = (n_pixels - p0 < MISE_MOMENT_PIXEL_BLOCK) ?
+             n_pixels : p0 + MISE_MOMENT_PIXEL_BLOCK;
+
+        for (p = p0; p < p1; p++) {
+            const U16* next_pixel = &(data[p * bands]);
+            for (i = 0; i < bands; i++) {
+                sum[i] += next_pixel[i];
+            }
+        }
+
+        for (i0 = 0; i0 < bands; i0 += MISE_MOMENT_BAND_BLOCK) {
+            i1 = eos_umin(i0 + MISE_MOMENT_BAND_BLOCK, bands);
+            for (p = p0; p < p1; p++) {
+                const U16* next_pixel = &(data[p * bands]);
+                for (i = i0; i < i1; i++) {
+                    _moment_row_update(&(sum_sq[_packed_index(bands, i, i)]),
+                        next_pixel[i], &(next_pixel[i]), bands - i);
+                }
+            }
+        }
+    }
+}
+
+/* Subtract the raw moments of n_pixels consecutive BIP pixels */
+static void _bip_moments_remove(const U16* data, U64 n_pixels, U32 bands,
+                                U64* sum, U64* sum_sq) {
+    U64 p;
+    U32 i, j;
+    U64* row;
+
+    for (p = 0; p < n_pixels; p++) {
+        const U16* next_pixel = &(data[p * bands]);
+        for (i = 0; i < bands; i++) {
+            sum[i] -= next_pixel[i];
+            row = &(sum_sq[_packed_index(bands, i, i)]);
+            for (j = i; j < bands; j++) {
+                row[j - i] -= (U32) next_pixel[i] * next_pixel[j];
+            }
+        }
+    }
+}
+
+/*
+ * Add (or subtract) the raw moments of n consecutive pixels whose values in
+ * each band form a contiguous run, with runs band_stride apart (as in the
+ * BIL and BSQ layouts). Each moment is a dot product of two runs, summed
+ * exactly, so the result is identical to that of the BIP kernels.
+ */
+static void _moment_runs_update(const U16* data, U64 band_stride, U32 n,
+                                U32 bands, U32 add, U64* sum, U64* sum_sq) {
+    U32 i, j, p;
+    U64 total;
+    U64* row;
+
+    for (i = 0; i < bands; i++) {
+        const U16* x = &(data[i * band_stride]);
+        total = 0;
+        for (p = 0; p < n; p++) {
+            total += x[p];
+        }
+        sum[i] = add ? sum[i] + total : sum[i] - total;
+
+        row = &(sum_sq[_packed_index(bands, i, i)]);
+        for (j = i; j < bands; j++) {
+            const U16* y = &(data[j * band_stride]);
+            total = 0;
+            for (p = 0; p < n; p++) {
+                total += (U32) x[p] * y[p];
+            }
+            row[j - i] = add ? row[j - i] + total : row[j - i] - total;
+        }
+    }
+}
+
+/*
+ * Add (or subtract) the raw moments of the pixels in rows
+ * [row_start, row_end) of the observation. In the BIL and BSQ layouts, the
+ * pixels are taken a block of a run at a time, where a run is a row (BIL) or
+ * all of the rows (BSQ).
+ */
+static void _update_moments(const U16* data, const EosObsShape* shape,
+                            EosMiseLayout layout,
+                            U32 row_start, U32 row_end, U32 add,
+                            U64* sum, U64* sum_sq) {
+    const MiseStrides strides = _mise_strides(shape, layout);
+    const U32 bands = shape->bands;
+    U64 start, n, p;
+    U32 row, next;
+
+    if (layout == EOS_MISE_BIP) {
+        start = (U64) row_start * shape->cols * bands;
+        n = (U64) (row_end - row_start) * shape->cols;
+        if (add) {
+            _bip_moments_add(&(data[start]), n, bands, sum, sum_sq);
+        } else {
+            _bip_moments_remove(&(data[start]), n, bands, sum, sum_sq);
+        }
+        return;
+    }
+
+    for (row = row_start; row < row_end; row = next) {
+        next = (layout == EOS_MISE_BSQ) ? row_end : row + 1;
+        start = row * strides.row;
+        n = (U64) (next - row) * shape->cols;
+        for (p = 0; p < n; p += MISE_MOMENT_PIXEL_BLOCK) {
+            _moment_runs_update(&(data[start + p]), strides.band,
+                (U32) (n - p < MISE_MOMENT_PIXEL_BLOCK ?
+                       n - p : MISE_MOMENT_PIXEL_BLOCK),
+                bands, add, sum, sum_sq);
+        }
+    }
+}
+
+/*
+ * Given an array of U16 data, accumulate the raw first and second moments
+ * of the pixels in a single pass over the data:
+ *    sum[b] = sum_i x_i[b]
+ *    sum_sq[(b1, b2)] = sum_i x_i[b1] * x_i[b2], for b1 <= b2
+ * The second moments are stored as a row-major packed upper triangle with
+ * bands * (bands + 1) / 2 entries. The sums are exact integers, so the result
+ * does not depend on the order in which pixels are visited (or on the layout
+ * of the data).
+ *
+ * :param data: pixel data in the given layout
+ * :param shape: pointer to observation shape struct
+ * :param layout: order of the bands of the data (see EosMiseLayout)
+ * :param sum: destination for the band sums; at least shape->bands entries
+ * :param sum_sq: destination for the packed second moments
+ *
+ * :return: status indicating whether an error occurred
+ */
+EosStatus compute_moments(const U16* data, const EosObsShape* shape,
+                          EosMiseLayout layout, U64* sum, U64* sum_sq) {
+
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* Initialize to zero */
+    memset(sum, 0, sizeof(U64) * shape->bands);
+    memset(sum_sq, 0, sizeof(U64) * shape->bands * (shape->bands + 1) / 2);
+
+    return accumulate_moments(data, shape, layout, sum, sum_sq);
+}
+
+/*
+ * Add the raw moments of the pixels in data to sum and sum_sq, which hold the
+ * moments of previously seen pixels (see compute_moments). Since the sums are
+ * exact, accumulating an observation in any number of pieces gives the same
+ * moments as a single call to compute_moments.
+ */
+EosStatus accumulate_moments(const U16* data, const EosObsShape* shape,
+                             EosMiseLayout layout, U64* sum, U64* sum_sq) {
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+
+    _update_moments(data, shape, layout, 0, shape->rows, EOS_TRUE, sum, sum_sq);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Subtract the raw moments of the pixels in data from sum and sum_sq, which
+ * must include them (the inverse of accumulate_moments)
+ */
+EosStatus remove_moments(const U16* data, const EosObsShape* shape,
+                         EosMiseLayout layout, U64* sum, U64* sum_sq) {
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+
+    _update_moments(data, shape, layout, 0, shape->rows, EOS_FALSE, sum,
+                    sum_sq);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Convert moments to the mean pixel and the covariance stored densely or as a
+ * packed upper triangle (see moments_to_mean_covariance). Each packed entry
+ * is read before the covariance entry at the same position is written, so
+ * the packed covariance may overwrite sum_sq.
+ */
+static EosStatus _moments_to_mean_covariance(U64 n_pixels, U32 bands,
+                                             const U64* sum, const U64* sum_sq,
+                                             F64 mean_pixel[], F64* cov,
+                                             U32 packed) {
+
+    U32 b1, b2;
+    U64 a_hi, a_lo, b_hi, b_lo;
+    F64 denom;
+    F64 entry;
+
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(mean_pixel != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(cov != NULL)) { return EOS_ASSERT_ERROR; }
+
+    if (n_pixels <= 1) {
+        // Sample size not large enough to compute covariance
+        return EOS_VALUE_ERROR;
+    }
+
+    for (b1 = 0; b1 < bands; b1++) {
+        mean_pixel[b1] = (F64) sum[b1] / n_pixels;
+    }
+
+    /* cov = (n * sum_i x_i x_i' - (sum_i x_i) (sum_i x_i)') / (n * (n-1)) */
+    denom = (F64) (n_pixels * (n_pixels - 1));
+    for (b1 = 0; b1 < bands; b1++) {
+        const U64* row = &(sum_sq[_packed_index(bands, b1, b1)]);
+        F64* cov_row = &(cov[_sym_row(bands, packed, b1)]);
+        for (b2 = b1; b2 < bands; b2++) {
+            eos_umul128(n_pixels, row[b2 - b1], &a_hi, &a_lo);
+            eos_umul128(sum[b1], sum[b2], &b_hi, &b_lo);
+            entry = eos_u128_diff(a_hi, a_lo, b_hi, b_lo) / denom;
+            cov_row[b2] = entry;
+            if (!packed) {
+                cov[b2 * bands + b1] = entry;
+            }
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Convert raw moments accumulated over n_pixels pixels (see compute_moments)
+ * into the mean pixel and the full sample covariance matrix (with DOF=N-1).
+ *
+ * Each covariance entry is computed from the exact integer numerator
+ * N * sum(x_i x_j) - sum(x_i) * sum(x_j) (up to 96 bits wide), so there is no
+ * cancellation error and the only rounding happens in the final conversion
+ * to F64. Since the integer sums do not depend on the order of accumulation,
+ * the result is bit-for-bit reproducible however the moments were gathered.
+ *
+ * :param n_pixels: number of pixels over which moments were accumulated
+ * :param bands: number of bands
+ * :param sum: band sums
+ * :param sum_sq: packed second moments
+ * :param mean_pixel: destination for the mean pixel
+ * :param cov: destination of the (dense) covariance matrix
+ *
+ * :return: status indicating whether an error occurred
+ */
+EosStatus moments_to_mean_covariance(U64 n_pixels, U32 bands,
+                                     const U64* sum, const U64* sum_sq,
+                                     F64 mean_pixel[], F64* cov) {
+    return _moments_to_mean_covariance(n_pixels, bands, sum, sum_sq,
+                                       mean_pixel, cov, EOS_FALSE);
+}
+
+/*
+ * As moments_to_mean_covariance, with the covariance stored as a packed upper
+ * triangle of mise_packed_size(bands) entries in the layout of sum_sq. The
+ * covariance may be written over sum_sq (cov == (F64*) sum_sq), halving the
+ * storage of the background.
+ */
+EosStatus moments_to_mean_covariance_packed(U64 n_pixels, U32 bands,
+                                            const U64* sum, const U64* sum_sq,
+                                            F64 mean_pixel[], F64* cov) {
+    return _moments_to_mean_covariance(n_pixels, bands, sum, sum_sq,
+                                       mean_pixel, cov, EOS_TRUE);
+}
+
+/*
+ * Number of entries in the packed upper triangle of a symmetric
+ * bands x bands matrix
+ */
+U64 mise_packed_size(U32 bands) {
+    return (U64) bands * (bands + 1) / 2;
+}
+
+/*
+ * Number of U64 values needed to hold the band sums and packed second
+ * moments accumulated by compute_moments
+ */
+U64 mise_moments_size(U32 bands) {
+    return (U64) bands + (U64) bands * (bands + 1) / 2;
+}
+
+/*
+ * Number of U16 values in the buffer that each worker gathers sampled pixels
+ * into (see compute_moments_sampled)
+ */
+U64 mise_sample_gather_size(U32 bands) {
+    return (U64) MISE_MOMENT_PIXEL_BLOCK * bands;
+}
+
+/*
+ * Whether the pixel at (row, col) of an observation with cols columns is in
+ * the background sample. The decision depends only on the pixel's position,
+ * so the sample does not depend on how the rows are split across workers.
+ * The pseudo-random sample hashes the pixel index with the seed (the
+ * SplitMix64 finalizer), so it is reproducible without any generator state.
+ */
+static U32 _pixel_sampled(const MiseSampling* sampling, U32 row, U32 col,
+                          U32 cols) {
+    U64 x;
+
+    switch (sampling->mode) {
+        case EOS_MISE_SAMPLE_STRIDE:
+            return ((U64) row * cols + col) % sampling->step == 0;
+        case EOS_MISE_SAMPLE_GRID:
+            return (row % sampling->step == 0) && (col % sampling->step == 0);
+        case EOS_MISE_SAMPLE_RANDOM:
+            x = ((U64) row * cols + col)
+                + 0x9E3779B97F4A7C15ull * ((U64) sampling->seed + 1);
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            x ^= x >> 31;
+            return x % sampling->step == 0;
+        default:
+            return EOS_TRUE;
+    }
+}
+
+/* Whether only a sample of the pixels is used for the background */
+static U32 _is_sampled(const MiseSampling* sampling) {
+    return sampling != NULL && sampling->mode != EOS_MISE_SAMPLE_ALL;
+}
+
+/* Whether the background pixels are gathered (see _sampled_moments) rather
+ * than read in place */
+static U32 _is_gathered(const MiseSampling* sampling,
+                        const EosPixelMask* mask) {
+    return _is_sampled(sampling) || mask != NULL;
+}
+
+/* Shared state for workers accumulating moments in parallel */
+typedef struct {
+    const U16* data;
+    EosObsShape shape;
+    EosMiseLayout layout;
+    const EosPixelMask* mask;       /* NULL for all pixels */
+    EosMaskRegion region;
+    U32 n_workers;
+    U32 stride;
+    const MiseSampling* sampling;   /* NULL for all pixels */
+    U64* sum[EOS_MAX_WORKERS];
+    U64* sum_sq[EOS_MAX_WORKERS];
+    U16* gather[EOS_MAX_WORKERS];
+    U64 n_sampled[EOS_MAX_WORKERS];
+} MiseMomentsJob;
+
+/*
+ * Accumulate the moments of the valid (see EosPixelMask) and sampled pixels
+ * of rows [row_start, row_end), gathering them a block at a time so that the
+ * blocked accumulation of accumulate_moments can be used. Gathering costs
+ * O(bands) per pixel, against O(bands^2) to accumulate it.
+ */
+static EosStatus _sampled_moments(const MiseMomentsJob* job, U32 row_start,
+                                  U32 row_end, U16* gather, U64* sum,
+                                  U64* sum_sq, U64* n_sampled) {
+    EosStatus status;
+    EosObsShape block = {1, 0, job->shape.bands};
+    const MiseStrides strides = _mise_strides(&(job->shape), job->layout);
+    const U32 bands = job->shape.bands;
+    const U16* pixel;
+    U16* gathered;
+    U32 row, col, b;
+
+    memset(sum, 0, sizeof(U64) * bands);
+    memset(sum_sq, 0, sizeof(U64) * bands * (bands + 1) / 2);
+    *n_sampled = 0;
+
+    for (row = row_start; row < row_end; row++) {
+        for (col = eos_mask_next(job->mask, job->shape.cols, row,
+                                 job->region.col_start, job->region.col_end);
+                col < job->region.col_end;
+                col = eos_mask_next(job->mask, job->shape.cols, row, col + 1,
+                                    job->region.col_end)) {
+            if (_is_sampled(job->sampling)
+                    && !_pixel_sampled(job->sampling, row, col,
+                                       job->shape.cols)) {
+                continue;
+            }
+            /* Pixels are gathered in BIP order whatever the layout */
+            pixel = &(job->data[row * strides.row + col * strides.col]);
+            gathered = &(gather[(U64) block.cols * bands]);
+            if (strides.band == 1) {
+                memcpy(gathered, pixel, sizeof(U16) * bands);
+            } else {
+                for (b = 0; b < bands; b++) {
+                    gathered[b] = pixel[b * strides.band];
+                }
+            }
+            block.cols++;
+            if (block.cols == MISE_MOMENT_PIXEL_BLOCK) {
+                status = accumulate_moments(gather, &block, EOS_MISE_BIP, sum,
+                                            sum_sq);
+                if (status != EOS_SUCCESS) { return status; }
+                *n_sampled += block.cols;
+                block.cols = 0;
+            }
+        }
+    }
+    if (block.cols > 0) {
+        status = accumulate_moments(gather, &block, EOS_MISE_BIP, sum, sum_sq);
+        if (status != EOS_SUCCESS) { return status; }
+        *n_sampled += block.cols;
+    }
+    return EOS_SUCCESS;
+}
+
+/* Accumulate the moments of (the selected pixels of) one slab of rows of the
+ * region of interest */
+static EosStatus _moments_worker(void* context, U32 worker) {
+    MiseMomentsJob* job = (MiseMomentsJob*) context;
+    const U32 bands = job->shape.bands;
+    const U32 rows = job->region.row_end - job->region.row_start;
+    U32 row_start, row_end;
+
+    row_start = job->region.row_start
+        + (U32) (((U64) worker * rows) / job->n_workers);
+    row_end = job->region.row_start
+        + (U32) (((U64) (worker + 1) * rows) / job->n_workers);
+
+    if (_is_gathered(job->sampling, job->mask)) {
+        return _sampled_moments(job, row_start, row_end, job->gather[worker],
+                                job->sum[worker], job->sum_sq[worker],
+                                &(job->n_sampled[worker]));
+    }
+    job->n_sampled[worker] = (U64) (row_end - row_start) * job->shape.cols;
+    memset(job->sum[worker], 0, sizeof(U64) * bands);
+    memset(job->sum_sq[worker], 0, sizeof(U64) * mise_packed_size(bands));
+    _update_moments(job->data, &(job->shape), job->layout, row_start, row_end,
+                    EOS_TRUE, job->sum[worker], job->sum_sq[worker]);
+    return EOS_SUCCESS;
+}
+
+/* Add the partial moments of worker (2 * stride * pair + stride) into those
+ * of worker (2 * stride * pair) */
+static EosStatus _moments_reduce_worker(void* context, U32 pair) {
+    MiseMomentsJob* job = (MiseMomentsJob*) context;
+    const U32 dst = 2 * job->stride * pair;
+    const U32 src = dst + job->stride;
+    const U32 bands = job->shape.bands;
+    U64 i;
+
+    for (i = 0; i < bands; i++) {
+        job->sum[dst][i] += job->sum[src][i];
+    }
+    for (i = 0; i < (U64) bands * (bands + 1) / 2; i++) {
+        job->sum_sq[dst][i] += job->sum_sq[src][i];
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Run the moments workers of job and combine their partial moments with a
+ * pairwise tree reduction (also split across workers) into those of worker 0
+ */
+static EosStatus _run_moments_job(MiseMomentsJob* job) {
+    EosStatus status;
+    U32 w;
+
+    status = eos_run_workers(job->n_workers, _moments_worker, job);
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* Each level of the tree halves the number of partial results; the
+     * level with the given stride combines ceil((n - stride) / (2 stride))
+     * pairs of partial results */
+    for (job->stride = 1; job->stride < job->n_workers; job->stride *= 2) {
+        status = eos_run_workers(
+            (job->n_workers + job->stride - 1) / (2 * job->stride),
+            _moments_reduce_worker, job
+        );
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    for (w = 1; w < job->n_workers; w++) {
+        job->n_sampled[0] += job->n_sampled[w];
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Accumulate the same moments as compute_moments using n_workers workers.
+ * The rows of the observation are split into contiguous slabs, and each
+ * worker accumulates partial moments over its slab in its own region: worker
+ * 0 uses sum and sum_sq directly, and worker w > 0 uses region w - 1 of
+ * scratch. The partial moments are then combined with a pairwise tree
+ * reduction (also split across workers) into sum and sum_sq.
+ *
+ * Because the partial sums are exact integers, the result is identical to
+ * that of compute_moments for any number of workers.
+ *
+ * :param data: pixel data in the given layout
+ * :param shape: pointer to observation shape struct
+ * :param layout: order of the bands of the data (see EosMiseLayout)
+ * :param n_workers: number of workers (1 to EOS_MAX_WORKERS)
+ * :param scratch: space for (n_workers - 1) * mise_moments_size(bands)
+ *                 values; may be NULL if n_workers is 1
+ * :param sum: destination for the band sums
+ * :param sum_sq: destination for the packed second moments
+ *
+ * :return: status indicating whether an error occurred
+ */
+EosStatus compute_moments_parallel(const U16* data, const EosObsShape* shape,
+                                   EosMiseLayout layout,
+                                   U32 n_workers, U64* scratch,
+                                   U64* sum, U64* sum_sq) {
+    U64 n_sampled;
+    return compute_moments_sampled(data, shape, layout, NULL, NULL, n_workers,
+                                   scratch, NULL, sum, sum_sq, &n_sampled);
+}
+
+/*
+ * Accumulate the moments of a sample of the valid pixels (see EosPixelMask
+ * and _pixel_sampled) using n_workers workers, as compute_moments_parallel
+ * does for all pixels. Each worker gathers its selected pixels into its own
+ * region of gather before accumulating them. The number of pixels in the
+ * sample is returned in n_sampled.
+ *
+ * :param mask: the pixels to use; NULL for all pixels
+ * :param sampling: the background sample of those pixels; NULL (or
+ *                  EOS_MISE_SAMPLE_ALL) for all of them
+ * :param gather: space for n_workers * mise_sample_gather_size(bands)
+ *                values; may be NULL if all pixels are used
+ *
+ * The other parameters are those of compute_moments_parallel.
+ */
+EosStatus compute_moments_sampled(const U16* data, const EosObsShape* shape,
+                                  EosMiseLayout layout,
+                                  const EosPixelMask* mask,
+                                  const MiseSampling* sampling,
+                                  U32 n_workers, U64* scratch, U16* gather,
+                                  U64* sum, U64* sum_sq, U64* n_sampled) {
+
+    EosStatus status;
+    MiseMomentsJob job;
+    U32 w;
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_sampled != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers == 1 || scratch != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (_is_gathered(sampling, mask)) {
+        if (eos_assert(gather != NULL)) { return EOS_ASSERT_ERROR; }
+    }
+    if (_is_sampled(sampling)) {
+        if (eos_assert(sampling->step > 0)) { return EOS_ASSERT_ERROR; }
+    }
+
+    job.data = data;
+    job.layout = layout;
+    job.shape = *shape;
+    job.mask = mask;
+    job.region = eos_mask_region(mask, shape);
+    job.n_workers = n_workers;
+    job.sampling = sampling;
+    job.sum[0] = sum;
+    job.sum_sq[0] = sum_sq;
+    for (w = 1; w < n_workers; w++) {
+        job.sum[w] = &(scratch[(w - 1) * mise_moments_size(shape->bands)]);
+        job.sum_sq[w] = job.sum[w] + shape->bands;
+    }
+    for (w = 0; w < n_workers; w++) {
+        job.gather[w] = (gather == NULL) ? NULL :
+            &(gather[w * mise_sample_gather_size(shape->bands)]);
+    }
+
+    status = _run_moments_job(&job);
+    if (status != EOS_SUCCESS) { return status; }
+    *n_sampled = job.n_sampled[0];
+    return EOS_SUCCESS;
+}
+
 /***********************************************************
  * Methods to support matrix inversion were borrowed from
  * or inspired by VPT:
@@ -125,24 +839,29 @@ EosStatus _rotate_F64(F64 *a, F64 *b, F64 c, F64 d) {
     return EOS_SUCCESS;
 }
 
-EosStatus _eigen_rotate(U32 n, F64* A, F64* V, U32 k, U32 l, F64 c, F64 s) {
+EosStatus _eigen_rotate(U32 n, U32 packed, F64* A, F64* V, U32 k, U32 l,
+                        F64 c, F64 s) {
     EosStatus status;
     U32 i;
+    const U64 row_k = _sym_row(n, packed, k);
+    const U64 row_l = _sym_row(n, packed, l);
 
     if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(V != NULL)) { return EOS_ASSERT_ERROR; }
 
     // rotate rows and columns k and l
     for (i = 0; i < k; i++) {
-        status = _rotate_F64(&A[n*i+k], &A[n*i+l], c, s);
+        status = _rotate_F64(&A[_sym_row(n, packed, i) + k],
+                             &A[_sym_row(n, packed, i) + l], c, s);
         if (status != EOS_SUCCESS) { return status; }
     }
     for (i = k+1; i < l; i++) {
-        status = _rotate_F64(&A[n*k+i], &A[n*i+l], c, s);
+        status = _rotate_F64(&A[row_k + i], &A[_sym_row(n, packed, i) + l],
+                             c, s);
         if (status != EOS_SUCCESS) { return status; }
     }
     for (i = l+1; i < n; i++) {
-        status = _rotate_F64(&A[n*k+i], &A[n*l+i], c, s);
+        status = _rotate_F64(&A[row_k + i], &A[row_l + i], c, s);
         if (status != EOS_SUCCESS) { return status; }
     }
 
@@ -154,11 +873,13 @@ EosStatus _eigen_rotate(U32 n, F64* A, F64* V, U32 k, U32 l, F64 c, F64 s) {
     return EOS_SUCCESS;
 }
 
-EosStatus _eigen_maxind(U32 n, F64* A, U32 idx, U32* row_index, U32* col_index) {
+EosStatus _eigen_maxind(U32 n, U32 packed, F64* A, U32 idx, U32* row_index,
+                        U32* col_index) {
     U32 m;
     U32 i;
     F64 mv;
     F64 val;
+    const U64 row = _sym_row(n, packed, idx);
 
     if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
     if (eos_assert(row_index != NULL)) { return EOS_ASSERT_ERROR; }
@@ -166,9 +887,9 @@ EosStatus _eigen_maxind(U32 n, F64* A, U32 idx, U32* row_index, U32* col_index)
 
     if (idx < n - 1) {
         m = idx+1;
-        mv = fabs(A[n*idx + m]);
+        mv = fabs(A[row + m]);
         for (i = idx+2; i < n; i++) {
-            val = fabs(A[n*idx+i]);
+            val = fabs(A[row + i]);
             if (mv < val) {
                 mv = val, m = i;
             }
@@ -179,7 +900,7 @@ EosStatus _eigen_maxind(U32 n, F64* A, U32 idx, U32* row_index, U32* col_index)
         m = 0;
         mv = fabs(A[idx]);
         for (i = 1; i < idx; i++) {
-            val = fabs(A[n*i+idx]);
+            val = fabs(A[_sym_row(n, packed, i) + idx]);
             if (mv < val) {
                 mv = val, m = i;
             }
@@ -207,12 +928,11 @@ EosStatus _eigen_pivot(F64 p, F64 y, F64* c, F64* s, F64* t) {
 }
 
 /*
- * Find eigenvalues/vectors of matrix A,
- * assuming A is symmetric and square.
- * Eigenvalues are stored in w and eigenvectors are in the rows of V.
- * The buf array should have size at least 2*n.
+ * Jacobi eigensolver for a symmetric matrix stored densely or as a packed
+ * upper triangle (see get_eigen_symm)
  */
-EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
+static EosStatus _eigen_symm_jacobi(U32 n, U32 packed, F64* A, F64* w,
+                                    F64* V, U32* buf) {
     EosStatus status;
     U32 i, k, l;
     U32 iters;
@@ -237,8 +957,8 @@ EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
     col_index = row_index + n;
 
     for (k = 0; k < n; k++) {
-        w[k] = A[(n + 1)*k]; /* diagonal */
-        status = _eigen_maxind(n, A, k, row_index, col_index);
+        w[k] = A[_sym_row(n, packed, k) + k]; /* diagonal */
+        status = _eigen_maxind(n, packed, A, k, row_index, col_index);
         if (status != EOS_SUCCESS) { return status; }
     }
 
@@ -251,7 +971,7 @@ EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
         k = 0;
         mv = fabs(A[row_index[0]]);
         for (i = 1; i < n-1; i++) {
-            val = fabs(A[n*i + row_index[i]]);
+            val = fabs(A[_sym_row(n, packed, i) + row_index[i]]);
             if (mv < val) {
                 mv = val;
                 k = i;
@@ -259,7 +979,7 @@ EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
         }
         l = row_index[k];
         for (i = 1; i < n; i++) {
-            val = fabs(A[n*col_index[i] + i]);
+            val = fabs(A[_sym_row(n, packed, col_index[i]) + i]);
             if (mv < val) {
                 mv = val;
                 k = col_index[i];
@@ -267,147 +987,4528 @@ EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
             }
         }
 
-        p = A[n*k + l];
+        p = A[_sym_row(n, packed, k) + l];
         if (fabs(p) <= DBL_EPSILON) { break; }
         y = 0.5*(w[l] - w[k]);
 
         status = _eigen_pivot(p, y, &c, &s, &t);
         if (status != EOS_SUCCESS) { return status; }
 
-        A[n*k + l] = 0;
+        A[_sym_row(n, packed, k) + l] = 0;
 
         w[k] -= t;
         w[l] += t;
 
-        status = _eigen_rotate(n, A, V, k, l, c, s);
+        status = _eigen_rotate(n, packed, A, V, k, l, c, s);
         if (status != EOS_SUCCESS) { return status; }
 
-        status = _eigen_maxind(n, A, k, row_index, col_index);
+        status = _eigen_maxind(n, packed, A, k, row_index, col_index);
         if (status != EOS_SUCCESS) { return status; }
-        status = _eigen_maxind(n, A, l, row_index, col_index);
+        status = _eigen_maxind(n, packed, A, l, row_index, col_index);
         if (status != EOS_SUCCESS) { return status; }
     }
 
     return EOS_SUCCESS;
 }
 
-
-/* This matrix inversion method was inspired by the VPT method
- * for inverting a symmetric matrix:
-https://github-fn.jpl.nasa.gov/COSMIC/COSMIC_VPT/blob/ed73b4cc919d1953fe8c5563703d0bea08718d41/vpt/vpt_homography.c#L227-L266
-*/
-EosStatus invert_sym_matrix(U32 n, F64* A, F64* A_inv) {
+/*
+ * Reduce the symmetric matrix in W to tridiagonal form by Householder
+ * reflections (the EISPACK tred2 method), leaving the diagonal in d, the
+ * subdiagonal in e[1..n) (e[0] = 0), and the accumulated reflections in the
+ * rows of W. W is stored transposed with respect to tred2, so that every
+ * inner loop runs along a row.
+ */
+static void _eigen_tridiagonalize(U32 n, F64* W, F64* d, F64* e) {
     U32 i, j, k;
-    F64 Ac[n*n];
-    F64 V[n*n];
-    F64 w[n];
-    U32 iptr[2*n];
-    F64 threshold;
-    EosStatus status;
-
-    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(A_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    F64 scale, f, g, h, hh;
+    F64* row;
 
-    /* Make a copy because get_eigen_symm is destructive */
-    memcpy(Ac, A, sizeof(F64)*n*n);
-
-    /* find eigenvalues of a symmetric matrix and populate
-     * w (eigenvalues) and V (eigenvectors) */
-    status = get_eigen_symm(n, Ac, w, V, iptr);
-    if (status != EOS_SUCCESS) { return status; }
-
-    threshold = 2*DBL_EPSILON*fabs(eos_dsum(n, w));
-    memset(A_inv, 0, sizeof(F64)*n*n);
+    for (j = 0; j < n; j++) {
+        d[j] = W[(U64) j * n + n - 1];
+    }
 
-    // Ainv = v * inv(w) * vT
-    for (i = 0; i < n; i++) {
-        if (fabs(w[i]) <= threshold) {
-            continue;
+    for (i = n - 1; i > 0; i--) {
+        scale = 0.0;
+        h = 0.0;
+        for (k = 0; k < i; k++) {
+            scale += fabs(d[k]);
         }
-
-        for (j = 0; j < n; j++) {
-            for (k = 0; k < n; k++) {
-                A_inv[j*n + k] += V[n*i + j] * V[i*n + k] / w[i];
+        if (scale != 0.0) {
+            for (k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
             }
         }
-    }
+        if (scale == 0.0 || h == 0.0) {
+            /* Row i is already reduced: skip the Householder update */
+            e[i] = scale * d[i - 1];
+            for (j = 0; j < i; j++) {
+                d[j] = W[(U64) j * n + i - 1];
+                W[(U64) j * n + i] = 0.0;
+                W[(U64) i * n + j] = 0.0;
+            }
+        } else {
+            /* Householder vector of row i */
+            f = d[i - 1];
+            g = sqrt(h);
+            if (f > 0) { g = -g; }
+            e[i] = scale * g;
+            h = h - f * g;
+            d[i - 1] = f - g;
+            memset(e, 0, sizeof(F64) * i);
 
+            /* Apply the similarity transformation to the remaining rows */
+            for (j = 0; j < i; j++) {
+                row = &(W[(U64) j * n]);
+                f = d[j];
+                W[(U64) i * n + j] = f;
+                g = e[j] + row[j] * f;
+                for (k = j + 1; k < i; k++) {
+                    g += row[k] * d[k];
+                    e[k] += row[k] * f;
+                }
+                e[j] = g;
+            }
+            f = 0.0;
+            for (j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            hh = f / (h + h);
+            for (j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+            for (j = 0; j < i; j++) {
+                row = &(W[(U64) j * n]);
+                f = d[j];
+                g = e[j];
+                for (k = j; k < i; k++) {
+                    row[k] -= (f * e[k] + g * d[k]);
+                }
+                d[j] = row[i - 1];
+                row[i] = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    /* Accumulate the transformations */
+    for (i = 0; i + 1 < n; i++) {
+        W[(U64) i * n + n - 1] = W[(U64) i * n + i];
+        W[(U64) i * n + i] = 1.0;
+        h = d[i + 1];
+        if (h != 0.0) {
+            row = &(W[(U64) (i + 1) * n]);
+            for (k = 0; k <= i; k++) {
+                d[k] = row[k] / h;
+            }
+            for (j = 0; j <= i; j++) {
+                g = 0.0;
+                for (k = 0; k <= i; k++) {
+                    g += row[k] * W[(U64) j * n + k];
+                }
+                for (k = 0; k <= i; k++) {
+                    W[(U64) j * n + k] -= g * d[k];
+                }
+            }
+        }
+        memset(&(W[(U64) (i + 1) * n]), 0, sizeof(F64) * (i + 1));
+    }
+    for (j = 0; j < n; j++) {
+        d[j] = W[(U64) j * n + n - 1];
+        W[(U64) j * n + n - 1] = 0.0;
+    }
+    W[(U64) n * n - 1] = 1.0;
+    e[0] = 0.0;
+}
+
+/*
+ * Diagonalize the tridiagonal matrix from _eigen_tridiagonalize by the QL
+ * method with implicit shifts (the EISPACK tql2 method), rotating the rows
+ * of W along, so that d holds the eigenvalues and the rows of W the
+ * eigenvectors. Each eigenvalue takes at most MISE_EIGEN_QL_MAX_ITERATIONS
+ * iterations (usually two or three); past that, the last iterate is kept.
+ */
+static void _eigen_tridiagonal_ql(U32 n, F64* W, F64* d, F64* e) {
+    U32 i, k, l, m, iters;
+    F64 f = 0.0, tst1 = 0.0;
+    F64 g, h, p, r, c, c2, c3, s, s2, el1, dl1, w_i, w_i1;
+    F64 *row_i, *row_i1;
+
+    for (i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.0;
+
+    for (l = 0; l < n; l++) {
+        /* Find a small subdiagonal entry */
+        if (tst1 < fabs(d[l]) + fabs(e[l])) {
+            tst1 = fabs(d[l]) + fabs(e[l]);
+        }
+        m = l;
+        while (m < n - 1 && fabs(e[m]) > DBL_EPSILON * tst1) {
+            m++;
+        }
+
+        /* If m == l, d[l] is already an eigenvalue; otherwise iterate */
+        for (iters = 0; m > l && e[l] != 0.0
+                && fabs(e[l]) > DBL_EPSILON * tst1
+                && iters < MISE_EIGEN_QL_MAX_ITERATIONS; iters++) {
+            /* Compute the implicit shift */
+            g = d[l];
+            p = (d[l + 1] - g) / (2.0 * e[l]);
+            r = eos_hypot(p, 1.0);
+            if (p < 0) { r = -r; }
+            d[l] = e[l] / (p + r);
+            d[l + 1] = e[l] * (p + r);
+            dl1 = d[l + 1];
+            h = g - d[l];
+            for (i = l + 2; i < n; i++) {
+                d[i] -= h;
+            }
+            f += h;
+
+            /* Implicit QL transformation */
+            p = d[m];
+            c = 1.0;
+            c2 = c;
+            c3 = c;
+            el1 = e[l + 1];
+            s = 0.0;
+            s2 = 0.0;
+            for (i = m; i-- > l; ) {
+                c3 = c2;
+                c2 = c;
+                s2 = s;
+                g = c * e[i];
+                h = c * p;
+                r = eos_hypot(p, e[i]);
+                if (r == 0.0) {
+                    /* The rotation underflowed: split the matrix here */
+                    d[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                e[i + 1] = s * r;
+                s = e[i] / r;
+                c = p / r;
+                p = c * d[i] - s * g;
+                d[i + 1] = h + s * (c * g + s * d[i]);
+
+                /* Accumulate the rotation into the eigenvectors */
+                row_i = &(W[(U64) i * n]);
+                row_i1 = row_i + n;
+                for (k = 0; k < n; k++) {
+                    w_i = row_i[k];
+                    w_i1 = row_i1[k];
+                    row_i1[k] = s * w_i + c * w_i1;
+                    row_i[k] = c * w_i - s * w_i1;
+                }
+            }
+            if (r == 0.0) { continue; }
+            p = -s * s2 * c3 * el1 * e[l] / dl1;
+            e[l] = s * p;
+            d[l] = c * p;
+        }
+        d[l] = d[l] + f;
+        e[l] = 0.0;
+    }
+}
+
+/*
+ * Eigensolver for a symmetric matrix stored densely or as a packed upper
+ * triangle (see get_eigen_symm) by Householder tridiagonalization and
+ * implicit QL. The matrix is expanded into V, where the eigenvectors are
+ * formed, and A (which is destroyed anyway) holds the subdiagonal. Unlike
+ * the Jacobi method, the cost does not depend on how the matrix converges:
+ * about 4/3 n^3 for the reduction and 3 n^3 for the QL iterations.
+ */
+static EosStatus _eigen_symm_ql(U32 n, U32 packed, F64* A, F64* w,
+                                F64* V) {
+    U32 i, j;
+
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(w != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(V != NULL)) { return EOS_ASSERT_ERROR; }
+
+    if (n == 0) { return EOS_SUCCESS; }
+
+    for (i = 0; i < n; i++) {
+        for (j = i; j < n; j++) {
+            V[(U64) i * n + j] = A[_sym_row(n, packed, i) + j];
+            V[(U64) j * n + i] = V[(U64) i * n + j];
+        }
+    }
+    _eigen_tridiagonalize(n, V, w, A);
+    _eigen_tridiagonal_ql(n, V, w, A);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Eigensolver behind get_eigen_symm: Householder tridiagonalization and
+ * implicit QL by default, or the Jacobi method if built with
+ * MISE_EIGEN=JACOBI
+ */
+static EosStatus _eigen_symm(U32 n, U32 packed, F64* A, F64* w, F64* V,
+                             U32* buf) {
+#ifdef EOS_MISE_JACOBI
+    return _eigen_symm_jacobi(n, packed, A, w, V, buf);
+#else
+    (void) buf;
+    return _eigen_symm_ql(n, packed, A, w, V);
+#endif
+}
+
+/*
+ * Find eigenvalues/vectors of matrix A,
+ * assuming A is symmetric and square.
+ * Eigenvalues are stored in w and eigenvectors are in the rows of V.
+ * The buf array should have size at least 2*n.
+ * A is destroyed, and the eigenvalues are in no particular order.
+ */
+EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf) {
+    return _eigen_symm(n, EOS_FALSE, A, w, V, buf);
+}
+
+/* As get_eigen_symm, always with the Jacobi method */
+EosStatus get_eigen_symm_jacobi(U32 n, F64* A, F64* w, F64* V, U32* buf) {
+    return _eigen_symm_jacobi(n, EOS_FALSE, A, w, V, buf);
+}
+
+/* As get_eigen_symm, always with tridiagonalization and QL (no buf) */
+EosStatus get_eigen_symm_ql(U32 n, F64* A, F64* w, F64* V) {
+    return _eigen_symm_ql(n, EOS_FALSE, A, w, V);
+}
+
+/*
+ * As get_eigen_symm, for a matrix stored as a packed upper triangle (see
+ * mise_packed_size), which is destroyed
+ */
+EosStatus get_eigen_symm_packed(U32 n, F64* A, F64* w, F64* V, U32* buf) {
+    return _eigen_symm(n, EOS_TRUE, A, w, V, buf);
+}
+
+/*
+ * Form the pseudo-inverse V' inv(w) V from the eigenvalues w and the
+ * eigenvectors (rows of V), dropping eigenvalues at or below the threshold
+ * 2 * eps * |trace|, into A_inv stored densely or as a packed upper triangle
+ */
+static void _pseudo_inverse(U32 n, U32 packed, const F64* V, F64* w,
+                            F64* A_inv) {
+    U32 i, j, k;
+    F64 threshold;
+    F64* row;
+
+    threshold = 2*DBL_EPSILON*fabs(eos_dsum(n, w));
+    memset(A_inv, 0, sizeof(F64) *
+           (packed ? (U64) n * (n + 1) / 2 : (U64) n * n));
+
+    // Ainv = v * inv(w) * vT
+    for (i = 0; i < n; i++) {
+        if (fabs(w[i]) <= threshold) {
+            continue;
+        }
+
+        for (j = 0; j < n; j++) {
+            row = &(A_inv[_sym_row(n, packed, j)]);
+            for (k = (packed ? j : 0); k < n; k++) {
+                row[k] += V[(U64) n*i + j] * V[(U64) n*i + k] / w[i];
+            }
+        }
+    }
+}
+
+/* This matrix inversion method was inspired by the VPT method
+ * for inverting a symmetric matrix:
+https://github-fn.jpl.nasa.gov/COSMIC/COSMIC_VPT/blob/ed73b4cc919d1953fe8c5563703d0bea08718d41/vpt/vpt_homography.c#L227-L266
+ *
+ * The eigenvalues w (n), eigenvectors V (n x n), and buf (2 * n) are
+ * workspace as for get_eigen_symm; A_inv doubles as the copy of A that the
+ * eigensolver destroys.
+*/
+EosStatus invert_sym_matrix(U32 n, const F64* A, F64* A_inv, F64* w, F64* V,
+                            U32* buf) {
+    EosStatus status;
+
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(A_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(w != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(V != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(buf != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* Make a copy because get_eigen_symm is destructive */
+    memcpy(A_inv, A, sizeof(F64)*n*n);
+
+    /* find eigenvalues of a symmetric matrix and populate
+     * w (eigenvalues) and V (eigenvectors) */
+    status = get_eigen_symm(n, A_inv, w, V, buf);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _pseudo_inverse(n, EOS_FALSE, V, w, A_inv);
+
+    return EOS_SUCCESS;
+
+}
+
+/*
+ * As invert_sym_matrix, in place for a matrix stored as a packed upper
+ * triangle (see mise_packed_size); the result is identical to the upper
+ * triangle of that of invert_sym_matrix
+ */
+EosStatus invert_sym_matrix_packed(U32 n, F64* A, F64* w, F64* V, U32* buf) {
+    EosStatus status;
+
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(w != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(V != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(buf != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status = get_eigen_symm_packed(n, A, w, V, buf);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _pseudo_inverse(n, EOS_TRUE, V, w, A);
+
+    return EOS_SUCCESS;
+}
+/***********************************************************/
+
+/*
+ * Compute the Cholesky factorization A = L L' of a symmetric matrix A and
+ * store the lower-triangular factor in L (the strict upper triangle of L is
+ * zeroed). Only the lower triangle of A is read; A and L must not overlap.
+ *
+ * A pivot at or below the threshold used by invert_sym_matrix to discard
+ * eigenvalues (2 * eps * |trace(A)|) means that A is not numerically positive
+ * definite; in that case EOS_VALUE_ERROR is returned and L is undefined.
+ */
+EosStatus cholesky_decompose(U32 n, const F64* A, F64* L) {
+    U32 i, j, k;
+    F64 trace = 0.0;
+    F64 threshold;
+    F64 sum;
+
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(L != NULL)) { return EOS_ASSERT_ERROR; }
+
+    for (i = 0; i < n; i++) {
+        trace += A[(n + 1)*i];
+    }
+    threshold = 2*DBL_EPSILON*fabs(trace);
+
+    memset(L, 0, sizeof(F64)*n*n);
+    for (j = 0; j < n; j++) {
+        /* Diagonal entry */
+        sum = A[n*j + j];
+        for (k = 0; k < j; k++) {
+            sum -= L[n*j + k] * L[n*j + k];
+        }
+        if (sum <= threshold) {
+            return EOS_VALUE_ERROR;
+        }
+        L[n*j + j] = sqrt(sum);
+
+        /* Entries below the diagonal in column j */
+        for (i = j + 1; i < n; i++) {
+            sum = A[n*i + j];
+            for (k = 0; k < j; k++) {
+                sum -= L[n*i + k] * L[n*j + k];
+            }
+            L[n*i + j] = sum / L[n*j + j];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/* Smallest pivot accepted by the Cholesky factorization of the packed
+ * symmetric n x n matrix A, relative to its trace */
+static F64 _cholesky_threshold(U32 n, const F64* A) {
+    F64 trace = 0.0;
+    U32 i;
+
+    for (i = 0; i < n; i++) {
+        trace += A[_sym_row(n, EOS_TRUE, i) + i];
+    }
+    return 2*DBL_EPSILON*fabs(trace);
+}
+
+/*
+ * Do steps [k_start, k_end) of cholesky_decompose_packed, so that the
+ * factorization can be split across calls; step k costs about
+ * (n - k)^2 / 2 multiply-adds. Returns EOS_VALUE_ERROR if a pivot is at most
+ * threshold.
+ */
+static EosStatus _cholesky_packed_columns(U32 n, F64* A, F64 threshold,
+                                          U32 k_start, U32 k_end) {
+    U32 i, j, k;
+    F64 a;
+    F64* row_k;
+    F64* row_i;
+
+    for (k = k_start; k < k_end; k++) {
+        row_k = &(A[_sym_row(n, EOS_TRUE, k)]);
+        if (row_k[k] <= threshold) {
+            return EOS_VALUE_ERROR;
+        }
+        row_k[k] = sqrt(row_k[k]);
+        for (j = k + 1; j < n; j++) {
+            row_k[j] /= row_k[k];
+        }
+
+        for (i = k + 1; i < n; i++) {
+            row_i = &(A[_sym_row(n, EOS_TRUE, i)]);
+            a = row_k[i];
+            for (j = i; j < n; j++) {
+                row_i[j] -= a * row_k[j];
+            }
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Compute the Cholesky factorization A = U' U in place for a symmetric matrix
+ * stored as a packed upper triangle (see mise_packed_size), overwriting it
+ * with the upper-triangular factor U = L' (so row i of U holds column i of
+ * the L of cholesky_decompose). Each step scales row k by its pivot and
+ * subtracts its outer product from the trailing rows, which are contiguous in
+ * the packed storage. The updates are applied in the same order as in
+ * cholesky_decompose, so the factors are identical.
+ *
+ * As for cholesky_decompose, EOS_VALUE_ERROR is returned if A is not
+ * numerically positive definite; A is then destroyed.
+ */
+EosStatus cholesky_decompose_packed(U32 n, F64* A) {
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+
+    return _cholesky_packed_columns(n, A, _cholesky_threshold(n, A), 0, n);
+}
+
+/*
+ * Compute the inverse of the symmetric positive definite matrix A = L L' from
+ * its Cholesky factor L (see cholesky_decompose). Row j of A_inv is found by
+ * solving L L' x = e_j in place, with forward then back substitution; since
+ * A_inv is symmetric, this is also column j. L and A_inv must not overlap.
+ */
+EosStatus cholesky_invert(U32 n, const F64* L, F64* A_inv) {
+    U32 i, j, k;
+    F64 sum;
+    F64* x;
+
+    if (eos_assert(L != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(A_inv != NULL)) { return EOS_ASSERT_ERROR; }
+
+    for (j = 0; j < n; j++) {
+        x = &(A_inv[(U64) n * j]);
+
+        /* Solve L y = e_j; the entries of y before j are zero */
+        for (i = 0; i < j; i++) {
+            x[i] = 0.0;
+        }
+        x[j] = 1.0 / L[(U64) n * j + j];
+        for (i = j + 1; i < n; i++) {
+            sum = -eos_ddot(i - j, &(L[(U64) n * i + j]), &(x[j]));
+            x[i] = sum / L[(U64) n * i + i];
+        }
+
+        /* Solve L' x = y */
+        for (i = n; i-- > 0;) {
+            sum = x[i];
+            for (k = i + 1; k < n; k++) {
+                sum -= L[(U64) n * k + i] * x[k];
+            }
+            x[i] = sum / L[(U64) n * i + i];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Given the inverse M_inv of a symmetric n x n matrix M, apply the
+ * Sherman-Morrison formula to update it to the inverse of M + c v v':
+ *    inv(M + c v v') = M_inv - c u u' / (1 + c v' u), where u = M_inv v
+ * at a cost of O(n^2). A negative c removes a rank-1 term (a downdate). If the
+ * denominator is at most MISE_SHERMAN_MORRISON_MIN_DENOM, the updated matrix
+ * is (nearly) singular and the update would lose all accuracy; M_inv is left
+ * unchanged and EOS_VALUE_ERROR is returned.
+ *
+ * :param u: workspace for n values
+ */
+EosStatus sherman_morrison_update(U32 n, F64* M_inv, const F64* v, F64 c,
+                                  F64* u) {
+    U32 i, j;
+    F64 denom, f;
+    F64* row;
+
+    if (eos_assert(M_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(v != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(u != NULL)) { return EOS_ASSERT_ERROR; }
+
+    for (i = 0; i < n; i++) {
+        u[i] = eos_ddot(n, &(M_inv[(U64) n * i]), v);
+    }
+    denom = 1.0 + c * eos_ddot(n, v, u);
+    if (!(denom > MISE_SHERMAN_MORRISON_MIN_DENOM)) {
+        return EOS_VALUE_ERROR;
+    }
+
+    f = c / denom;
+    for (i = 0; i < n; i++) {
+        row = &(M_inv[(U64) n * i]);
+        for (j = 0; j < n; j++) {
+            row[j] -= f * u[i] * u[j];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/* Number of vectors iterated by get_top_eigen_symm for k eigenpairs */
+U32 mise_top_eigen_block(U32 n, U32 k) {
+    return eos_umin(n, k + MISE_PCA_OVERSAMPLE);
+}
+
+/*
+ * Number of F64 values of workspace needed by get_top_eigen_symm for k
+ * eigenpairs of an n x n matrix
+ */
+U64 mise_top_eigen_work_size(U32 n, U32 k) {
+    const U64 m = mise_top_eigen_block(n, k);
+    return 2 * m * n + 2 * m * m + 2 * m;
+}
+
+/* Fill v with n deterministic pseudo-random values in [-1, 1) */
+static void _fill_start_vector(U32 n, U32 index, F64* v) {
+    U32 j;
+    U32 x = 2463534242u + 0x9E3779B9u * (index + 1);
+    for (j = 0; j < n; j++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        v[j] = (F64) x / 2147483648.0 - 1.0;
+    }
+}
+
+/* y += a x for n-vectors x and y */
+static void _daxpy(U32 n, F64 a, const F64* x, F64* y) {
+    U32 i;
+    for (i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+/*
+ * Orthonormalize the m rows of length n (m <= n) of V with modified
+ * Gram-Schmidt, applied twice for numerical orthogonality. A row that is
+ * (numerically) in the span of the previous rows is replaced with a
+ * pseudo-random vector before being orthogonalized again.
+ */
+static void _orthonormalize_rows(U32 m, U32 n, F64* V) {
+    U32 i, j, pass, retry;
+    F64 norm, start_norm, dot;
+    F64* v;
+
+    for (i = 0; i < m; i++) {
+        v = &(V[(U64) i * n]);
+        for (retry = 0; retry < 4; retry++) {
+            start_norm = sqrt(eos_ddot(n, v, v));
+            for (pass = 0; pass < 2; pass++) {
+                for (j = 0; j < i; j++) {
+                    dot = eos_ddot(n, &(V[(U64) j * n]), v);
+                    _daxpy(n, -dot, &(V[(U64) j * n]), v);
+                }
+            }
+            norm = sqrt(eos_ddot(n, v, v));
+            if (norm > 1e-10 * start_norm && norm > 0.0) { break; }
+            _fill_start_vector(n, m + 4 * i + retry, v);
+        }
+        for (j = 0; j < n; j++) {
+            v[j] /= norm;
+        }
+    }
+}
+
+/* get_top_eigen_symm, also returning the number of iterations used */
+static EosStatus _top_eigen_symm(U32 n, const F64* A, U32 k, U32 warm_start,
+                                 F64* w, F64* V, F64* work, U32* buf,
+                                 U32* n_iterations) {
+    EosStatus status;
+    U32 i, j, a, iter, best;
+    U32 converged = EOS_FALSE;
+    F64 change, scale;
+    const U32 m = mise_top_eigen_block(n, k);
+    F64* Y;
+    F64* X;
+    F64* H;
+    F64* U;
+    F64* theta;
+    F64* previous;
+    U32* order;
+
+    if (eos_assert(A != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(w != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(V != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(work != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(buf != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(k >= 1 && k <= n)) { return EOS_ASSERT_ERROR; }
+
+    Y = work;
+    X = Y + (U64) m * n;
+    H = X + (U64) m * n;
+    U = H + (U64) m * m;
+    theta = U + (U64) m * m;
+    previous = theta + m;
+    order = buf + 2 * m;
+
+    for (i = (warm_start ? k : 0); i < m; i++) {
+        _fill_start_vector(n, i, &(V[(U64) i * n]));
+    }
+    _orthonormalize_rows(m, n, V);
+
+    for (iter = 0; iter < MISE_PCA_MAX_ITERATIONS && !converged; iter++) {
+        /* Project A onto the span of the rows of V: H = V A V' */
+        for (i = 0; i < m; i++) {
+            for (j = 0; j < n; j++) {
+                Y[(U64) i * n + j] = eos_ddot(n, &(A[(U64) j * n]),
+                                              &(V[(U64) i * n]));
+            }
+        }
+        for (i = 0; i < m; i++) {
+            for (j = i; j < m; j++) {
+                H[i * m + j] = eos_ddot(n, &(V[(U64) i * n]),
+                                        &(Y[(U64) j * n]));
+                H[j * m + i] = H[i * m + j];
+            }
+        }
+        status = get_eigen_symm(m, H, theta, U, buf);
+        if (status != EOS_SUCCESS) { return status; }
+
+        /* Order the Ritz values by decreasing value */
+        for (a = 0; a < m; a++) {
+            order[a] = a;
+        }
+        for (a = 0; a < m; a++) {
+            best = a;
+            for (i = a + 1; i < m; i++) {
+                if (theta[order[i]] > theta[order[best]]) { best = i; }
+            }
+            i = order[a];
+            order[a] = order[best];
+            order[best] = i;
+        }
+
+        scale = fabs(theta[order[0]]);
+        converged = (iter > 0);
+        for (a = 0; a < k; a++) {
+            change = fabs(theta[order[a]] - previous[a]);
+            if (change > MISE_PCA_TOLERANCE * scale) {
+                converged = EOS_FALSE;
+            }
+            previous[a] = theta[order[a]];
+        }
+
+        /* Ritz vectors X = U V, and the next block A X = U Y */
+        for (a = 0; a < m; a++) {
+            const F64* u = &(U[order[a] * m]);
+            F64* x = &(X[(U64) a * n]);
+            memset(x, 0, sizeof(F64) * n);
+            for (i = 0; i < m; i++) {
+                _daxpy(n, u[i], &(V[(U64) i * n]), x);
+            }
+        }
+        if (converged || iter + 1 == MISE_PCA_MAX_ITERATIONS) { break; }
+        for (a = 0; a < m; a++) {
+            const F64* u = &(U[order[a] * m]);
+            F64* v = &(V[(U64) a * n]);
+            memset(v, 0, sizeof(F64) * n);
+            for (i = 0; i < m; i++) {
+                _daxpy(n, u[i], &(Y[(U64) i * n]), v);
+            }
+        }
+        _orthonormalize_rows(m, n, V);
+    }
+
+    if (!converged) {
+        eos_logf(EOS_LOG_INFO,
+            "Eigenvalues did not converge in %u iterations.",
+            MISE_PCA_MAX_ITERATIONS);
+    }
+    *n_iterations = iter + 1;
+    memcpy(V, X, sizeof(F64) * m * n);
+    for (a = 0; a < m; a++) {
+        w[a] = theta[order[a]];
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Find the k largest eigenvalues of the symmetric n x n matrix A (in w, in
+ * decreasing order) and their eigenvectors (in the first k rows of V) with
+ * block subspace iteration and Rayleigh-Ritz projection. A block of
+ * m = mise_top_eigen_block(n, k) vectors (a few more than k, which speeds up
+ * convergence) is repeatedly multiplied by A and orthonormalized; each
+ * iteration costs O(m n^2), against O(n^3) per sweep for get_eigen_symm on
+ * the full matrix, which is only applied to the m x m projection of A.
+ *
+ * Iteration stops once none of the k eigenvalues changes by more than
+ * MISE_PCA_TOLERANCE relative to the largest, or after
+ * MISE_PCA_MAX_ITERATIONS iterations.
+ *
+ * :param warm_start: if set, the first k rows of V hold an initial basis
+ *                    (e.g., the eigenvectors found for a previous frame)
+ * :param w: destination for m values (the first k are the eigenvalues)
+ * :param V: m x n values; the eigenvectors are returned in the first k rows
+ * :param work: workspace for mise_top_eigen_work_size(n, k) values
+ * :param buf: workspace for 3 * m values
+ */
+EosStatus get_top_eigen_symm(U32 n, const F64* A, U32 k, U32 warm_start,
+                             F64* w, F64* V, F64* work, U32* buf) {
+    U32 n_iterations;
+    return _top_eigen_symm(n, A, k, warm_start, w, V, work, buf,
+                           &n_iterations);
+}
+
+/* Compute the RX score of the mean-subtracted observation with respect to
+ * the Cholesky factor L of the covariance matrix (cov = L L'):
+ *    rx_score = sub' inv(cov) sub = |z|^2, where L z = sub
+ * The forward substitution reads contiguous rows of L and needs about half
+ * the multiply-adds of the dense product in _rx_score.
+ */
+EosStatus _rx_score_cholesky(F64* mean_sub, F64* chol, const EosObsShape shape,
+        F64* temp, F64* score) {
+
+    U32 b1;
+    F64 sum;
+    if (eos_assert(mean_sub != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(chol != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(temp != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(score != NULL)) { return EOS_ASSERT_ERROR; }
+
+    // Initialize score to zero
+    *score = 0.0;
+
+    /* solve L . temp = mean_sub */
+    for (b1 = 0; b1 < shape.bands; b1++) {
+        const F64* row = &(chol[b1 * shape.bands]);
+        sum = mean_sub[b1] - eos_ddot(b1, row, temp);
+        temp[b1] = sum / row[b1];
+        *score += temp[b1] * temp[b1];
+    }
+
+    return EOS_SUCCESS;
+
+}
+
+/* Compute the RX score of the mean-subtracted observation
+ * with respect to the (inverse) covariance matrix
+ *    rx_score = np.dot(np.dot(sub, cov_inv), sub.T)
+ * using the symmetric quadratic form kernel, which reads only the contiguous
+ * upper-triangular rows of cov_inv (see eos_quad_form_sym).
+ */
+EosStatus _rx_score(F64* mean_sub, F64* cov_inv, const EosObsShape shape,
+        F64* score) {
+
+    if (eos_assert(mean_sub != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(cov_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(score != NULL)) { return EOS_ASSERT_ERROR; }
+
+    *score = eos_quad_form_sym(shape.bands, cov_inv, mean_sub);
+
+    return EOS_SUCCESS;
+
+}
+
+/*
+ * Index of entry (i, j) of a symmetric matrix stored densely or as a packed
+ * upper triangle. For i >= j, it is also the index of entry (i, j) of a
+ * lower-triangular Cholesky factor L stored densely (see cholesky_decompose)
+ * or as its packed upper-triangular transpose (see cholesky_decompose_packed).
+ */
+static U64 _sym_index(U32 n, U32 packed, U32 i, U32 j) {
+    if (packed && i > j) {
+        return _sym_row(n, packed, j) + i;
+    }
+    return _sym_row(n, packed, i) + j;
+}
+
+/*
+ * Compute the RX scores of a tile of MISE_SCORE_PIXEL_BLOCK mean-subtracted
+ * pixels with respect to the Cholesky factor L of the covariance matrix. The
+ * tile is stored band-major (tile[b * MISE_SCORE_PIXEL_BLOCK + p] holds band
+ * b of pixel p) and is overwritten with the solution Z of L Z = tile; the
+ * score of pixel p is the squared norm of column p of Z.
+ *
+ * The triangular solve is blocked by MISE_SCORE_BAND_BLOCK bands: as soon as
+ * a block of rows of Z is solved, it is applied to all later rows while it is
+ * still in cache. Each entry of L is therefore read once per tile rather than
+ * once per pixel, and the innermost loops run over the contiguous pixels of
+ * the tile: each row of Z is updated from the solved rows of the block by
+ * eos_daxpy_rows, whose vector kernel is selected at run time.
+ *
+ * The factor may be stored densely or packed (see _sym_index); the scores do
+ * not depend on the storage.
+ */
+EosStatus _rx_score_tile_cholesky(const F64* chol, U32 bands, U32 packed,
+                                  F64* tile, F64* scores) {
+    U32 k0, k1, b1, b2, p;
+    F64* z1;
+    F64 l;
+    F64 coefs[MISE_SCORE_BAND_BLOCK];
+
+    if (eos_assert(chol != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(tile != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(scores != NULL)) { return EOS_ASSERT_ERROR; }
+
+    for (k0 = 0; k0 < bands; k0 = k1) {
+        k1 = eos_umin(k0 + MISE_SCORE_BAND_BLOCK, bands);
+
+        /* Solve the rows of Z in the diagonal block */
+        for (b1 = k0; b1 < k1; b1++) {
+            z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+            for (b2 = k0; b2 < b1; b2++) {
+                coefs[b2 - k0] = -chol[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_daxpy_rows(b1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]), z1);
+            l = chol[_sym_index(bands, packed, b1, b1)];
+            for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+                z1[p] /= l;
+            }
+        }
+
+        /* Eliminate the solved block from the remaining rows */
+        for (b1 = k1; b1 < bands; b1++) {
+            z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+            for (b2 = k0; b2 < k1; b2++) {
+                coefs[b2 - k0] = -chol[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_daxpy_rows(k1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]), z1);
+        }
+    }
+
+    for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        scores[p] = 0.0;
+    }
+    for (b1 = 0; b1 < bands; b1++) {
+        z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+            scores[p] += z1[p] * z1[p];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Compute the RX scores of a tile of MISE_SCORE_PIXEL_BLOCK mean-subtracted
+ * pixels (stored band-major as for _rx_score_tile_cholesky) with respect to
+ * the (pseudo-)inverse covariance matrix. The product Y = cov_inv X of the
+ * matrix with the tile X is accumulated in product, one MISE_SCORE_BAND_BLOCK
+ * slice of X at a time so that the slice stays in cache while every row of
+ * the matrix is applied to it; the score of pixel p is then column p of X
+ * dotted with column p of Y. Each row of Y is updated from the slice by
+ * eos_daxpy_rows. The matrix may be stored densely or packed (see
+ * _sym_index).
+ */
+EosStatus _rx_score_tile(const F64* cov_inv, U32 bands, U32 packed,
+                         const F64* tile, F64* product, F64* scores) {
+    U32 k0, k1, b1, b2, p;
+    F64* y;
+    const F64* x;
+    F64 coefs[MISE_SCORE_BAND_BLOCK];
+
+    if (eos_assert(cov_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(tile != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(product != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(scores != NULL)) { return EOS_ASSERT_ERROR; }
+
+    memset(product, 0, sizeof(F64) * bands * MISE_SCORE_PIXEL_BLOCK);
+    for (k0 = 0; k0 < bands; k0 = k1) {
+        k1 = eos_umin(k0 + MISE_SCORE_BAND_BLOCK, bands);
+        for (b1 = 0; b1 < bands; b1++) {
+            for (b2 = k0; b2 < k1; b2++) {
+                coefs[b2 - k0] = cov_inv[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_daxpy_rows(k1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]),
+                           &(product[b1 * MISE_SCORE_PIXEL_BLOCK]));
+        }
+    }
+
+    for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        scores[p] = 0.0;
+    }
+    for (b1 = 0; b1 < bands; b1++) {
+        x = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        y = &(product[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+            scores[p] += x[p] * y[p];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Single-precision version of _rx_score_tile_cholesky. Only the scoring is
+ * done in single precision: the factor is computed in double precision and
+ * rounded, and the score of each pixel is accumulated in double precision.
+ * Halving the size of the factor and tile doubles the number of pixels per
+ * vector operation and halves the memory traffic of the O(bands^2) solve.
+ */
+EosStatus _rx_score_tile_cholesky_f32(const F32* chol, U32 bands, U32 packed,
+                                      F32* tile, F64* scores) {
+    U32 k0, k1, b1, b2, p;
+    F32* z1;
+    F32 l;
+    F32 coefs[MISE_SCORE_BAND_BLOCK];
+
+    if (eos_assert(chol != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(tile != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(scores != NULL)) { return EOS_ASSERT_ERROR; }
+
+    for (k0 = 0; k0 < bands; k0 = k1) {
+        k1 = eos_umin(k0 + MISE_SCORE_BAND_BLOCK, bands);
+
+        /* Solve the rows of Z in the diagonal block */
+        for (b1 = k0; b1 < k1; b1++) {
+            z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+            for (b2 = k0; b2 < b1; b2++) {
+                coefs[b2 - k0] = -chol[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_saxpy_rows(b1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]), z1);
+            l = chol[_sym_index(bands, packed, b1, b1)];
+            for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+                z1[p] /= l;
+            }
+        }
+
+        /* Eliminate the solved block from the remaining rows */
+        for (b1 = k1; b1 < bands; b1++) {
+            z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+            for (b2 = k0; b2 < k1; b2++) {
+                coefs[b2 - k0] = -chol[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_saxpy_rows(k1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]), z1);
+        }
+    }
+
+    for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        scores[p] = 0.0;
+    }
+    for (b1 = 0; b1 < bands; b1++) {
+        z1 = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+            scores[p] += (F64) z1[p] * z1[p];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Single-precision version of _rx_score_tile (see
+ * _rx_score_tile_cholesky_f32)
+ */
+EosStatus _rx_score_tile_f32(const F32* cov_inv, U32 bands, U32 packed,
+                             const F32* tile, F32* product, F64* scores) {
+    U32 k0, k1, b1, b2, p;
+    F32* y;
+    const F32* x;
+    F32 coefs[MISE_SCORE_BAND_BLOCK];
+
+    if (eos_assert(cov_inv != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(tile != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(product != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(scores != NULL)) { return EOS_ASSERT_ERROR; }
+
+    memset(product, 0, sizeof(F32) * bands * MISE_SCORE_PIXEL_BLOCK);
+    for (k0 = 0; k0 < bands; k0 = k1) {
+        k1 = eos_umin(k0 + MISE_SCORE_BAND_BLOCK, bands);
+        for (b1 = 0; b1 < bands; b1++) {
+            for (b2 = k0; b2 < k1; b2++) {
+                coefs[b2 - k0] = cov_inv[_sym_index(bands, packed, b1, b2)];
+            }
+            eos_saxpy_rows(k1 - k0, MISE_SCORE_PIXEL_BLOCK, coefs,
+                           &(tile[k0 * MISE_SCORE_PIXEL_BLOCK]),
+                           &(product[b1 * MISE_SCORE_PIXEL_BLOCK]));
+        }
+    }
+
+    for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        scores[p] = 0.0;
+    }
+    for (b1 = 0; b1 < bands; b1++) {
+        x = &(tile[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        y = &(product[b1 * MISE_SCORE_PIXEL_BLOCK]);
+        for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+            scores[p] += (F64) x[p] * y[p];
+        }
+    }
+
+    return EOS_SUCCESS;
+}
+
+/*
+ * Compute the RX scores of a tile of MISE_SCORE_PIXEL_BLOCK mean-subtracted
+ * pixels (stored band-major as for _rx_score_tile_cholesky) within the
+ * principal subspace of the background:
+ *    score = sum_c (v_c' x)^2 / lambda_c
+ * over the components c of the basis, at a cost of O(bands k) per pixel for
+ * k components. Each projection v_c' X is accumulated in projection one band
+ * at a time, so the inner loop runs over the pixels of the tile.
+ */
+EosStatus _rx_score_tile_pca(const MisePcaBasis* pca, U32 bands,
+                             const F64* tile, F64* projection,
+                             F64* scores) {
+    U32 c, p;
+
+    if (eos_assert(pca != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(tile != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(projection != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(scores != NULL)) { return EOS_ASSERT_ERROR; }
+
+    memset(scores, 0, sizeof(F64) * MISE_SCORE_PIXEL_BLOCK);
+    for (c = 0; c < pca->n_components; c++) {
+        memset(projection, 0, sizeof(F64) * MISE_SCORE_PIXEL_BLOCK);
+        eos_daxpy_rows(bands, MISE_SCORE_PIXEL_BLOCK,
+                       &(pca->basis[(U64) c * bands]), tile, projection);
+        for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+            scores[p] += pca->inv_eigenvalues[c] * projection[p] * projection[p];
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Factor of the background covariance that pixels are scored against */
+typedef struct {
+    U32 use_cholesky;           /* Cholesky factor, or pseudo-inverse */
+    U32 packed;                 /* Stored as a packed upper triangle */
+    const F64* values;
+    const F32* values_f32;      /* Non-NULL to score in single precision */
+} MiseFactor;
+
+/* Background classes of segmented RX, each with its own mean and factor
+ * (see eos_mise_detect_anomaly_segmented_rx) */
+typedef struct {
+    U32 n_clusters;
+    const F64* centroids;       /* bands x n_clusters; band-major */
+    const F64* centroid_norms;  /* Squared norm of each centroid */
+    const F64* means;           /* n_clusters x bands */
+    const MiseFactor* factors;
+} MiseClusters;
+
+/* State shared by the workers that score pixels against the background */
+typedef struct {
+    const U16* data;
+    EosObsShape shape;
+    MiseStrides strides;
+    const EosPixelMask* mask;   /* NULL for all pixels */
+    EosMaskRegion region;
+    U32 n_workers;
+    const F64* mean_pixel;
+    const MiseFactor* factor;
+    const MisePcaBasis* pca;    /* NULL for the full-dimensional score */
+    const MiseTargets* targets; /* NULL to rank the pixels' RX scores */
+    const MiseClusters* clusters;   /* NULL for a single background */
+    const EosScoreMap* map;     /* NULL for none */
+    U32 map_row;                /* First row of the map's current block */
+    F64* tile[EOS_MAX_WORKERS];
+    F64* product[EOS_MAX_WORKERS];
+    F64* scores[EOS_MAX_WORKERS];
+    F64* principal[EOS_MAX_WORKERS];
+    EosDetectionHeap heap[EOS_MAX_WORKERS];
+    F64* target_product[EOS_MAX_WORKERS];
+    EosDetectionHeap* target_heaps[EOS_MAX_WORKERS];   /* One per target */
+    F64* pixel[EOS_MAX_WORKERS];        /* Pixel and centroid distances */
+    U64* pending[EOS_MAX_WORKERS];      /* A partial tile per cluster */
+    U32* n_pending[EOS_MAX_WORKERS];
+} MiseScoreJob;
+
+/* Offsets of the first bands of the n_pixels pixels of a tile */
+static void _tile_offsets(const MiseScoreJob* job, const U64* pixels,
+                          U32 n_pixels, U64* offsets) {
+    U32 p;
+    for (p = 0; p < n_pixels; p++) {
+        offsets[p] = _pixel_offset(&(job->strides), job->shape.cols,
+                                   pixels[p]);
+    }
+}
+
+/* Load a tile of mean-subtracted pixels in band-major order (see
+ * _rx_score_tile_cholesky); the unused columns of a partial tile are zero.
+ * BIP pixels are read a pixel at a time, and BIL and BSQ pixels a band at a
+ * time. */
+static void _load_tile(const MiseScoreJob* job, const F64* mean_pixel,
+                       const U64* pixels, U32 n_pixels, F64* tile) {
+    const U32 bands = job->shape.bands;
+    const U16* values;
+    U64 offsets[MISE_SCORE_PIXEL_BLOCK];
+    U32 b, p;
+
+    _tile_offsets(job, pixels, n_pixels, offsets);
+    if (job->strides.band == 1) {
+        for (p = 0; p < n_pixels; p++) {
+            values = &(job->data[offsets[p]]);
+            for (b = 0; b < bands; b++) {
+                tile[b * MISE_SCORE_PIXEL_BLOCK + p] =
+                    values[b] - mean_pixel[b];
+            }
+        }
+    } else {
+        for (b = 0; b < bands; b++) {
+            values = &(job->data[b * job->strides.band]);
+            for (p = 0; p < n_pixels; p++) {
+                tile[b * MISE_SCORE_PIXEL_BLOCK + p] =
+                    values[offsets[p]] - mean_pixel[b];
+            }
+        }
+    }
+    for (p = n_pixels; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        for (b = 0; b < bands; b++) {
+            tile[b * MISE_SCORE_PIXEL_BLOCK + p] = 0.0;
+        }
+    }
+}
+
+/* Single-precision version of _load_tile (the mean is subtracted in double
+ * precision before rounding) */
+static void _load_tile_f32(const MiseScoreJob* job, const F64* mean_pixel,
+                           const U64* pixels, U32 n_pixels, F32* tile) {
+    const U32 bands = job->shape.bands;
+    const U16* values;
+    U64 offsets[MISE_SCORE_PIXEL_BLOCK];
+    U32 b, p;
+
+    _tile_offsets(job, pixels, n_pixels, offsets);
+    if (job->strides.band == 1) {
+        for (p = 0; p < n_pixels; p++) {
+            values = &(job->data[offsets[p]]);
+            for (b = 0; b < bands; b++) {
+                tile[b * MISE_SCORE_PIXEL_BLOCK + p] =
+                    (F32) (values[b] - mean_pixel[b]);
+            }
+        }
+    } else {
+        for (b = 0; b < bands; b++) {
+            values = &(job->data[b * job->strides.band]);
+            for (p = 0; p < n_pixels; p++) {
+                tile[b * MISE_SCORE_PIXEL_BLOCK + p] =
+                    (F32) (values[offsets[p]] - mean_pixel[b]);
+            }
+        }
+    }
+    for (p = n_pixels; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+        for (b = 0; b < bands; b++) {
+            tile[b * MISE_SCORE_PIXEL_BLOCK + p] = 0.0f;
+        }
+    }
+}
+
+/*
+ * Score a tile of n_pixels pixels against every target of the library once
+ * the tile has been scored against the background, which leaves Z = L^-1 X
+ * in the tile (Cholesky factor) or X itself (pseudo-inverse). The whitened
+ * basis W holds the matching rows for the targets, so the product T = W tile
+ * gives (s - mu)' cov^-1 x for every target and pixel at once. It is
+ * accumulated one MISE_SCORE_BAND_BLOCK slice of the tile at a time, as in
+ * _rx_score_tile, so each slice is applied to all targets while in cache.
+ *
+ * The matched filter score of a pixel is its target product divided by the
+ * target's whitened squared norm (an abundance estimate), and the ACE score
+ * is the squared product divided by both that norm and the pixel's RX score
+ * (the squared cosine of the whitened angle). The top results of each
+ * target are kept in the worker's own heap for that target.
+ */
+static EosStatus _score_tile_targets(MiseScoreJob* job, U32 worker,
+                                     const U64* pixels, U32 n_pixels) {
+    const MiseTargets* targets = job->targets;
+    const U32 bands = job->shape.bands;
+    const F64* tile = job->tile[worker];
+    const F64* scores = job->scores[worker];
+    F64* product = job->target_product[worker];
+    EosStatus status;
+    EosPixelDetection det;
+    const F64 *w, *x;
+    F64* t;
+    U32 k0, k1, b, i, p;
+
+    memset(product, 0,
+           sizeof(F64) * targets->n_targets * MISE_SCORE_PIXEL_BLOCK);
+    for (k0 = 0; k0 < bands; k0 = k1) {
+        k1 = eos_umin(k0 + MISE_SCORE_BAND_BLOCK, bands);
+        for (i = 0; i < targets->n_targets; i++) {
+            w = &(targets->basis[(U64) i * bands]);
+            t = &(product[i * MISE_SCORE_PIXEL_BLOCK]);
+            for (b = k0; b < k1; b++) {
+                x = &(tile[b * MISE_SCORE_PIXEL_BLOCK]);
+                for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+                    t[p] += w[b] * x[p];
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < targets->n_targets; i++) {
+        t = &(product[i * MISE_SCORE_PIXEL_BLOCK]);
+        for (p = 0; p < n_pixels; p++) {
+            det.row = (U32) (pixels[p] / job->shape.cols);
+            det.col = (U32) (pixels[p] % job->shape.cols);
+            if (targets->alg == EOS_MISE_ACE) {
+                det.score = (scores[p] > 0.0) ?
+                    t[p] * t[p] * targets->inv_norms[i] / scores[p] : 0.0;
+            } else {
+                det.score = t[p] * targets->inv_norms[i];
+            }
+            status = detection_heap_push(&(job->target_heaps[worker][i]),
+                                         det);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Score a tile of n_pixels pixels (given by their row-major indices) against
+ * the background of the given cluster (0 without clusters), store their
+ * scores in the score map, and keep the top results in the worker's own heap
+ * (or score it against the targets, if any) */
+static EosStatus _score_tile(MiseScoreJob* job, U32 worker, U32 cluster,
+                             const U64* pixels, U32 n_pixels) {
+    const EosObsShape shape = job->shape;
+    const MiseFactor* factor = (job->clusters == NULL) ? job->factor :
+                               &(job->clusters->factors[cluster]);
+    const F64* mean_pixel = (job->clusters == NULL) ? job->mean_pixel :
+        &(job->clusters->means[(U64) cluster * shape.bands]);
+    F64* tile = job->tile[worker];
+    F64* scores = job->scores[worker];
+    EosStatus status;
+    EosPixelDetection det;
+    U32 p;
+
+    if (factor->values_f32 != NULL) {
+        /* The single-precision tile and product use the first half of
+         * their double-precision buffers */
+        _load_tile_f32(job, mean_pixel, pixels, n_pixels, (F32*) tile);
+        if (factor->use_cholesky) {
+            status = _rx_score_tile_cholesky_f32(factor->values_f32,
+                shape.bands, factor->packed, (F32*) tile, scores);
+        } else {
+            status = _rx_score_tile_f32(factor->values_f32, shape.bands,
+                factor->packed, (F32*) tile,
+                (F32*) job->product[worker], scores);
+        }
+        if (status != EOS_SUCCESS) { return status; }
+    } else {
+        _load_tile(job, mean_pixel, pixels, n_pixels, tile);
+
+        /* The principal part is projected first, since the Cholesky
+         * scores are computed in place in the tile */
+        if (job->pca != NULL) {
+            status = _rx_score_tile_pca(job->pca, shape.bands, tile,
+                job->product[worker],
+                job->pca->complement ? job->principal[worker] : scores);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+
+        if (job->pca == NULL || job->pca->complement) {
+            if (factor->use_cholesky) {
+                status = _rx_score_tile_cholesky(factor->values,
+                    shape.bands, factor->packed, tile, scores);
+            } else {
+                status = _rx_score_tile(factor->values, shape.bands,
+                    factor->packed, tile, job->product[worker], scores);
+            }
+            if (status != EOS_SUCCESS) { return status; }
+        }
+
+        /* The score in the complement of the principal subspace is the
+         * full score less the principal part (the eigenvectors of the
+         * covariance are orthogonal) */
+        if (job->pca != NULL && job->pca->complement) {
+            for (p = 0; p < MISE_SCORE_PIXEL_BLOCK; p++) {
+                scores[p] -= job->principal[worker][p];
+                if (scores[p] < 0.0) { scores[p] = 0.0; }
+            }
+        }
+    }
+
+    if (job->targets != NULL) {
+        return _score_tile_targets(job, worker, pixels, n_pixels);
+    }
+
+    for (p = 0; p < n_pixels; p++) {
+        det.row = (U32) (pixels[p] / shape.cols);
+        det.col = (U32) (pixels[p] % shape.cols);
+        det.score = scores[p];
+        eos_score_map_store(job->map,
+            pixels[p] - (U64) job->map_row * shape.cols, det.score);
+        status = detection_heap_push(&(job->heap[worker]), det);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Load the bands of the pixel at (row, col) in double precision */
+static void _load_pixel(const U16* data, const EosObsShape* shape,
+                        const MiseStrides* strides, U32 row, U32 col,
+                        F64* x) {
+    const U16* values = &(data[_pixel_offset(strides, shape->cols,
+                                             (U64) row * shape->cols + col)]);
+    U32 b;
+
+    for (b = 0; b < shape->bands; b++) {
+        x[b] = values[(U64) b * strides->band];
+    }
+}
+
+/*
+ * Index of the centroid nearest to the pixel x (the first of equally near
+ * centroids). The squared distance to centroid c is |x|^2 - 2 x.c + |c|^2,
+ * so only x.c is computed per pixel; with the centroids stored band-major,
+ * it is accumulated a band at a time across the contiguous centroids. dots
+ * holds n_clusters values.
+ */
+static U32 _nearest_centroid(U32 bands, U32 n_clusters, const F64* centroids,
+                             const F64* centroid_norms, const F64* x,
+                             F64* dots) {
+    const F64* centroid;
+    U32 b, c, nearest = 0;
+
+    memset(dots, 0, sizeof(F64) * n_clusters);
+    for (b = 0; b < bands; b++) {
+        centroid = &(centroids[(U64) b * n_clusters]);
+        for (c = 0; c < n_clusters; c++) {
+            dots[c] += x[b] * centroid[c];
+        }
+    }
+    for (c = 0; c < n_clusters; c++) {
+        dots[c] = centroid_norms[c] - 2.0 * dots[c];
+        if (dots[c] < dots[nearest]) { nearest = c; }
+    }
+    return nearest;
+}
+
+/* Score the valid pixels of one slab of rows of the region of interest, a
+ * tile at a time. With clusters, each pixel goes to the tile of its nearest
+ * cluster, and each tile is scored against its cluster's background once it
+ * is full, so the scoring is still blocked. */
+static EosStatus _score_worker(void* context, U32 worker) {
+    MiseScoreJob* job = (MiseScoreJob*) context;
+    const EosMaskRegion region = job->region;
+    const U32 rows = region.row_end - region.row_start;
+    const U32 cols = job->shape.cols;
+    const MiseClusters* clusters = job->clusters;
+    EosStatus status;
+    U64 pixels[MISE_SCORE_PIXEL_BLOCK];
+    U64* pending = pixels;
+    U32 n_pixels = 0;
+    U32* n_pending = &n_pixels;
+    U32 n_tiles = 1;
+    U32 row, row_start, row_end, col;
+    U32 c = 0;
+
+    row_start = region.row_start
+        + (U32) (((U64) worker * rows) / job->n_workers);
+    row_end = region.row_start
+        + (U32) (((U64) (worker + 1) * rows) / job->n_workers);
+
+    if (clusters != NULL) {
+        pending = job->pending[worker];
+        n_pending = job->n_pending[worker];
+        n_tiles = clusters->n_clusters;
+        memset(n_pending, 0, sizeof(U32) * n_tiles);
+    }
+
+    /* Tiles are filled from the slab in row-major order and may span rows */
+    for (row = row_start; row < row_end; row++) {
+        for (col = eos_mask_next(job->mask, cols, row, region.col_start,
+                                 region.col_end);
+                col < region.col_end;
+                col = eos_mask_next(job->mask, cols, row, col + 1,
+                                    region.col_end)) {
+            if (clusters != NULL) {
+                _load_pixel(job->data, &(job->shape), &(job->strides), row,
+                            col, job->pixel[worker]);
+                c = _nearest_centroid(job->shape.bands, n_tiles,
+                        clusters->centroids, clusters->centroid_norms,
+                        job->pixel[worker],
+                        job->pixel[worker] + job->shape.bands);
+            }
+            pending[c * MISE_SCORE_PIXEL_BLOCK + n_pending[c]++] =
+                (U64) row * cols + col;
+            if (n_pending[c] == MISE_SCORE_PIXEL_BLOCK) {
+                status = _score_tile(job, worker, c,
+                    &(pending[c * MISE_SCORE_PIXEL_BLOCK]), n_pending[c]);
+                if (status != EOS_SUCCESS) { return status; }
+                n_pending[c] = 0;
+            }
+        }
+    }
+    for (c = 0; c < n_tiles; c++) {
+        if (n_pending[c] > 0) {
+            status = _score_tile(job, worker, c,
+                &(pending[c * MISE_SCORE_PIXEL_BLOCK]), n_pending[c]);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Size in bytes of the pixel tile, product, scores, and principal scores
+ * of one worker */
+static U64 _score_tile_size(U32 bands) {
+    return sizeof(F64) * (2 * (U64) bands + 2) * MISE_SCORE_PIXEL_BLOCK;
+}
+
+/* Size in bytes of the scoring workspace of one additional worker */
+static U64 _score_worker_size(U32 bands, U32 n_results) {
+    return _score_tile_size(bands) + sizeof(EosPixelDetection) * n_results;
+}
+
+/* Size in bytes of the pixel, centroid distances, and partial tiles (with
+ * their sizes, padded to whole U64 words) used by one worker to score
+ * against n_clusters clusters (none without clusters) */
+static U64 _score_cluster_size(U32 bands, U32 n_clusters) {
+    if (n_clusters == 0) { return 0; }
+    return sizeof(F64) * ((U64) bands + n_clusters)
+        + sizeof(U64) * (U64) n_clusters * MISE_SCORE_PIXEL_BLOCK
+        + sizeof(U64) * ((n_clusters + 1) / 2);
+}
+
+/* Size in bytes of the eigenvalues, eigenvectors, and index buffer used by
+ * _rx_pseudo_inverse */
+static U64 _sym_inverse_work_size(U32 bands) {
+    return sizeof(F64) * ((U64) bands * bands + bands)
+        + sizeof(U32) * 2 * bands;
+}
+
+U64 eos_mise_detect_anomaly_rx_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U64 moments_size, score_size;
+    U32 n;
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // mean_pixel
+    base_size += sizeof(F64) * n;
+    // The packed covariance, which is factored in place
+    base_size += sizeof(F64) * mise_packed_size(n);
+
+    // The moments, which are kept until the covariance is factored, and the
+    // partial moments of each additional worker (and, when the background is
+    // sampled, the gathered pixels of each worker) are freed before the
+    // pseudo-inverse workspace, which is only needed if the covariance is
+    // rank-deficient, and that is freed before the scoring tiles and the top
+    // results of each additional worker
+    moments_size = sizeof(U64) * n_workers * mise_moments_size(n)
+        + sizeof(U16) * n_workers * mise_sample_gather_size(n);
+    score_size = _score_tile_size(n)
+        + (n_workers - 1) * _score_worker_size(n, params->mise_max_results);
+    call_size = (moments_size > score_size) ? moments_size : score_size;
+    call_size = (_sym_inverse_work_size(n) > call_size) ?
+                _sym_inverse_work_size(n) : call_size;
+
+    return base_size + call_size;
+}
+
+/* Size in bytes of the space that the workers gather the valid and sampled
+ * pixels into */
+static U64 _sample_gather_bytes(const MiseSampling* sampling,
+                                const EosPixelMask* mask, U32 bands,
+                                U32 n_workers) {
+    if (!_is_gathered(sampling, mask)) { return 0; }
+    return sizeof(U16) * n_workers * mise_sample_gather_size(bands);
+}
+
+/*
+ * Accumulate the background moments of the sampled valid pixels (see
+ * compute_moments_sampled), returning the number of pixels in the sample in
+ * n_pixels. A sample of fewer than two pixels cannot give a covariance, so
+ * all valid pixels are used instead.
+ */
+static EosStatus _background_moments(const EosObsShape* shape,
+                                     const U16* data, EosMiseLayout layout,
+                                     const EosPixelMask* mask, U32 n_workers,
+                                     const MiseSampling* sampling,
+                                     U64* scratch, U16* gather,
+                                     U64* sum, U64* sum_sq, U64* n_pixels) {
+    EosStatus status;
+
+    status = compute_moments_sampled(data, shape, layout, mask, sampling,
+                                     n_workers, scratch, gather, sum, sum_sq,
+                                     n_pixels);
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (*n_pixels < 2 && _is_sampled(sampling)) {
+        eos_log(EOS_LOG_INFO,
+            "Background sample is too small; using all pixels.");
+        status = compute_moments_sampled(data, shape, layout, mask, NULL,
+                                         n_workers, scratch, gather, sum,
+                                         sum_sq, n_pixels);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Compute the pseudo-inverse of the covariance for scoring, stored densely
+ * or, in place (factor == cov), as a packed upper triangle. The eigensolver
+ * workspace is taken from the arena rather than the stack, since it holds
+ * bands x bands eigenvectors.
+ */
+static EosStatus _rx_pseudo_inverse(U32 bands, U32 packed, const F64* cov,
+                                    F64* factor) {
+    EosStatus status;
+    EosMemoryBuffer* eigen_buffer;
+    F64 *w, *V;
+    U32* buf;
+
+    eos_log(EOS_LOG_INFO,
+        "Covariance is not positive definite; using pseudo-inverse.");
+
+    status = lifo_allocate_buffer_checked(&eigen_buffer,
+        _sym_inverse_work_size(bands), "eigensolver buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    w = (F64*) eigen_buffer->ptr;
+    V = w + bands;
+    buf = (U32*) (V + (U64) bands * bands);
+
+    if (packed) {
+        status = invert_sym_matrix_packed(bands, factor, w, V, buf);
+    } else {
+        status = invert_sym_matrix(bands, cov, factor, w, V, buf);
+    }
+    if (status != EOS_SUCCESS) { return status; }
+
+    return lifo_deallocate_buffer(eigen_buffer);
+}
+
+/*
+ * Factor the (dense) covariance for scoring: the Cholesky factor
+ * (use_cholesky is set) or, if the covariance is rank-deficient, the
+ * pseudo-inverse.
+ */
+static EosStatus _rx_factor(U32 bands, const F64* cov, F64* factor,
+                            U32* use_cholesky) {
+    EosStatus status;
+
+    status = cholesky_decompose(bands, cov, factor);
+    if (status == EOS_SUCCESS) {
+        *use_cholesky = EOS_TRUE;
+    } else if (status == EOS_VALUE_ERROR) {
+        *use_cholesky = EOS_FALSE;
+        status = _rx_pseudo_inverse(bands, EOS_FALSE, cov, factor);
+        if (status != EOS_SUCCESS) { return status; }
+    } else {
+        return status;
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Round the size values of the factor to single precision for scoring with
+ * EOS_MISE_SINGLE_PRECISION, in place in the first half of the factor's
+ * storage (rounded value i overwrites part of value i / 2, which has already
+ * been read). Returns NULL (score in double precision) otherwise, leaving the
+ * factor intact.
+ */
+static const F32* _factor_f32(U64 size, F64* factor,
+                              EosMisePrecision precision) {
+    F32* factor_f32 = (F32*) factor;
+    U64 i;
+
+    if (precision != EOS_MISE_SINGLE_PRECISION) {
+        return NULL;
+    }
+    for (i = 0; i < size; i++) {
+        factor_f32[i] = (F32) factor[i];
+    }
+    return factor_f32;
+}
+
+/*
+ * Factor the packed covariance of the n pixels with the given raw moments in
+ * place, as for eos_mise_detect_anomaly_rx_sampled; the moments are intact,
+ * so a covariance destroyed by a failed factorization is simply recomputed
+ */
+static EosStatus _rx_factor_moments(U64 n, U32 bands, const U64* sum,
+                                    const U64* sum_sq, F64* mean_pixel,
+                                    F64* cov, U32* use_cholesky) {
+    EosStatus status;
+
+    status = moments_to_mean_covariance_packed(n, bands, sum, sum_sq,
+                                               mean_pixel, cov);
+    if (status != EOS_SUCCESS) { return status; }
+    status = cholesky_decompose_packed(bands, cov);
+    *use_cholesky = (status == EOS_SUCCESS);
+    if (status == EOS_VALUE_ERROR) {
+        status = moments_to_mean_covariance_packed(n, bands, sum, sum_sq,
+                                                   mean_pixel, cov);
+        if (status != EOS_SUCCESS) { return status; }
+        status = _rx_pseudo_inverse(bands, EOS_TRUE, cov, cov);
+    }
+    return status;
+}
+
+/*
+ * Estimate the RX background of the sampled valid pixels of the observation
+ * (see _background_moments), and factor its covariance for scoring: the
+ * packed Cholesky factor (use_cholesky is set) or, if the covariance is
+ * rank-deficient, the packed pseudo-inverse. The covariance is factored in
+ * place, and the moments are kept until it is factored, so that a failed
+ * factorization, which destroys the covariance, rebuilds it from the
+ * moments (as _rx_factor_moments does) rather than from the pixels.
+ */
+static EosStatus _rx_background(const EosObsShape* shape, const U16* data,
+                                EosMiseLayout layout,
+                                const EosPixelMask* mask, U32 n_workers,
+                                const MiseSampling* sampling,
+                                F64* mean_pixel, F64* cov,
+                                U32* use_cholesky) {
+    EosStatus status;
+    const U32 bands = shape->bands;
+    U64 *sum, *sum_sq, *scratch;
+    U16* gather;
+    U64 n_background;
+    EosMemoryBuffer* moments_buffer;
+
+    /* Accumulate moments in a single pass */
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * n_workers * mise_moments_size(bands)
+        + _sample_gather_bytes(sampling, mask, bands, n_workers),
+        "moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    sum = (U64*) moments_buffer->ptr;
+    sum_sq = sum + bands;
+    scratch = sum + mise_moments_size(bands);
+    gather = (U16*) (scratch + (n_workers - 1) * mise_moments_size(bands));
+    status = _background_moments(shape, data, layout, mask, n_workers, sampling,
+        scratch, gather, sum, sum_sq, &n_background);
+    if (status != EOS_SUCCESS) { return status; }
+    status = moments_to_mean_covariance_packed(n_background, bands,
+        sum, sum_sq, mean_pixel, cov);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = cholesky_decompose_packed(bands, cov);
+    *use_cholesky = (status == EOS_SUCCESS);
+    if (status == EOS_VALUE_ERROR) {
+        status = moments_to_mean_covariance_packed(n_background, bands,
+            sum, sum_sq, mean_pixel, cov);
+    }
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(moments_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    if (!*use_cholesky) {
+        status = _rx_pseudo_inverse(bands, EOS_TRUE, cov, cov);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Score every valid pixel (see EosPixelMask; NULL for all pixels) against the
+ * RX background using n_workers workers, and return the top n_results in
+ * results (sorted). Each worker keeps the top
+ * results of its own rows, and these are merged before sorting; since the
+ * detection heap orders ties by pixel position, the results do not depend on
+ * the number of workers.
+ *
+ * The scores are also written to the score map (NULL for none). The workers
+ * split each block of map rows in turn, so that the block can be emitted
+ * before the next one is scored.
+ *
+ * If pca is given, pixels are scored within its principal subspace (the
+ * factor values are not used) or within the complement of that subspace. If
+ * the factor has single-precision values, they are used to score in single
+ * precision (without pca). If clusters are given, each pixel is instead
+ * scored against the background of its nearest cluster (without pca).
+ */
+static EosStatus _rx_score_pixels(const EosObsShape shape, const U16* data,
+                                  const EosMiseLayout layout,
+                                  const EosPixelMask* mask,
+                                  const U32 n_workers, const F64* mean_pixel,
+                                  const MiseFactor* factor,
+                                  const MisePcaBasis* pca,
+                                  const MiseClusters* clusters,
+                                  U32* n_results,
+                                  EosPixelDetection* results,
+                                  const EosScoreMap* map) {
+    EosStatus status;
+    EosMemoryBuffer *tile_buffer, *scratch_buffer, *cluster_buffer;
+    MiseScoreJob job;
+    EosMaskRegion region;
+    U8* worker_space;
+    U32 n_clusters = (clusters == NULL) ? 0 : clusters->n_clusters;
+    U32 w, i, block, block_rows, block_end;
+
+    /* Worker 0 scores into the results array; the other workers also get
+     * their heaps from the scratch buffer */
+    status = lifo_allocate_buffer_checked(&tile_buffer,
+        _score_tile_size(shape.bands), "tile buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_allocate_buffer_checked(&scratch_buffer,
+        (n_workers - 1) * _score_worker_size(shape.bands, *n_results),
+        "worker scoring buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_allocate_buffer_checked(&cluster_buffer,
+        n_workers * _score_cluster_size(shape.bands, n_clusters),
+        "cluster scoring buffer");
+    if (status != EOS_SUCCESS) { return status; }
+
+    job.data = data;
+    job.shape = shape;
+    job.strides = _mise_strides(&shape, layout);
+    job.mask = mask;
+    job.n_workers = n_workers;
+    job.mean_pixel = mean_pixel;
+    job.factor = factor;
+    job.pca = pca;
+    job.targets = NULL;
+    job.clusters = clusters;
+    job.map = map;
+    job.tile[0] = (F64*) tile_buffer->ptr;
+    job.heap[0].data = results;
+    worker_space = scratch_buffer->ptr;
+    for (w = 1; w < n_workers; w++) {
+        job.tile[w] = (F64*) worker_space;
+        job.heap[w].data = (EosPixelDetection*) (
+            worker_space + _score_tile_size(shape.bands));
+        worker_space += _score_worker_size(shape.bands, *n_results);
+    }
+    for (w = 0; w < n_workers; w++) {
+        job.product[w] = job.tile[w] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+        job.scores[w] = job.product[w] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+        job.principal[w] = job.scores[w] + MISE_SCORE_PIXEL_BLOCK;
+        job.heap[w].capacity = *n_results;
+        job.heap[w].size = 0;
+        job.pixel[w] = (F64*) ((U8*) cluster_buffer->ptr
+            + w * _score_cluster_size(shape.bands, n_clusters));
+        job.pending[w] = (U64*) (job.pixel[w] + shape.bands + n_clusters);
+        job.n_pending[w] = (U32*) (job.pending[w]
+            + (U64) n_clusters * MISE_SCORE_PIXEL_BLOCK);
+    }
+
+    /* Compute a score for each pixel and store the top results in the
+     * heaps, a block of map rows at a time (a single block without a map) */
+    region = eos_mask_region(mask, &shape);
+    job.region = region;
+    block_rows = eos_score_map_block_rows(map, shape.rows);
+    for (block = 0; block < shape.rows; block = block_end) {
+        block_end = block + eos_umin(block_rows, shape.rows - block);
+        job.map_row = block;
+        job.region.row_start = eos_umax(region.row_start, block);
+        job.region.row_end = eos_umin(region.row_end, block_end);
+        eos_score_map_clear(map, (U64) (block_end - block) * shape.cols);
+        if (job.region.row_start < job.region.row_end) {
+            status = eos_run_workers(n_workers, _score_worker, &job);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+        status = eos_score_map_emit(map, block, block_end - block);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    /* Merge the top results of the other workers into the results heap */
+    for (w = 1; w < n_workers; w++) {
+        for (i = 0; i < job.heap[w].size; i++) {
+            status = detection_heap_push(&(job.heap[0]), job.heap[w].data[i]);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+    }
+
+    status = lifo_deallocate_buffer(cluster_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(scratch_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(tile_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = detection_heap_sort(&(job.heap[0]));
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* Update n_results with the number of actual detections returned */
+    *n_results = job.heap[0].size;
+
+    return EOS_SUCCESS;
+}
+
+/* Use the RX algorithm to rank all pixels and return the top n_results;
+ * the background statistics are accumulated and the pixels are scored by
+ * n_workers workers. */
+EosStatus eos_mise_detect_anomaly_rx(const EosObsShape shape,
+                                     const U16* data,
+                                     const EosMiseLayout layout,
+                                     const U32 n_workers,
+                                     U32* n_results,
+                                     EosPixelDetection* results) {
+    return eos_mise_detect_anomaly_rx_sampled(shape, data, layout, NULL,
+                                              n_workers, NULL,
+                                              EOS_MISE_DOUBLE_PRECISION,
+                                              n_results, results, NULL);
+}
+
+/*
+ * Use the RX algorithm to rank all pixels, estimating the background from a
+ * sample of the pixels (see compute_moments_sampled); NULL samples all of
+ * them. Accumulating the moments costs O(N bands^2) for N background pixels,
+ * so a sample of 1 / step of the pixels cuts that cost by about step, while
+ * scoring still visits every pixel.
+ *
+ * Only the valid pixels selected by the mask (see EosPixelMask; NULL for all
+ * pixels) are used for the background and scored, so masked pixels cost
+ * nothing beyond a scan of the mask, a word of 64 pixels at a time.
+ *
+ * The covariance is stored as a packed upper triangle, which first holds the
+ * packed second moments and is then factored in place, so the background
+ * needs about bands^2 / 2 values. If the covariance turns out not to be
+ * positive definite, the failed factorization has destroyed it, so the
+ * moments are accumulated again before the pseudo-inverse is computed.
+ *
+ * With EOS_MISE_SINGLE_PRECISION, the background is still estimated and
+ * factored in double precision (the moments are exact integers), but the
+ * O(N bands^2) scoring runs in single precision against the rounded factor,
+ * which is kept in the first half of the factor's storage.
+ *
+ * The score of every pixel is also written to the score map (see
+ * EosScoreMap; NULL for none), which is produced even if no results are
+ * requested.
+ */
+EosStatus eos_mise_detect_anomaly_rx_sampled(const EosObsShape shape,
+                                             const U16* data,
+                                             const EosMiseLayout layout,
+                                             const EosPixelMask* mask,
+                                             const U32 n_workers,
+                                             const MiseSampling* sampling,
+                                             const EosMisePrecision precision,
+                                             U32* n_results,
+                                             EosPixelDetection* results,
+                                             const EosScoreMap* map) {
+
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor factor;
+    F64 *mean_pixel, *cov;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer;
+
+    if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* If we are asked to compute 0 results (and no map), just return
+     * success */
+    if (*n_results == 0 && map == NULL) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results and a blank map */
+    if (eos_mask_count(mask, &shape) == 0) {
+        *n_results = 0;
+        return eos_score_map_blank(map, &shape);
+    }
+
+    /* If we made it past the previous checks, we need to make sure these
+     *  pointers aren't NULL (it's ok if they were NULL if either the
+     * observation size or n_results were zero) */
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    // Allocate memory after we've passed basic checks above
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * shape.bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * mise_packed_size(shape.bands), "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cov = (F64*) cov_buffer->ptr;
+
+    /* 1. Compute RX background from all pixels */
+    status = _rx_background(&shape, data, layout, mask, n_workers, sampling,
+                            mean_pixel, cov, &(factor.use_cholesky));
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* 2. Score all pixels against the background */
+    factor.packed = EOS_TRUE;
+    factor.values = cov;
+    factor.values_f32 = _factor_f32(mise_packed_size(shape.bands), cov,
+                                    precision);
+    status = _rx_score_pixels(shape, data, layout, mask, n_workers, mean_pixel,
+                              &factor, NULL, NULL, n_results, results, map);
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Deallocate memory in LIFO order
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return status;
+}
+
+/*
+ * Use the RX algorithm to rank the pixels of an observation whose raw moments
+ * (see compute_moments) were already accumulated, e.g. row by row as the
+ * observation was acquired; only the background factorization and scoring
+ * remain. Results are identical to those of eos_mise_detect_anomaly_rx_sampled
+ * with all pixels sampled and the same precision. Needs no more memory than
+ * eos_mise_detect_anomaly_rx.
+ */
+EosStatus eos_mise_detect_anomaly_rx_moments(const EosObsShape shape,
+                                             const U16* data,
+                                             const EosMiseLayout layout,
+                                             const U32 n_workers,
+                                             const U64* sum,
+                                             const U64* sum_sq,
+                                             const EosMisePrecision precision,
+                                             U32* n_results,
+                                             EosPixelDetection* results) {
+
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor factor;
+    F64 *mean_pixel, *cov;
+    const U64 n_pixels = (U64) shape.rows * shape.cols;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer;
+
+    if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* If we are asked to compute 0 results, just return success */
+    if (*n_results == 0) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation is zero size, return success with zero results */
+    if (shape.rows == 0 || shape.cols == 0) {
+        *n_results = 0;
+        return EOS_SUCCESS;
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(sum_sq != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(results != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * shape.bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * mise_packed_size(shape.bands), "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cov = (F64*) cov_buffer->ptr;
+
+    status = _rx_factor_moments(n_pixels, shape.bands, sum, sum_sq,
+                                mean_pixel, cov, &(factor.use_cholesky));
+    if (status != EOS_SUCCESS) { return status; }
+
+    factor.packed = EOS_TRUE;
+    factor.values = cov;
+    factor.values_f32 = _factor_f32(mise_packed_size(shape.bands), cov,
+                                    precision);
+    status = _rx_score_pixels(shape, data, layout, NULL, n_workers, mean_pixel,
+                              &factor, NULL, NULL, n_results, results,
+                              NULL);
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Deallocate memory in LIFO order
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return status;
+}
+
+/*
+ * Accumulate the moments of the sampled valid pixels of every nonempty
+ * observation of a batch into sum (see compute_moments_sampled), using
+ * cube_sum for the moments of each observation in turn
+ */
+static EosStatus _pooled_moments(const U32 n_observations,
+                                 const EosMiseObservation* observations,
+                                 U32 n_workers, const MiseSampling* sampling,
+                                 U64* scratch, U16* gather, U64* cube_sum,
+                                 U64* sum, U64* n_pixels) {
+    EosStatus status;
+    const EosMiseObservation* obs;
+    const U32 bands = observations[0].shape.bands;
+    U64 n_sampled, j;
+    U32 i;
+
+    memset(sum, 0, sizeof(U64) * mise_moments_size(bands));
+    *n_pixels = 0;
+    for (i = 0; i < n_observations; i++) {
+        obs = &(observations[i]);
+        if (eos_mask_count(obs->mask, &(obs->shape)) == 0) { continue; }
+        status = compute_moments_sampled(obs->data, &(obs->shape),
+            obs->layout, obs->mask, sampling, n_workers, scratch, gather,
+            cube_sum, cube_sum + bands, &n_sampled);
+        if (status != EOS_SUCCESS) { return status; }
+        for (j = 0; j < mise_moments_size(bands); j++) {
+            sum[j] += cube_sum[j];
+        }
+        *n_pixels += n_sampled;
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Use the RX algorithm to rank the pixels of each observation of a batch,
+ * all with the same number of bands, against a single background pooled from
+ * the sampled valid pixels of all of them (see compute_moments_sampled). The
+ * background is estimated and factored once; the top results of each
+ * observation are then returned in its result, as by
+ * eos_mise_detect_anomaly_rx_sampled. As for a single observation, a pooled
+ * sample of fewer than two pixels is replaced by all valid pixels.
+ */
+EosStatus eos_mise_detect_anomaly_rx_pooled(const U32 n_observations,
+                                    const EosMiseObservation* observations,
+                                    const U32 n_workers,
+                                    const MiseSampling* sampling,
+                                    const EosMisePrecision precision,
+                                    EosMiseDetectionResult* results) {
+
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor factor;
+    const EosMiseObservation* obs;
+    F64 *mean_pixel, *cov;
+    U64 *sum, *cube_sum, *scratch;
+    U16* gather;
+    U64 gather_bytes = 0, n_background, n_valid = 0;
+    U32 bands, i;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer, *sum_buffer;
+    EosMemoryBuffer* moments_buffer;
+
+    if (n_observations == 0) { return EOS_SUCCESS; }
+    if (eos_assert(observations != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(results != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    bands = observations[0].shape.bands;
+    for (i = 0; i < n_observations; i++) {
+        obs = &(observations[i]);
+        if (eos_assert(obs->shape.bands == bands)) {
+            return EOS_ASSERT_ERROR;
+        }
+        if (eos_mask_count(obs->mask, &(obs->shape)) == 0) { continue; }
+        if (eos_assert(obs->data != NULL)) { return EOS_ASSERT_ERROR; }
+        if (eos_assert(results[i].n_results == 0
+                       || results[i].results != NULL)) {
+            return EOS_ASSERT_ERROR;
+        }
+        n_valid++;
+        gather_bytes = eos_lmax(gather_bytes,
+            _sample_gather_bytes(sampling, obs->mask, bands, n_workers));
+    }
+
+    /* If every observation is empty, return success with zero results */
+    if (n_valid == 0) {
+        for (i = 0; i < n_observations; i++) {
+            results[i].n_results = 0;
+        }
+        return EOS_SUCCESS;
+    }
+
+    // Allocate memory after we've passed basic checks above
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * mise_packed_size(bands), "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cov = (F64*) cov_buffer->ptr;
+
+    /* 1. Compute the pooled RX background once */
+    status = lifo_allocate_buffer_checked(&sum_buffer,
+        sizeof(U64) * mise_moments_size(bands), "pooled moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    sum = (U64*) sum_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * n_workers * mise_moments_size(bands) + gather_bytes,
+        "moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cube_sum = (U64*) moments_buffer->ptr;
+    scratch = cube_sum + mise_moments_size(bands);
+    gather = (gather_bytes == 0) ? NULL :
+             (U16*) (scratch + (n_workers - 1) * mise_moments_size(bands));
+    status = _pooled_moments(n_observations, observations, n_workers,
+        sampling, scratch, gather, cube_sum, sum, &n_background);
+    if (status != EOS_SUCCESS) { return status; }
+    if (n_background < 2 && _is_sampled(sampling)) {
+        eos_log(EOS_LOG_INFO,
+            "Background sample is too small; using all pixels.");
+        status = _pooled_moments(n_observations, observations, n_workers,
+            NULL, scratch, gather, cube_sum, sum, &n_background);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    status = lifo_deallocate_buffer(moments_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = _rx_factor_moments(n_background, bands, sum, sum + bands,
+                                mean_pixel, cov, &(factor.use_cholesky));
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(sum_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* 2. Score each observation against the pooled background */
+    factor.packed = EOS_TRUE;
+    factor.values = cov;
+    factor.values_f32 = _factor_f32(mise_packed_size(bands), cov, precision);
+    for (i = 0; i < n_observations; i++) {
+        obs = &(observations[i]);
+        if (eos_mask_count(obs->mask, &(obs->shape)) == 0) {
+            results[i].n_results = 0;
+            continue;
+        }
+        if (results[i].n_results == 0) { continue; }
+        status = _rx_score_pixels(obs->shape, obs->data, obs->layout, obs->mask,
+            n_workers, mean_pixel, &factor, NULL, NULL,
+            &(results[i].n_results), results[i].results, NULL);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    // Deallocate memory in LIFO order
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return status;
+}
+
+U64 eos_mise_detect_anomaly_rx_pooled_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U64 moments_size, score_size;
+    U32 n;
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // mean_pixel and the packed covariance
+    base_size += sizeof(F64) * (n + mise_packed_size(n));
+
+    // The pooled moments, with the moments of each observation and the
+    // partial moments of each additional worker (and any gathered pixels),
+    // are freed before the scoring tiles and the top results of each
+    // additional worker; the pseudo-inverse workspace is only needed while
+    // the pooled moments are held
+    moments_size = sizeof(U64) * (n_workers + 1) * mise_moments_size(n)
+        + sizeof(U16) * n_workers * mise_sample_gather_size(n);
+    moments_size = eos_lmax(moments_size, sizeof(U64) * mise_moments_size(n)
+                            + _sym_inverse_work_size(n));
+    score_size = _score_tile_size(n)
+        + (n_workers - 1) * _score_worker_size(n, params->mise_max_results);
+    call_size = eos_lmax(moments_size, score_size);
+
+    return base_size + call_size;
+}
+
+U64 eos_mise_detect_anomaly_pca_rx_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U64 moments_size, basis_size, eigen_size, score_size;
+    U32 n;
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // mean_pixel, cov, and its factor (which first holds the packed second
+    // moments)
+    base_size += sizeof(F64) * n;
+    base_size += 2 * sizeof(F64) * (n * n);
+
+    // The moments are freed before the basis (at most n vectors and their
+    // eigenvalues) is allocated; the eigensolver workspace is then freed
+    // before the pixels are scored
+    moments_size = sizeof(U64) * (n + (n_workers - 1) * mise_moments_size(n))
+        + sizeof(U16) * n_workers * mise_sample_gather_size(n);
+    basis_size = sizeof(F64) * ((U64) n * n + n);
+    eigen_size = sizeof(F64) * mise_top_eigen_work_size(n, n)
+        + sizeof(U32) * 3 * n;
+    score_size = _score_tile_size(n)
+        + (n_workers - 1) * _score_worker_size(n, params->mise_max_results);
+    // With the complement, the full covariance is factored after the
+    // eigensolver workspace is freed (its pseudo-inverse needs a workspace)
+    score_size = (_sym_inverse_work_size(n) > score_size) ?
+                 _sym_inverse_work_size(n) : score_size;
+    call_size = basis_size
+        + ((eigen_size > score_size) ? eigen_size : score_size);
+    call_size = (moments_size > call_size) ? moments_size : call_size;
+
+    return base_size + call_size;
+}
+
+/*
+ * Use PCA-reduced RX to rank all pixels: find the n_components principal
+ * components of the background covariance (with get_top_eigen_symm), and
+ * score each pixel within their span, at a cost of O(bands n_components)
+ * per pixel instead of O(bands^2). If complement is set, pixels are instead
+ * scored within the complement of the principal subspace (subspace RX),
+ * which suppresses the dominant background variation; this needs the full
+ * score as well, so it costs more than plain RX.
+ *
+ * If basis_state is not NULL, the eigensolver starts from the basis it holds
+ * (once it holds one), and the basis found is stored back for the next
+ * observation; a basis close to the new one converges in fewer iterations.
+ *
+ * The background may be sampled, and the pixels masked, as for
+ * eos_mise_detect_anomaly_rx_sampled.
+ */
+EosStatus eos_mise_detect_anomaly_pca_rx(const EosObsShape shape,
+                                         const U16* data,
+                                         const EosMiseLayout layout,
+                                         const EosPixelMask* mask,
+                                         const U32 n_workers,
+                                         const MiseSampling* sampling,
+                                         const U32 n_components,
+                                         const U32 complement,
+                                         EosMisePcaBasisState* basis_state,
+                                         U32* n_results,
+                                         EosPixelDetection* results,
+                                         const EosScoreMap* map) {
+
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor full_factor;
+    U32 block, c, warm_start, n_iterations;
+    F64 *mean_pixel, *cov, *factor, *basis, *eigenvalues;
+    F64 trace = 0.0;
+    U64 *sum, *sum_sq;
+    U64 n_background;
+    MisePcaBasis pca;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer, *factor_buffer,
+        *moments_buffer, *basis_buffer, *eigen_buffer;
+
+    if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* If we are asked to compute 0 results (and no map), just return
+     * success */
+    if (*n_results == 0 && map == NULL) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results and a blank map */
+    if (eos_mask_count(mask, &shape) == 0) {
+        *n_results = 0;
+        return eos_score_map_blank(map, &shape);
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_components >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_components <= shape.bands)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+    if (basis_state != NULL) {
+        if (eos_assert(basis_state->basis != NULL)) {
+            return EOS_ASSERT_ERROR;
+        }
+        if (eos_assert(basis_state->bands == shape.bands)) {
+            return EOS_ASSERT_ERROR;
+        }
+        if (eos_assert(basis_state->n_components == n_components)) {
+            return EOS_ASSERT_ERROR;
+        }
+    }
+
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * shape.bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * shape.bands * shape.bands, "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cov = (F64*) cov_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&factor_buffer,
+        sizeof(F64) * shape.bands * shape.bands, "factor buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    factor = (F64*) factor_buffer->ptr;
+
+    /* 1. Compute the background mean and covariance */
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * (shape.bands
+                       + (n_workers - 1) * mise_moments_size(shape.bands))
+        + _sample_gather_bytes(sampling, mask, shape.bands,
+                               n_workers),
+        "moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    sum = (U64*) moments_buffer->ptr;
+    sum_sq = (U64*) factor;
+    status = _background_moments(&shape, data, layout, mask, n_workers,
+        sampling, sum + shape.bands,
+        (U16*) (sum + shape.bands
+                + (n_workers - 1) * mise_moments_size(shape.bands)),
+        sum, sum_sq, &n_background);
+    if (status != EOS_SUCCESS) { return status; }
+    status = moments_to_mean_covariance(n_background, shape.bands,
+                                        sum, sum_sq, mean_pixel, cov);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(moments_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* 2. Find the principal components of the background */
+    block = mise_top_eigen_block(shape.bands, n_components);
+    status = lifo_allocate_buffer_checked(&basis_buffer,
+        sizeof(F64) * ((U64) block * shape.bands + block), "basis buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    basis = (F64*) basis_buffer->ptr;
+    eigenvalues = basis + (U64) block * shape.bands;
+
+    status = lifo_allocate_buffer_checked(&eigen_buffer,
+        sizeof(F64) * mise_top_eigen_work_size(shape.bands, n_components)
+        + sizeof(U32) * 3 * block, "eigensolver buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    warm_start = (basis_state != NULL && basis_state->n_observations > 0);
+    if (warm_start) {
+        memcpy(basis, basis_state->basis,
+               sizeof(F64) * n_components * shape.bands);
+    }
+    status = _top_eigen_symm(shape.bands, cov, n_components, warm_start,
+        eigenvalues, basis, (F64*) eigen_buffer->ptr,
+        (U32*) ((F64*) eigen_buffer->ptr
+                + mise_top_eigen_work_size(shape.bands, n_components)),
+        &n_iterations);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(eigen_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    if (basis_state != NULL) {
+        memcpy(basis_state->basis, basis,
+               sizeof(F64) * n_components * shape.bands);
+        basis_state->n_iterations = n_iterations;
+        basis_state->n_observations++;
+    }
+
+    /* Components with (numerically) zero variance are left out of the
+     * score, using the pseudo-inverse threshold of invert_sym_matrix */
+    for (c = 0; c < shape.bands; c++) {
+        trace += cov[(U64) c * shape.bands + c];
+    }
+    for (c = 0; c < n_components; c++) {
+        eigenvalues[c] = (eigenvalues[c] > 2 * DBL_EPSILON * fabs(trace)) ?
+                         1.0 / eigenvalues[c] : 0.0;
+    }
+    pca.complement = complement;
+    pca.n_components = n_components;
+    pca.basis = basis;
+    pca.inv_eigenvalues = eigenvalues;
+
+    /* 3. Score all pixels within (or outside) the principal subspace */
+    full_factor.use_cholesky = EOS_FALSE;
+    full_factor.packed = EOS_FALSE;
+    full_factor.values = factor;
+    full_factor.values_f32 = NULL;
+    if (complement) {
+        status = _rx_factor(shape.bands, cov, factor,
+                            &(full_factor.use_cholesky));
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    status = _rx_score_pixels(shape, data, layout, mask, n_workers, mean_pixel,
+                              &full_factor, &pca, NULL, n_results, results,
+                              map);
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Deallocate memory in LIFO order
+    status = lifo_deallocate_buffer(basis_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(factor_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return status;
+}
+
+/* State shared by the workers that fit the clusters of segmented RX */
+typedef struct {
+    const U16* data;
+    EosObsShape shape;
+    MiseStrides strides;
+    const EosPixelMask* mask;       /* NULL for all pixels */
+    EosMaskRegion region;
+    U32 n_workers;
+    const MiseSampling* sampling;   /* NULL for all pixels */
+    U32 n_clusters;
+    const F64* centroids;           /* bands x n_clusters; band-major */
+    const F64* centroid_norms;
+    U32 stride;                     /* Level of the moments reduction */
+    U64* moments[EOS_MAX_WORKERS];  /* Moments of each cluster, then the
+                                     * number of pixels in each */
+    F64* pixel[EOS_MAX_WORKERS];    /* Pixel and centroid distances */
+    F64* sums[EOS_MAX_WORKERS];     /* n_clusters x bands */
+    U64* n_assigned[EOS_MAX_WORKERS]; /* Pixels assigned to (or gathered
+                                       * for) each cluster */
+    U16* gather[EOS_MAX_WORKERS];   /* A block of pixels of each cluster,
+                                     * in BIP order */
+} MiseKmeansJob;
+
+/* Size in bytes of the workspace of one worker fitting n_clusters clusters
+ * (see MiseKmeansJob) */
+static U64 _kmeans_worker_size(U32 bands, U32 n_clusters) {
+    return sizeof(F64) * ((U64) bands + n_clusters
+                          + (U64) n_clusters * bands)
+        + sizeof(U64) * n_clusters
+        + sizeof(U64) * ((n_clusters * mise_sample_gather_size(bands) + 3)
+                         / 4);
+}
+
+/* Number of U64 values in the partial moments of one worker accumulating
+ * n_clusters clusters (see MiseKmeansJob) */
+static U64 _kmeans_moments_size(U32 bands, U32 n_clusters) {
+    return (U64) n_clusters * (mise_moments_size(bands) + 1);
+}
+
+/* Whether the valid pixel at (row, col) is in the job's background sample */
+static U32 _kmeans_sampled(const MiseKmeansJob* job, U32 row, U32 col) {
+    return !_is_sampled(job->sampling)
+        || _pixel_sampled(job->sampling, row, col, job->shape.cols);
+}
+
+/*
+ * Seed the centroids with sampled pixels spread evenly through the sample
+ * in raster order, and return the number of pixels in the sample. The
+ * centroids are stored band-major. The seeds only depend on the sample, so
+ * the clusters are reproducible.
+ */
+static U64 _kmeans_seed(const MiseKmeansJob* job, F64* centroids) {
+    const EosMaskRegion region = job->region;
+    const U32 cols = job->shape.cols;
+    const U32 k = job->n_clusters;
+    F64* x = job->pixel[0];
+    U64 n_sampled = 0, i = 0;
+    U32 row, col, b;
+    U32 c = 0;
+
+    for (row = region.row_start; row < region.row_end; row++) {
+        for (col = eos_mask_next(job->mask, cols, row, region.col_start,
+                                 region.col_end);
+                col < region.col_end;
+                col = eos_mask_next(job->mask, cols, row, col + 1,
+                                    region.col_end)) {
+            n_sampled += _kmeans_sampled(job, row, col);
+        }
+    }
+
+    for (row = region.row_start; row < region.row_end && c < k; row++) {
+        for (col = eos_mask_next(job->mask, cols, row, region.col_start,
+                                 region.col_end);
+                col < region.col_end && c < k;
+                col = eos_mask_next(job->mask, cols, row, col + 1,
+                                    region.col_end)) {
+            if (!_kmeans_sampled(job, row, col)) { continue; }
+            /* Several seeds may share a pixel if the sample is small */
+            while (c < k && i == (2 * (U64) c + 1) * n_sampled / (2 * k)) {
+                _load_pixel(job->data, &(job->shape), &(job->strides), row,
+                            col, x);
+                for (b = 0; b < job->shape.bands; b++) {
+                    centroids[(U64) b * k + c] = x[b];
+                }
+                c++;
+            }
+            i++;
+        }
+    }
+    return n_sampled;
+}
+
+/* Squared norm of each (band-major) centroid */
+static void _centroid_norms(U32 bands, U32 n_clusters, const F64* centroids,
+                            F64* centroid_norms) {
+    U32 b, c;
+
+    memset(centroid_norms, 0, sizeof(F64) * n_clusters);
+    for (b = 0; b < bands; b++) {
+        for (c = 0; c < n_clusters; c++) {
+            centroid_norms[c] += centroids[(U64) b * n_clusters + c]
+                                 * centroids[(U64) b * n_clusters + c];
+        }
+    }
+}
+
+/* Assign the sampled valid pixels of one slab of rows of the region of
+ * interest to their nearest centroids, summing the pixels of each cluster
+ * (one k-means step) */
+static EosStatus _kmeans_assign_worker(void* context, U32 worker) {
+    MiseKmeansJob* job = (MiseKmeansJob*) context;
+    const EosMaskRegion region = job->region;
+    const U32 rows = region.row_end - region.row_start;
+    const U32 bands = job->shape.bands;
+    F64* x = job->pixel[worker];
+    F64* sum;
+    U32 row, row_start, row_end, col, b, c;
+
+    row_start = region.row_start
+        + (U32) (((U64) worker * rows) / job->n_workers);
+    row_end = region.row_start
+        + (U32) (((U64) (worker + 1) * rows) / job->n_workers);
+
+    memset(job->sums[worker], 0,
+           sizeof(F64) * job->n_clusters * (U64) bands);
+    memset(job->n_assigned[worker], 0, sizeof(U64) * job->n_clusters);
+    for (row = row_start; row < row_end; row++) {
+        for (col = eos_mask_next(job->mask, job->shape.cols, row,
+                                 region.col_start, region.col_end);
+                col < region.col_end;
+                col = eos_mask_next(job->mask, job->shape.cols, row, col + 1,
+                                    region.col_end)) {
+            if (!_kmeans_sampled(job, row, col)) { continue; }
+            _load_pixel(job->data, &(job->shape), &(job->strides), row, col,
+                        x);
+            c = _nearest_centroid(bands, job->n_clusters, job->centroids,
+                                  job->centroid_norms, x, x + bands);
+            sum = &(job->sums[worker][(U64) c * bands]);
+            for (b = 0; b < bands; b++) {
+                sum[b] += x[b];
+            }
+            job->n_assigned[worker][c]++;
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Accumulate the gathered block of pixels of cluster c into the worker's
+ * partial moments of the cluster */
+static EosStatus _kmeans_flush_block(const MiseKmeansJob* job, U32 worker,
+                                     U32 c) {
+    const U32 bands = job->shape.bands;
+    const EosObsShape block = {1, (U32) job->n_assigned[worker][c], bands};
+    U64* moments = &(job->moments[worker][(U64) c
+                                          * mise_moments_size(bands)]);
+    U64* counts = job->moments[worker]
+        + (U64) job->n_clusters * mise_moments_size(bands);
+    EosStatus status;
+
+    status = accumulate_moments(
+        &(job->gather[worker][c * mise_sample_gather_size(bands)]), &block,
+        EOS_MISE_BIP, moments, moments + bands);
+    if (status != EOS_SUCCESS) { return status; }
+    counts[c] += block.cols;
+    job->n_assigned[worker][c] = 0;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Accumulate the exact partial moments (see compute_moments) of each cluster
+ * over the sampled valid pixels of one slab of rows of the region of
+ * interest. Each pixel is assigned once, and gathered into the block of its
+ * cluster, which is accumulated with the blocked accumulate_moments when it
+ * is full.
+ */
+static EosStatus _kmeans_moments_worker(void* context, U32 worker) {
+    MiseKmeansJob* job = (MiseKmeansJob*) context;
+    const EosMaskRegion region = job->region;
+    const U32 rows = region.row_end - region.row_start;
+    const U32 bands = job->shape.bands;
+    F64* x = job->pixel[worker];
+    U64* n_gathered = job->n_assigned[worker];
+    U16* gathered;
+    EosStatus status;
+    U32 row, row_start, row_end, col, b, c;
+
+    row_start = region.row_start
+        + (U32) (((U64) worker * rows) / job->n_workers);
+    row_end = region.row_start
+        + (U32) (((U64) (worker + 1) * rows) / job->n_workers);
+
+    memset(job->moments[worker], 0,
+           sizeof(U64) * _kmeans_moments_size(bands, job->n_clusters));
+    memset(n_gathered, 0, sizeof(U64) * job->n_clusters);
+    for (row = row_start; row < row_end; row++) {
+        for (col = eos_mask_next(job->mask, job->shape.cols, row,
+                                 region.col_start, region.col_end);
+                col < region.col_end;
+                col = eos_mask_next(job->mask, job->shape.cols, row, col + 1,
+                                    region.col_end)) {
+            if (!_kmeans_sampled(job, row, col)) { continue; }
+            _load_pixel(job->data, &(job->shape), &(job->strides), row, col,
+                        x);
+            c = _nearest_centroid(bands, job->n_clusters, job->centroids,
+                                  job->centroid_norms, x, x + bands);
+            gathered = &(job->gather[worker][c * mise_sample_gather_size(bands)
+                                             + n_gathered[c] * bands]);
+            for (b = 0; b < bands; b++) {
+                gathered[b] = (U16) x[b];
+            }
+            n_gathered[c]++;
+            if (n_gathered[c] == MISE_MOMENT_PIXEL_BLOCK) {
+                status = _kmeans_flush_block(job, worker, c);
+                if (status != EOS_SUCCESS) { return status; }
+            }
+        }
+    }
+    for (c = 0; c < job->n_clusters; c++) {
+        if (n_gathered[c] == 0) { continue; }
+        status = _kmeans_flush_block(job, worker, c);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Add the partial cluster moments of worker (2 * stride * pair + stride)
+ * into those of worker (2 * stride * pair) */
+static EosStatus _kmeans_reduce_worker(void* context, U32 pair) {
+    MiseKmeansJob* job = (MiseKmeansJob*) context;
+    const U32 dst = 2 * job->stride * pair;
+    const U32 src = dst + job->stride;
+    const U64 size = _kmeans_moments_size(job->shape.bands, job->n_clusters);
+    U64 i;
+
+    for (i = 0; i < size; i++) {
+        job->moments[dst][i] += job->moments[src][i];
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Accumulate the moments and pixel counts of the job's clusters into
+ * moments, which holds n_workers * _kmeans_moments_size values. Each worker
+ * accumulates partial moments over a slab of rows in its own region of
+ * moments, which are combined with a pairwise tree reduction into the first
+ * region, as in _run_moments_job. The sums are exact, so the result does not
+ * depend on the number of workers.
+ */
+static EosStatus _kmeans_run_moments(MiseKmeansJob* job, U64* moments) {
+    EosStatus status;
+    U32 w;
+
+    for (w = 0; w < job->n_workers; w++) {
+        job->moments[w] = &(moments[w * _kmeans_moments_size(
+            job->shape.bands, job->n_clusters)]);
+    }
+    status = eos_run_workers(job->n_workers, _kmeans_moments_worker, job);
+    if (status != EOS_SUCCESS) { return status; }
+
+    for (job->stride = 1; job->stride < job->n_workers; job->stride *= 2) {
+        status = eos_run_workers(
+            (job->n_workers + job->stride - 1) / (2 * job->stride),
+            _kmeans_reduce_worker, job
+        );
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
+
+U64 eos_mise_detect_anomaly_segmented_rx_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U64 fit_size, score_size;
+    U32 n, k;
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+    k = eos_umax(params->mise_max_clusters, 1);
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // The centroids, their norms, and the mean and packed factor of each
+    // cluster
+    base_size += sizeof(F64) * ((U64) k * n * 2 + k
+                                + (U64) k * mise_packed_size(n));
+    base_size += sizeof(MiseFactor) * k;
+
+    // The k-means workspace and the partial moments of each cluster of each
+    // worker (with the pseudo-inverse workspace of a rank-deficient cluster)
+    // are freed before the pixels are scored
+    fit_size = n_workers * (_kmeans_worker_size(n, k)
+                            + sizeof(U64) * _kmeans_moments_size(n, k))
+        + _sym_inverse_work_size(n);
+    score_size = _score_tile_size(n)
+        + (n_workers - 1) * _score_worker_size(n, params->mise_max_results)
+        + n_workers * _score_cluster_size(n, k);
+    call_size = eos_lmax(fit_size, score_size);
+
+    return base_size + call_size;
+}
+
+/*
+ * Use segmented RX to rank all pixels: the background is split into
+ * n_clusters classes (e.g., ice and terrain) by n_iterations k-means steps
+ * on the background sample, each class gets its own mean and factored
+ * covariance, and every pixel is scored against the class of its nearest
+ * centroid. A single Gaussian background fitted to a mixed scene is too
+ * broad for either class, so anomalies within one class stand out more.
+ *
+ * The k-means steps assign the sampled pixels in parallel (see
+ * _kmeans_assign_worker), with the distances to all centroids computed at
+ * once from a band-major copy of the centroids (see _nearest_centroid); a
+ * cluster that loses all its pixels keeps its centroid. The moments of each
+ * class are then accumulated exactly, as for RX, in one parallel pass that
+ * assigns each pixel once (see _kmeans_moments_worker). The covariance of
+ * a class of at most bands pixels is singular, so such a class is dropped
+ * and its pixels are reassigned to the nearest remaining class (whose
+ * moments are accumulated again); if every class is dropped, a single class
+ * of all sampled pixels is used, as for global RX. Scoring fills a tile per
+ * class, so each pixel still costs about as much as with global RX, plus
+ * O(bands n_clusters) to find its class.
+ *
+ * The background may be sampled, and the pixels masked, as for
+ * eos_mise_detect_anomaly_rx_sampled. Pixels are scored in double
+ * precision.
+ */
+EosStatus eos_mise_detect_anomaly_segmented_rx(const EosObsShape shape,
+                                               const U16* data,
+                                               const EosMiseLayout layout,
+                                               const EosPixelMask* mask,
+                                               const U32 n_workers,
+                                               const MiseSampling* sampling,
+                                               const U32 n_clusters,
+                                               const U32 n_iterations,
+                                               U32* n_results,
+                                               EosPixelDetection* results,
+                                               const EosScoreMap* map) {
+    EosStatus status = EOS_SUCCESS;
+    const U32 bands = shape.bands;
+    const U64 packed = mise_packed_size(shape.bands);
+    MiseKmeansJob job;
+    MiseClusters clusters;
+    MiseFactor* factors;
+    F64 *centroids, *centroid_norms, *means, *covs, *sum;
+    U64 *counts;
+    U64 n_sampled, n_assigned;
+    U32 w, c, b, it, n_kept;
+    EosMemoryBuffer *cluster_buffer, *work_buffer, *moments_buffer;
+
+    if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* If we are asked to compute 0 results (and no map), just return
+     * success */
+    if (*n_results == 0 && map == NULL) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results and a blank map */
+    if (eos_mask_count(mask, &shape) == 0) {
+        *n_results = 0;
+        return eos_score_map_blank(map, &shape);
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_clusters >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    status = lifo_allocate_buffer_checked(&cluster_buffer,
+        sizeof(F64) * ((U64) n_clusters * bands * 2 + n_clusters
+                       + n_clusters * packed)
+        + sizeof(MiseFactor) * n_clusters, "cluster buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    centroids = (F64*) cluster_buffer->ptr;
+    centroid_norms = centroids + (U64) n_clusters * bands;
+    means = centroid_norms + n_clusters;
+    covs = means + (U64) n_clusters * bands;
+    factors = (MiseFactor*) (covs + n_clusters * packed);
+
+    status = lifo_allocate_buffer_checked(&work_buffer,
+        n_workers * _kmeans_worker_size(bands, n_clusters),
+        "k-means buffer");
+    if (status != EOS_SUCCESS) { return status; }
+
+    job.data = data;
+    job.shape = shape;
+    job.strides = _mise_strides(&shape, layout);
+    job.mask = mask;
+    job.region = eos_mask_region(mask, &shape);
+    job.n_workers = n_workers;
+    job.sampling = sampling;
+    job.n_clusters = n_clusters;
+    job.centroids = centroids;
+    job.centroid_norms = centroid_norms;
+    for (w = 0; w < n_workers; w++) {
+        job.pixel[w] = (F64*) ((U8*) work_buffer->ptr
+                               + w * _kmeans_worker_size(bands, n_clusters));
+        job.sums[w] = job.pixel[w] + bands + n_clusters;
+        job.n_assigned[w] = (U64*) (job.sums[w]
+                                    + (U64) n_clusters * bands);
+        job.gather[w] = (U16*) (job.n_assigned[w] + n_clusters);
+    }
+
+    /* 1. Fit the clusters to the background sample */
+    n_sampled = _kmeans_seed(&job, centroids);
+    if (n_sampled < 2 && _is_sampled(sampling)) {
+        eos_log(EOS_LOG_INFO,
+            "Background sample is too small; using all pixels.");
+        job.sampling = NULL;
+        n_sampled = _kmeans_seed(&job, centroids);
+    }
+    _centroid_norms(bands, n_clusters, centroids, centroid_norms);
+    for (it = 0; it < n_iterations; it++) {
+        status = eos_run_workers(n_workers, _kmeans_assign_worker, &job);
+        if (status != EOS_SUCCESS) { return status; }
+        for (c = 0; c < n_clusters; c++) {
+            n_assigned = 0;
+            for (w = 0; w < n_workers; w++) {
+                n_assigned += job.n_assigned[w][c];
+            }
+            if (n_assigned == 0) { continue; }
+            for (b = 0; b < bands; b++) {
+                sum = &(job.sums[0][(U64) c * bands + b]);
+                for (w = 1; w < n_workers; w++) {
+                    *sum += job.sums[w][(U64) c * bands + b];
+                }
+                centroids[(U64) b * n_clusters + c] = *sum / n_assigned;
+            }
+        }
+        _centroid_norms(bands, n_clusters, centroids, centroid_norms);
+    }
+
+    /* 2. Accumulate the moments of each cluster */
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * n_workers * _kmeans_moments_size(bands, n_clusters),
+        "moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    status = _kmeans_run_moments(&job, (U64*) moments_buffer->ptr);
+    if (status != EOS_SUCCESS) { return status; }
+    counts = job.moments[0] + (U64) n_clusters * mise_moments_size(bands);
+
+    /* Keep the clusters with enough pixels for a full-rank covariance (more
+     * than bands), with their centroids (held in the means until they are
+     * stored band-major for the kept clusters) */
+    n_kept = 0;
+    for (c = 0; c < n_clusters; c++) {
+        if (counts[c] <= bands) { continue; }
+        for (b = 0; b < bands; b++) {
+            means[(U64) n_kept * bands + b] =
+                centroids[(U64) b * n_clusters + c];
+        }
+        n_kept++;
+    }
+    if (n_kept < n_clusters) {
+        /* The pixels of the dropped clusters are reassigned to the nearest
+         * kept centroid, so the moments are accumulated again; a kept
+         * cluster only gains pixels. With no cluster kept, a single class
+         * of all sampled pixels is used (whose covariance may still be
+         * rank-deficient, as for global RX). */
+        if (n_kept == 0) {
+            eos_log(EOS_LOG_INFO,
+                "Background clusters are too small; using one background.");
+            n_kept = 1;
+            memset(centroids, 0, sizeof(F64) * bands);
+            centroid_norms[0] = 0.0;
+        } else {
+            eos_log(EOS_LOG_INFO, "Reassigning the pixels of background "
+                    "clusters too small for a covariance.");
+            for (c = 0; c < n_kept; c++) {
+                for (b = 0; b < bands; b++) {
+                    centroids[(U64) b * n_kept + c] =
+                        means[(U64) c * bands + b];
+                }
+            }
+            _centroid_norms(bands, n_kept, centroids, centroid_norms);
+        }
+        job.n_clusters = n_kept;
+        status = _kmeans_run_moments(&job, (U64*) moments_buffer->ptr);
+        if (status != EOS_SUCCESS) { return status; }
+        counts = job.moments[0] + (U64) n_kept * mise_moments_size(bands);
+    }
+
+    /* 3. Factor the background of each cluster */
+    for (c = 0; c < n_kept; c++) {
+        status = _rx_factor_moments(counts[c], bands,
+            &(job.moments[0][(U64) c * mise_moments_size(bands)]),
+            &(job.moments[0][(U64) c * mise_moments_size(bands) + bands]),
+            &(means[(U64) c * bands]), &(covs[c * packed]),
+            &(factors[c].use_cholesky));
+        if (status != EOS_SUCCESS) { return status; }
+        factors[c].packed = EOS_TRUE;
+        factors[c].values = &(covs[c * packed]);
+        factors[c].values_f32 = NULL;
+    }
+    status = lifo_deallocate_buffer(moments_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(work_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* 4. Score every pixel against its own cluster */
+    clusters.n_clusters = n_kept;
+    clusters.centroids = centroids;
+    clusters.centroid_norms = centroid_norms;
+    clusters.means = means;
+    clusters.factors = factors;
+    status = _rx_score_pixels(shape, data, layout, mask, n_workers, means,
+                              &(factors[0]), NULL, &clusters, n_results,
+                              results, map);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return lifo_deallocate_buffer(cluster_buffer);
+}
+
+/*
+ * Whiten the spectra of the library against the background factor once per
+ * observation (see _score_tile_targets). With the Cholesky factor, the basis
+ * row of target s is L^-1 (s - mu), found by forward substitution; with the
+ * pseudo-inverse, it is cov^+ (s - mu). In either case its product with
+ * (s - mu) or with itself is the target's whitened squared norm, which is
+ * stored inverted (0 for a target that matches the background). work holds
+ * bands values.
+ */
+static void _whiten_targets(U32 bands, const F64* mean_pixel,
+                            const MiseFactor* factor,
+                            const EosMiseTargetLibrary* library,
+                            F64* basis, F64* inv_norms, F64* work) {
+    const F64* values = factor->values;
+    const F64* spectrum;
+    F64* w;
+    F64 a, norm;
+    U32 i, b1, b2;
+
+    for (i = 0; i < library->n_targets; i++) {
+        spectrum = &(library->spectra[(U64) i * bands]);
+        w = &(basis[(U64) i * bands]);
+        norm = 0.0;
+        if (factor->use_cholesky) {
+            for (b1 = 0; b1 < bands; b1++) {
+                a = spectrum[b1] - mean_pixel[b1];
+                for (b2 = 0; b2 < b1; b2++) {
+                    a -= values[_sym_index(bands, factor->packed, b1, b2)]
+                        * w[b2];
+                }
+                w[b1] = a / values[_sym_index(bands, factor->packed,
+                                              b1, b1)];
+                norm += w[b1] * w[b1];
+            }
+        } else {
+            for (b1 = 0; b1 < bands; b1++) {
+                work[b1] = spectrum[b1] - mean_pixel[b1];
+            }
+            for (b1 = 0; b1 < bands; b1++) {
+                a = 0.0;
+                for (b2 = 0; b2 < bands; b2++) {
+                    a += values[_sym_index(bands, factor->packed, b1, b2)]
+                        * work[b2];
+                }
+                w[b1] = a;
+                norm += work[b1] * a;
+            }
+        }
+        inv_norms[i] = (norm > 0.0) ? 1.0 / norm : 0.0;
+    }
+}
+
+/* Size in bytes of the target products and heaps of one worker, and of n
+ * results kept for the targets */
+static U64 _target_worker_size(U32 n_targets, U64 n_results) {
+    return sizeof(F64) * (U64) n_targets * MISE_SCORE_PIXEL_BLOCK
+        + sizeof(EosDetectionHeap) * n_targets
+        + sizeof(EosPixelDetection) * n_results;
+}
+
+/*
+ * Score every valid pixel against each target using n_workers workers (see
+ * _score_tile_targets), and return the top results of each target in its
+ * own result (sorted), up to the result's capacity. As in _rx_score_pixels,
+ * each worker keeps the top results of its own rows, and these are merged
+ * before sorting, so the results do not depend on the number of workers.
+ */
+static EosStatus _target_score_pixels(const EosObsShape shape,
+                                      const U16* data,
+                                      const EosMiseLayout layout,
+                                      const EosPixelMask* mask,
+                                      const U32 n_workers,
+                                      const F64* mean_pixel,
+                                      const MiseFactor* factor,
+                                      const MiseTargets* targets,
+                                      EosMiseDetectionResult* results) {
+    EosStatus status;
+    EosMemoryBuffer *tile_buffer, *scratch_buffer;
+    MiseScoreJob job;
+    U8* worker_space;
+    U64 n_results = 0;
+    U32 w, i, j;
+
+    for (i = 0; i < targets->n_targets; i++) {
+        n_results += results[i].n_results;
+    }
+
+    /* Worker 0 scores into the results arrays; the other workers also get
+     * their results from the scratch buffer */
+    status = lifo_allocate_buffer_checked(&tile_buffer,
+        _score_tile_size(shape.bands)
+        + _target_worker_size(targets->n_targets, 0), "tile buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_allocate_buffer_checked(&scratch_buffer,
+        (n_workers - 1) * (_score_tile_size(shape.bands)
+            + _target_worker_size(targets->n_targets, n_results)),
+        "worker scoring buffer");
+    if (status != EOS_SUCCESS) { return status; }
+
+    job.data = data;
+    job.shape = shape;
+    job.strides = _mise_strides(&shape, layout);
+    job.mask = mask;
+    job.region = eos_mask_region(mask, &shape);
+    job.n_workers = n_workers;
+    job.mean_pixel = mean_pixel;
+    job.factor = factor;
+    job.pca = NULL;
+    job.targets = targets;
+    job.clusters = NULL;
+    job.map = NULL;
+    job.map_row = 0;
+    worker_space = tile_buffer->ptr;
+    for (w = 0; w < n_workers; w++) {
+        if (w == 1) { worker_space = scratch_buffer->ptr; }
+        job.tile[w] = (F64*) worker_space;
+        job.product[w] = job.tile[w] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+        job.scores[w] = job.product[w] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+        job.principal[w] = job.scores[w] + MISE_SCORE_PIXEL_BLOCK;
+        job.heap[w].capacity = 0;
+        job.heap[w].size = 0;
+        job.target_product[w] = job.principal[w] + MISE_SCORE_PIXEL_BLOCK;
+        job.target_heaps[w] = (EosDetectionHeap*) (job.target_product[w]
+            + (U64) targets->n_targets * MISE_SCORE_PIXEL_BLOCK);
+        worker_space = (U8*) (job.target_heaps[w] + targets->n_targets);
+        for (i = 0; i < targets->n_targets; i++) {
+            job.target_heaps[w][i].capacity = results[i].n_results;
+            job.target_heaps[w][i].size = 0;
+            if (w == 0) {
+                job.target_heaps[w][i].data = results[i].results;
+            } else {
+                job.target_heaps[w][i].data =
+                    (EosPixelDetection*) worker_space;
+                worker_space += sizeof(EosPixelDetection)
+                                * results[i].n_results;
+            }
+        }
+    }
+
+    /* Score all pixels against all targets, keeping the top results of
+     * each target */
+    if (job.region.row_start < job.region.row_end) {
+        status = eos_run_workers(n_workers, _score_worker, &job);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    /* Merge the top results of the other workers into the results heaps */
+    for (w = 1; w < n_workers; w++) {
+        for (i = 0; i < targets->n_targets; i++) {
+            for (j = 0; j < job.target_heaps[w][i].size; j++) {
+                status = detection_heap_push(&(job.target_heaps[0][i]),
+                                             job.target_heaps[w][i].data[j]);
+                if (status != EOS_SUCCESS) { return status; }
+            }
+        }
+    }
+    for (i = 0; i < targets->n_targets; i++) {
+        status = detection_heap_sort(&(job.target_heaps[0][i]));
+        if (status != EOS_SUCCESS) { return status; }
+        results[i].n_results = job.target_heaps[0][i].size;
+    }
+
+    status = lifo_deallocate_buffer(scratch_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    return lifo_deallocate_buffer(tile_buffer);
+}
+
+U64 mise_detect_targets_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U64 moments_size, score_size;
+    U32 n, n_targets;
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+    n_targets = params->mise_max_targets;
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // mean_pixel and the packed covariance factor, as for RX
+    base_size += sizeof(F64) * n;
+    base_size += sizeof(F64) * mise_packed_size(n);
+    // The whitened targets, their inverse norms, and a spectrum of work
+    base_size += sizeof(F64) * ((U64) n_targets * n + n_targets + n);
+
+    // The background moments and pseudo-inverse workspace are freed before
+    // the whitened targets are allocated; each worker then has its own tile,
+    // target products, and heaps, and each additional worker its own top
+    // results for every target
+    moments_size = sizeof(U64) * n_workers * mise_moments_size(n)
+        + sizeof(U16) * n_workers * mise_sample_gather_size(n);
+    score_size = n_workers * (_score_tile_size(n)
+                              + _target_worker_size(n_targets, 0))
+        + (n_workers - 1) * sizeof(EosPixelDetection) * n_targets
+                          * params->mise_max_results;
+    call_size = eos_lmax(moments_size, score_size);
+    call_size = eos_lmax(call_size, _sym_inverse_work_size(n));
+
+    return base_size + call_size;
+}
+
+/*
+ * Detect the known targets of a spectral library in an observation with the
+ * matched filter (EOS_MISE_MATCHED_FILTER) or adaptive coherence estimator
+ * (EOS_MISE_ACE), returning the top results of target i in results[i], up to
+ * its capacity. The background is estimated and factored as for
+ * eos_mise_detect_anomaly_rx_sampled (with the same sampling and mask), and
+ * the library is whitened against it once. Every pixel is then scored
+ * against all targets as one blocked product of the whitened library with
+ * each tile of pixels, so that the pixels are loaded and whitened once for
+ * the whole library rather than once per target. Pixels are always scored in
+ * double precision.
+ */
+EosStatus mise_detect_targets(const EosObsShape shape, const U16* data,
+                              const EosMiseLayout layout,
+                              const EosPixelMask* mask, const U32 n_workers,
+                              const MiseSampling* sampling,
+                              const EosMiseAlgorithm alg,
+                              const EosMiseTargetLibrary* library,
+                              EosMiseDetectionResult* results) {
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor factor;
+    MiseTargets targets;
+    F64 *mean_pixel, *cov, *basis;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer, *basis_buffer;
+    U64 n_results = 0;
+    U32 i;
+
+    if (eos_assert(library != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library->n_targets == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(alg == EOS_MISE_MATCHED_FILTER || alg == EOS_MISE_ACE)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    /* If we are asked to compute 0 results, just return success */
+    for (i = 0; i < library->n_targets; i++) {
+        if (eos_assert(results[i].n_results == 0
+                       || results[i].results != NULL)) {
+            return EOS_ASSERT_ERROR;
+        }
+        n_results += results[i].n_results;
+    }
+    if (n_results == 0) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results */
+    if (eos_mask_count(mask, &shape) == 0) {
+        for (i = 0; i < library->n_targets; i++) {
+            results[i].n_results = 0;
+        }
+        return EOS_SUCCESS;
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library->spectra != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library->bands == shape.bands)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * shape.bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * mise_packed_size(shape.bands), "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    cov = (F64*) cov_buffer->ptr;
+
+    /* 1. Compute RX background from all pixels */
+    status = _rx_background(&shape, data, layout, mask, n_workers, sampling,
+                            mean_pixel, cov, &(factor.use_cholesky));
+    if (status != EOS_SUCCESS) { return status; }
+    factor.packed = EOS_TRUE;
+    factor.values = cov;
+    factor.values_f32 = NULL;
+
+    /* 2. Whiten the library against the background */
+    status = lifo_allocate_buffer_checked(&basis_buffer,
+        sizeof(F64) * ((U64) library->n_targets * shape.bands
+                       + library->n_targets + shape.bands), "basis buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    basis = (F64*) basis_buffer->ptr;
+    _whiten_targets(shape.bands, mean_pixel, &factor, library, basis,
+                    basis + (U64) library->n_targets * shape.bands,
+                    basis + (U64) library->n_targets * (shape.bands + 1));
+    targets.alg = alg;
+    targets.n_targets = library->n_targets;
+    targets.basis = basis;
+    targets.inv_norms = basis + (U64) library->n_targets * shape.bands;
+
+    /* 3. Score all pixels against all targets */
+    status = _target_score_pixels(shape, data, layout, mask, n_workers,
+                                  mean_pixel, &factor, &targets, results);
+    if (status != EOS_SUCCESS) { return status; }
+
+    // Deallocate memory in LIFO order
+    status = lifo_deallocate_buffer(basis_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    return status;
+}
+
+/* Number of targets of a spectral angle mapper index, padded to the group
+ * size */
+static U32 _sam_stride(U32 n_targets) {
+    return (n_targets + MISE_SAM_GROUP - 1) / MISE_SAM_GROUP * MISE_SAM_GROUP;
+}
+
+/*
+ * Size of the caller-provided buffers of a spectral angle mapper index of
+ * n_targets targets with the given number of bands (see
+ * mise_sam_index_build)
+ */
+EosStatus mise_sam_index_request(U32 n_targets, U32 bands,
+                                 EosMiseSamIndexRequest* req) {
+    if (eos_assert(req != NULL)) { return EOS_ASSERT_ERROR; }
+    req->band_order_size = bands;
+    req->spectra_size = (U64) bands * _sam_stride(n_targets);
+    req->tail_norms_size = _sam_stride(n_targets);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Build the spectral angle mapper index of the library (see
+ * EosMiseSamIndex): each spectrum is scaled to unit norm, and every
+ * coarse_step-th band is moved to the front as a coarse band of the
+ * pre-filter (a coarse_step of 0 or 1 makes every band coarse, which turns
+ * the pre-filter off). The norm of each spectrum beyond the coarse bands is
+ * kept to bound its angles (see _sam_classify_pixel). A spectrum of zero has
+ * no angle, so it gives EOS_VALUE_ERROR.
+ */
+EosStatus mise_sam_index_build(const EosMiseTargetLibrary* library,
+                               U32 coarse_step, EosMiseSamIndex* index) {
+    const F64* spectrum;
+    F64 norm, tail;
+    U32 n_coarse = 0, n_fine = 0;
+    U32 b, k, e;
+
+    if (eos_assert(library != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->band_order != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->spectra != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->tail_norms != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(library->n_targets == 0 || library->spectra != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    index->n_targets = library->n_targets;
+    index->bands = library->bands;
+    index->stride = _sam_stride(library->n_targets);
+    coarse_step = eos_umax(coarse_step, 1);
+    for (b = 0; b < library->bands; b++) {
+        if (b % coarse_step == 0) { n_coarse++; }
+    }
+    index->n_coarse_bands = n_coarse;
+    for (b = 0; b < library->bands; b++) {
+        if (b % coarse_step == 0) {
+            index->band_order[b / coarse_step] = b;
+        } else {
+            index->band_order[n_coarse + n_fine++] = b;
+        }
+    }
+
+    memset(index->spectra, 0,
+           sizeof(F64) * library->bands * index->stride);
+    memset(index->tail_norms, 0, sizeof(F64) * index->stride);
+    for (e = 0; e < library->n_targets; e++) {
+        spectrum = &(library->spectra[(U64) e * library->bands]);
+        norm = 0.0;
+        for (b = 0; b < library->bands; b++) {
+            norm += spectrum[b] * spectrum[b];
+        }
+        if (!(norm > 0.0)) {
+            eos_logf(EOS_LOG_ERROR, "Library spectrum %u has no angle.", e);
+            return EOS_VALUE_ERROR;
+        }
+        norm = sqrt(norm);
+        tail = 0.0;
+        for (k = 0; k < library->bands; k++) {
+            index->spectra[(U64) k * index->stride + e] =
+                spectrum[index->band_order[k]] / norm;
+            if (k >= n_coarse) {
+                tail += index->spectra[(U64) k * index->stride + e]
+                        * index->spectra[(U64) k * index->stride + e];
+            }
+        }
+        index->tail_norms[e] = sqrt(tail);
+    }
+    return EOS_SUCCESS;
+}
+
+/* State shared by the workers that classify pixels with the spectral angle
+ * mapper */
+typedef struct {
+    const U16* data;
+    EosObsShape shape;
+    MiseStrides strides;
+    const EosPixelMask* mask;
+    EosMaskRegion region;
+    U32 n_workers;
+    const EosMiseSamIndex* index;
+    F64 min_cos;                /* Cosine of the largest angle */
+    F64* pixel[EOS_MAX_WORKERS];
+    F64* dots[EOS_MAX_WORKERS];
+    EosDetectionHeap* heaps[EOS_MAX_WORKERS];   /* One per target */
+} MiseSamJob;
+
+/*
+ * Assign a pixel to the library target with the smallest spectral angle, if
+ * that angle is within the largest angle, and keep it in the worker's heap
+ * for that target with the cosine of the angle as its score.
+ *
+ * The dot products of the pixel with all targets are first accumulated over
+ * the coarse bands, a band at a time across the contiguous targets. Over the
+ * remaining bands, the dot product of the pixel's tail x_t with a target's
+ * tail s_t is bounded by |x_t| |s_t|, which bounds each target's full dot
+ * product from above and below. A group of targets whose upper bounds are
+ * all below the best lower bound (or the largest angle) cannot hold the
+ * nearest target, so its remaining bands are skipped; with a library of
+ * well-separated classes, most groups are pruned after the coarse bands.
+ */
+static EosStatus _sam_classify_pixel(MiseSamJob* job, U32 worker, U32 row,
+                                     U32 col) {
+    const EosMiseSamIndex* index = job->index;
+    const U32 stride = index->stride;
+    const U16* values;
+    F64* x = job->pixel[worker];
+    F64* dots = job->dots[worker];
+    const F64* s;
+    EosPixelDetection det;
+    F64 norm = 0.0, coarse = 0.0;
+    F64 tail, bound, lower;
+    U32 k, e, g, best, keep;
+
+    values = &(job->data[_pixel_offset(&(job->strides), job->shape.cols,
+                                       (U64) row * job->shape.cols + col)]);
+    for (k = 0; k < index->bands; k++) {
+        x[k] = values[(U64) index->band_order[k] * job->strides.band];
+        norm += x[k] * x[k];
+        if (k < index->n_coarse_bands) { coarse += x[k] * x[k]; }
+    }
+    /* A pixel of zero has no angle */
+    if (norm == 0.0) { return EOS_SUCCESS; }
+    tail = (norm > coarse) ? sqrt(norm - coarse) : 0.0;
+    norm = sqrt(norm);
+
+    memset(dots, 0, sizeof(F64) * stride);
+    for (k = 0; k < index->n_coarse_bands; k++) {
+        s = &(index->spectra[(U64) k * stride]);
+        for (e = 0; e < stride; e++) {
+            dots[e] += x[k] * s[e];
+        }
+    }
+
+    if (index->n_coarse_bands < index->bands) {
+        bound = job->min_cos * norm;
+        for (e = 0; e < index->n_targets; e++) {
+            lower = dots[e] - tail * index->tail_norms[e];
+            if (lower > bound) { bound = lower; }
+        }
+        bound -= MISE_SAM_PRUNE_SLACK * norm;
+
+        for (g = 0; g < index->n_targets; g += MISE_SAM_GROUP) {
+            keep = EOS_FALSE;
+            for (e = g; e < eos_umin(g + MISE_SAM_GROUP, index->n_targets);
+                    e++) {
+                if (dots[e] + tail * index->tail_norms[e] >= bound) {
+                    keep = EOS_TRUE;
+                }
+            }
+            if (!keep) {
+                for (e = g; e < g + MISE_SAM_GROUP; e++) {
+                    dots[e] = -DBL_MAX;
+                }
+                continue;
+            }
+            for (k = index->n_coarse_bands; k < index->bands; k++) {
+                s = &(index->spectra[(U64) k * stride + g]);
+                for (e = 0; e < MISE_SAM_GROUP; e++) {
+                    dots[g + e] += x[k] * s[e];
+                }
+            }
+        }
+    }
+
+    best = 0;
+    for (e = 1; e < index->n_targets; e++) {
+        if (dots[e] > dots[best]) { best = e; }
+    }
+    det.row = row;
+    det.col = col;
+    det.score = dots[best] / norm;
+    if (!(det.score >= job->min_cos)) { return EOS_SUCCESS; }
+    return detection_heap_push(&(job->heaps[worker][best]), det);
+}
+
+/* Classify the valid pixels of one slab of rows of the region of interest */
+static EosStatus _sam_worker(void* context, U32 worker) {
+    MiseSamJob* job = (MiseSamJob*) context;
+    const EosMaskRegion region = job->region;
+    const U32 rows = region.row_end - region.row_start;
+    const U32 cols = job->shape.cols;
+    EosStatus status;
+    U32 row, row_start, row_end, col;
+
+    row_start = region.row_start
+        + (U32) (((U64) worker * rows) / job->n_workers);
+    row_end = region.row_start
+        + (U32) (((U64) (worker + 1) * rows) / job->n_workers);
+
+    for (row = row_start; row < row_end; row++) {
+        for (col = eos_mask_next(job->mask, cols, row, region.col_start,
+                                 region.col_end);
+                col < region.col_end;
+                col = eos_mask_next(job->mask, cols, row, col + 1,
+                                    region.col_end)) {
+            status = _sam_classify_pixel(job, worker, row, col);
+            if (status != EOS_SUCCESS) { return status; }
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/* Size in bytes of the pixel, dot products, and heaps of one worker, and of
+ * n results kept for the targets */
+static U64 _sam_worker_size(U32 bands, U32 n_targets, U64 n_results) {
+    return sizeof(F64) * ((U64) bands + _sam_stride(n_targets))
+        + sizeof(EosDetectionHeap) * n_targets
+        + sizeof(EosPixelDetection) * n_results;
+}
+
+U64 mise_classify_sam_mreq(const EosInitParams* params) {
+    U32 n_workers;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n_workers = eos_umax(params->mise_workers, 1);
+
+    // Each worker has its own pixel, dot products, and heaps, and each
+    // additional worker its own top results for every target
+    return n_workers * _sam_worker_size(params->mise_max_bands,
+                                        params->mise_max_targets, 0)
+        + (n_workers - 1) * sizeof(EosPixelDetection)
+          * params->mise_max_targets * params->mise_max_results;
+}
+
+/*
+ * Classify the pixels of an observation with the spectral angle mapper:
+ * each valid pixel (see EosPixelMask; NULL for all pixels) is assigned to
+ * the target of the index (see mise_sam_index_build) with the smallest
+ * angle, if that angle is at most max_angle (in radians), and the top
+ * results of target i, ranked by the cosine of the angle (1 for a pixel
+ * with exactly the target's shape), are returned in results[i], up to its
+ * capacity. No background is estimated, so this costs O(bands n_targets)
+ * per pixel at most, and much less once the pre-filter prunes most targets.
+ * As for RX, each of the n_workers workers keeps the top results of its own
+ * rows, so the results do not depend on the number of workers.
+ */
+EosStatus mise_classify_sam(const EosObsShape shape, const U16* data,
+                            const EosMiseLayout layout,
+                            const EosPixelMask* mask, const U32 n_workers,
+                            const F64 max_angle,
+                            const EosMiseSamIndex* index,
+                            EosMiseDetectionResult* results) {
+    EosStatus status;
+    EosMemoryBuffer* worker_buffer;
+    MiseSamJob job;
+    U8* worker_space;
+    U64 n_results = 0;
+    U32 w, i, j;
+
+    if (eos_assert(index != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->n_targets == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+
+    /* If we are asked to compute 0 results, just return success */
+    for (i = 0; i < index->n_targets; i++) {
+        if (eos_assert(results[i].n_results == 0
+                       || results[i].results != NULL)) {
+            return EOS_ASSERT_ERROR;
+        }
+        n_results += results[i].n_results;
+    }
+    if (n_results == 0) {
+        return EOS_SUCCESS;
+    }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results */
+    if (eos_mask_count(mask, &shape) == 0) {
+        for (i = 0; i < index->n_targets; i++) {
+            results[i].n_results = 0;
+        }
+        return EOS_SUCCESS;
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(index->bands == shape.bands)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    /* Worker 0 keeps its results in the results arrays */
+    status = lifo_allocate_buffer_checked(&worker_buffer,
+        n_workers * _sam_worker_size(shape.bands, index->n_targets, 0)
+        + (n_workers - 1) * sizeof(EosPixelDetection) * n_results,
+        "worker classification buffer");
+    if (status != EOS_SUCCESS) { return status; }
+
+    job.data = data;
+    job.shape = shape;
+    job.strides = _mise_strides(&shape, layout);
+    job.mask = mask;
+    job.region = eos_mask_region(mask, &shape);
+    job.n_workers = n_workers;
+    job.index = index;
+    job.min_cos = cos(max_angle);
+    worker_space = worker_buffer->ptr;
+    for (w = 0; w < n_workers; w++) {
+        job.pixel[w] = (F64*) worker_space;
+        job.dots[w] = job.pixel[w] + shape.bands;
+        job.heaps[w] = (EosDetectionHeap*) (job.dots[w] + index->stride);
+        worker_space = (U8*) (job.heaps[w] + index->n_targets);
+        for (i = 0; i < index->n_targets; i++) {
+            job.heaps[w][i].capacity = results[i].n_results;
+            job.heaps[w][i].size = 0;
+            if (w == 0) {
+                job.heaps[w][i].data = results[i].results;
+            } else {
+                job.heaps[w][i].data = (EosPixelDetection*) worker_space;
+                worker_space += sizeof(EosPixelDetection)
+                                * results[i].n_results;
+            }
+        }
+    }
+
+    if (job.region.row_start < job.region.row_end) {
+        status = eos_run_workers(n_workers, _sam_worker, &job);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+
+    /* Merge the top results of the other workers into the results heaps */
+    for (w = 1; w < n_workers; w++) {
+        for (i = 0; i < index->n_targets; i++) {
+            for (j = 0; j < job.heaps[w][i].size; j++) {
+                status = detection_heap_push(&(job.heaps[0][i]),
+                                             job.heaps[w][i].data[j]);
+                if (status != EOS_SUCCESS) { return status; }
+            }
+        }
+    }
+    for (i = 0; i < index->n_targets; i++) {
+        status = detection_heap_sort(&(job.heaps[0][i]));
+        if (status != EOS_SUCCESS) { return status; }
+        results[i].n_results = job.heaps[0][i].size;
+    }
+
+    return lifo_deallocate_buffer(worker_buffer);
+}
+
+/*
+ * Size of the caller-provided state for streaming an observation with the
+ * given number of bands (see mise_stream_begin)
+ */
+EosStatus mise_stream_state_request(U32 bands,
+                                    EosMiseStreamStateRequest* req) {
+    if (eos_assert(req != NULL)) { return EOS_ASSERT_ERROR; }
+    req->moments_size = mise_moments_size(bands);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Start streaming an observation with the given number of columns and bands.
+ * The state's moments buffer must be provided by the caller, with the size
+ * given by mise_stream_state_request.
+ */
+EosStatus mise_stream_begin(U32 cols, U32 bands, EosMiseStreamState* state) {
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->moments != NULL)) { return EOS_ASSERT_ERROR; }
+
+    state->shape.rows = 0;
+    state->shape.cols = cols;
+    state->shape.bands = bands;
+    state->layout = EOS_MISE_BIP;
+    memset(state->moments, 0, sizeof(U64) * mise_moments_size(bands));
+    return EOS_SUCCESS;
+}
+
+/*
+ * Accumulate the background moments of the next n_rows rows of a streamed
+ * observation. The block of rows is stored in the layout state->layout (as
+ * if it were an observation of n_rows rows), and is only read during this
+ * call.
+ */
+EosStatus mise_stream_push_rows(EosMiseStreamState* state, U32 n_rows,
+                                const U16* rows) {
+    EosObsShape shape;
+
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->moments != NULL)) { return EOS_ASSERT_ERROR; }
+    if (n_rows == 0) { return EOS_SUCCESS; }
+    if (eos_assert(rows != NULL)) { return EOS_ASSERT_ERROR; }
+
+    shape = state->shape;
+    shape.rows = n_rows;
+    state->shape.rows += n_rows;
+    return accumulate_moments(rows, &shape, state->layout, state->moments,
+                              state->moments + shape.bands);
+}
+
+/*
+ * Size of the caller-provided state of a resumable RX detection for
+ * observations with the given number of bands (see mise_rx_job_begin)
+ */
+EosStatus mise_rx_job_state_request(U32 bands, EosMiseRxJobStateRequest* req) {
+    if (eos_assert(req != NULL)) { return EOS_ASSERT_ERROR; }
+    req->moments_size = mise_moments_size(bands);
+    req->vector_size = bands;
+    req->factor_size = mise_packed_size(bands);
+    req->pseudo_inverse_pixels = (U64) MISE_RX_JOB_PSEUDO_INVERSE_PIXELS
+                                 * bands;
+    return EOS_SUCCESS;
+}
+
+/* Size in bytes of the workspace of a step of a resumable RX detection */
+U64 mise_rx_job_step_mreq(const EosInitParams* params) {
+    U64 moments_size;
+    U32 n;
+
+    if (eos_assert(params != NULL)) { return 0; }
+    n = params->mise_max_bands;
+
+    // Partial moments of a slab of gathered pixels, the pseudo-inverse
+    // workspace, or the scoring tile, one step at a time
+    moments_size = sizeof(U64) * mise_moments_size(n)
+        + sizeof(U16) * mise_sample_gather_size(n);
+    return eos_lmax(eos_lmax(moments_size, _sym_inverse_work_size(n)),
+                    _score_tile_size(n));
+}
+
+/*
+ * Start a resumable RX detection of the observation, with the precision and
+ * background sample given by params. The top
+ * results are kept in result->results, whose capacity is result->n_results.
+ * The observation's data and mask, and the results array, are read and
+ * written by the steps of the job, so they must not change until it ends.
+ */
+EosStatus mise_rx_job_begin(const EosMiseParams* params,
+                            const EosMiseObservation* observation,
+                            EosMiseDetectionResult* result,
+                            EosMiseRxJobState* state) {
+    const U32 bands = observation->shape.bands;
+
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->moments != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->mean_pixel != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->factor != NULL)) { return EOS_ASSERT_ERROR; }
+
+    state->params = *params;
+    state->observation = *observation;
+    state->result = result;
+    state->max_results = result->n_results;
+    state->phase = MISE_RX_JOB_BACKGROUND;
+    state->sampled = (params->background_sampling != EOS_MISE_SAMPLE_ALL);
+    state->next_row = 0;
+    state->next_col = 0;
+    state->n_background = 0;
+    state->use_cholesky = EOS_FALSE;
+    state->factor_threshold = 0.0;
+    state->n_results = 0;
+    memset(state->moments, 0, sizeof(U64) * mise_moments_size(bands));
+
+    /* An empty observation has no work */
+    if (eos_mask_count(observation->mask, &(observation->shape)) == 0
+            || state->max_results == 0) {
+        result->n_results = 0;
+        state->phase = MISE_RX_JOB_DONE;
+    } else if (eos_assert(observation->data != NULL)
+            || eos_assert(result->results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Accumulate the background moments of the next rows of the region of
+ * interest, at least one row and about budget pixels (see mise_rx_job_step)
+ */
+static EosStatus _rx_job_background(EosMiseRxJobState* state, U64 budget) {
+    EosStatus status;
+    const EosMiseObservation* obs = &(state->observation);
+    const U32 bands = obs->shape.bands;
+    const EosMaskRegion region = eos_mask_region(obs->mask, &(obs->shape));
+    const U32 cols = region.col_end - region.col_start;
+    EosMemoryBuffer* moments_buffer;
+    MiseMomentsJob job;
+    MiseSampling sampling;
+    U64 *sum, *sum_sq, n_sampled, i;
+    U32 row_start, row_end;
+
+    if (state->next_row < region.row_start) {
+        state->next_row = region.row_start;
+    }
+    row_start = state->next_row;
+    row_end = region.row_end;
+    if (budget / cols < row_end - row_start) {
+        row_end = row_start + (U32) eos_lmax(1, (I64) (budget / cols));
+    }
+
+    sampling.mode = state->sampled ? state->params.background_sampling
+                                   : EOS_MISE_SAMPLE_ALL;
+    sampling.step = state->params.background_sample_step;
+    sampling.seed = state->params.background_sample_seed;
+    if (_is_gathered(&sampling, obs->mask)) {
+        /* Gathered pixels are accumulated into partial moments, which are
+         * then added to the job's */
+        status = lifo_allocate_buffer_checked(&moments_buffer,
+            sizeof(U64) * mise_moments_size(bands)
+            + sizeof(U16) * mise_sample_gather_size(bands),
+            "moments buffer");
+        if (status != EOS_SUCCESS) { return status; }
+        sum = (U64*) moments_buffer->ptr;
+        sum_sq = sum + bands;
+
+        job.data = obs->data;
+        job.layout = obs->layout;
+        job.shape = obs->shape;
+        job.mask = obs->mask;
+        job.region = region;
+        job.sampling = &sampling;
+        status = _sampled_moments(&job, row_start, row_end,
+            (U16*) (sum + mise_moments_size(bands)), sum, sum_sq,
+            &n_sampled);
+        if (status != EOS_SUCCESS) { return status; }
+        for (i = 0; i < mise_moments_size(bands); i++) {
+            state->moments[i] += sum[i];
+        }
+        state->n_background += n_sampled;
+
+        status = lifo_deallocate_buffer(moments_buffer);
+        if (status != EOS_SUCCESS) { return status; }
+    } else {
+        _update_moments(obs->data, &(obs->shape), obs->layout, row_start,
+                        row_end, EOS_TRUE, state->moments,
+                        state->moments + bands);
+        state->n_background += (U64) (row_end - row_start) * cols;
+    }
+
+    state->next_row = row_end;
+    if (row_end == region.row_end) {
+        if (state->n_background < 2 && state->sampled) {
+            /* As for _background_moments, a sample too small for a
+             * covariance is replaced by all valid pixels */
+            eos_log(EOS_LOG_INFO,
+                "Background sample is too small; using all pixels.");
+            state->sampled = EOS_FALSE;
+            state->next_row = 0;
+            state->n_background = 0;
+            memset(state->moments, 0, sizeof(U64) * mise_moments_size(bands));
+        } else {
+            state->phase = MISE_RX_JOB_FACTOR;
+        }
+    }
     return EOS_SUCCESS;
+}
 
+/* Finish factoring the background of the job for scoring */
+static void _rx_job_factored(EosMiseRxJobState* state, U32 use_cholesky) {
+    _factor_f32(mise_packed_size(state->observation.shape.bands),
+                state->factor, state->params.precision);
+    state->use_cholesky = use_cholesky;
+    state->phase = MISE_RX_JOB_SCORE;
+    state->next_row = 0;
+    state->next_col = 0;
 }
-/***********************************************************/
 
-/* Compute the RX score of the mean-subtracted observation
- * with respect to the (inverse) covariance matrix
- *    rx_score = np.dot(np.dot(sub, cov_inv), sub.T)
+/*
+ * Do the next columns of the Cholesky factorization of the background of
+ * the job, at least one and about as many multiply-adds as scoring budget
+ * pixels (bands^2 / 2 each); state->next_col is the next column. A
+ * rank-deficient covariance moves the job to the pseudo-inverse (see
+ * _rx_factor_moments).
  */
-EosStatus _rx_score(F64* mean_sub, F64* cov_inv, const EosObsShape shape,
-        F64* temp, F64* score) {
+static EosStatus _rx_job_factor(EosMiseRxJobState* state, U64 budget) {
+    EosStatus status;
+    const U32 bands = state->observation.shape.bands;
+    const U64 pixel_work = (U64) bands * bands / 2 + 1;
+    U64 work = 0;
+    U32 col_end;
 
-    U32 b1, b2;
-    if (eos_assert(mean_sub != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(cov_inv != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(temp != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(score != NULL)) { return EOS_ASSERT_ERROR; }
+    if (budget == 0) { budget = 1; }
+    if (state->next_col == 0) {
+        status = moments_to_mean_covariance_packed(state->n_background,
+            bands, state->moments, state->moments + bands,
+            state->mean_pixel, state->factor);
+        if (status != EOS_SUCCESS) { return status; }
+        state->factor_threshold = _cholesky_threshold(bands, state->factor);
+    }
 
-    // Initialize score to zero
-    *score = 0.0;
+    col_end = state->next_col;
+    do {
+        work += (U64) (bands - col_end) * (bands - col_end) / 2;
+        col_end++;
+    } while (col_end < bands && work / pixel_work < budget);
 
-    /* compute mean_sub . cov_inv */
-    for (b1 = 0; b1 < shape.bands; b1++) {
-        temp[b1] = 0.0;
-        for (b2 = 0; b2 < shape.bands; b2++) {
-            temp[b1] += mean_sub[b2] * cov_inv[b2 * shape.bands + b1];
+    status = _cholesky_packed_columns(bands, state->factor,
+        state->factor_threshold, state->next_col, col_end);
+    if (status == EOS_VALUE_ERROR) {
+        state->phase = MISE_RX_JOB_PSEUDO_INVERSE;
+        return EOS_SUCCESS;
+    }
+    if (status != EOS_SUCCESS) { return status; }
+
+    state->next_col = col_end;
+    if (col_end == bands) {
+        _rx_job_factored(state, EOS_TRUE);
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Replace the rank-deficient background of the job, which the failed
+ * factorization destroyed, by the pseudo-inverse of its covariance, in a
+ * step of its own
+ */
+static EosStatus _rx_job_pseudo_inverse(EosMiseRxJobState* state) {
+    EosStatus status;
+    const U32 bands = state->observation.shape.bands;
+
+    status = moments_to_mean_covariance_packed(state->n_background, bands,
+        state->moments, state->moments + bands, state->mean_pixel,
+        state->factor);
+    if (status != EOS_SUCCESS) { return status; }
+    status = _rx_pseudo_inverse(bands, EOS_TRUE, state->factor,
+                                state->factor);
+    if (status != EOS_SUCCESS) { return status; }
+
+    _rx_job_factored(state, EOS_FALSE);
+    return EOS_SUCCESS;
+}
+
+/*
+ * Score the next valid pixels of the region of interest, at least one and
+ * at most about budget, a tile at a time; the top results so far are kept
+ * as a heap in the results array
+ */
+static EosStatus _rx_job_score(EosMiseRxJobState* state, U64 budget) {
+    EosStatus status;
+    const EosMiseObservation* obs = &(state->observation);
+    const EosObsShape shape = obs->shape;
+    EosMemoryBuffer* tile_buffer;
+    MiseScoreJob job;
+    MiseFactor factor;
+    U64 pixels[MISE_SCORE_PIXEL_BLOCK];
+    U64 n_scored = 0;
+    U32 n_pixels = 0;
+    U32 row, col;
+
+    status = lifo_allocate_buffer_checked(&tile_buffer,
+        _score_tile_size(shape.bands), "tile buffer");
+    if (status != EOS_SUCCESS) { return status; }
+
+    factor.use_cholesky = state->use_cholesky;
+    factor.packed = EOS_TRUE;
+    factor.values = state->factor;
+    factor.values_f32 = (state->params.precision
+                         == EOS_MISE_SINGLE_PRECISION) ?
+                        (const F32*) state->factor : NULL;
+    job.data = obs->data;
+    job.shape = shape;
+    job.strides = _mise_strides(&shape, obs->layout);
+    job.mask = obs->mask;
+    job.region = eos_mask_region(obs->mask, &shape);
+    job.n_workers = 1;
+    job.mean_pixel = state->mean_pixel;
+    job.factor = &factor;
+    job.pca = NULL;
+    job.targets = NULL;
+    job.clusters = NULL;
+    job.map = NULL;
+    job.map_row = 0;
+    job.tile[0] = (F64*) tile_buffer->ptr;
+    job.product[0] = job.tile[0] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+    job.scores[0] = job.product[0] + shape.bands * MISE_SCORE_PIXEL_BLOCK;
+    job.principal[0] = job.scores[0] + MISE_SCORE_PIXEL_BLOCK;
+    job.heap[0].data = state->result->results;
+    job.heap[0].capacity = state->max_results;
+    job.heap[0].size = state->n_results;
+
+    /* Resume from the next pixel, which is within the region of interest */
+    row = eos_umax(state->next_row, job.region.row_start);
+    col = eos_umax(state->next_col, job.region.col_start);
+    if (budget == 0) { budget = 1; }
+    for (; row < job.region.row_end && n_scored < budget; row++) {
+        for (col = eos_mask_next(obs->mask, shape.cols, row, col,
+                                 job.region.col_end);
+                col < job.region.col_end && n_scored < budget;
+                col = eos_mask_next(obs->mask, shape.cols, row, col + 1,
+                                    job.region.col_end)) {
+            pixels[n_pixels++] = (U64) row * shape.cols + col;
+            n_scored++;
+            if (n_pixels == MISE_SCORE_PIXEL_BLOCK) {
+                status = _score_tile(&job, 0, 0, pixels, n_pixels);
+                if (status != EOS_SUCCESS) { return status; }
+                n_pixels = 0;
+            }
         }
+        if (col < job.region.col_end) { break; }
+        col = job.region.col_start;
     }
-    /* compute (mean_sub . cov_inv) . mean_sub */
-    for (b1 = 0; b1 < shape.bands; b1++) {
-        *score += temp[b1] * mean_sub[b1];
+    if (n_pixels > 0) {
+        status = _score_tile(&job, 0, 0, pixels, n_pixels);
+        if (status != EOS_SUCCESS) { return status; }
     }
+    state->next_row = row;
+    state->next_col = col;
+    state->n_results = job.heap[0].size;
+
+    status = lifo_deallocate_buffer(tile_buffer);
+    if (status != EOS_SUCCESS) { return status; }
 
+    if (row >= job.region.row_end) {
+        status = detection_heap_sort(&(job.heap[0]));
+        if (status != EOS_SUCCESS) { return status; }
+        state->result->n_results = state->n_results;
+        state->phase = MISE_RX_JOB_DONE;
+    }
     return EOS_SUCCESS;
+}
+
+/*
+ * Do the next part of a resumable RX detection: accumulate the background
+ * moments of about budget pixels (in whole rows, at least one), factor the
+ * background (in columns of about as much work as scoring budget pixels, at
+ * least one), or score about budget pixels. A rank-deficient background is
+ * instead pseudo-inverted in a step of its own, which costs about as much as
+ * scoring pseudo_inverse_pixels (see mise_rx_job_state_request). Returns
+ * EOS_IN_PROGRESS while work remains, and EOS_SUCCESS once the results are
+ * complete (and on any later call). Each step runs on the calling thread.
+ *
+ * The background is accumulated with exact integer moments and each pixel is
+ * scored as in eos_mise_detect_anomaly_rx_sampled, so the results are
+ * identical to those of a single call, whatever the budget.
+ */
+EosStatus mise_rx_job_step(EosMiseRxJobState* state, U64 budget) {
+    EosStatus status;
+
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
 
+    switch (state->phase) {
+        case MISE_RX_JOB_BACKGROUND:
+            status = _rx_job_background(state, budget);
+            break;
+        case MISE_RX_JOB_FACTOR:
+            status = _rx_job_factor(state, budget);
+            break;
+        case MISE_RX_JOB_PSEUDO_INVERSE:
+            status = _rx_job_pseudo_inverse(state);
+            break;
+        case MISE_RX_JOB_SCORE:
+            status = _rx_job_score(state, budget);
+            break;
+        case MISE_RX_JOB_DONE:
+            return EOS_SUCCESS;
+        default:
+            eos_logf(EOS_LOG_ERROR, "Invalid RX job phase %u.", state->phase);
+            return EOS_PARAM_ERROR;
+    }
+    if (status != EOS_SUCCESS) { return status; }
+    return (state->phase == MISE_RX_JOB_DONE) ? EOS_SUCCESS : EOS_IN_PROGRESS;
 }
 
-U64 eos_mise_detect_anomaly_rx_mreq(const EosInitParams* params) {
+/*
+ * Size of the caller-provided persistent background for observations with
+ * the given number of bands (see mise_background_init)
+ */
+EosStatus mise_background_state_request(U32 bands,
+                                        EosMiseBackgroundStateRequest* req) {
+    if (eos_assert(req != NULL)) { return EOS_ASSERT_ERROR; }
+    req->vector_size = bands;
+    req->matrix_size = (U64) bands * bands;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Start an empty persistent background for observations with the given
+ * number of bands. The state's arrays must be provided by the caller, with
+ * the sizes given by mise_background_state_request.
+ */
+EosStatus mise_background_init(U32 bands, EosMiseBackgroundState* state) {
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->mean_pixel != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->cov != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->factor_mean_pixel != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(state->factor_cov != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->factor != NULL)) { return EOS_ASSERT_ERROR; }
+
+    state->bands = bands;
+    state->use_cholesky = EOS_FALSE;
+    state->n_observations = 0;
+    state->n_factorizations = 0;
+    state->weight = 0.0;
+    memset(state->mean_pixel, 0, sizeof(F64) * bands);
+    memset(state->cov, 0, sizeof(F64) * bands * bands);
+    return EOS_SUCCESS;
+}
+
+EosStatus mise_pca_basis_state_request(U32 bands, U32 n_components,
+                                       EosMisePcaBasisStateRequest* req) {
+    if (eos_assert(req != NULL)) { return EOS_ASSERT_ERROR; }
+    req->basis_size = (U64) n_components * bands;
+    return EOS_SUCCESS;
+}
+
+EosStatus mise_pca_basis_init(U32 bands, U32 n_components,
+                              EosMisePcaBasisState* state) {
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state->basis != NULL)) { return EOS_ASSERT_ERROR; }
+
+    state->bands = bands;
+    state->n_components = n_components;
+    state->n_iterations = 0;
+    state->n_observations = 0;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Merge the mean and covariance of an observation of n_pixels pixels into
+ * the background, after scaling the background's weight by forgetting. With
+ * W = forgetting * weight and d = obs_mean - mean, the scatter matrices are
+ * pooled as
+ *    S' = forgetting * S + S_obs + (W n / (W + n)) d d'
+ * (Chan et al.), where S = (weight - 1) cov; with forgetting = 1, this is the
+ * covariance of all pixels merged so far.
+ */
+static void _background_merge(EosMiseBackgroundState* state, F64 forgetting,
+                              U64 n_pixels, const F64* obs_mean,
+                              const F64* obs_cov) {
+    const U32 n = state->bands;
+    const F64 n_obs = (F64) n_pixels;
+    F64 kept, total, scale, between;
+    U32 b1, b2;
+
+    if (state->n_observations == 0) {
+        memcpy(state->mean_pixel, obs_mean, sizeof(F64) * n);
+        memcpy(state->cov, obs_cov, sizeof(F64) * n * n);
+        state->weight = n_obs;
+        state->n_observations = 1;
+        return;
+    }
+
+    kept = forgetting * state->weight;
+    total = kept + n_obs;
+    scale = forgetting * (state->weight - 1.0);
+    between = kept * n_obs / total;
+    for (b1 = 0; b1 < n; b1++) {
+        const F64 d1 = obs_mean[b1] - state->mean_pixel[b1];
+        for (b2 = 0; b2 < n; b2++) {
+            const F64 d2 = obs_mean[b2] - state->mean_pixel[b2];
+            state->cov[b1 * n + b2] = (scale * state->cov[b1 * n + b2]
+                + (n_obs - 1.0) * obs_cov[b1 * n + b2]
+                + between * d1 * d2) / (total - 1.0);
+        }
+    }
+    for (b1 = 0; b1 < n; b1++) {
+        state->mean_pixel[b1] +=
+            (n_obs / total) * (obs_mean[b1] - state->mean_pixel[b1]);
+    }
+    state->weight = total;
+    state->n_observations++;
+}
+
+/*
+ * Drift of the current background from the factored one: the larger of the
+ * mean shift relative to the total standard deviation,
+ *    ||mean - factor_mean|| / sqrt(trace(factor_cov)),
+ * and the relative change in covariance,
+ *    ||cov - factor_cov||_F / ||factor_cov||_F.
+ * Both cost O(bands^2), against O(bands^3) for the factorization.
+ */
+static F64 _background_drift(const EosMiseBackgroundState* state) {
+    const U32 n = state->bands;
+    F64 shift = 0.0, trace = 0.0, change = 0.0, norm = 0.0;
+    F64 diff, mean_drift, cov_drift;
+    U32 i;
+
+    for (i = 0; i < n; i++) {
+        diff = state->mean_pixel[i] - state->factor_mean_pixel[i];
+        shift += diff * diff;
+        trace += state->factor_cov[i * n + i];
+    }
+    for (i = 0; i < n * n; i++) {
+        diff = state->cov[i] - state->factor_cov[i];
+        change += diff * diff;
+        norm += state->factor_cov[i] * state->factor_cov[i];
+    }
+
+    /* A background with no variance has drifted if it changed at all */
+    if (trace <= 0.0 || norm <= 0.0) {
+        return (shift > 0.0 || change > 0.0) ? DBL_MAX : 0.0;
+    }
+    mean_drift = sqrt(shift / trace);
+    cov_drift = sqrt(change / norm);
+    return (mean_drift > cov_drift) ? mean_drift : cov_drift;
+}
+
+U64 eos_mise_detect_anomaly_rx_background_mreq(const EosInitParams* params) {
     U64 base_size = 0;
     U64 call_size = 0;
+    U64 merge_size, score_size;
     U32 n;
+    U32 n_workers;
 
     if (eos_assert(params != NULL)) { return 0; }
 
     n = params->mise_max_bands;
+    n_workers = eos_umax(params->mise_workers, 1);
 
-    // mean_pixel, mean_sub, and temp
+    // The observation's mean pixel and covariance, and its moments (with the
+    // partial moments and gathered pixels of each worker), are freed once
+    // merged into the background, before the background is factored (the
+    // pseudo-inverse needs a workspace) and the pixels are scored (by
+    // _rx_score_pixels)
+    merge_size = sizeof(F64) * (n + (U64) n * n)
+        + sizeof(U64) * n_workers * mise_moments_size(n)
+        + sizeof(U16) * n_workers * mise_sample_gather_size(n);
+    score_size = _score_tile_size(n)
+        + (n_workers - 1) * _score_worker_size(n, params->mise_max_results);
+    call_size = (merge_size > score_size) ? merge_size : score_size;
+    call_size = (_sym_inverse_work_size(n) > call_size) ?
+                _sym_inverse_work_size(n) : call_size;
+
+    return base_size + call_size;
+}
+
+/*
+ * Use the RX algorithm with a background carried across observations: merge
+ * this observation into the background (see _background_merge), factor the
+ * background again only if it has drifted by more than drift_tolerance from
+ * the factored one (see _background_drift), and rank all pixels against the
+ * factored background. Once the background has settled, each observation
+ * costs one pass for the moments and one for scoring, with no O(bands^3)
+ * factorization.
+ *
+ * The observation is merged even if no results are requested. If the
+ * background is sampled or masked (see compute_moments_sampled), the
+ * observation is weighted by the number of pixels in its sample, and an
+ * observation with no valid pixels is neither merged nor scored.
+ */
+EosStatus eos_mise_detect_anomaly_rx_background(const EosObsShape shape,
+                                                const U16* data,
+                                                const EosMiseLayout layout,
+                                                const EosPixelMask* mask,
+                                                const U32 n_workers,
+                                                const F64 forgetting,
+                                                const F64 drift_tolerance,
+                                                const MiseSampling* sampling,
+                                                EosMiseBackgroundState* state,
+                                                U32* n_results,
+                                                EosPixelDetection* results) {
+
+    EosStatus status = EOS_SUCCESS;
+    MiseFactor factor;
+    F64 *obs_mean, *obs_cov;
+    U64 *moments;
+    U64 n_background;
+    EosMemoryBuffer *mean_pixel_buffer, *cov_buffer, *moments_buffer;
+    const U64 moments_size = mise_moments_size(shape.bands);
+
+    if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(state != NULL)) { return EOS_ASSERT_ERROR; }
+
+    /* If the observation (or the part of it selected by the mask) is
+     * empty, return success with zero results */
+    if (eos_mask_count(mask, &shape) == 0) {
+        *n_results = 0;
+        return EOS_SUCCESS;
+    }
+
+    if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(state->bands == shape.bands)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(forgetting > 0 && forgetting <= 1)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(n_workers >= 1)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+    /* 1. Merge the observation into the background */
+    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
+        sizeof(F64) * shape.bands, "mean pixel buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    obs_mean = (F64*) mean_pixel_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&cov_buffer,
+        sizeof(F64) * shape.bands * shape.bands, "cov buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    obs_cov = (F64*) cov_buffer->ptr;
+
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * n_workers * moments_size
+        + _sample_gather_bytes(sampling, mask, shape.bands,
+                               n_workers),
+        "moments buffer");
+    if (status != EOS_SUCCESS) { return status; }
+    moments = (U64*) moments_buffer->ptr;
+
+    status = _background_moments(&shape, data, layout, mask, n_workers,
+        sampling, moments + moments_size,
+        (U16*) (moments + n_workers * moments_size),
+        moments, moments + shape.bands, &n_background);
+    if (status != EOS_SUCCESS) { return status; }
+    status = moments_to_mean_covariance(n_background, shape.bands,
+        moments, moments + shape.bands, obs_mean, obs_cov);
+    if (status != EOS_SUCCESS) { return status; }
+    _background_merge(state, forgetting, n_background, obs_mean, obs_cov);
+
+    status = lifo_deallocate_buffer(moments_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(cov_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    if (status != EOS_SUCCESS) { return status; }
+
+    /* 2. Factor the background again if it has drifted */
+    if (state->n_factorizations == 0
+            || _background_drift(state) > drift_tolerance) {
+        memcpy(state->factor_mean_pixel, state->mean_pixel,
+               sizeof(F64) * shape.bands);
+        memcpy(state->factor_cov, state->cov,
+               sizeof(F64) * shape.bands * shape.bands);
+        status = _rx_factor(shape.bands, state->factor_cov, state->factor,
+                            &(state->use_cholesky));
+        if (status != EOS_SUCCESS) { return status; }
+        state->n_factorizations++;
+    }
+
+    /* 3. Score all pixels against the factored background */
+    if (*n_results == 0) {
+        return EOS_SUCCESS;
+    }
+    factor.use_cholesky = state->use_cholesky;
+    factor.packed = EOS_FALSE;
+    factor.values = state->factor;
+    factor.values_f32 = NULL;
+    return _rx_score_pixels(shape, data, layout, mask, n_workers,
+                            state->factor_mean_pixel, &factor, NULL, NULL,
+                            n_results, results, NULL);
+}
+
+U64 eos_mise_detect_anomaly_local_rx_mreq(const EosInitParams* params) {
+    U64 base_size = 0;
+    U64 call_size = 0;
+    U32 n;
+
+    if (eos_assert(params != NULL)) { return 0; }
+
+    n = params->mise_max_bands;
+
+    // window moments
+    base_size += sizeof(U64) * mise_moments_size(n);
+    // mean_pixel, diff, and Sherman-Morrison workspace
     base_size += 3 * sizeof(F64) * n;
-    // cov, cov_inv
-    base_size += 2 * sizeof(F64) * (n * n);
+    // cov, its Cholesky factor, and the inverse scatter matrix
+    base_size += 3 * sizeof(F64) * (n * n);
 
     // No memory-allocating functions called (no need to update `call_size`)
 
     return base_size + call_size;
 }
 
-/* Use the RX algorithm to rank all pixels and return the top n_results */
-EosStatus eos_mise_detect_anomaly_rx(const EosObsShape shape,
-                                     const U16* data, U32* n_results,
-                                     EosPixelDetection* results) {
+/*
+ * Whether local RX slides its window over rows of cols pixels with rank-1
+ * updates rather than refactoring it. The 2 cols Sherman-Morrison updates of
+ * a slide take about 4 cols bands^2 multiply-adds, and a refactor (Cholesky
+ * factor and inverse) about bands^3. Measured from 64 to 421 bands, a
+ * refactor costs about as much as 0.8 bands updates, so updating only pays
+ * off for rows of up to about 0.4 bands pixels.
+ */
+U32 mise_local_rx_updates(U32 cols, U32 bands) {
+    return (U64) 100 * cols
+           <= (U64) MISE_LOCAL_RX_UPDATE_COLS_PERCENT * bands;
+}
+
+/* State of the sliding background window used by local RX */
+typedef struct {
+    U32 bands;
+    U64 n_pixels;      /* Number of pixels in the window */
+    U64* sum;          /* Exact moments of the window */
+    U64* sum_sq;
+    F64* mean_pixel;   /* Mean of the window */
+    F64* cov;
+    F64* factor;
+    F64* scatter_inv;  /* Inverse of the scatter matrix (n - 1) * cov */
+    F64* diff;
+    F64* work;
+    U32 updatable;     /* Whether scatter_inv is a true inverse */
+    U32 updates;       /* Number of rows slid since the last refactor */
+} MiseLocalWindow;
+
+/*
+ * Recompute the window background from its exact moments. If the covariance
+ * is rank-deficient, the pseudo-inverse is used for scoring, but it cannot be
+ * updated, so the next slide refactors again.
+ */
+static EosStatus _local_window_refactor(MiseLocalWindow* window) {
+    EosStatus status;
+    const U32 n = window->bands;
+    U64 i;
+
+    status = moments_to_mean_covariance(window->n_pixels, n, window->sum,
+        window->sum_sq, window->mean_pixel, window->cov);
+    if (status != EOS_SUCCESS) { return status; }
+
+    status = cholesky_decompose(n, window->cov, window->factor);
+    if (status == EOS_SUCCESS) {
+        status = cholesky_invert(n, window->factor, window->scatter_inv);
+        if (status != EOS_SUCCESS) { return status; }
+        window->updatable = EOS_TRUE;
+    } else if (status == EOS_VALUE_ERROR) {
+        /* The failed factor, and the vectors used by the updates, serve as
+         * the eigensolver workspace */
+        status = invert_sym_matrix(n, window->cov, window->scatter_inv,
+            window->work, window->factor, (U32*) window->diff);
+        if (status != EOS_SUCCESS) { return status; }
+        window->updatable = EOS_FALSE;
+    } else {
+        return status;
+    }
+
+    for (i = 0; i < (U64) n * n; i++) {
+        window->scatter_inv[i] /= (F64) (window->n_pixels - 1);
+    }
+    window->updates = 0;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Update the inverse scatter matrix and mean of the window for the pixels of
+ * the given row of the observation entering (add is true) or leaving the
+ * window. Returns EOS_VALUE_ERROR if an update is ill-conditioned, in which
+ * case the window must be refactored.
+ */
+static EosStatus _local_window_update_row(MiseLocalWindow* window,
+                                          const U16* data,
+                                          const EosObsShape* shape,
+                                          EosMiseLayout layout,
+                                          U32 row, U32 add) {
+    EosStatus status;
+    const U32 n = window->bands;
+    const MiseStrides strides = _mise_strides(shape, layout);
+    const U16* pixel;
+    U32 col, b;
+    F64 count, c;
+
+    for (col = 0; col < shape->cols; col++) {
+        count = (F64) window->n_pixels;
+        pixel = &(data[row * strides.row + col * strides.col]);
+        for (b = 0; b < n; b++) {
+            window->diff[b] = pixel[b * strides.band]
+                              - window->mean_pixel[b];
+        }
+        /* With d = x - mean, adding x to a window of N pixels adds
+         * N / (N + 1) d d' to the scatter matrix, and removing it subtracts
+         * N / (N - 1) d d' */
+        c = add ? count / (count + 1) : -count / (count - 1);
+        status = sherman_morrison_update(n, window->scatter_inv,
+                                         window->diff, c, window->work);
+        if (status != EOS_SUCCESS) { return status; }
+        for (b = 0; b < n; b++) {
+            window->mean_pixel[b] += add ? window->diff[b] / (count + 1)
+                                         : -window->diff[b] / (count - 1);
+        }
+        if (add) {
+            window->n_pixels++;
+        } else {
+            window->n_pixels--;
+        }
+    }
+    return EOS_SUCCESS;
+}
+
+/*
+ * Use a local (along-track sliding window) RX algorithm to rank all pixels
+ * and return the top n_results. Each row is scored against the background of
+ * the window_rows rows centered on it (shifted to stay within the
+ * observation), so small anomalies are found against the local terrain.
+ *
+ * When the window slides by a row, the exact window moments are updated. For
+ * narrow rows, the inverse of the scatter matrix is then updated with one
+ * Sherman-Morrison rank-1 update per entering pixel and one downdate per
+ * leaving pixel, at a cost of O(cols * bands^2) per row rather than the
+ * O(bands^3) of refactoring; since that is only cheaper for rows of fewer
+ * than about 0.4 bands pixels (see mise_local_rx_updates), wider windows are
+ * refactored from their exact moments at every slide. The window is also
+ * refactored if an update is ill-conditioned, if the covariance is
+ * rank-deficient, and every MISE_LOCAL_RX_REFACTOR_ROWS rows to bound the
+ * accumulated rounding error.
+ *
+ * Rows are scored in order, so each block of score map rows (see
+ * EosScoreMap; NULL for none) is emitted as soon as its last row is scored.
+ */
+EosStatus eos_mise_detect_anomaly_local_rx(const EosObsShape shape,
+                                           const U16* data,
+                                           const EosMiseLayout layout,
+                                           const U32 window_rows,
+                                           U32* n_results,
+                                           EosPixelDetection* results,
+                                           const EosScoreMap* map) {
 
     EosStatus status = EOS_SUCCESS;
-    U32 b;
-    F64 *mean_pixel, *mean_sub, *temp,
-        *cov, *cov_inv;
-    EosMemoryBuffer *mean_pixel_buffer,
-        *cov_buffer, *cov_inv_buffer,
-        *mean_sub_buffer, *temp_buffer;
-    EosPixelDetection det;
+    MiseLocalWindow window;
+    EosMemoryBuffer *moments_buffer, *vector_buffer,
+        *cov_buffer, *factor_buffer, *inv_buffer;
     EosDetectionHeap heap;
-    F64 score;
+    EosPixelDetection det;
+    U32 n_window_rows, start, next_start, b, block, block_rows, update;
+    const U16* pixel;
+    const MiseStrides strides = _mise_strides(&shape, layout);
 
     if (eos_assert(n_results != NULL)) { return EOS_ASSERT_ERROR; }
 
-    /* If we are asked to compute 0 results, just return success */
-    if (*n_results == 0) {
+    /* If we are asked to compute 0 results (and no map), just return
+     * success */
+    if (*n_results == 0 && map == NULL) {
         return EOS_SUCCESS;
     }
 
@@ -417,68 +5518,134 @@ EosStatus eos_mise_detect_anomaly_rx(const EosObsShape shape,
         return EOS_SUCCESS;
     }
 
-    /* If we made it past the previous checks, we need to make sure these
-     *  pointers aren't NULL (it's ok if they were NULL if either the
-     * observation size or n_results were zero) */
     if (eos_assert(data != NULL)) { return EOS_ASSERT_ERROR; }
-    if (eos_assert(results != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(*n_results == 0 || results != NULL)) {
+        return EOS_ASSERT_ERROR;
+    }
+    if (eos_assert(window_rows >= 1)) { return EOS_ASSERT_ERROR; }
 
-    // Allocate memory after we've passed basic checks above
-    status = lifo_allocate_buffer_checked(&mean_pixel_buffer,
-        sizeof(F64) * shape.bands, "mean pixel buffer");
-    if (status != EOS_SUCCESS) { return status; }
-    mean_pixel = (F64*) mean_pixel_buffer->ptr;
+    n_window_rows = eos_umin(window_rows, shape.rows);
+    update = mise_local_rx_updates(shape.cols, shape.bands);
 
-    status = lifo_allocate_buffer_checked(&mean_sub_buffer,
-        sizeof(F64) * shape.bands, "mean sub buffer");
+    // Allocate memory after we've passed basic checks above
+    status = lifo_allocate_buffer_checked(&moments_buffer,
+        sizeof(U64) * mise_moments_size(shape.bands), "moments buffer");
     if (status != EOS_SUCCESS) { return status; }
-    mean_sub = (F64*) mean_sub_buffer->ptr;
+    window.sum = (U64*) moments_buffer->ptr;
+    window.sum_sq = window.sum + shape.bands;
 
-    status = lifo_allocate_buffer_checked(&temp_buffer,
-        sizeof(F64) * shape.bands, "temp buffer");
+    status = lifo_allocate_buffer_checked(&vector_buffer,
+        3 * sizeof(F64) * shape.bands, "vector buffer");
     if (status != EOS_SUCCESS) { return status; }
-    temp = (F64*) temp_buffer->ptr;
+    window.mean_pixel = (F64*) vector_buffer->ptr;
+    window.diff = window.mean_pixel + shape.bands;
+    window.work = window.diff + shape.bands;
 
     status = lifo_allocate_buffer_checked(&cov_buffer,
         sizeof(F64) * shape.bands * shape.bands, "cov buffer");
     if (status != EOS_SUCCESS) { return status; }
-    cov = (F64*) cov_buffer->ptr;
+    window.cov = (F64*) cov_buffer->ptr;
 
-    status = lifo_allocate_buffer_checked(&cov_inv_buffer,
-        sizeof(F64) * shape.bands * shape.bands, "cov_inv buffer");
+    status = lifo_allocate_buffer_checked(&factor_buffer,
+        sizeof(F64) * shape.bands * shape.bands, "factor buffer");
     if (status != EOS_SUCCESS) { return status; }
-    cov_inv = (F64*) cov_inv_buffer->ptr;
+    window.factor = (F64*) factor_buffer->ptr;
 
-    /* 1. Compute RX background from all pixels */
-    /* Compute mean pixel */
-    status = compute_mean_pixel(data, &shape, mean_pixel);
+    status = lifo_allocate_buffer_checked(&inv_buffer,
+        sizeof(F64) * shape.bands * shape.bands, "inverse buffer");
     if (status != EOS_SUCCESS) { return status; }
+    window.scatter_inv = (F64*) inv_buffer->ptr;
 
-    /* Compute the covariance matrix and invert it */
-    status = compute_covariance(data, &shape, mean_pixel, cov);
-    if (status != EOS_SUCCESS) { return status; }
-    status = invert_sym_matrix(shape.bands, cov, cov_inv);
+    /* Background of the first window */
+    window.bands = shape.bands;
+    window.n_pixels = (U64) n_window_rows * shape.cols;
+    memset(window.sum, 0, sizeof(U64) * mise_moments_size(shape.bands));
+    _update_moments(data, &shape, layout, 0, n_window_rows, EOS_TRUE,
+                    window.sum, window.sum_sq);
+    status = _local_window_refactor(&window);
     if (status != EOS_SUCCESS) { return status; }
+    start = 0;
 
-    /* Initialize heap with results array */
     heap.capacity = *n_results;
     heap.size = 0;
     heap.data = results;
+    block_rows = eos_score_map_block_rows(map, shape.rows);
+    block = 0;
 
-    /* Compute a score for each pixel and store the top results in the heap */
     for (det.row = 0; det.row < shape.rows; det.row++) {
+        /* Center the window on this row, within the observation */
+        next_start = (det.row > n_window_rows / 2) ?
+                     det.row - n_window_rows / 2 : 0;
+        next_start = eos_umin(next_start, shape.rows - n_window_rows);
+
+        if (next_start != start) {
+            /* Slide by one row: the exact moments are always updated */
+            const U32 entering = start + n_window_rows;
+            const U32 leaving = start;
+            _update_moments(data, &shape, layout, entering, entering + 1,
+                            EOS_TRUE, window.sum, window.sum_sq);
+            _update_moments(data, &shape, layout, leaving, leaving + 1,
+                            EOS_FALSE, window.sum, window.sum_sq);
+            start = next_start;
+
+            /* Enter the new row before the old one leaves, so the window
+             * never has fewer pixels than it will end up with */
+            status = EOS_VALUE_ERROR;
+            if (update && window.updatable
+                    && window.updates < MISE_LOCAL_RX_REFACTOR_ROWS) {
+                status = _local_window_update_row(&window, data, &shape,
+                                                  layout, entering, EOS_TRUE);
+                if (status == EOS_SUCCESS) {
+                    status = _local_window_update_row(&window, data, &shape,
+                                                      layout, leaving,
+                                                      EOS_FALSE);
+                }
+                if (status != EOS_SUCCESS && status != EOS_VALUE_ERROR) {
+                    return status;
+                }
+            }
+            window.n_pixels = (U64) n_window_rows * shape.cols;
+            if (status == EOS_SUCCESS) {
+                /* Use the exact mean rather than the running one */
+                for (b = 0; b < shape.bands; b++) {
+                    window.mean_pixel[b] =
+                        (F64) window.sum[b] / window.n_pixels;
+                }
+                window.updates++;
+            } else {
+                status = _local_window_refactor(&window);
+                if (status != EOS_SUCCESS) { return status; }
+            }
+        }
+
+        /* Score the row against its window:
+         *    rx_score = d' inv(cov) d = (N - 1) d' inv(scatter) d */
+        if (det.row == block) {
+            eos_score_map_clear(map, (U64) eos_umin(block_rows,
+                shape.rows - block) * shape.cols);
+        }
         for (det.col = 0; det.col < shape.cols; det.col++) {
+            pixel = &(data[det.row * strides.row + det.col * strides.col]);
             for (b = 0; b < shape.bands; b++) {
-                mean_sub[b] = data[(det.row * shape.cols + det.col)
-                                   * shape.bands + b] - mean_pixel[b];
+                window.diff[b] = pixel[b * strides.band]
+                                 - window.mean_pixel[b];
             }
-            status = _rx_score(mean_sub, cov_inv, shape, temp, &score);
-            if (status != EOS_SUCCESS) { return status; }
-            det.score = score;
+            det.score = (F64) (window.n_pixels - 1) * eos_quad_form_sym(
+                shape.bands, window.scatter_inv, window.diff);
+
+            eos_score_map_store(map,
+                (U64) (det.row - block) * shape.cols + det.col, det.score);
 
             status = detection_heap_push(&heap, det);
             if (status != EOS_SUCCESS) { return status; }
         }
+
+        /* Emit the block of map rows once its last row is scored */
+        if (det.row + 1 == shape.rows || det.row + 1 - block == block_rows) {
+            status = eos_score_map_emit(map, block, det.row + 1 - block);
+            if (status != EOS_SUCCESS) { return status; }
+            block = det.row + 1;
+        }
     }
 
     status = detection_heap_sort(&heap);
@@ -488,17 +5655,16 @@ EosStatus eos_mise_detect_anomaly_rx(const EosObsShape shape,
     *n_results = heap.size;
 
     // Deallocate memory in LIFO order
-    status = lifo_deallocate_buffer(cov_inv_buffer);
+    status = lifo_deallocate_buffer(inv_buffer);
     if (status != EOS_SUCCESS) { return status; }
-    status = lifo_deallocate_buffer(cov_buffer);
+    status = lifo_deallocate_buffer(factor_buffer);
     if (status != EOS_SUCCESS) { return status; }
-    status = lifo_deallocate_buffer(temp_buffer);
+    status = lifo_deallocate_buffer(cov_buffer);
     if (status != EOS_SUCCESS) { return status; }
-    status = lifo_deallocate_buffer(mean_sub_buffer);
+    status = lifo_deallocate_buffer(vector_buffer);
     if (status != EOS_SUCCESS) { return status; }
-    status = lifo_deallocate_buffer(mean_pixel_buffer);
+    status = lifo_deallocate_buffer(moments_buffer);
     if (status != EOS_SUCCESS) { return status; }
 
     return status;
 }
-
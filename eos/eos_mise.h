@@ -3,17 +3,220 @@
 
 #include "eos_types.h"
 
+/* Block sizes used when accumulating moments (see compute_moments) */
+#define MISE_MOMENT_PIXEL_BLOCK 64
+#define MISE_MOMENT_BAND_BLOCK 16
+
+/* Block sizes used when scoring pixels (see _rx_score_tile_cholesky) */
+#define MISE_SCORE_PIXEL_BLOCK 32
+#define MISE_SCORE_BAND_BLOCK 64
+
+/* Subspace iteration for the principal components (see get_top_eigen_symm):
+ * extra vectors iterated, relative eigenvalue tolerance, and iteration
+ * limit */
+#define MISE_PCA_OVERSAMPLE 8
+#define MISE_PCA_TOLERANCE 1e-12
+#define MISE_PCA_MAX_ITERATIONS 200
+
+/* Implicit QL iterations allowed per eigenvalue (see get_eigen_symm_ql) */
+#define MISE_EIGEN_QL_MAX_ITERATIONS 30
+
+/* Spectral angle mapper (see mise_classify_sam): library targets are padded
+ * to groups of MISE_SAM_GROUP, which are pruned together, and the bounds of
+ * the pre-filter are widened by a relative slack for rounding */
+#define MISE_SAM_GROUP 4
+#define MISE_SAM_PRUNE_SLACK 1e-12
+
+/* Sherman-Morrison updates with a smaller denominator are rejected */
+#define MISE_SHERMAN_MORRISON_MIN_DENOM 1e-6
+/* Local RX refactors its window at least this often (in rows) */
+#define MISE_LOCAL_RX_REFACTOR_ROWS 64
+/* Local RX only updates its window while a row has at most this percentage
+ * of bands pixels (see mise_local_rx_updates) */
+#define MISE_LOCAL_RX_UPDATE_COLS_PERCENT 40
+
+/* Phases of a resumable RX detection (see mise_rx_job_step) */
+typedef enum {
+    MISE_RX_JOB_BACKGROUND = 0,
+    MISE_RX_JOB_FACTOR = 1,
+    MISE_RX_JOB_PSEUDO_INVERSE = 2,
+    MISE_RX_JOB_SCORE = 3,
+    MISE_RX_JOB_DONE = 4,
+} MiseRxJobPhase;
+
+/* Work of the pseudo-inverse of a rank-deficient background in a resumable
+ * RX detection, in pixels of scoring per band (measured from 64 to 421
+ * bands, with some margin; see mise_rx_job_state_request) */
+#ifdef EOS_MISE_JACOBI
+#define MISE_RX_JOB_PSEUDO_INVERSE_PIXELS 200
+#else
+#define MISE_RX_JOB_PSEUDO_INVERSE_PIXELS 8
+#endif
+
+/* Pixels used to estimate a background (see compute_moments_sampled) */
+typedef struct {
+    EosMiseSampling mode;
+    U32 step;
+    U32 seed;
+} MiseSampling;
+
+/* Principal subspace used to score pixels (see _rx_score_tile_pca) */
+typedef struct {
+    U32 complement;         /* Score outside of the subspace instead */
+    U32 n_components;
+    const F64* basis;       /* n_components x bands; orthonormal rows */
+    const F64* inv_eigenvalues;  /* 1 / variance of each component (or 0) */
+} MisePcaBasis;
+
+/* Library targets whitened against the background (see _whiten_targets) */
+typedef struct {
+    EosMiseAlgorithm alg;   /* EOS_MISE_MATCHED_FILTER or EOS_MISE_ACE */
+    U32 n_targets;
+    const F64* basis;       /* n_targets x bands */
+    const F64* inv_norms;   /* 1 / whitened squared norm of each (or 0) */
+} MiseTargets;
+
 EosStatus eos_mise_detect_anomaly_rx(const EosObsShape shape,
-    const U16* data, U32* n_results, EosPixelDetection* results);
+    const U16* data, const EosMiseLayout layout, const U32 n_workers,
+    U32* n_results, EosPixelDetection* results);
+
+EosStatus eos_mise_detect_anomaly_rx_sampled(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const EosPixelMask* mask,
+    const U32 n_workers, const MiseSampling* sampling,
+    const EosMisePrecision precision,
+    U32* n_results, EosPixelDetection* results,
+    const EosScoreMap* map);
+
+EosStatus eos_mise_detect_anomaly_rx_moments(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const U32 n_workers,
+    const U64* sum, const U64* sum_sq, const EosMisePrecision precision,
+    U32* n_results, EosPixelDetection* results);
 
 U64 eos_mise_detect_anomaly_rx_mreq(const EosInitParams* params);
 
+EosStatus eos_mise_detect_anomaly_rx_pooled(const U32 n_observations,
+    const EosMiseObservation* observations, const U32 n_workers,
+    const MiseSampling* sampling,
+    const EosMisePrecision precision,
+    EosMiseDetectionResult* results);
+
+U64 eos_mise_detect_anomaly_rx_pooled_mreq(const EosInitParams* params);
+
+EosStatus eos_mise_detect_anomaly_local_rx(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const U32 window_rows,
+    U32* n_results, EosPixelDetection* results,
+    const EosScoreMap* map);
+
+U64 eos_mise_detect_anomaly_local_rx_mreq(const EosInitParams* params);
+
+EosStatus eos_mise_detect_anomaly_pca_rx(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const EosPixelMask* mask,
+    const U32 n_workers, const MiseSampling* sampling,
+    const U32 n_components, const U32 complement,
+    EosMisePcaBasisState* basis_state,
+    U32* n_results, EosPixelDetection* results,
+    const EosScoreMap* map);
+
+U64 eos_mise_detect_anomaly_pca_rx_mreq(const EosInitParams* params);
+
+EosStatus eos_mise_detect_anomaly_segmented_rx(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const EosPixelMask* mask,
+    const U32 n_workers, const MiseSampling* sampling,
+    const U32 n_clusters, const U32 n_iterations,
+    U32* n_results, EosPixelDetection* results,
+    const EosScoreMap* map);
+
+U64 eos_mise_detect_anomaly_segmented_rx_mreq(const EosInitParams* params);
+
+EosStatus mise_detect_targets(const EosObsShape shape, const U16* data,
+    const EosMiseLayout layout, const EosPixelMask* mask, const U32 n_workers,
+    const MiseSampling* sampling, const EosMiseAlgorithm alg,
+    const EosMiseTargetLibrary* library, EosMiseDetectionResult* results);
+
+U64 mise_detect_targets_mreq(const EosInitParams* params);
+
+EosStatus mise_sam_index_request(U32 n_targets, U32 bands,
+    EosMiseSamIndexRequest* req);
+EosStatus mise_sam_index_build(const EosMiseTargetLibrary* library,
+    U32 coarse_step, EosMiseSamIndex* index);
+EosStatus mise_classify_sam(const EosObsShape shape, const U16* data,
+    const EosMiseLayout layout, const EosPixelMask* mask, const U32 n_workers,
+    const F64 max_angle, const EosMiseSamIndex* index,
+    EosMiseDetectionResult* results);
+
+U64 mise_classify_sam_mreq(const EosInitParams* params);
+
+EosStatus eos_mise_detect_anomaly_rx_background(const EosObsShape shape,
+    const U16* data, const EosMiseLayout layout, const EosPixelMask* mask,
+    const U32 n_workers, const F64 forgetting,
+    const F64 drift_tolerance, const MiseSampling* sampling,
+    EosMiseBackgroundState* state, U32* n_results,
+    EosPixelDetection* results);
+
+U64 eos_mise_detect_anomaly_rx_background_mreq(const EosInitParams* params);
+
+EosStatus mise_stream_state_request(U32 bands,
+    EosMiseStreamStateRequest* req);
+EosStatus mise_stream_begin(U32 cols, U32 bands, EosMiseStreamState* state);
+EosStatus mise_stream_push_rows(EosMiseStreamState* state, U32 n_rows,
+    const U16* rows);
+EosStatus mise_rx_job_state_request(U32 bands, EosMiseRxJobStateRequest* req);
+U64 mise_rx_job_step_mreq(const EosInitParams* params);
+EosStatus mise_rx_job_begin(const EosMiseParams* params,
+                            const EosMiseObservation* observation,
+                            EosMiseDetectionResult* result,
+                            EosMiseRxJobState* state);
+EosStatus mise_rx_job_step(EosMiseRxJobState* state, U64 budget);
+
+EosStatus mise_background_state_request(U32 bands,
+    EosMiseBackgroundStateRequest* req);
+EosStatus mise_background_init(U32 bands, EosMiseBackgroundState* state);
+
+EosStatus mise_pca_basis_state_request(U32 bands, U32 n_components,
+    EosMisePcaBasisStateRequest* req);
+EosStatus mise_pca_basis_init(U32 bands, U32 n_components,
+    EosMisePcaBasisState* state);
+
 EosStatus compute_mean_pixel(const U16* data, const EosObsShape* shape,
-    F64 mp[]);
+    EosMiseLayout layout, F64 mp[]);
 EosStatus compute_covariance(const U16* data, const EosObsShape* shape,
-    F64 mean_pixel[], F64* cov);
+    EosMiseLayout layout, F64 mean_pixel[], F64* cov);
+EosStatus compute_moments(const U16* data, const EosObsShape* shape,
+    EosMiseLayout layout, U64* sum, U64* sum_sq);
+EosStatus accumulate_moments(const U16* data, const EosObsShape* shape,
+    EosMiseLayout layout, U64* sum, U64* sum_sq);
+EosStatus remove_moments(const U16* data, const EosObsShape* shape,
+    EosMiseLayout layout, U64* sum, U64* sum_sq);
+EosStatus compute_moments_parallel(const U16* data, const EosObsShape* shape,
+    EosMiseLayout layout, U32 n_workers, U64* scratch, U64* sum, U64* sum_sq);
+EosStatus compute_moments_sampled(const U16* data, const EosObsShape* shape,
+    EosMiseLayout layout, const EosPixelMask* mask,
+    const MiseSampling* sampling, U32 n_workers, U64* scratch, U16* gather,
+    U64* sum, U64* sum_sq, U64* n_sampled);
+U64 mise_moments_size(U32 bands);
+U64 mise_sample_gather_size(U32 bands);
+EosStatus moments_to_mean_covariance(U64 n_pixels, U32 bands,
+    const U64* sum, const U64* sum_sq, F64 mean_pixel[], F64* cov);
+EosStatus moments_to_mean_covariance_packed(U64 n_pixels, U32 bands,
+    const U64* sum, const U64* sum_sq, F64 mean_pixel[], F64* cov);
+U64 mise_packed_size(U32 bands);
 
 EosStatus get_eigen_symm(U32 n, F64* A, F64* w, F64* V, U32* buf);
-EosStatus invert_sym_matrix(U32 n, F64* A, F64* A_inv);
+EosStatus get_eigen_symm_packed(U32 n, F64* A, F64* w, F64* V, U32* buf);
+EosStatus get_eigen_symm_jacobi(U32 n, F64* A, F64* w, F64* V, U32* buf);
+EosStatus get_eigen_symm_ql(U32 n, F64* A, F64* w, F64* V);
+EosStatus invert_sym_matrix(U32 n, const F64* A, F64* A_inv, F64* w, F64* V,
+    U32* buf);
+EosStatus invert_sym_matrix_packed(U32 n, F64* A, F64* w, F64* V, U32* buf);
+EosStatus cholesky_decompose(U32 n, const F64* A, F64* L);
+EosStatus cholesky_decompose_packed(U32 n, F64* A);
+EosStatus cholesky_invert(U32 n, const F64* L, F64* A_inv);
+U32 mise_top_eigen_block(U32 n, U32 k);
+U64 mise_top_eigen_work_size(U32 n, U32 k);
+EosStatus get_top_eigen_symm(U32 n, const F64* A, U32 k, U32 warm_start,
+    F64* w, F64* V, F64* work, U32* buf);
+EosStatus sherman_morrison_update(U32 n, F64* M_inv, const F64* v, F64 c,
+    F64* u);
+U32 mise_local_rx_updates(U32 cols, U32 bands);
 
 #endif
@@ -28,6 +28,45 @@ EosStatus mise_params_check(const EosMiseParams* params) {
     /* Check for valid algorithm (in range) */
     status |= param_in_range(params->alg, 0, (EOS_MISE_N_ALGS - 1));
 
+    if (params->alg == EOS_MISE_LOCAL_RX) {
+        status |= param_gt_zero(params->local_rx_window_rows);
+    }
+    if (params->alg == EOS_MISE_PCA_RX) {
+        status |= param_gt_zero(params->pca_rx_components);
+    }
+    if (params->alg == EOS_MISE_SAM) {
+        status |= param_gte_zero(params->sam_max_angle);
+    }
+    if (params->alg == EOS_MISE_SEGMENTED_RX) {
+        status |= param_gt_zero(params->segmented_rx_clusters);
+    }
+
+    status |= param_in_range(params->background_sampling, 0,
+                             (EOS_MISE_N_SAMPLINGS - 1));
+    if (params->background_sampling != EOS_MISE_SAMPLE_ALL) {
+        status |= param_gt_zero(params->background_sample_step);
+    }
+
+    status |= param_check(params->batch_pooled_background <= 1);
+
+    status |= param_in_range(params->precision, 0,
+                             (EOS_MISE_N_PRECISIONS - 1));
+
+    if (status != EOS_SUCCESS) {
+        status = EOS_PARAM_ERROR;
+    }
+    return status;
+}
+
+/* Parameters only used with a persistent background */
+EosStatus mise_background_params_check(const EosMiseParams* params) {
+    EosStatus status = EOS_SUCCESS;
+    if (eos_assert(params != NULL)) { return EOS_ASSERT_ERROR; }
+
+    status |= param_gt_zero(params->background_forgetting);
+    status |= param_check(params->background_forgetting <= 1);
+    status |= param_gte_zero(params->background_drift_tolerance);
+
     if (status != EOS_SUCCESS) {
         status = EOS_PARAM_ERROR;
     }
@@ -57,6 +96,7 @@ EosStatus params_check(const EosParams* params) {
 
     status |= ethemis_params_check(&params->ethemis);
     status |= mise_params_check(&params->mise);
+    status |= mise_background_params_check(&params->mise);
     status |= pims_params_check(&params->pims);
 
     if (status != EOS_SUCCESS) {
@@ -79,6 +119,26 @@ EosStatus params_init_default(EosParams* params) {
 
     /* Initialize MISE parameters. */
     params->mise.alg = EOS_DEFAULT_MISE_ALG;
+    params->mise.local_rx_window_rows = EOS_DEFAULT_MISE_LOCAL_RX_WINDOW_ROWS;
+    params->mise.pca_rx_components = EOS_DEFAULT_MISE_PCA_RX_COMPONENTS;
+    params->mise.pca_rx_complement = EOS_DEFAULT_MISE_PCA_RX_COMPLEMENT;
+    params->mise.background_forgetting =
+        EOS_DEFAULT_MISE_BACKGROUND_FORGETTING;
+    params->mise.background_drift_tolerance =
+        EOS_DEFAULT_MISE_BACKGROUND_DRIFT_TOLERANCE;
+    params->mise.background_sampling = EOS_DEFAULT_MISE_BACKGROUND_SAMPLING;
+    params->mise.background_sample_step =
+        EOS_DEFAULT_MISE_BACKGROUND_SAMPLE_STEP;
+    params->mise.background_sample_seed =
+        EOS_DEFAULT_MISE_BACKGROUND_SAMPLE_SEED;
+    params->mise.batch_pooled_background =
+        EOS_DEFAULT_MISE_BATCH_POOLED_BACKGROUND;
+    params->mise.sam_max_angle = EOS_DEFAULT_MISE_SAM_MAX_ANGLE;
+    params->mise.segmented_rx_clusters =
+        EOS_DEFAULT_MISE_SEGMENTED_RX_CLUSTERS;
+    params->mise.segmented_rx_iterations =
+        EOS_DEFAULT_MISE_SEGMENTED_RX_ITERATIONS;
+    params->mise.precision = EOS_DEFAULT_MISE_PRECISION;
 
     /* Initialize PIMS parameters. */
     params->pims.params.common_params.threshold =
@@ -13,6 +13,23 @@
 
 // Default MISE Params
 #define EOS_DEFAULT_MISE_ALG EOS_MISE_RX
+#define EOS_DEFAULT_MISE_LOCAL_RX_WINDOW_ROWS 32
+#define EOS_DEFAULT_MISE_PCA_RX_COMPONENTS 10
+#define EOS_DEFAULT_MISE_PCA_RX_COMPLEMENT EOS_FALSE
+#define EOS_DEFAULT_MISE_BACKGROUND_FORGETTING 0.9
+#define EOS_DEFAULT_MISE_BACKGROUND_DRIFT_TOLERANCE 0.01
+#define EOS_DEFAULT_MISE_BACKGROUND_SAMPLING EOS_MISE_SAMPLE_ALL
+#define EOS_DEFAULT_MISE_BACKGROUND_SAMPLE_STEP 8
+#define EOS_DEFAULT_MISE_BACKGROUND_SAMPLE_SEED 0
+#define EOS_DEFAULT_MISE_BATCH_POOLED_BACKGROUND EOS_FALSE
+#define EOS_DEFAULT_MISE_SAM_MAX_ANGLE 0.1
+#define EOS_DEFAULT_MISE_SEGMENTED_RX_CLUSTERS 4
+#define EOS_DEFAULT_MISE_SEGMENTED_RX_ITERATIONS 5
+#ifdef EOS_MISE_SINGLE
+#define EOS_DEFAULT_MISE_PRECISION EOS_MISE_SINGLE_PRECISION
+#else
+#define EOS_DEFAULT_MISE_PRECISION EOS_MISE_DOUBLE_PRECISION
+#endif
 
 // Default PIMS Params
 #define EOS_DEFAULT_PIMS_THRESHOLD 0
@@ -24,6 +41,7 @@
 EosStatus params_init_default(EosParams* params);
 EosStatus ethemis_params_check(const EosEthemisParams* params);
 EosStatus mise_params_check(const EosMiseParams* params);
+EosStatus mise_background_params_check(const EosMiseParams* params);
 EosStatus pims_params_check(const EosPimsParams* params);
 EosStatus params_check(const EosParams* params);
 EosStatus _param_check(U32 check, CHAR* check_str);
@@ -0,0 +1,114 @@
+/*
+ * Methods to write per-pixel score maps (see EosScoreMap). Detectors produce
+ * the map a block of rows at a time: the block is cleared, the scores of its
+ * pixels are stored, and it is emitted to the map's function (if any). A map
+ * without a function is a single block of all rows, and a NULL map makes
+ * every method a no-op, so detectors follow the same steps either way.
+ */
+#include <stdlib.h>
+#include <float.h>
+
+#include "eos_score_map.h"
+#include "eos_log.h"
+#include "eos_util.h"
+
+/* Check that the map can be written (a NULL map is always valid) */
+EosStatus eos_score_map_check(const EosScoreMap* map) {
+    if (map == NULL) { return EOS_SUCCESS; }
+
+    if (map->format >= EOS_SCORE_MAP_N_FORMATS) {
+        eos_logf(EOS_LOG_ERROR, "Invalid score map format %d.",
+                 (int) map->format);
+        return EOS_PARAM_ERROR;
+    }
+    if (map->format == EOS_SCORE_MAP_U16
+            && !(map->scale > 0.0 && map->scale <= DBL_MAX)) {
+        eos_log(EOS_LOG_ERROR, "Score map scale must be positive.");
+        return EOS_PARAM_ERROR;
+    }
+    if (map->values == NULL) {
+        eos_log(EOS_LOG_ERROR, "Score map has no values buffer.");
+        return EOS_PARAM_ERROR;
+    }
+    if (map->function != NULL && map->block_rows == 0) {
+        eos_log(EOS_LOG_ERROR, "Score map blocks must hold at least a row.");
+        return EOS_PARAM_ERROR;
+    }
+    return EOS_SUCCESS;
+}
+
+/* Number of rows of an observation with the given rows in each block */
+U32 eos_score_map_block_rows(const EosScoreMap* map, U32 rows) {
+    if (map == NULL || map->function == NULL) {
+        return eos_umax(rows, 1);
+    }
+    return map->block_rows;
+}
+
+/* Store the score as the value at the given index of the block */
+void eos_score_map_store(const EosScoreMap* map, U64 index, F64 score) {
+    F64 q;
+
+    if (map == NULL) { return; }
+    if (map->format == EOS_SCORE_MAP_F32) {
+        ((F32*) map->values)[index] = (F32) score;
+        return;
+    }
+
+    /* Written so that NaN quantizes to zero */
+    q = (score - map->offset) / map->scale;
+    if (!(q > 0.0)) {
+        ((U16*) map->values)[index] = 0;
+    } else if (q >= 65535.0) {
+        ((U16*) map->values)[index] = 65535;
+    } else {
+        ((U16*) map->values)[index] = (U16) (q + 0.5);
+    }
+}
+
+/* Give the first n_values values of the block a score of zero */
+void eos_score_map_clear(const EosScoreMap* map, U64 n_values) {
+    U64 i;
+
+    if (map == NULL || n_values == 0) { return; }
+    eos_score_map_store(map, 0, 0.0);
+    if (map->format == EOS_SCORE_MAP_F32) {
+        for (i = 1; i < n_values; i++) {
+            ((F32*) map->values)[i] = ((F32*) map->values)[0];
+        }
+    } else {
+        for (i = 1; i < n_values; i++) {
+            ((U16*) map->values)[i] = ((U16*) map->values)[0];
+        }
+    }
+}
+
+/*
+ * Pass the block, which holds rows [row, row + n_rows) of the map, to the
+ * map's function
+ */
+EosStatus eos_score_map_emit(const EosScoreMap* map, U32 row, U32 n_rows) {
+    if (map == NULL || map->function == NULL || n_rows == 0) {
+        return EOS_SUCCESS;
+    }
+    return map->function(map->context, row, n_rows, map->values);
+}
+
+/* Write a map in which no pixel is scored */
+EosStatus eos_score_map_blank(const EosScoreMap* map,
+                              const EosObsShape* shape) {
+    EosStatus status;
+    U32 block_rows, row, n_rows;
+
+    if (map == NULL) { return EOS_SUCCESS; }
+    if (eos_assert(shape != NULL)) { return EOS_ASSERT_ERROR; }
+
+    block_rows = eos_score_map_block_rows(map, shape->rows);
+    for (row = 0; row < shape->rows; row += n_rows) {
+        n_rows = eos_umin(block_rows, shape->rows - row);
+        eos_score_map_clear(map, (U64) n_rows * shape->cols);
+        status = eos_score_map_emit(map, row, n_rows);
+        if (status != EOS_SUCCESS) { return status; }
+    }
+    return EOS_SUCCESS;
+}
@@ -0,0 +1,14 @@
+#ifndef JPL_EOS_SCORE_MAP
+#define JPL_EOS_SCORE_MAP
+
+#include "eos_types.h"
+
+EosStatus eos_score_map_check(const EosScoreMap* map);
+U32 eos_score_map_block_rows(const EosScoreMap* map, U32 rows);
+void eos_score_map_clear(const EosScoreMap* map, U64 n_values);
+void eos_score_map_store(const EosScoreMap* map, U64 index, F64 score);
+EosStatus eos_score_map_emit(const EosScoreMap* map, U32 row, U32 n_rows);
+EosStatus eos_score_map_blank(const EosScoreMap* map,
+                              const EosObsShape* shape);
+
+#endif
@@ -0,0 +1,547 @@
+/*
+ * Vector kernels with run-time instruction set selection.
+ *
+ * On x86 targets built with GCC or Clang, SSE2, AVX2 (with FMA), and AVX-512
+ * versions of each kernel are compiled with per-function target attributes,
+ * and eos_simd_init selects the widest one that the running CPU supports. On
+ * other targets (e.g., the flight build), or when built with EOS_NO_SIMD, only
+ * the portable scalar kernels are available. The integer kernels have no
+ * AVX-512 version, so that level uses their AVX2 versions.
+ *
+ * The vector kernels accumulate in a different order than the scalar ones,
+ * and the AVX2 and AVX-512 kernels fuse multiplies and adds, so results can
+ * differ in the last bits. For a dot product of length n, every kernel is
+ * within n * DBL_EPSILON * sum_i |a_i b_i| of the exact result (the standard
+ * bound for recursive summation), so any two kernels agree to within twice
+ * that.
+ */
+#include <stdlib.h>
+
+#include "eos_simd.h"
+#include "eos_log.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(EOS_NO_SIMD)
+#define EOS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+typedef F64 (*EosDotFunction)(U32 n, const F64* a, const F64* b);
+typedef void (*EosDecodeFunction)(U64 n, const U8* src, U16* dst);
+typedef void (*EosDaxpyRowsFunction)(U32 n, U32 m, const F64* a,
+                                     const F64* X, F64* y);
+typedef void (*EosSaxpyRowsFunction)(U32 n, U32 m, const F32* a,
+                                     const F32* X, F32* y);
+
+static F64 _ddot_scalar(U32 n, const F64* a, const F64* b) {
+    U32 i;
+    F64 sum = 0.0;
+    for (i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static void _daxpy_rows_scalar(U32 n, U32 m, const F64* a, const F64* X,
+                               F64* y) {
+    U32 i, p;
+    const F64* x;
+    for (i = 0; i < n; i++) {
+        x = &(X[(U64) i * m]);
+        for (p = 0; p < m; p++) {
+            y[p] += a[i] * x[p];
+        }
+    }
+}
+
+static void _saxpy_rows_scalar(U32 n, U32 m, const F32* a, const F32* X,
+                               F32* y) {
+    U32 i, p;
+    const F32* x;
+    for (i = 0; i < n; i++) {
+        x = &(X[(U64) i * m]);
+        for (p = 0; p < m; p++) {
+            y[p] += a[i] * x[p];
+        }
+    }
+}
+
+/* Written byte by byte, so it is correct on hosts of either endianness */
+static void _decode_u16_be_scalar(U64 n, const U8* src, U16* dst) {
+    U64 i;
+    for (i = 0; i < n; i++) {
+        dst[i] = (U16) ((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+#ifdef EOS_SIMD_X86
+
+/* x86 is little-endian, so decoding swaps the bytes of each value */
+__attribute__((target("sse2")))
+static void _decode_u16_be_sse2(U64 n, const U8* src, U16* dst) {
+    U64 i = 0;
+    __m128i v;
+
+    for (; i + 8 <= n; i += 8) {
+        v = _mm_loadu_si128((const __m128i*) &src[2 * i]);
+        _mm_storeu_si128((__m128i*) &dst[i],
+                         _mm_or_si128(_mm_slli_epi16(v, 8),
+                                      _mm_srli_epi16(v, 8)));
+    }
+    _decode_u16_be_scalar(n - i, &src[2 * i], &dst[i]);
+}
+
+__attribute__((target("avx2")))
+static void _decode_u16_be_avx2(U64 n, const U8* src, U16* dst) {
+    U64 i = 0;
+    __m256i v;
+
+    for (; i + 16 <= n; i += 16) {
+        v = _mm256_loadu_si256((const __m256i*) &src[2 * i]);
+        _mm256_storeu_si256((__m256i*) &dst[i],
+                            _mm256_or_si256(_mm256_slli_epi16(v, 8),
+                                            _mm256_srli_epi16(v, 8)));
+    }
+    _decode_u16_be_scalar(n - i, &src[2 * i], &dst[i]);
+}
+
+__attribute__((target("sse2")))
+static F64 _ddot_sse2(U32 n, const F64* a, const F64* b) {
+    U32 i = 0;
+    F64 lanes[2];
+    F64 sum;
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(&a[i]),
+                                           _mm_loadu_pd(&b[i])));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(&a[i + 2]),
+                                           _mm_loadu_pd(&b[i + 2])));
+    }
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static F64 _ddot_avx2(U32 n, const F64* a, const F64* b) {
+    U32 i = 0;
+    F64 lanes[4];
+    F64 sum;
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(&a[i]),
+                               _mm256_loadu_pd(&b[i]), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(&a[i + 4]),
+                               _mm256_loadu_pd(&b[i + 4]), acc1);
+        acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(&a[i + 8]),
+                               _mm256_loadu_pd(&b[i + 8]), acc2);
+        acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(&a[i + 12]),
+                               _mm256_loadu_pd(&b[i + 12]), acc3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(&a[i]),
+                               _mm256_loadu_pd(&b[i]), acc0);
+    }
+    acc0 = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    _mm256_storeu_pd(lanes, acc0);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+static F64 _ddot_avx512(U32 n, const F64* a, const F64* b) {
+    U32 i = 0;
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    __mmask8 mask;
+
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(&a[i]),
+                               _mm512_loadu_pd(&b[i]), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(&a[i + 8]),
+                               _mm512_loadu_pd(&b[i + 8]), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(&a[i]),
+                               _mm512_loadu_pd(&b[i]), acc0);
+    }
+    /* Masked loads handle the remaining (fewer than 8) elements */
+    if (i < n) {
+        mask = (__mmask8) ((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &a[i]),
+                               _mm512_maskz_loadu_pd(mask, &b[i]), acc1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+
+/*
+ * The axpy_rows kernels keep a chunk of y in four registers while every row
+ * of X is applied to it, then move on to the next chunk; the columns past
+ * the last full chunk are handled a register (or, for SSE2 and AVX2, an
+ * element) at a time.
+ */
+__attribute__((target("sse2")))
+static void _daxpy_rows_sse2(U32 n, U32 m, const F64* a, const F64* X,
+                             F64* y) {
+    U32 i, p = 0;
+    __m128d y0, y1, y2, y3, ai;
+    const F64* x;
+
+    for (; p + 8 <= m; p += 8) {
+        y0 = _mm_loadu_pd(&y[p]);
+        y1 = _mm_loadu_pd(&y[p + 2]);
+        y2 = _mm_loadu_pd(&y[p + 4]);
+        y3 = _mm_loadu_pd(&y[p + 6]);
+        for (i = 0; i < n; i++) {
+            ai = _mm_set1_pd(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm_add_pd(y0, _mm_mul_pd(ai, _mm_loadu_pd(&x[0])));
+            y1 = _mm_add_pd(y1, _mm_mul_pd(ai, _mm_loadu_pd(&x[2])));
+            y2 = _mm_add_pd(y2, _mm_mul_pd(ai, _mm_loadu_pd(&x[4])));
+            y3 = _mm_add_pd(y3, _mm_mul_pd(ai, _mm_loadu_pd(&x[6])));
+        }
+        _mm_storeu_pd(&y[p], y0);
+        _mm_storeu_pd(&y[p + 2], y1);
+        _mm_storeu_pd(&y[p + 4], y2);
+        _mm_storeu_pd(&y[p + 6], y3);
+    }
+    for (; p + 2 <= m; p += 2) {
+        y0 = _mm_loadu_pd(&y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm_add_pd(y0, _mm_mul_pd(_mm_set1_pd(a[i]),
+                                           _mm_loadu_pd(&X[(U64) i * m + p])));
+        }
+        _mm_storeu_pd(&y[p], y0);
+    }
+    for (; p < m; p++) {
+        for (i = 0; i < n; i++) {
+            y[p] += a[i] * X[(U64) i * m + p];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void _daxpy_rows_avx2(U32 n, U32 m, const F64* a, const F64* X,
+                             F64* y) {
+    U32 i, p = 0;
+    __m256d y0, y1, y2, y3, ai;
+    const F64* x;
+
+    for (; p + 16 <= m; p += 16) {
+        y0 = _mm256_loadu_pd(&y[p]);
+        y1 = _mm256_loadu_pd(&y[p + 4]);
+        y2 = _mm256_loadu_pd(&y[p + 8]);
+        y3 = _mm256_loadu_pd(&y[p + 12]);
+        for (i = 0; i < n; i++) {
+            ai = _mm256_set1_pd(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm256_fmadd_pd(ai, _mm256_loadu_pd(&x[0]), y0);
+            y1 = _mm256_fmadd_pd(ai, _mm256_loadu_pd(&x[4]), y1);
+            y2 = _mm256_fmadd_pd(ai, _mm256_loadu_pd(&x[8]), y2);
+            y3 = _mm256_fmadd_pd(ai, _mm256_loadu_pd(&x[12]), y3);
+        }
+        _mm256_storeu_pd(&y[p], y0);
+        _mm256_storeu_pd(&y[p + 4], y1);
+        _mm256_storeu_pd(&y[p + 8], y2);
+        _mm256_storeu_pd(&y[p + 12], y3);
+    }
+    for (; p + 4 <= m; p += 4) {
+        y0 = _mm256_loadu_pd(&y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm256_fmadd_pd(_mm256_set1_pd(a[i]),
+                                 _mm256_loadu_pd(&X[(U64) i * m + p]), y0);
+        }
+        _mm256_storeu_pd(&y[p], y0);
+    }
+    for (; p < m; p++) {
+        for (i = 0; i < n; i++) {
+            y[p] += a[i] * X[(U64) i * m + p];
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void _daxpy_rows_avx512(U32 n, U32 m, const F64* a, const F64* X,
+                               F64* y) {
+    U32 i, p = 0;
+    __m512d y0, y1, y2, y3, ai;
+    __mmask8 mask;
+    const F64* x;
+
+    for (; p + 32 <= m; p += 32) {
+        y0 = _mm512_loadu_pd(&y[p]);
+        y1 = _mm512_loadu_pd(&y[p + 8]);
+        y2 = _mm512_loadu_pd(&y[p + 16]);
+        y3 = _mm512_loadu_pd(&y[p + 24]);
+        for (i = 0; i < n; i++) {
+            ai = _mm512_set1_pd(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm512_fmadd_pd(ai, _mm512_loadu_pd(&x[0]), y0);
+            y1 = _mm512_fmadd_pd(ai, _mm512_loadu_pd(&x[8]), y1);
+            y2 = _mm512_fmadd_pd(ai, _mm512_loadu_pd(&x[16]), y2);
+            y3 = _mm512_fmadd_pd(ai, _mm512_loadu_pd(&x[24]), y3);
+        }
+        _mm512_storeu_pd(&y[p], y0);
+        _mm512_storeu_pd(&y[p + 8], y1);
+        _mm512_storeu_pd(&y[p + 16], y2);
+        _mm512_storeu_pd(&y[p + 24], y3);
+    }
+    for (; p < m; p += 8) {
+        mask = (m - p >= 8) ? (__mmask8) 0xFF
+                            : (__mmask8) ((1u << (m - p)) - 1);
+        y0 = _mm512_maskz_loadu_pd(mask, &y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm512_fmadd_pd(_mm512_set1_pd(a[i]),
+                _mm512_maskz_loadu_pd(mask, &X[(U64) i * m + p]), y0);
+        }
+        _mm512_mask_storeu_pd(&y[p], mask, y0);
+    }
+}
+
+__attribute__((target("sse2")))
+static void _saxpy_rows_sse2(U32 n, U32 m, const F32* a, const F32* X,
+                             F32* y) {
+    U32 i, p = 0;
+    __m128 y0, y1, y2, y3, ai;
+    const F32* x;
+
+    for (; p + 16 <= m; p += 16) {
+        y0 = _mm_loadu_ps(&y[p]);
+        y1 = _mm_loadu_ps(&y[p + 4]);
+        y2 = _mm_loadu_ps(&y[p + 8]);
+        y3 = _mm_loadu_ps(&y[p + 12]);
+        for (i = 0; i < n; i++) {
+            ai = _mm_set1_ps(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm_add_ps(y0, _mm_mul_ps(ai, _mm_loadu_ps(&x[0])));
+            y1 = _mm_add_ps(y1, _mm_mul_ps(ai, _mm_loadu_ps(&x[4])));
+            y2 = _mm_add_ps(y2, _mm_mul_ps(ai, _mm_loadu_ps(&x[8])));
+            y3 = _mm_add_ps(y3, _mm_mul_ps(ai, _mm_loadu_ps(&x[12])));
+        }
+        _mm_storeu_ps(&y[p], y0);
+        _mm_storeu_ps(&y[p + 4], y1);
+        _mm_storeu_ps(&y[p + 8], y2);
+        _mm_storeu_ps(&y[p + 12], y3);
+    }
+    for (; p + 4 <= m; p += 4) {
+        y0 = _mm_loadu_ps(&y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_set1_ps(a[i]),
+                                           _mm_loadu_ps(&X[(U64) i * m + p])));
+        }
+        _mm_storeu_ps(&y[p], y0);
+    }
+    for (; p < m; p++) {
+        for (i = 0; i < n; i++) {
+            y[p] += a[i] * X[(U64) i * m + p];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void _saxpy_rows_avx2(U32 n, U32 m, const F32* a, const F32* X,
+                             F32* y) {
+    U32 i, p = 0;
+    __m256 y0, y1, y2, y3, ai;
+    const F32* x;
+
+    for (; p + 32 <= m; p += 32) {
+        y0 = _mm256_loadu_ps(&y[p]);
+        y1 = _mm256_loadu_ps(&y[p + 8]);
+        y2 = _mm256_loadu_ps(&y[p + 16]);
+        y3 = _mm256_loadu_ps(&y[p + 24]);
+        for (i = 0; i < n; i++) {
+            ai = _mm256_set1_ps(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm256_fmadd_ps(ai, _mm256_loadu_ps(&x[0]), y0);
+            y1 = _mm256_fmadd_ps(ai, _mm256_loadu_ps(&x[8]), y1);
+            y2 = _mm256_fmadd_ps(ai, _mm256_loadu_ps(&x[16]), y2);
+            y3 = _mm256_fmadd_ps(ai, _mm256_loadu_ps(&x[24]), y3);
+        }
+        _mm256_storeu_ps(&y[p], y0);
+        _mm256_storeu_ps(&y[p + 8], y1);
+        _mm256_storeu_ps(&y[p + 16], y2);
+        _mm256_storeu_ps(&y[p + 24], y3);
+    }
+    for (; p + 8 <= m; p += 8) {
+        y0 = _mm256_loadu_ps(&y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm256_fmadd_ps(_mm256_set1_ps(a[i]),
+                                 _mm256_loadu_ps(&X[(U64) i * m + p]), y0);
+        }
+        _mm256_storeu_ps(&y[p], y0);
+    }
+    for (; p < m; p++) {
+        for (i = 0; i < n; i++) {
+            y[p] += a[i] * X[(U64) i * m + p];
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void _saxpy_rows_avx512(U32 n, U32 m, const F32* a, const F32* X,
+                               F32* y) {
+    U32 i, p = 0;
+    __m512 y0, y1, ai;
+    __mmask16 mask;
+    const F32* x;
+
+    for (; p + 32 <= m; p += 32) {
+        y0 = _mm512_loadu_ps(&y[p]);
+        y1 = _mm512_loadu_ps(&y[p + 16]);
+        for (i = 0; i < n; i++) {
+            ai = _mm512_set1_ps(a[i]);
+            x = &(X[(U64) i * m + p]);
+            y0 = _mm512_fmadd_ps(ai, _mm512_loadu_ps(&x[0]), y0);
+            y1 = _mm512_fmadd_ps(ai, _mm512_loadu_ps(&x[16]), y1);
+        }
+        _mm512_storeu_ps(&y[p], y0);
+        _mm512_storeu_ps(&y[p + 16], y1);
+    }
+    for (; p < m; p += 16) {
+        mask = (m - p >= 16) ? (__mmask16) 0xFFFF
+                             : (__mmask16) ((1u << (m - p)) - 1);
+        y0 = _mm512_maskz_loadu_ps(mask, &y[p]);
+        for (i = 0; i < n; i++) {
+            y0 = _mm512_fmadd_ps(_mm512_set1_ps(a[i]),
+                _mm512_maskz_loadu_ps(mask, &X[(U64) i * m + p]), y0);
+        }
+        _mm512_mask_storeu_ps(&y[p], mask, y0);
+    }
+}
+
+#endif
+
+static EosDotFunction eos_ddot_function = _ddot_scalar;
+static EosDecodeFunction eos_decode_function = _decode_u16_be_scalar;
+static EosDaxpyRowsFunction eos_daxpy_rows_function = _daxpy_rows_scalar;
+static EosSaxpyRowsFunction eos_saxpy_rows_function = _saxpy_rows_scalar;
+
+/*
+ * Returns the widest kernel level that the running CPU supports (and that
+ * this build includes)
+ */
+EosSimdLevel eos_simd_supported(void) {
+#ifdef EOS_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) { return EOS_SIMD_AVX512; }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return EOS_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) { return EOS_SIMD_SSE2; }
+#endif
+    return EOS_SIMD_SCALAR;
+}
+
+/*
+ * Select the kernels for the given level, or for the widest supported level
+ * below it if the CPU does not support it. Returns the level selected.
+ *
+ * This is not thread-safe with respect to running kernels; it is called by
+ * eos_init, and may be called again (e.g., by tests) while no library
+ * function is running.
+ */
+EosSimdLevel eos_simd_set_level(EosSimdLevel level) {
+    EosSimdLevel supported = eos_simd_supported();
+    if (level > supported) {
+        level = supported;
+    }
+
+    switch (level) {
+#ifdef EOS_SIMD_X86
+        case EOS_SIMD_AVX512:
+            /* 16-bit shifts of 512-bit vectors need AVX-512BW */
+            eos_ddot_function = _ddot_avx512;
+            eos_decode_function = _decode_u16_be_avx2;
+            eos_daxpy_rows_function = _daxpy_rows_avx512;
+            eos_saxpy_rows_function = _saxpy_rows_avx512;
+            break;
+        case EOS_SIMD_AVX2:
+            eos_ddot_function = _ddot_avx2;
+            eos_decode_function = _decode_u16_be_avx2;
+            eos_daxpy_rows_function = _daxpy_rows_avx2;
+            eos_saxpy_rows_function = _saxpy_rows_avx2;
+            break;
+        case EOS_SIMD_SSE2:
+            eos_ddot_function = _ddot_sse2;
+            eos_decode_function = _decode_u16_be_sse2;
+            eos_daxpy_rows_function = _daxpy_rows_sse2;
+            eos_saxpy_rows_function = _saxpy_rows_sse2;
+            break;
+#endif
+        default:
+            level = EOS_SIMD_SCALAR;
+            eos_ddot_function = _ddot_scalar;
+            eos_decode_function = _decode_u16_be_scalar;
+            eos_daxpy_rows_function = _daxpy_rows_scalar;
+            eos_saxpy_rows_function = _saxpy_rows_scalar;
+            break;
+    }
+    return level;
+}
+
+/* Select the widest supported kernels */
+EosSimdLevel eos_simd_init(void) {
+    EosSimdLevel level = eos_simd_set_level(EOS_SIMD_AVX512);
+    eos_logf(EOS_LOG_INFO, "Using vector kernel level %d.", (int) level);
+    return level;
+}
+
+/* Dot product of the n-vectors a and b */
+F64 eos_ddot(U32 n, const F64* a, const F64* b) {
+    return eos_ddot_function(n, a, b);
+}
+
+/*
+ * y += a' X for the n x m row-major matrix X, i.e., y += a_i X_i over the
+ * rows X_i of X; with X a tile of pixels stored band-major (e.g., see
+ * _rx_score_tile), this applies n bands of a matrix row to every pixel of
+ * the tile at once. The m entries of y stay in registers across the rows.
+ */
+void eos_daxpy_rows(U32 n, U32 m, const F64* a, const F64* X, F64* y) {
+    eos_daxpy_rows_function(n, m, a, X, y);
+}
+
+/* Single-precision version of eos_daxpy_rows */
+void eos_saxpy_rows(U32 n, U32 m, const F32* a, const F32* X, F32* y) {
+    eos_saxpy_rows_function(n, m, a, X, y);
+}
+
+/*
+ * Decode the n big-endian 16-bit values at src (which need not be aligned)
+ * into native values at dst, e.g., MISE data as it is loaded
+ */
+void eos_decode_u16_be(U64 n, const void* src, U16* dst) {
+    eos_decode_function(n, (const U8*) src, dst);
+}
+
+/*
+ * Quadratic form x' A x of the symmetric n x n (row-major) matrix A. Only the
+ * diagonal and upper triangle of A are read, as contiguous row segments:
+ *    x' A x = sum_i x_i (A_ii x_i + 2 sum_{j > i} A_ij x_j)
+ * which needs about half the multiply-adds of the dense product.
+ */
+F64 eos_quad_form_sym(U32 n, const F64* A, const F64* x) {
+    U32 i;
+    F64 sum = 0.0;
+    const F64* row;
+    for (i = 0; i < n; i++) {
+        row = &(A[(U64) i * n]);
+        sum += x[i] * (row[i] * x[i]
+                       + 2.0 * eos_ddot_function(n - i - 1, &row[i + 1],
+                                                 &x[i + 1]));
+    }
+    return sum;
+}
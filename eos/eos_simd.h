@@ -0,0 +1,24 @@
+#ifndef JPL_EOS_SIMD
+#define JPL_EOS_SIMD
+
+#include "eos_types.h"
+
+/* Instruction set levels of the vector kernels, in increasing order */
+typedef enum {
+    EOS_SIMD_SCALAR = 0,
+    EOS_SIMD_SSE2,
+    EOS_SIMD_AVX2,
+    EOS_SIMD_AVX512
+} EosSimdLevel;
+
+EosSimdLevel eos_simd_supported(void);
+EosSimdLevel eos_simd_init(void);
+EosSimdLevel eos_simd_set_level(EosSimdLevel level);
+
+F64 eos_ddot(U32 n, const F64* a, const F64* b);
+F64 eos_quad_form_sym(U32 n, const F64* A, const F64* x);
+void eos_daxpy_rows(U32 n, U32 m, const F64* a, const F64* X, F64* y);
+void eos_saxpy_rows(U32 n, U32 m, const F32* a, const F32* X, F32* y);
+void eos_decode_u16_be(U64 n, const void* src, U16* dst);
+
+#endif
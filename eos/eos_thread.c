@@ -0,0 +1,91 @@
+/*
+ * Minimal fork-join support for splitting library work across workers.
+ *
+ * When built with EOS_PTHREADS, each call forks one POSIX thread per extra
+ * worker and joins them before returning. Otherwise (e.g., the flight build)
+ * the workers run one after another on the calling thread, so the partition
+ * of work and the results are the same in both configurations.
+ */
+#include <stdlib.h>
+
+#ifdef EOS_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "eos_thread.h"
+#include "eos_log.h"
+
+#ifdef EOS_PTHREADS
+typedef struct {
+    EosWorkerFunction function;
+    void* context;
+    U32 worker;
+    EosStatus status;
+} EosWorkerTask;
+
+static void* _worker_main(void* arg) {
+    EosWorkerTask* task = (EosWorkerTask*) arg;
+    task->status = task->function(task->context, task->worker);
+    return NULL;
+}
+#endif
+
+/*
+ * Call `function(context, w)` for every worker w in [0, n_workers) and wait
+ * for all of them to finish. Worker 0 always runs on the calling thread.
+ *
+ * :param n_workers: number of workers (at most EOS_MAX_WORKERS)
+ * :param function: work to perform; must only write to per-worker state
+ * :param context: shared argument passed to every worker
+ *
+ * :return: status of the lowest-numbered worker that failed, if any
+ */
+EosStatus eos_run_workers(U32 n_workers, EosWorkerFunction function,
+                          void* context) {
+    EosStatus status = EOS_SUCCESS;
+    EosStatus worker_status;
+    U32 w;
+
+    if (eos_assert(function != NULL)) { return EOS_ASSERT_ERROR; }
+    if (eos_assert(n_workers <= EOS_MAX_WORKERS)) { return EOS_ASSERT_ERROR; }
+
+#ifdef EOS_PTHREADS
+    EosWorkerTask tasks[EOS_MAX_WORKERS];
+    pthread_t threads[EOS_MAX_WORKERS];
+    U32 started[EOS_MAX_WORKERS];
+
+    for (w = 1; w < n_workers; w++) {
+        tasks[w].function = function;
+        tasks[w].context = context;
+        tasks[w].worker = w;
+        tasks[w].status = EOS_SUCCESS;
+        started[w] = (pthread_create(&threads[w], NULL,
+                                     _worker_main, &tasks[w]) == 0);
+        if (!started[w]) {
+            /* Could not create a thread; do the work here instead */
+            tasks[w].status = function(context, w);
+        }
+    }
+    if (n_workers > 0) {
+        status = function(context, 0);
+    }
+    for (w = 1; w < n_workers; w++) {
+        if (started[w]) {
+            pthread_join(threads[w], NULL);
+        }
+        worker_status = tasks[w].status;
+        if (status == EOS_SUCCESS) {
+            status = worker_status;
+        }
+    }
+#else
+    for (w = 0; w < n_workers; w++) {
+        worker_status = function(context, w);
+        if (status == EOS_SUCCESS) {
+            status = worker_status;
+        }
+    }
+#endif
+
+    return status;
+}
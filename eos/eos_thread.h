@@ -0,0 +1,13 @@
+#ifndef JPL_EOS_THREAD
+#define JPL_EOS_THREAD
+
+#include "eos_types.h"
+
+#define EOS_MAX_WORKERS 64
+
+typedef EosStatus (*EosWorkerFunction)(void* context, U32 worker);
+
+EosStatus eos_run_workers(U32 n_workers, EosWorkerFunction function,
+                          void* context);
+
+#endif
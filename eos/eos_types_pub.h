@@ -26,6 +26,7 @@ typedef enum {
     EOS_PIMS_BINS_MISMATCH_ERROR = 16,
     EOS_PIMS_QUEUE_EMPTY = 17,
     EOS_PIMS_QUEUE_FULL = 18,
+    EOS_IN_PROGRESS = 19,   /* A resumable job has work left */
 } EosStatus;
 
 /*
@@ -48,6 +49,27 @@ typedef struct {
     uint32_t bands;
 } EosObsShape;
 
+/*
+ * Pixels of an observation to process. The region of interest is rows
+ * [row_start, row_start + rows) and columns [col_start, col_start + cols),
+ * where zero rows (or cols) extends it to the last row (or column). Within
+ * it, only the pixels whose bits are set in the valid bitmask are processed:
+ * pixel (row, col) is bit p % 64 of valid[p / 64], for p = row * cols + col
+ * with the observation's cols. A NULL bitmask makes every pixel valid, so an
+ * all-zero mask selects the whole observation.
+ */
+typedef struct {
+    uint32_t row_start;
+    uint32_t col_start;
+    uint32_t rows;
+    uint32_t cols;
+    const uint64_t* valid;
+} EosPixelMask;
+
+/* Number of words in the valid bitmask of an observation */
+#define EOS_PIXEL_MASK_WORDS(rows, cols) \
+    (((uint64_t) (rows) * (cols) + 63) / 64)
+
 /*
  * Enum for the E-THEMIS bands
  */
@@ -66,6 +88,7 @@ typedef struct {
     uint32_t timestamp;
     EosObsShape band_shape[EOS_ETHEMIS_N_BANDS];
     uint16_t* band_data[EOS_ETHEMIS_N_BANDS];
+    const EosPixelMask* band_mask[EOS_ETHEMIS_N_BANDS];   /* NULL for all */
 } EosEthemisObservation;
 
 /*
@@ -80,14 +103,74 @@ typedef struct {
  */
 typedef enum {
     EOS_MISE_RX = 0,
-    EOS_MISE_N_ALGS = 1,
+    EOS_MISE_LOCAL_RX = 1,
+    EOS_MISE_PCA_RX = 2,
+    EOS_MISE_MATCHED_FILTER = 3,  /* See eos_mise_detect_targets */
+    EOS_MISE_ACE = 4,             /* See eos_mise_detect_targets */
+    EOS_MISE_SAM = 5,             /* See eos_mise_classify_sam */
+    EOS_MISE_SEGMENTED_RX = 6,
+    EOS_MISE_N_ALGS = 7,
 } EosMiseAlgorithm;
 
+/*
+ * Pixels used to estimate the MISE background (every pixel is still scored)
+ */
+typedef enum {
+    EOS_MISE_SAMPLE_ALL = 0,
+    EOS_MISE_SAMPLE_STRIDE = 1,   /* Every step-th pixel in raster order */
+    EOS_MISE_SAMPLE_GRID = 2,     /* Every step-th row and column */
+    EOS_MISE_SAMPLE_RANDOM = 3,   /* About 1 / step of the pixels (seeded) */
+    EOS_MISE_N_SAMPLINGS = 4,
+} EosMiseSampling;
+
+/*
+ * Floating-point precision in which MISE pixels are scored
+ */
+typedef enum {
+    EOS_MISE_DOUBLE_PRECISION = 0,
+    EOS_MISE_SINGLE_PRECISION = 1,
+    EOS_MISE_N_PRECISIONS = 2,
+} EosMisePrecision;
+
 /*
  * Parameters relevant to MISE detector
  */
 typedef struct {
     EosMiseAlgorithm alg;
+    /* Number of rows in the along-track background window of each row
+     * (EOS_MISE_LOCAL_RX only) */
+    uint32_t local_rx_window_rows;
+    /* Weight kept by the persistent background each time an observation is
+     * merged into it, in (0, 1]; 1 weights all observations equally */
+    double background_forgetting;
+    /* Relative drift of the persistent background beyond which it is
+     * factored again (0 factors it after every observation) */
+    double background_drift_tolerance;
+    /* Number of principal components of the background within which
+     * pixels are scored, or outside of which if pca_rx_complement is set
+     * (EOS_MISE_PCA_RX only) */
+    uint32_t pca_rx_components;
+    uint32_t pca_rx_complement;
+    /* Pixels used to estimate the background (EOS_MISE_RX,
+     * EOS_MISE_PCA_RX, and EOS_MISE_SEGMENTED_RX) */
+    EosMiseSampling background_sampling;
+    uint32_t background_sample_step;
+    uint32_t background_sample_seed;
+    /* Whether eos_mise_detect_anomaly_batch scores every observation against
+     * one background pooled from all of them (EOS_MISE_RX only) */
+    uint32_t batch_pooled_background;
+    /* Largest spectral angle, in radians, at which a pixel is assigned to
+     * its nearest library class (EOS_MISE_SAM only) */
+    double sam_max_angle;
+    /* Number of background classes (e.g., ice and terrain) that pixels are
+     * clustered into, and the number of k-means steps that fit them; each
+     * pixel is scored against its nearest class (EOS_MISE_SEGMENTED_RX
+     * only) */
+    uint32_t segmented_rx_clusters;
+    uint32_t segmented_rx_iterations;
+    /* Precision of the RX scores (EOS_MISE_RX, including streaming; the
+     * background is always estimated and factored in double precision) */
+    EosMisePrecision precision;
 } EosMiseParams;
 
 /*
@@ -99,6 +182,43 @@ typedef struct {
     double score;
 } EosPixelDetection;
 
+/*
+ * Format of the values of a score map. EOS_SCORE_MAP_U16 quantizes each
+ * score s to round((s - offset) / scale), clamped to [0, 65535].
+ */
+typedef enum {
+    EOS_SCORE_MAP_F32 = 0,
+    EOS_SCORE_MAP_U16 = 1,
+    EOS_SCORE_MAP_N_FORMATS = 2,
+} EosScoreMapFormat;
+
+/*
+ * Receives rows [row, row + n_rows) of a score map as n_rows * cols values
+ * in row-major order. Returning anything other than EOS_SUCCESS stops the
+ * detection with that status.
+ */
+typedef EosStatus (*EosScoreMapFunction)(void* context, uint32_t row,
+                                         uint32_t n_rows, const void* values);
+
+/*
+ * Per-pixel scores written alongside the top detections. Pixels that are
+ * not scored (outside the observation's mask) have a score of zero.
+ *
+ * Without a function, values holds the whole rows x cols map. With one,
+ * values only holds block_rows rows: the map is produced block_rows rows at
+ * a time, in order, and each block is passed to the function (the last
+ * block may be shorter), so the full map is never held.
+ */
+typedef struct {
+    EosScoreMapFormat format;
+    double scale;                   /* EOS_SCORE_MAP_U16 only */
+    double offset;                  /* EOS_SCORE_MAP_U16 only */
+    void* values;
+    uint32_t block_rows;            /* Rows held by values with a function */
+    EosScoreMapFunction function;   /* NULL to keep the whole map */
+    void* context;                  /* Passed to the function */
+} EosScoreMap;
+
 /*
  * A set of detection results for E-THEMIS
  */
@@ -107,6 +227,16 @@ typedef struct {
     EosPixelDetection* band_results[EOS_ETHEMIS_N_BANDS];
 } EosEthemisDetectionResult;
 
+/*
+ * Arrangement of the bands of MISE data in memory
+ */
+typedef enum {
+    EOS_MISE_BIP = 0,   /* Band-interleaved by pixel: (row, col, band) */
+    EOS_MISE_BIL = 1,   /* Band-interleaved by line: (row, band, col) */
+    EOS_MISE_BSQ = 2,   /* Band-sequential: (band, row, col) */
+    EOS_MISE_N_LAYOUTS = 3,
+} EosMiseLayout;
+
 /*
  * Data from a MISE observation
  */
@@ -115,9 +245,25 @@ typedef struct {
     uint32_t observation_id;
     uint32_t timestamp;
     EosObsShape shape;   /* Assume same for all bands */
-    uint16_t* data;      /* All data in BIP (row, col, band) format */
+    uint16_t* data;      /* All data, in the given layout */
+    EosMiseLayout layout;   /* Order of the data (BIP, which is zero, unless
+                               set otherwise) */
+    const EosPixelMask* mask;   /* Pixels to process; NULL for all */
 } EosMiseObservation;
 
+/*
+ * Spectral reduction applied while loading a MISE observation. If
+ * n_selected_bands is nonzero, only the listed bands (in increasing order)
+ * are kept; the kept bands are then averaged in consecutive groups of
+ * bin_factor (the last group may be smaller). A bin_factor of 1 with no
+ * selected bands loads the observation unchanged.
+ */
+typedef struct {
+    uint32_t bin_factor;
+    uint32_t n_selected_bands;
+    const uint32_t* selected_bands;
+} EosMiseBandReduction;
+
 /*
  * A set of detection results for MISE
  */
@@ -126,6 +272,138 @@ typedef struct {
     EosPixelDetection* results;
 } EosMiseDetectionResult;
 
+/*
+ * Spectral library of known targets for MISE target detection (see
+ * eos_mise_detect_targets): n_targets spectra of the given number of bands,
+ * stored one after another in data units.
+ */
+typedef struct {
+    uint32_t n_targets;
+    uint32_t bands;
+    const double* spectra;      /* n_targets x bands */
+} EosMiseTargetLibrary;
+
+/*
+ * Normalized spectral library index for the spectral angle mapper (see
+ * eos_mise_sam_index_build), built once and reused for every observation.
+ * The buffers are provided by the caller, with the sizes (in values) given
+ * by eos_mise_sam_index_request. The unit-norm spectra are stored
+ * band-major, with the targets of each band contiguous and padded to a
+ * multiple of the SIMD width (stride targets), and with the coarse bands of
+ * the pre-filter first (in the order given by band_order).
+ */
+typedef struct {
+    uint32_t n_targets;
+    uint32_t bands;
+    uint32_t n_coarse_bands;
+    uint32_t stride;
+    uint32_t* band_order;       /* bands */
+    double* spectra;            /* bands x stride */
+    double* tail_norms;         /* stride; norm beyond the coarse bands */
+} EosMiseSamIndex;
+
+typedef struct {
+    uint64_t band_order_size;
+    uint64_t spectra_size;
+    uint64_t tail_norms_size;
+} EosMiseSamIndexRequest;
+
+/*
+ * State for streaming a MISE observation row by row (see
+ * eos_mise_stream_begin). The moments buffer is provided by the caller, with
+ * the size given by eos_mise_stream_state_request.
+ */
+typedef struct {
+    EosObsShape shape;   /* Rows received so far, cols, and bands */
+    EosMiseLayout layout;   /* Order of each block of pushed rows (BIP
+                               unless set after eos_mise_stream_begin) */
+    uint64_t* moments;   /* Band sums followed by packed second moments */
+} EosMiseStreamState;
+
+typedef struct {
+    uint64_t moments_size;  /* Number of uint64_t values in moments */
+} EosMiseStreamStateRequest;
+
+/*
+ * Background carried across MISE observations (see
+ * eos_mise_detect_anomaly_background). The arrays are provided by the caller,
+ * with the sizes given by eos_mise_background_state_request. Pixels are
+ * scored against the background as of its last factorization, which is
+ * refreshed only once the current background has drifted far enough from it.
+ */
+typedef struct {
+    uint32_t bands;
+    uint32_t use_cholesky;      /* factor is a Cholesky factor (else the
+                                   pseudo-inverse of factor_cov) */
+    uint64_t n_observations;    /* Observations merged so far */
+    uint64_t n_factorizations;  /* Times the background was factored */
+    double weight;              /* Effective number of background pixels */
+    double* mean_pixel;         /* Current background mean */
+    double* cov;                /* Current background covariance */
+    double* factor_mean_pixel;  /* Mean as of the last factorization */
+    double* factor_cov;         /* Covariance as of the last factorization */
+    double* factor;             /* Factor of factor_cov used for scoring */
+} EosMiseBackgroundState;
+
+typedef struct {
+    uint64_t vector_size;   /* Number of doubles in each mean pixel */
+    uint64_t matrix_size;   /* Number of doubles in each matrix */
+} EosMiseBackgroundStateRequest;
+
+/*
+ * Principal basis carried across MISE observations for PCA RX (see
+ * eos_mise_detect_anomaly_pca_basis). The basis array is provided by the
+ * caller, with the size given by eos_mise_pca_basis_state_request. The
+ * eigensolver for each observation starts from the basis found for the
+ * previous one.
+ */
+typedef struct {
+    uint32_t bands;
+    uint32_t n_components;
+    uint32_t n_iterations;      /* Eigensolver iterations for the last
+                                   observation */
+    uint64_t n_observations;    /* Observations scored so far */
+    double* basis;              /* n_components x bands principal components
+                                   of the last observation */
+} EosMisePcaBasisState;
+
+typedef struct {
+    uint64_t basis_size;    /* Number of doubles in basis */
+} EosMisePcaBasisStateRequest;
+
+/*
+ * State of a resumable RX detection (see eos_mise_rx_job_begin), which is
+ * carried between the calls that do its work. The arrays are provided by
+ * the caller, with the sizes given by eos_mise_rx_job_state_request; the
+ * other fields are managed by the library.
+ */
+typedef struct {
+    uint64_t* moments;      /* Band sums followed by packed second moments */
+    double* mean_pixel;     /* Background mean */
+    double* factor;         /* Packed factor of the background covariance */
+    EosMiseParams params;
+    EosMiseObservation observation;
+    EosMiseDetectionResult* result;
+    uint32_t max_results;
+    uint32_t phase;         /* Background, factorization, or scoring */
+    uint32_t sampled;       /* Whether the background is sampled */
+    uint32_t next_row;      /* Next pixel of the current phase */
+    uint32_t next_col;
+    uint64_t n_background;  /* Background pixels accumulated so far */
+    double factor_threshold; /* Smallest pivot of the factorization */
+    uint32_t use_cholesky;
+    uint32_t n_results;     /* Top results kept so far */
+} EosMiseRxJobState;
+
+typedef struct {
+    uint64_t moments_size;  /* Number of uint64_t values in moments */
+    uint64_t vector_size;   /* Number of doubles in mean_pixel */
+    uint64_t factor_size;   /* Number of doubles in factor */
+    uint64_t pseudo_inverse_pixels; /* Work of the one step that is not
+                                       bounded by its budget (see
+                                       eos_mise_rx_job_step), in pixels */
+} EosMiseRxJobStateRequest;
+
 /*
  * PIMS modes
  */
@@ -290,6 +568,29 @@ typedef struct {
 typedef struct {
     EosPimsParams pims_params;
     uint32_t mise_max_bands;
+    /* Number of workers used to estimate the MISE background (0 or 1 for
+     * single-threaded operation); each additional worker needs its own
+     * partial moments, which are included in the memory requirement */
+    uint32_t mise_workers;
+    /* Largest number of MISE results requested when more than one worker is
+     * used; each additional worker keeps its own top results while scoring,
+     * which are included in the memory requirement (larger requests are
+     * rejected with EOS_PARAM_ERROR) */
+    uint32_t mise_max_results;
+    /* Largest number of targets in a library passed to
+     * eos_mise_detect_targets or eos_mise_classify_sam; each target needs
+     * its whitened spectrum (for the former) and, for each worker, its own
+     * top results while scoring */
+    uint32_t mise_max_targets;
+    /* Largest number of background classes used by EOS_MISE_SEGMENTED_RX;
+     * each class needs its own mean and factored covariance and, for each
+     * worker, its own partial tile while scoring */
+    uint32_t mise_max_clusters;
+    /* MISE algorithms that will be run, as a bitmask of
+     * (1 << EosMiseAlgorithm), or 0 for all of them; only these are included
+     * in the memory requirement. EOS_MISE_RX also covers streaming and the
+     * persistent background. */
+    uint32_t mise_algorithms;
 } EosInitParams;
 
 #endif
@@ -188,3 +188,40 @@ U32 eos_uabs_diff(U32 x, U32 y){
 F64 eos_hypot(F64 x, F64 y){
     return sqrt((x * x) + (y * y));
 }
+
+/*
+ * Compute the full 128-bit product a * b, returned as high and low words
+ */
+void eos_umul128(U64 a, U64 b, U64* hi, U64* lo) {
+    const U64 mask = 0xFFFFFFFFULL;
+    U64 p0, p1, p2, p3, mid;
+
+    p0 = (a & mask) * (b & mask);
+    p1 = (a & mask) * (b >> 32);
+    p2 = (a >> 32) * (b & mask);
+    p3 = (a >> 32) * (b >> 32);
+
+    mid = (p0 >> 32) + (p1 & mask) + (p2 & mask);
+    *lo = (mid << 32) | (p0 & mask);
+    *hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+}
+
+/*
+ * Convert the difference a - b of two unsigned 128-bit values, each given as
+ * high and low words, to the nearest F64 (the result may be negative)
+ */
+F64 eos_u128_diff(U64 a_hi, U64 a_lo, U64 b_hi, U64 b_lo) {
+    U64 hi, lo;
+    F64 sign = 1.0;
+
+    if ((a_hi < b_hi) || ((a_hi == b_hi) && (a_lo < b_lo))) {
+        hi = a_hi; a_hi = b_hi; b_hi = hi;
+        lo = a_lo; a_lo = b_lo; b_lo = lo;
+        sign = -1.0;
+    }
+    hi = a_hi - b_hi - (a_lo < b_lo);
+    lo = a_lo - b_lo;
+
+    /* 2^64 */
+    return sign * ((F64) hi * 18446744073709551616.0 + (F64) lo);
+}
@@ -38,5 +38,7 @@ U32 eos_umin(U32 a, U32 b);
 U32 eos_umax(U32 a, U32 b);
 U32 eos_uabs_diff(U32 a, U32 b);
 F64 eos_hypot(F64 n, F64 x);
+void eos_umul128(U64 a, U64 b, U64* hi, U64* lo);
+F64 eos_u128_diff(U64 a_hi, U64 a_lo, U64 b_hi, U64 b_lo);
 
 #endif
@@ -114,6 +114,71 @@ static EosStatus load_config(config_t *config, EosParams *params,
     if (status != EOS_SUCCESS) { return status; }
     result->n_results = value; // Re-assign (potentially modified) value
 
+    value = params->mise.alg; // Store default
+    // Only the anomaly detectors; target detection needs a library
+    status = _extract_int(
+        root_setting, "alg",
+        &(value), 0, EOS_MISE_PCA_RX
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.alg = (EosMiseAlgorithm) value;
+
+    value = params->mise.local_rx_window_rows; // Store default
+    status = _extract_int(
+        root_setting, "local_rx_window_rows",
+        &(value), 1, INT32_MAX
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.local_rx_window_rows = value;
+
+    value = params->mise.pca_rx_components; // Store default
+    status = _extract_int(
+        root_setting, "pca_rx_components",
+        &(value), 1, INT32_MAX
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.pca_rx_components = value;
+
+    value = params->mise.pca_rx_complement; // Store default
+    status = _extract_int(
+        root_setting, "pca_rx_complement",
+        &(value), 0, 1
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.pca_rx_complement = value;
+
+    value = params->mise.background_sampling; // Store default
+    status = _extract_int(
+        root_setting, "background_sampling",
+        &(value), 0, EOS_MISE_N_SAMPLINGS - 1
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.background_sampling = (EosMiseSampling) value;
+
+    value = params->mise.background_sample_step; // Store default
+    status = _extract_int(
+        root_setting, "background_sample_step",
+        &(value), 1, INT32_MAX
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.background_sample_step = value;
+
+    value = params->mise.background_sample_seed; // Store default
+    status = _extract_int(
+        root_setting, "background_sample_seed",
+        &(value), 0, INT32_MAX
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.background_sample_seed = value;
+
+    value = params->mise.precision; // Store default
+    status = _extract_int(
+        root_setting, "precision",
+        &(value), 0, EOS_MISE_N_PRECISIONS - 1
+    );
+    if (status != EOS_SUCCESS) { return status; }
+    params->mise.precision = (EosMisePrecision) value;
+
     count = config_setting_length(root_setting);
     for (v = 0; v < count; v++) {
         config_setting_t *member = config_setting_get_elem(root_setting, v);
@@ -36,6 +36,11 @@ EosStatus default_init_params_pims(EosInitParams* init_params){
     };
     init_params -> pims_params = pims_params;
     init_params -> mise_max_bands = 0;
+    init_params -> mise_workers = 1;
+    init_params -> mise_max_results = 0;
+    init_params -> mise_max_targets = 0;
+    init_params -> mise_max_clusters = 0;
+    init_params -> mise_algorithms = 0;
     return EOS_SUCCESS;
 }
 
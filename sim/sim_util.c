@@ -13,6 +13,11 @@
 void default_init_params(EosInitParams *init_params) {
     if (init_params == NULL) { return; }
     init_params->mise_max_bands = EOS_MISE_N_BANDS;
+    init_params->mise_workers = 1;
+    init_params->mise_max_results = 0;
+    init_params->mise_max_targets = 0;
+    init_params->mise_max_clusters = 0;
+    init_params->mise_algorithms = 0;
 }
 
 /* Private function prototypes. */
@@ -30,6 +35,7 @@ EosStatus init_ethemis_obs(EosEthemisObservation *obs, const int size) {
         obs->band_shape[band].rows = 1;
         obs->band_shape[band].cols = size;
         obs->band_shape[band].bands = 1; /* one band at a time */
+        obs->band_mask[band] = NULL;
         obs->band_data[band] = (uint16_t*) malloc(sizeof(uint16_t) * size);
         if (obs->band_data[band] == NULL) {
             eos_logf(EOS_LOG_ERROR,
@@ -123,6 +129,8 @@ EosStatus init_mise_obs(EosMiseObservation *obs, const int size) {
     obs->shape.cols = 1;
     obs->shape.rows = 1;
     obs->shape.bands = 1;
+    obs->layout = EOS_MISE_BIP;
+    obs->mask = NULL;
 
     return EOS_SUCCESS;
 }
@@ -1,9 +1,11 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <eos_data.h>
 #include <eos_log.h>
+#include <eos_mise.h>
 #include "CuTest.h"
 #include "util.h"
 
@@ -457,6 +459,257 @@ void TestLoadMiseWrongVersion(CuTest* ct) {
     FreeMiseObs(&obs);
 }
 
+/*
+ * Write a version-1 MISE file for an observation with the given values
+ * (rows x cols x bands, in BIP order) into file, which must hold
+ * 12 + 4 * MISE_HEADER_ENTRIES + 2 * rows * cols * bands bytes
+ */
+static uint32_t _write_mise_file(uint8_t* file, uint32_t rows, uint32_t cols,
+                                 uint32_t bands, const uint16_t* values) {
+    const uint32_t header[MISE_HEADER_ENTRIES] = {7, 9, cols, rows, bands};
+    uint32_t i, offset = 12;
+
+    memcpy(file, "EOS_MISE\xff\xff\xff\x01", 12);
+    for (i = 0; i < MISE_HEADER_ENTRIES; i++) {
+        file[offset++] = (uint8_t) (header[i] >> 24);
+        file[offset++] = (uint8_t) (header[i] >> 16);
+        file[offset++] = (uint8_t) (header[i] >> 8);
+        file[offset++] = (uint8_t) header[i];
+    }
+    for (i = 0; i < rows * cols * bands; i++) {
+        file[offset++] = (uint8_t) (values[i] >> 8);
+        file[offset++] = (uint8_t) values[i];
+    }
+    return offset;
+}
+
+void TestLoadMiseReduced(CuTest* ct) {
+    const uint32_t rows = 3, cols = 2, bands = 7;
+    uint16_t values[3 * 2 * 7];
+    uint8_t file[32 + 2 * 3 * 2 * 7];
+    uint16_t loaded[3 * 2 * 7];
+    const uint32_t selected[3] = {1, 4, 6};
+    const uint32_t unordered[2] = {4, 1};
+    const uint32_t out_of_range[2] = {1, 7};
+    EosMiseBandReduction reduction;
+    EosMiseObservation obs;
+    EosStatus status;
+    uint32_t i, p, size, reduced;
+
+    for (i = 0; i < rows * cols * bands; i++) {
+        values[i] = (uint16_t) (1000 + 37 * i + (i % 3) * 20000);
+    }
+    size = _write_mise_file(file, rows, cols, bands, values);
+    obs.data = loaded;
+
+    // No reduction
+    status = load_mise_reduced(file, size, NULL, &obs);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 7, obs.observation_id);
+    CuAssertIntEquals(ct, 9, obs.timestamp);
+    CuAssertIntEquals(ct, rows, obs.shape.rows);
+    CuAssertIntEquals(ct, cols, obs.shape.cols);
+    CuAssertIntEquals(ct, bands, obs.shape.bands);
+    CuAssertIntEquals(ct, EOS_MISE_BIP, obs.layout);
+    for (i = 0; i < rows * cols * bands; i++) {
+        CuAssertIntEquals(ct, values[i], loaded[i]);
+    }
+
+    // Binning: the last bin holds a single band
+    reduction.bin_factor = 3;
+    reduction.n_selected_bands = 0;
+    reduction.selected_bands = NULL;
+    status = mise_reduced_bands(bands, &reduction, &reduced);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, reduced);
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, obs.shape.bands);
+    for (p = 0; p < rows * cols; p++) {
+        const uint16_t* v = &(values[p * bands]);
+        CuAssertIntEquals(ct, (v[0] + v[1] + v[2] + 1) / 3, loaded[p * 3]);
+        CuAssertIntEquals(ct, (v[3] + v[4] + v[5] + 1) / 3, loaded[p * 3 + 1]);
+        CuAssertIntEquals(ct, v[6], loaded[p * 3 + 2]);
+    }
+
+    // Selection
+    reduction.bin_factor = 1;
+    reduction.n_selected_bands = 3;
+    reduction.selected_bands = selected;
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, obs.shape.bands);
+    for (p = 0; p < rows * cols; p++) {
+        for (i = 0; i < 3; i++) {
+            CuAssertIntEquals(ct, values[p * bands + selected[i]],
+                              loaded[p * 3 + i]);
+        }
+    }
+
+    // Selection, then binning
+    reduction.bin_factor = 2;
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, obs.shape.bands);
+    for (p = 0; p < rows * cols; p++) {
+        const uint16_t* v = &(values[p * bands]);
+        CuAssertIntEquals(ct, (v[1] + v[4] + 1) / 2, loaded[p * 2]);
+        CuAssertIntEquals(ct, v[6], loaded[p * 2 + 1]);
+    }
+
+    // Bad reductions
+    reduction.bin_factor = 0;
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    reduction.bin_factor = 1;
+    reduction.n_selected_bands = 2;
+    reduction.selected_bands = unordered;
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    reduction.selected_bands = out_of_range;
+    status = load_mise_reduced(file, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_MISE_LOAD_ERROR, status);
+    reduction.selected_bands = selected;
+    status = load_mise_reduced(file, size - 1, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_MISE_LOAD_ERROR, status);
+}
+
+void TestPublicLoadMiseReduced(CuTest* ct) {
+    void* data;
+    uint32_t size, reduced, i;
+    EosStatus status;
+    EosMiseObservation obs;
+    EosMiseBandReduction reduction = {2, 0, NULL};
+    EosInitParams init_params;
+
+    // The reduced band count is available before initialization, so it
+    // can size the library
+    status = eos_mise_reduced_bands(5, &reduction, &reduced);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, reduced);
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = reduced;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    InitMiseObs(&obs, 10, 10, reduced);
+    read_resource(ct, "mise/test_mise.mis", &data, &size);
+
+    status = eos_load_mise_reduced(data, size, &reduction, &obs);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, obs.shape.rows);
+    CuAssertIntEquals(ct, 10, obs.shape.cols);
+    CuAssertIntEquals(ct, 3, obs.shape.bands);
+    for (i = 0; i < 10 * 10 * 3; i++) {
+        CuAssertIntEquals(ct, 1, obs.data[i]);
+    }
+
+    free(data);
+    FreeMiseObs(&obs);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+}
+
+/*
+ * Loading with a stream state gives the observation of eos_load_mise_reduced
+ * and its exact background moments, from which the results of a full
+ * detection are finalized
+ */
+void TestLoadMiseStream(CuTest* ct) {
+    const uint32_t rows = 5, cols = 9, bands = 6;
+    uint16_t values[5 * 9 * 6];
+    uint8_t file[32 + 2 * 5 * 9 * 6];
+    uint16_t loaded[5 * 9 * 6], expected_data[5 * 9 * 6];
+    uint64_t moments[6 + 6 * 7 / 2], expected_moments[6 + 6 * 7 / 2];
+    EosPixelDetection expected_detections[10], detections[10];
+    EosMiseDetectionResult expected, result;
+    EosMiseBandReduction reduction = {2, 0, NULL};
+    EosMiseStreamStateRequest req;
+    EosMiseStreamState state;
+    EosMiseObservation obs;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosStatus status;
+    uint32_t i, r, size;
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = bands;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    all_params.mise.alg = EOS_MISE_RX;
+
+    status = eos_mise_stream_state_request(bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, req.moments_size == sizeof(moments) / sizeof(uint64_t));
+    state.moments = moments;
+
+    for (i = 0; i < rows * cols * bands; i++) {
+        values[i] = (uint16_t) ((i * 7919 + (i % bands) * 40000) % 65521);
+    }
+    size = _write_mise_file(file, rows, cols, bands, values);
+    expected.results = expected_detections;
+    result.results = detections;
+
+    // All bands, and then binned
+    for (r = 0; r < 2; r++) {
+        obs.data = expected_data;
+        status = eos_load_mise_reduced(file, size, r ? &reduction : NULL,
+                                       &obs);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = compute_moments(obs.data, &(obs.shape), obs.layout,
+                                 expected_moments,
+                                 expected_moments + obs.shape.bands);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        expected.n_results = 10;
+        status = eos_mise_detect_anomaly(&(all_params.mise), &obs, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+        obs.data = loaded;
+        status = eos_load_mise_stream(file, size, r ? &reduction : NULL,
+                                      &obs, &state);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, rows, state.shape.rows);
+        CuAssertIntEquals(ct, cols, state.shape.cols);
+        CuAssertIntEquals(ct, obs.shape.bands, state.shape.bands);
+        for (i = 0; i < rows * cols * obs.shape.bands; i++) {
+            CuAssertIntEquals(ct, expected_data[i], loaded[i]);
+        }
+        for (i = 0; i < mise_moments_size(obs.shape.bands); i++) {
+            CuAssertTrue(ct, expected_moments[i] == moments[i]);
+        }
+
+        result.n_results = 10;
+        status = eos_mise_stream_finalize(&(all_params.mise), &state, &obs,
+                                          &result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, expected.n_results, result.n_results);
+        for (i = 0; i < result.n_results; i++) {
+            CuAssertIntEquals(ct, expected_detections[i].row,
+                              detections[i].row);
+            CuAssertIntEquals(ct, expected_detections[i].col,
+                              detections[i].col);
+            CuAssertDblEquals(ct, expected_detections[i].score,
+                              detections[i].score, 0);
+        }
+    }
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // More bands than the state can hold
+    init_params.mise_max_bands = bands - 1;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_load_mise_stream(file, size, NULL, &obs, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+}
+
 void TestPimsObservationAttr(CuTest* ct){
     void* data;
     uint32_t size;
@@ -771,6 +1024,9 @@ CuSuite* CuDataGetSuite(void)
     SUITE_ADD_TEST(suite, TestLoadMiseTruncated);
     SUITE_ADD_TEST(suite, TestLoadMiseWrongHeader);
     SUITE_ADD_TEST(suite, TestLoadMiseWrongVersion);
+    SUITE_ADD_TEST(suite, TestLoadMiseReduced);
+    SUITE_ADD_TEST(suite, TestPublicLoadMiseReduced);
+    SUITE_ADD_TEST(suite, TestLoadMiseStream);
     SUITE_ADD_TEST(suite, TestPimsObservationAttr);
     SUITE_ADD_TEST(suite, TestPimsObservationAttrTooSmall);
     SUITE_ADD_TEST(suite, TestPublicLoadPims);
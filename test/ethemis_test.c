@@ -126,6 +126,9 @@ void TestEmptyEthemisObservation(CuTest *ct) {
     obs.band_data[EOS_ETHEMIS_BAND_1] = NULL;
     obs.band_data[EOS_ETHEMIS_BAND_2] = NULL;
     obs.band_data[EOS_ETHEMIS_BAND_3] = NULL;
+    obs.band_mask[EOS_ETHEMIS_BAND_1] = NULL;
+    obs.band_mask[EOS_ETHEMIS_BAND_2] = NULL;
+    obs.band_mask[EOS_ETHEMIS_BAND_3] = NULL;
 
     EosEthemisDetectionResult result;
     // Request top 5 detections despite no data
@@ -434,6 +437,166 @@ void TestTooManyRequested(CuTest *ct) {
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 }
 
+/*
+ * Only the valid pixels within the region of interest of a band mask are
+ * detected
+ */
+void TestEthemisMask(CuTest *ct) {
+    const int NROWS = 4;
+    const int NCOLS = 70;
+    const uint16_t THRESH = 8;
+
+    EosStatus status;
+    EosInitParams init_params;
+    default_init_params_test(&init_params);
+
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    EosEthemisObservation obs;
+    InitEthemisObs(&obs, NROWS, NCOLS);
+    uint16_t* data = obs.band_data[EOS_ETHEMIS_BAND_1];
+    data[0*NCOLS + 5] = THRESH + 5;     // Outside the region of interest
+    data[1*NCOLS + 3] = THRESH + 4;     // Outside the region of interest
+    data[1*NCOLS + 62] = THRESH + 3;    // Invalid (crosses a word boundary)
+    data[2*NCOLS + 60] = THRESH + 2;
+    data[1*NCOLS + 10] = THRESH + 1;
+
+    // Rows 1-2, columns 5-69, with every pixel but (1, 62) valid
+    uint64_t valid[EOS_PIXEL_MASK_WORDS(4, 70)];
+    uint64_t p = 1*NCOLS + 62;
+    int i;
+    for (i = 0; i < (int) EOS_PIXEL_MASK_WORDS(4, 70); i++) {
+        valid[i] = ~0ull;
+    }
+    valid[p / 64] &= ~(1ull << (p % 64));
+    EosPixelMask mask = {1, 5, 2, 0, valid};
+    obs.band_mask[EOS_ETHEMIS_BAND_1] = &mask;
+
+    EosEthemisDetectionResult result;
+    result.n_results[EOS_ETHEMIS_BAND_1] = 5;
+    result.n_results[EOS_ETHEMIS_BAND_2] = 0;
+    result.n_results[EOS_ETHEMIS_BAND_3] = 0;
+    result.band_results[EOS_ETHEMIS_BAND_1] = calloc(
+        sizeof(EosPixelDetection), result.n_results[EOS_ETHEMIS_BAND_1]);
+    result.band_results[EOS_ETHEMIS_BAND_2] = NULL;
+    result.band_results[EOS_ETHEMIS_BAND_3] = NULL;
+
+    EosParams params;
+    status = eos_init_default_params(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params.ethemis.band_threshold[EOS_ETHEMIS_BAND_1] = THRESH;
+
+    status = eos_ethemis_detect_anomaly(&(params.ethemis), &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, result.n_results[EOS_ETHEMIS_BAND_1]);
+    EosPixelDetection* det = result.band_results[EOS_ETHEMIS_BAND_1];
+    CuAssertIntEquals(ct, 2, det[0].row);
+    CuAssertIntEquals(ct, 60, det[0].col);
+    CuAssertIntEquals(ct, 1, det[1].row);
+    CuAssertIntEquals(ct, 10, det[1].col);
+
+    // A region of interest outside the band
+    mask.cols = NCOLS;
+    result.n_results[EOS_ETHEMIS_BAND_1] = 5;
+    status = eos_ethemis_detect_anomaly(&(params.ethemis), &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // Clean up
+    CleanUpTest(&obs, &result);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+}
+
+/* Counts the blocks of rows passed to a score map function */
+static EosStatus _count_map_rows(void* context, uint32_t row, uint32_t n_rows,
+                                 const void* values) {
+    uint32_t* next_row = (uint32_t*) context;
+    (void) values;
+    if (row != *next_row) { return EOS_VALUE_ERROR; }
+    *next_row = row + n_rows;
+    return EOS_SUCCESS;
+}
+
+/*
+ * The score map of a band holds the value of every pixel, whether or not it
+ * reaches the threshold
+ */
+void TestEthemisScoreMap(CuTest *ct) {
+    const int NROWS = 5;
+    const int NCOLS = 4;
+    const uint16_t THRESH = 8;
+
+    EosStatus status;
+    EosInitParams init_params;
+    default_init_params_test(&init_params);
+
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    EosEthemisObservation obs;
+    InitEthemisObs(&obs, NROWS, NCOLS);
+    int i;
+    for (i = 0; i < NROWS * NCOLS; i++) {
+        obs.band_data[EOS_ETHEMIS_BAND_1][i] = (uint16_t) i;
+        obs.band_data[EOS_ETHEMIS_BAND_2][i] = (uint16_t) (2 * i);
+    }
+
+    float band_1_map[5 * 4];
+    uint16_t band_2_block[2 * 4];
+    uint32_t next_row = 0;
+    EosScoreMap map_1 = {EOS_SCORE_MAP_F32, 1.0, 0.0, band_1_map, 0,
+                         NULL, NULL};
+    EosScoreMap map_2 = {EOS_SCORE_MAP_U16, 2.0, 0.0, band_2_block, 2,
+                         _count_map_rows, &next_row};
+    const EosScoreMap* band_map[EOS_ETHEMIS_N_BANDS] = {
+        &map_1, &map_2, NULL
+    };
+
+    EosEthemisDetectionResult result;
+    result.n_results[EOS_ETHEMIS_BAND_1] = 2;
+    result.n_results[EOS_ETHEMIS_BAND_2] = 0;
+    result.n_results[EOS_ETHEMIS_BAND_3] = 0;
+    result.band_results[EOS_ETHEMIS_BAND_1] = calloc(
+        sizeof(EosPixelDetection), result.n_results[EOS_ETHEMIS_BAND_1]);
+    result.band_results[EOS_ETHEMIS_BAND_2] = NULL;
+    result.band_results[EOS_ETHEMIS_BAND_3] = NULL;
+
+    EosParams params;
+    status = eos_init_default_params(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params.ethemis.band_threshold[EOS_ETHEMIS_BAND_1] = THRESH;
+
+    status = eos_ethemis_detect_anomaly_map(&(params.ethemis), &obs, &result,
+                                            band_map);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, result.n_results[EOS_ETHEMIS_BAND_1]);
+    CuAssertDblEquals(ct, NROWS * NCOLS - 1,
+                      result.band_results[EOS_ETHEMIS_BAND_1][0].score, 0);
+    for (i = 0; i < NROWS * NCOLS; i++) {
+        CuAssertDblEquals(ct, (float) i, band_1_map[i], 0);
+    }
+    // The last block of band 2 holds its last row
+    CuAssertIntEquals(ct, NROWS, next_row);
+    for (i = 0; i < NCOLS; i++) {
+        CuAssertIntEquals(ct, (NROWS - 1) * NCOLS + i, band_2_block[i]);
+    }
+
+    // An invalid map
+    map_2.block_rows = 0;
+    result.n_results[EOS_ETHEMIS_BAND_1] = 2;
+    status = eos_ethemis_detect_anomaly_map(&(params.ethemis), &obs, &result,
+                                            band_map);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // Clean up
+    CleanUpTest(&obs, &result);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+}
+
 CuSuite* CuEthemisGetSuite(void)
 {
     CuSuite* suite = CuSuiteNew();
@@ -445,6 +608,8 @@ CuSuite* CuEthemisGetSuite(void)
     SUITE_ADD_TEST(suite, TestNExpectLimit);
     SUITE_ADD_TEST(suite, TestZeroRequested);
     SUITE_ADD_TEST(suite, TestTooManyRequested);
+    SUITE_ADD_TEST(suite, TestEthemisMask);
+    SUITE_ADD_TEST(suite, TestEthemisScoreMap);
 
     return suite;
 }
@@ -235,6 +235,41 @@ void TestHeapSortEmpty(CuTest *ct) {
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 }
 
+/*
+ * Detections with equal scores are ranked by pixel position (earlier pixels
+ * first), so the heap keeps the same detections in any push order.
+ */
+void TestHeapTiesByPosition(CuTest *ct) {
+    EosStatus status;
+    EosDetectionHeap heap;
+    EosPixelDetection det;
+    EosPixelDetection dets[4] = {
+        {1, 0, 1.0}, {0, 2, 1.0}, {0, 1, 1.0}, {2, 0, 1.0}
+    };
+    U32 order, i;
+
+    heap.capacity = 2;
+    heap.data = calloc(sizeof(EosPixelDetection), heap.capacity);
+
+    for (order = 0; order < 2; order++) {
+        heap.size = 0;
+        for (i = 0; i < 4; i++) {
+            det = dets[order ? 3 - i : i];
+            status = detection_heap_push(&heap, det);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        }
+        status = detection_heap_sort(&heap);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 2, heap.size);
+        CuAssertIntEquals(ct, 0, heap.data[0].row);
+        CuAssertIntEquals(ct, 1, heap.data[0].col);
+        CuAssertIntEquals(ct, 0, heap.data[1].row);
+        CuAssertIntEquals(ct, 2, heap.data[1].col);
+    }
+
+    free(heap.data);
+}
+
 CuSuite* CuHeapGetSuite(void)
 {
     CuSuite* suite = CuSuiteNew();
@@ -246,6 +281,7 @@ CuSuite* CuHeapGetSuite(void)
     SUITE_ADD_TEST(suite, TestHeapAddExtraLow);
     SUITE_ADD_TEST(suite, TestHeapAdd12345);
     SUITE_ADD_TEST(suite, TestHeapSortEmpty);
+    SUITE_ADD_TEST(suite, TestHeapTiesByPosition);
 
     return suite;
 }
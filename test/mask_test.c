@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <eos_mask.h>
+#include "CuTest.h"
+#include "util.h"
+
+#define MASK_TEST_ROWS 5
+#define MASK_TEST_COLS 70
+
+static void _set_valid(U64* valid, U32 cols, U32 row, U32 col) {
+    const U64 p = (U64) row * cols + col;
+    valid[p / 64] |= 1ull << (p % 64);
+}
+
+/* Valid columns visited by eos_mask_next in a row of the region */
+static U32 _visit_row(const EosPixelMask* mask, const EosObsShape* shape,
+                      U32 row, U32* cols) {
+    const EosMaskRegion region = eos_mask_region(mask, shape);
+    U32 col, n = 0;
+    for (col = eos_mask_next(mask, shape->cols, row, region.col_start,
+                             region.col_end);
+            col < region.col_end;
+            col = eos_mask_next(mask, shape->cols, row, col + 1,
+                                region.col_end)) {
+        cols[n++] = col;
+    }
+    return n;
+}
+
+/*
+ * A region of interest without a bitmask selects a clipped rectangle, and a
+ * zero size extends it to the edge of the observation
+ */
+void TestMaskRegion(CuTest *ct) {
+    const EosObsShape shape = {MASK_TEST_ROWS, MASK_TEST_COLS, 1};
+    EosPixelMask mask = {1, 3, 2, 4, NULL};
+    EosMaskRegion region;
+    U32 cols[MASK_TEST_COLS];
+    U32 n;
+
+    region = eos_mask_region(NULL, &shape);
+    CuAssertIntEquals(ct, 0, region.row_start);
+    CuAssertIntEquals(ct, MASK_TEST_ROWS, region.row_end);
+    CuAssertIntEquals(ct, 0, region.col_start);
+    CuAssertIntEquals(ct, MASK_TEST_COLS, region.col_end);
+    CuAssertTrue(ct, eos_mask_count(NULL, &shape)
+                 == MASK_TEST_ROWS * MASK_TEST_COLS);
+
+    region = eos_mask_region(&mask, &shape);
+    CuAssertIntEquals(ct, 1, region.row_start);
+    CuAssertIntEquals(ct, 3, region.row_end);
+    CuAssertIntEquals(ct, 3, region.col_start);
+    CuAssertIntEquals(ct, 7, region.col_end);
+    CuAssertTrue(ct, eos_mask_count(&mask, &shape) == 8);
+    CuAssertIntEquals(ct, 0, eos_mask_has_bitmask(&mask));
+
+    // Every column of the region is valid
+    n = _visit_row(&mask, &shape, 2, cols);
+    CuAssertIntEquals(ct, 4, n);
+    CuAssertIntEquals(ct, 3, cols[0]);
+    CuAssertIntEquals(ct, 6, cols[3]);
+
+    // Zero rows and columns extend to the edges
+    mask.rows = 0;
+    mask.cols = 0;
+    region = eos_mask_region(&mask, &shape);
+    CuAssertIntEquals(ct, MASK_TEST_ROWS, region.row_end);
+    CuAssertIntEquals(ct, MASK_TEST_COLS, region.col_end);
+    CuAssertTrue(ct, eos_mask_count(&mask, &shape)
+                 == (MASK_TEST_ROWS - 1) * (MASK_TEST_COLS - 3));
+}
+
+/*
+ * eos_mask_next and eos_mask_count agree with a pixel-by-pixel scan of the
+ * bitmask, including runs that cross word boundaries
+ */
+void TestMaskBitmask(CuTest *ct) {
+    const EosObsShape shape = {MASK_TEST_ROWS, MASK_TEST_COLS, 1};
+    U64 valid[EOS_PIXEL_MASK_WORDS(MASK_TEST_ROWS, MASK_TEST_COLS)];
+    EosPixelMask mask = {0, 0, 0, 0, NULL};
+    EosMaskRegion region;
+    U32 cols[MASK_TEST_COLS];
+    U32 row, col, n, expected_n;
+    U64 p, expected_count;
+    U32 seed = 7;
+    U32 roi;
+
+    CuAssertIntEquals(ct, 6,
+                      (int) EOS_PIXEL_MASK_WORDS(MASK_TEST_ROWS,
+                                                 MASK_TEST_COLS));
+    memset(valid, 0, sizeof(valid));
+    for (row = 0; row < MASK_TEST_ROWS; row++) {
+        for (col = 0; col < MASK_TEST_COLS; col++) {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 3 == 0) {
+                _set_valid(valid, MASK_TEST_COLS, row, col);
+            }
+        }
+    }
+    // A row that spans a word boundary with a single valid pixel after it
+    for (col = 0; col < MASK_TEST_COLS; col++) {
+        p = (U64) 1 * MASK_TEST_COLS + col;
+        valid[p / 64] &= ~(1ull << (p % 64));
+    }
+    _set_valid(valid, MASK_TEST_COLS, 1, 68);
+    mask.valid = valid;
+    CuAssertIntEquals(ct, 1, eos_mask_has_bitmask(&mask));
+
+    // The whole observation and then an interior region of interest
+    for (roi = 0; roi < 2; roi++) {
+        if (roi) {
+            mask.row_start = 1;
+            mask.rows = 3;
+            mask.col_start = 5;
+            mask.cols = 62;
+        }
+        region = eos_mask_region(&mask, &shape);
+        expected_count = 0;
+        for (row = region.row_start; row < region.row_end; row++) {
+            n = _visit_row(&mask, &shape, row, cols);
+            expected_n = 0;
+            for (col = region.col_start; col < region.col_end; col++) {
+                p = (U64) row * MASK_TEST_COLS + col;
+                if ((valid[p / 64] >> (p % 64)) & 1) {
+                    CuAssertTrue(ct, expected_n < n);
+                    CuAssertIntEquals(ct, col, cols[expected_n]);
+                    expected_n++;
+                }
+            }
+            CuAssertIntEquals(ct, expected_n, n);
+            expected_count += expected_n;
+        }
+        CuAssertTrue(ct, eos_mask_count(&mask, &shape) == expected_count);
+    }
+
+    // Row 1 has its single valid pixel outside the region of interest
+    CuAssertIntEquals(ct, 0, _visit_row(&mask, &shape, 1, cols));
+
+    // No valid pixels at all
+    memset(valid, 0, sizeof(valid));
+    CuAssertTrue(ct, eos_mask_count(&mask, &shape) == 0);
+    CuAssertIntEquals(ct, 67, eos_mask_next(&mask, MASK_TEST_COLS, 2, 5, 67));
+}
+
+/* A region of interest must lie within the observation */
+void TestMaskCheck(CuTest *ct) {
+    const EosObsShape shape = {MASK_TEST_ROWS, MASK_TEST_COLS, 1};
+    EosPixelMask mask = {0, 0, MASK_TEST_ROWS, MASK_TEST_COLS, NULL};
+
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_mask_check(NULL, &shape));
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_mask_check(&mask, &shape));
+
+    mask.rows = MASK_TEST_ROWS + 1;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_mask_check(&mask, &shape));
+    mask.rows = 0;
+    mask.row_start = MASK_TEST_ROWS + 1;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_mask_check(&mask, &shape));
+    mask.row_start = 0;
+    mask.col_start = 10;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_mask_check(&mask, &shape));
+    mask.cols = 0;
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_mask_check(&mask, &shape));
+}
+
+CuSuite* CuMaskGetSuite(void)
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, TestMaskRegion);
+    SUITE_ADD_TEST(suite, TestMaskBitmask);
+    SUITE_ADD_TEST(suite, TestMaskCheck);
+    return suite;
+}
@@ -1,15 +1,23 @@
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <float.h>
 
 #include <eos.h>
 #include <eos_mise.h>
+#include <eos_thread.h>
 #include "CuTest.h"
 #include "util.h"
 
 EosStatus _eigen_pivot(F64 p, F64 y, F64* c, F64* s, F64* t);
 EosStatus _rx_score(F64* mean_sub, F64* cov_inv, const EosObsShape shape,
+    F64* score);
+EosStatus _rx_score_cholesky(F64* mean_sub, F64* chol, const EosObsShape shape,
     F64* temp, F64* score);
+EosStatus _rx_score_tile_cholesky(const F64* chol, U32 bands, U32 packed,
+    F64* tile, F64* scores);
+EosStatus _rx_score_tile(const F64* cov_inv, U32 bands, U32 packed,
+    const F64* tile, F64* product, F64* scores);
 
 void TestComputeMeanPixel(CuTest *ct) {
 
@@ -23,7 +31,7 @@ void TestComputeMeanPixel(CuTest *ct) {
 
     F64 mp[3];
 
-    status = compute_mean_pixel(data, &shape, mp);
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, mp);
 
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertDblEquals(ct, 2.5, mp[0], 1e-9);
@@ -32,7 +40,7 @@ void TestComputeMeanPixel(CuTest *ct) {
 
     // Zero-size observation
     shape.rows = 0;
-    status = compute_mean_pixel(data, &shape, mp);
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, mp);
 
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertDblEquals(ct, 0, mp[0], 1e-9);
@@ -41,11 +49,11 @@ void TestComputeMeanPixel(CuTest *ct) {
 
     // Null Pointers
     shape.rows = 1;
-    status = compute_mean_pixel(NULL, &shape, mp);
+    status = compute_mean_pixel(NULL, &shape, EOS_MISE_BIP, mp);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-    status = compute_mean_pixel(data, NULL, mp);
+    status = compute_mean_pixel(data, NULL, EOS_MISE_BIP, mp);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-    status = compute_mean_pixel(data, &shape, NULL);
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, NULL);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 }
 
@@ -60,7 +68,7 @@ void TestComputeCovariance(CuTest *ct) {
     U32 i, cov_size = shape.bands * shape.bands;
 
     F64 mean_pixel[shape.bands];
-    status = compute_mean_pixel(data, &shape, mean_pixel);
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, mean_pixel);
 
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertDblEquals(ct, 4, mean_pixel[0], 1e-9);
@@ -68,7 +76,7 @@ void TestComputeCovariance(CuTest *ct) {
     CuAssertDblEquals(ct, 6, mean_pixel[2], 1e-9);
 
     F64 cov[shape.bands * shape.bands];
-    status = compute_covariance(data, &shape, mean_pixel, cov);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_pixel, cov);
 
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     for (i = 0; i < cov_size; i++) {
@@ -77,25 +85,208 @@ void TestComputeCovariance(CuTest *ct) {
 
     // Test Small Sample Sizes
     shape.cols = 1;
-    status = compute_covariance(data, &shape, mean_pixel, cov);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_pixel, cov);
     CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
 
     shape.cols = 0;
-    status = compute_covariance(data, &shape, mean_pixel, cov);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_pixel, cov);
     CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
 
     // Test NULL pointers
     shape.cols = 3;
-    status = compute_covariance(NULL, &shape, mean_pixel, cov);
+    status = compute_covariance(NULL, &shape, EOS_MISE_BIP, mean_pixel, cov);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-    status = compute_covariance(data, NULL, mean_pixel, cov);
+    status = compute_covariance(data, NULL, EOS_MISE_BIP, mean_pixel, cov);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-    status = compute_covariance(data, &shape, NULL, cov);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, NULL, cov);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-    status = compute_covariance(data, &shape, mean_pixel, NULL);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_pixel, NULL);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 }
 
+void TestComputeMoments(CuTest *ct) {
+    EosStatus status;
+    const U16 data[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EosObsShape shape = {1, 3, 3};
+    U64 sum[3];
+    U64 sum_sq[6];
+    U64 sum_sq_e[6] = {66, 78, 90, 93, 108, 126};
+    U32 i;
+
+    status = compute_moments(data, &shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 12, (int) sum[0]);
+    CuAssertIntEquals(ct, 15, (int) sum[1]);
+    CuAssertIntEquals(ct, 18, (int) sum[2]);
+    for (i = 0; i < 6; i++) {
+        CuAssertIntEquals(ct, (int) sum_sq_e[i], (int) sum_sq[i]);
+    }
+
+    // Largest possible values do not overflow
+    const U16 big[4] = {UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX};
+    EosObsShape big_shape = {2, 1, 2};
+    status = compute_moments(big, &big_shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, sum_sq[1] == 2 * (U64) UINT16_MAX * UINT16_MAX);
+
+    // Test NULL pointers
+    status = compute_moments(NULL, &shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments(data, NULL, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments(data, &shape, EOS_MISE_BIP, NULL, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments(data, &shape, EOS_MISE_BIP, sum, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+void TestMomentsMatchTwoPass(CuTest *ct) {
+    // Use enough pixels and bands to span several cache blocks
+    EosStatus status;
+    EosObsShape shape = {7, 23, 37};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 n_packed = shape.bands * (shape.bands + 1) / 2;
+    U16* data = malloc(sizeof(U16) * n_pixels * shape.bands);
+    U64* sum = malloc(sizeof(U64) * shape.bands);
+    U64* sum_sq = malloc(sizeof(U64) * n_packed);
+    F64* mean_e = malloc(sizeof(F64) * shape.bands);
+    F64* mean = malloc(sizeof(F64) * shape.bands);
+    F64* cov_e = malloc(sizeof(F64) * shape.bands * shape.bands);
+    F64* cov = malloc(sizeof(F64) * shape.bands * shape.bands);
+    U32 i, j, k;
+
+    srand(5);
+    for (i = 0; i < n_pixels * shape.bands; i++) {
+        data[i] = 1000 + (rand() % 4000);
+    }
+
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, mean_e);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_e, cov_e);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = compute_moments(data, &shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = moments_to_mean_covariance(n_pixels, shape.bands,
+                                        sum, sum_sq, mean, cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    for (i = 0; i < shape.bands; i++) {
+        CuAssertDblEquals(ct, mean_e[i], mean[i], 1e-9);
+    }
+    for (i = 0; i < shape.bands * shape.bands; i++) {
+        CuAssertDblEquals(ct, cov_e[i], cov[i], 1e-6);
+    }
+
+    // The packed covariance, written over the moments, is the upper triangle
+    // of the dense one
+    status = moments_to_mean_covariance_packed(n_pixels, shape.bands,
+        sum, sum_sq, mean, (F64*) sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0, j = 0; i < shape.bands; i++) {
+        for (k = i; k < shape.bands; k++, j++) {
+            CuAssertDblEquals(ct, cov[i * shape.bands + k],
+                              ((F64*) sum_sq)[j], 0.0);
+        }
+    }
+    status = moments_to_mean_covariance_packed(1, shape.bands,
+        sum, sum_sq, mean, cov);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Covariance of values near the top of the U16 range is exact
+    const U16 high[6] = {65535, 65533, 65534, 65534, 65533, 65535};
+    EosObsShape high_shape = {3, 1, 2};
+    status = compute_moments(high, &high_shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = moments_to_mean_covariance(3, 2, sum, sum_sq, mean, cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertDblEquals(ct, 65534.0, mean[0], 0);
+    CuAssertDblEquals(ct, 65534.0, mean[1], 0);
+    CuAssertDblEquals(ct, 1.0, cov[0], 0);
+    CuAssertDblEquals(ct, -1.0, cov[1], 0);
+    CuAssertDblEquals(ct, -1.0, cov[2], 0);
+    CuAssertDblEquals(ct, 1.0, cov[3], 0);
+
+    // Sample size not large enough to compute covariance
+    status = moments_to_mean_covariance(1, shape.bands,
+                                        sum, sum_sq, mean, cov);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Test NULL pointers
+    status = moments_to_mean_covariance(n_pixels, shape.bands,
+                                        NULL, sum_sq, mean, cov);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = moments_to_mean_covariance(n_pixels, shape.bands,
+                                        sum, NULL, mean, cov);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = moments_to_mean_covariance(n_pixels, shape.bands,
+                                        sum, sum_sq, NULL, cov);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = moments_to_mean_covariance(n_pixels, shape.bands,
+                                        sum, sum_sq, mean, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    free(data);
+    free(sum);
+    free(sum_sq);
+    free(mean_e);
+    free(mean);
+    free(cov_e);
+    free(cov);
+}
+
+void TestMomentsParallel(CuTest *ct) {
+    EosStatus status;
+    EosObsShape shape = {13, 11, 19};
+    const U32 n_values = shape.rows * shape.cols * shape.bands;
+    const U64 moments_size = mise_moments_size(shape.bands);
+    const U32 worker_counts[5] = {1, 2, 3, 4, 16};
+    U16* data = malloc(sizeof(U16) * n_values);
+    U64* expected = malloc(sizeof(U64) * moments_size);
+    U64* actual = malloc(sizeof(U64) * moments_size);
+    U64* scratch = malloc(sizeof(U64) * moments_size * 15);
+    U32 i, k;
+
+    srand(7);
+    for (i = 0; i < n_values; i++) {
+        data[i] = rand() % (UINT16_MAX + 1);
+    }
+
+    status = compute_moments(data, &shape, EOS_MISE_BIP, expected,
+                             expected + shape.bands);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // Partial sums are exact, so every partition gives identical moments
+    // (including more workers than rows for the 16-worker case)
+    for (k = 0; k < 5; k++) {
+        memset(actual, 0xFF, sizeof(U64) * moments_size);
+        status = compute_moments_parallel(data, &shape, EOS_MISE_BIP,
+                                          worker_counts[k],
+            scratch, actual, actual + shape.bands);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (i = 0; i < moments_size; i++) {
+            CuAssertTrue(ct, expected[i] == actual[i]);
+        }
+    }
+
+    // Invalid worker counts and missing scratch space
+    status = compute_moments_parallel(data, &shape, EOS_MISE_BIP, 0,
+        scratch, actual, actual + shape.bands);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments_parallel(data, &shape, EOS_MISE_BIP,
+                                      EOS_MAX_WORKERS + 1,
+        scratch, actual, actual + shape.bands);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments_parallel(data, &shape, EOS_MISE_BIP, 2,
+        NULL, actual, actual + shape.bands);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    free(data);
+    free(expected);
+    free(actual);
+    free(scratch);
+}
+
 void TestPZeroInEigenPivot(CuTest *ct) {
     EosStatus status;
     F64 p = 0;
@@ -108,18 +299,41 @@ void TestPZeroInEigenPivot(CuTest *ct) {
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 }
 
-void TestEigen(CuTest *ct) {
+/*
+ * Compare the rows of V with the expected eigenvectors, either exactly or
+ * up to the sign of each eigenvector
+ */
+static void _assert_eigenvectors(CuTest *ct, U32 n, const double* ve,
+                                 const double* v, U32 up_to_sign,
+                                 double tol) {
+    U32 i, k;
+    double sign;
+    for (k = 0; k < n; k++) {
+        sign = 1.0;
+        for (i = 0; i < n && up_to_sign; i++) {
+            if (fabs(ve[k * n + i]) > tol) {
+                sign = (ve[k * n + i] * v[k * n + i] < 0) ? -1.0 : 1.0;
+                break;
+            }
+        }
+        for (i = 0; i < n; i++) {
+            CuAssertDblEquals(ct, ve[k * n + i], sign * v[k * n + i], tol);
+        }
+    }
+}
+
+static void _test_eigen(CuTest *ct,
+                        EosStatus (*eigen)(U32, F64*, F64*, F64*, U32*),
+                        U32 up_to_sign) {
     double a[4] = {-5, 1, 1, 3};
     double v[9];
     double w[3];
     double ve[4] = {0.99250756, -0.12218326, 0.12218326, 0.99250756};
     double we[2] = {-5.12310563, 3.12310563};
     U32 buf[6];
-    get_eigen_symm(2, a, w, v, buf);
+    eigen(2, a, w, v, buf);
     int i;
-    for (i = 0; i < 4; i++) {
-        CuAssertDblEquals(ct,  ve[i], v[i], 1e-6);
-    }
+    _assert_eigenvectors(ct, 2, ve, v, up_to_sign, 1e-6);
     for (i = 0; i < 2; i++) {
         CuAssertDblEquals(ct,  we[i], w[i], 1e-6);
     }
@@ -128,10 +342,8 @@ void TestEigen(CuTest *ct) {
     double b[4] = {0, 0, 0, 0};
     double vbe[4] = {1.0, 0.0, 0.0, 1.0};
     double wbe[2] = {0.0, 0.0};
-    get_eigen_symm(2, b, w, v, buf);
-    for (i = 0; i < 4; i++) {
-        CuAssertDblEquals(ct,  vbe[i], v[i], DBL_EPSILON);
-    }
+    eigen(2, b, w, v, buf);
+    _assert_eigenvectors(ct, 2, vbe, v, up_to_sign, DBL_EPSILON);
     for (i = 0; i < 2; i++) {
         CuAssertDblEquals(ct,  wbe[i], w[i], DBL_EPSILON);
     }
@@ -143,25 +355,249 @@ void TestEigen(CuTest *ct) {
         -0.57735027, -0.57735027,  0.57735027
     };
     double wce[3] = {3.39444872, 10.60555128, -4.};
-    get_eigen_symm(3, c, w, v, buf);
-    for (i = 0; i < 9; i++) {
-        CuAssertDblEquals(ct,  vce[i], v[i], 1e-6);
-    }
+    eigen(3, c, w, v, buf);
+    _assert_eigenvectors(ct, 3, vce, v, up_to_sign, 1e-6);
     for (i = 0; i < 3; i++) {
         CuAssertDblEquals(ct,  wce[i], w[i], 1e-6);
     }
 
     // Test small matrix
     double d[1] = {2.0};
-    get_eigen_symm(1, d, w, v, buf);
-    CuAssertDblEquals(ct,  1.0, v[0], 1e-6);
+    double vde[1] = {1.0};
+    eigen(1, d, w, v, buf);
+    _assert_eigenvectors(ct, 1, vde, v, up_to_sign, 1e-6);
     CuAssertDblEquals(ct,  2.0, w[0], 1e-6);
 }
 
+/* The default solver, whose eigenvectors are pinned up to sign */
+void TestEigen(CuTest *ct) {
+    _test_eigen(ct, get_eigen_symm, EOS_TRUE);
+}
+
+/* The Jacobi method pins the sign of each eigenvector as well */
+void TestEigenJacobi(CuTest *ct) {
+    _test_eigen(ct, get_eigen_symm_jacobi, EOS_FALSE);
+}
+
+/* Indices of the n eigenvalues w in decreasing order */
+static void _sort_eigen_desc(U32 n, const F64* w, U32* order) {
+    U32 i, j, t;
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (i = 0; i < n; i++) {
+        for (j = i + 1; j < n; j++) {
+            if (w[order[j]] > w[order[i]]) {
+                t = order[i];
+                order[i] = order[j];
+                order[j] = t;
+            }
+        }
+    }
+}
+
+/*
+ * Tridiagonalization and QL agree with the Jacobi method: the eigenpairs
+ * satisfy A v = w v with orthonormal eigenvectors, for dense and packed
+ * matrices, including repeated and zero eigenvalues
+ */
+void TestEigenQl(CuTest *ct) {
+    const U32 n = 40;
+    F64* A = malloc(sizeof(F64) * n * n);
+    F64* A_copy = malloc(sizeof(F64) * n * n);
+    F64* packed = malloc(sizeof(F64) * n * (n + 1) / 2);
+    F64* V = malloc(sizeof(F64) * n * n);
+    F64* V_packed = malloc(sizeof(F64) * n * n);
+    F64 w[40], w_packed[40], w_jacobi[40];
+    U32 order[40], order_packed[40], order_jacobi[40], buf[80];
+    F64 x, r, scale;
+    U32 i, j, k, trial, seed = 3;
+    EosStatus status;
+
+    for (trial = 0; trial < 3; trial++) {
+        for (i = 0; i < n; i++) {
+            for (j = i; j < n; j++) {
+                seed = seed * 1103515245 + 12345;
+                x = (F64) ((seed >> 16) % 2001) - 1000.0;
+                if (trial == 1) {
+                    // Identity plus a rank-one matrix: a repeated eigenvalue
+                    x = (i == j) + (F64) (i % 7) * (j % 7);
+                } else if (trial == 2) {
+                    // Rank-deficient: half the rows are zero
+                    x = (i % 2 || j % 2) ? 0.0 : x;
+                }
+                A[i * n + j] = x;
+                A[j * n + i] = x;
+            }
+        }
+        scale = 0.0;
+        for (i = 0; i < n * n; i++) {
+            scale = (fabs(A[i]) > scale) ? fabs(A[i]) : scale;
+        }
+        k = 0;
+        for (i = 0; i < n; i++) {
+            for (j = i; j < n; j++) {
+                packed[k++] = A[i * n + j];
+            }
+        }
+
+        memcpy(A_copy, A, sizeof(F64) * n * n);
+        status = get_eigen_symm_ql(n, A_copy, w, V);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (k = 0; k < n; k++) {
+            for (i = 0; i < n; i++) {
+                r = -w[k] * V[k * n + i];
+                for (j = 0; j < n; j++) {
+                    r += A[i * n + j] * V[k * n + j];
+                }
+                CuAssertDblEquals(ct, 0.0, r, 1e-10 * n * scale);
+            }
+            for (j = 0; j < n; j++) {
+                r = 0.0;
+                for (i = 0; i < n; i++) {
+                    r += V[k * n + i] * V[j * n + i];
+                }
+                CuAssertDblEquals(ct, (j == k) ? 1.0 : 0.0, r, 1e-12 * n);
+            }
+        }
+
+        // The packed matrix (with the solver of get_eigen_symm) and the
+        // Jacobi method give the same eigenvalues
+        status = get_eigen_symm_packed(n, packed, w_packed, V_packed, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        memcpy(A_copy, A, sizeof(F64) * n * n);
+        status = get_eigen_symm_jacobi(n, A_copy, w_jacobi, V_packed, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        _sort_eigen_desc(n, w, order);
+        _sort_eigen_desc(n, w_packed, order_packed);
+        _sort_eigen_desc(n, w_jacobi, order_jacobi);
+        for (i = 0; i < n; i++) {
+            CuAssertDblEquals(ct, w[order[i]], w_packed[order_packed[i]],
+                              1e-10 * n * scale);
+            CuAssertDblEquals(ct, w[order[i]], w_jacobi[order_jacobi[i]],
+                              1e-10 * n * scale);
+        }
+    }
+
+    // A single entry, and a zero matrix
+    A[0] = 2.0;
+    status = get_eigen_symm_ql(1, A, w, V);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertDblEquals(ct, 2.0, w[0], 0);
+    CuAssertDblEquals(ct, 1.0, V[0], 0);
+    memset(A, 0, sizeof(F64) * 4);
+    status = get_eigen_symm_ql(2, A, w, V);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 4; i++) {
+        CuAssertDblEquals(ct, (i % 3 == 0) ? 1.0 : 0.0, fabs(V[i]), 0);
+    }
+    CuAssertDblEquals(ct, 0.0, w[0], 0);
+    CuAssertDblEquals(ct, 0.0, w[1], 0);
+
+    free(V_packed);
+    free(V);
+    free(packed);
+    free(A_copy);
+    free(A);
+}
+
+/*
+ * RX score x' pinv(A) x from the eigenpairs of A, dropping eigenvalues at
+ * or below the threshold used by invert_sym_matrix
+ */
+static F64 _pseudo_inverse_score(U32 n, const F64* w, const F64* V,
+                                 const F64* x) {
+    F64 trace = 0.0, score = 0.0, proj;
+    U32 i, k;
+    for (k = 0; k < n; k++) {
+        trace += w[k];
+    }
+    for (k = 0; k < n; k++) {
+        if (w[k] <= 2.0 * DBL_EPSILON * fabs(trace)) { continue; }
+        proj = 0.0;
+        for (i = 0; i < n; i++) {
+            proj += V[k * n + i] * x[i];
+        }
+        score += proj * proj / w[k];
+    }
+    return score;
+}
+
+/*
+ * A rank-two covariance over many bands, whose leading rows are exactly
+ * zero, gives QL rotations that underflow: the scores from its
+ * pseudo-inverse stay finite and agree with the Jacobi method
+ */
+void TestEigenQlRankDeficient(CuTest *ct) {
+    const U32 n = 50;
+    F64* A = malloc(sizeof(F64) * n * n);
+    F64* A_copy = malloc(sizeof(F64) * n * n);
+    F64* A_inv = malloc(sizeof(F64) * n * n);
+    F64* V = malloc(sizeof(F64) * n * n);
+    F64* V_jacobi = malloc(sizeof(F64) * n * n);
+    F64* V_work = malloc(sizeof(F64) * n * n);
+    F64 u[50], v[50], x[50], w[50], w_jacobi[50], w_work[50];
+    U32 buf[100];
+    F64 score, score_jacobi, score_inv;
+    U32 i, j, trial, p;
+    EosStatus status;
+
+    for (trial = 0; trial < 2; trial++) {
+        for (i = 0; i < n; i++) {
+            u[i] = (trial == 1 && i % 4 == 0) ? 0.0 : 1.0 + i % 3;
+            v[i] = (i < n / 2) ? 0.0 : 2.0;
+        }
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) {
+                A[i * n + j] = u[i] * u[j] + v[i] * v[j];
+            }
+        }
+        memcpy(A_copy, A, sizeof(F64) * n * n);
+        status = get_eigen_symm_ql(n, A_copy, w, V);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        memcpy(A_copy, A, sizeof(F64) * n * n);
+        status = get_eigen_symm_jacobi(n, A_copy, w_jacobi, V_jacobi, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = invert_sym_matrix(n, A, A_inv, w_work, V_work, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+        // Pixels in the span of the two components
+        for (p = 0; p < 4; p++) {
+            for (i = 0; i < n; i++) {
+                x[i] = (F64) (p + 1) * u[i] - (F64) (3 - p) * v[i];
+            }
+            score = _pseudo_inverse_score(n, w, V, x);
+            score_jacobi = _pseudo_inverse_score(n, w_jacobi, V_jacobi, x);
+            score_inv = 0.0;
+            for (i = 0; i < n; i++) {
+                for (j = 0; j < n; j++) {
+                    score_inv += x[i] * A_inv[i * n + j] * x[j];
+                }
+            }
+            CuAssertTrue(ct, isfinite(score));
+            CuAssertTrue(ct, isfinite(score_inv));
+            CuAssertDblEquals(ct, score_jacobi, score, 1e-6 * score_jacobi);
+            CuAssertDblEquals(ct, score_jacobi, score_inv,
+                              1e-6 * score_jacobi);
+        }
+    }
+
+    free(V_work);
+    free(V_jacobi);
+    free(V);
+    free(A_inv);
+    free(A_copy);
+    free(A);
+}
+
 void TestInvert(CuTest *ct) {
     EosStatus status;
     double v[64];
     double x[64];
+    double packed[36];
+    double w[8], V[64];
+    U32 buf[16];
+    U32 i, j, k;
     memset(v, 0, 64*sizeof(double));
     memset(x, 0, 64*sizeof(double));
     v[0*8 + 0] = -5;
@@ -174,12 +610,134 @@ void TestInvert(CuTest *ct) {
     v[5*8 + 5] = 1;
     v[6*8 + 6] = 1;
     v[7*8 + 7] = 1;
-    status = invert_sym_matrix(8, v, x);
+    status = invert_sym_matrix(8, v, x, w, V, buf);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertDblEquals(ct, -0.1875, x[0*8 + 0], DBL_EPSILON);
     CuAssertDblEquals(ct,  0.0625, x[0*8 + 1], DBL_EPSILON);
     CuAssertDblEquals(ct,  0.0625, x[1*8 + 0], DBL_EPSILON);
     CuAssertDblEquals(ct,  0.3125, x[1*8 + 1], DBL_EPSILON);
+
+    // The packed inverse is the upper triangle of the dense one
+    CuAssertIntEquals(ct, 36, (int) mise_packed_size(8));
+    for (i = 0, k = 0; i < 8; i++) {
+        for (j = i; j < 8; j++) {
+            packed[k++] = v[i*8 + j];
+        }
+    }
+    status = invert_sym_matrix_packed(8, packed, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0, k = 0; i < 8; i++) {
+        for (j = i; j < 8; j++) {
+            CuAssertDblEquals(ct, x[i*8 + j], packed[k++], 0.0);
+        }
+    }
+
+    status = invert_sym_matrix(8, v, x, NULL, V, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = invert_sym_matrix_packed(8, NULL, w, V, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+void TestCholesky(CuTest *ct) {
+    EosStatus status;
+    F64 a[9] = {
+         4.0,  12.0, -16.0,
+        12.0,  37.0, -43.0,
+       -16.0, -43.0,  98.0
+    };
+    F64 le[9] = {
+         2.0, 0.0, 0.0,
+         6.0, 1.0, 0.0,
+        -8.0, 5.0, 3.0
+    };
+    F64 l[9];
+    U32 i;
+
+    status = cholesky_decompose(3, a, l);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 9; i++) {
+        CuAssertDblEquals(ct, le[i], l[i], 1e-12);
+    }
+
+    // The packed factor is the transpose of L, in place
+    F64 ap[6] = {4.0, 12.0, -16.0, 37.0, -43.0, 98.0};
+    F64 ue[6] = {2.0, 6.0, -8.0, 1.0, 5.0, 3.0};
+    status = cholesky_decompose_packed(3, ap);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 6; i++) {
+        CuAssertDblEquals(ct, ue[i], ap[i], 1e-12);
+    }
+
+    // Rank-deficient matrix is rejected
+    F64 b[4] = {1.0, 1.0, 1.0, 1.0};
+    status = cholesky_decompose(2, b, l);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    F64 bp[3] = {1.0, 1.0, 1.0};
+    status = cholesky_decompose_packed(2, bp);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Indefinite matrix is rejected
+    F64 c[4] = {-5.0, 1.0, 1.0, 3.0};
+    status = cholesky_decompose(2, c, l);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Zero matrix is rejected
+    F64 d[4] = {0.0, 0.0, 0.0, 0.0};
+    status = cholesky_decompose(2, d, l);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Empty matrix is trivially factored
+    status = cholesky_decompose(0, a, l);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // NULL pointers
+    status = cholesky_decompose(3, NULL, l);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = cholesky_decompose(3, a, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = cholesky_decompose_packed(3, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+void TestRxScoreCholesky(CuTest *ct) {
+    EosStatus status;
+    EosObsShape shape = {1, 1, 3};
+    F64 mean_sub[3] = {1.0, -2.0, 0.5};
+    F64 cov[9] = {
+         4.0,  12.0, -16.0,
+        12.0,  37.0, -43.0,
+       -16.0, -43.0,  98.0
+    };
+    F64 chol[9];
+    F64 cov_inv[9];
+    F64 temp[3];
+    F64 w[3], V[9];
+    U32 buf[6];
+    F64 score, expected;
+
+    // Scores agree with the dense (pseudo-)inverse path
+    status = cholesky_decompose(3, cov, chol);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = invert_sym_matrix(3, cov, cov_inv, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = _rx_score(mean_sub, cov_inv, shape, &expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = _rx_score_cholesky(mean_sub, chol, shape, temp, &score);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertDblEquals(ct, expected, score, 1e-9 * expected);
+
+    status = _rx_score_cholesky(NULL, chol, shape, temp, &score);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = _rx_score_cholesky(mean_sub, NULL, shape, temp, &score);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = _rx_score_cholesky(mean_sub, chol, shape, NULL, &score);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = _rx_score_cholesky(mean_sub, chol, shape, temp, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 }
 
 void TestRxScore(CuTest *ct) {
@@ -191,24 +749,141 @@ void TestRxScore(CuTest *ct) {
         0.0, 2.0, 0.0,
         0.0, 0.0, 3.0
     };
-    F64 temp[3];
     F64 score;
 
-    status = _rx_score(mean_sub, cov_inv, shape, temp, &score);
+    status = _rx_score(mean_sub, cov_inv, shape, &score);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertDblEquals(ct, 36.0, score, 1e-12);
 
-    status = _rx_score(NULL, cov_inv, shape, temp, &score);
+    status = _rx_score(NULL, cov_inv, shape, &score);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
-    status = _rx_score(mean_sub, NULL, shape, temp, &score);
+    status = _rx_score(mean_sub, NULL, shape, &score);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
-    status = _rx_score(mean_sub, cov_inv, shape, NULL, &score);
+    status = _rx_score(mean_sub, cov_inv, shape, NULL);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+/*
+ * The tile kernels give the same scores as the per-pixel kernels; the band
+ * count spans more than one band block.
+ */
+void TestRxScoreTile(CuTest *ct) {
+    EosStatus status;
+    const U32 n = MISE_SCORE_BAND_BLOCK + 6;
+    const U32 t = MISE_SCORE_PIXEL_BLOCK;
+    EosObsShape shape = {1, 1, n};
+    F64* cov = malloc(sizeof(F64) * n * n);
+    F64* chol = malloc(sizeof(F64) * n * n);
+    F64* cov_inv = malloc(sizeof(F64) * n * n);
+    F64* tile = malloc(sizeof(F64) * n * t);
+    F64* zs = malloc(sizeof(F64) * n * t);
+    F64* product = malloc(sizeof(F64) * n * t);
+    F64* packed_chol = malloc(sizeof(F64) * mise_packed_size(n));
+    F64* packed_inv = malloc(sizeof(F64) * mise_packed_size(n));
+    F64* V = malloc(sizeof(F64) * n * n);
+    F64 w[MISE_SCORE_BAND_BLOCK + 6];
+    U32 buf[2 * (MISE_SCORE_BAND_BLOCK + 6)];
+    F64 mean_sub[MISE_SCORE_BAND_BLOCK + 6];
+    F64 temp[MISE_SCORE_BAND_BLOCK + 6];
+    F64 scores[MISE_SCORE_PIXEL_BLOCK];
+    F64 chol_scores[MISE_SCORE_PIXEL_BLOCK];
+    F64 packed_scores[MISE_SCORE_PIXEL_BLOCK];
+    F64 expected;
+    U32 seed = 12345;
+    U32 i, j, k, p;
+
+    // Diagonally dominant (so positive definite) covariance
+    for (i = 0; i < n; i++) {
+        for (j = 0; j <= i; j++) {
+            seed = seed * 1103515245 + 12345;
+            cov[i * n + j] = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+            cov[j * n + i] = cov[i * n + j];
+        }
+        cov[i * n + i] += n;
+    }
+    for (i = 0; i < n * t; i++) {
+        seed = seed * 1103515245 + 12345;
+        tile[i] = ((seed >> 16) % 2000) / 100.0 - 10.0;
+    }
+    memcpy(zs, tile, sizeof(F64) * n * t);
+
+    status = cholesky_decompose(n, cov, chol);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = invert_sym_matrix(n, cov, cov_inv, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = _rx_score_tile(cov_inv, n, EOS_FALSE, tile, product, scores);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = _rx_score_tile_cholesky(chol, n, EOS_FALSE, zs, chol_scores);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // The packed factors match the dense ones exactly, and so do the scores
+    for (i = 0, k = 0; i < n; i++) {
+        for (j = i; j < n; j++, k++) {
+            packed_chol[k] = cov[i * n + j];
+            packed_inv[k] = cov[i * n + j];
+        }
+    }
+    status = cholesky_decompose_packed(n, packed_chol);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = invert_sym_matrix_packed(n, packed_inv, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0, k = 0; i < n; i++) {
+        for (j = i; j < n; j++, k++) {
+            CuAssertDblEquals(ct, chol[j * n + i], packed_chol[k], 0.0);
+            CuAssertDblEquals(ct, cov_inv[i * n + j], packed_inv[k], 0.0);
+        }
+    }
+    status = _rx_score_tile(packed_inv, n, EOS_TRUE, tile, product,
+                            packed_scores);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (p = 0; p < t; p++) {
+        CuAssertDblEquals(ct, scores[p], packed_scores[p], 0.0);
+    }
+    memcpy(product, tile, sizeof(F64) * n * t);
+    status = _rx_score_tile_cholesky(packed_chol, n, EOS_TRUE, product,
+                                     packed_scores);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (p = 0; p < t; p++) {
+        CuAssertDblEquals(ct, chol_scores[p], packed_scores[p], 0.0);
+    }
+
+    for (p = 0; p < t; p++) {
+        for (i = 0; i < n; i++) {
+            mean_sub[i] = tile[i * t + p];
+        }
+        status = _rx_score_cholesky(mean_sub, chol, shape, temp, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertDblEquals(ct, expected, chol_scores[p], 1e-9 * expected);
+        CuAssertDblEquals(ct, expected, scores[p], 1e-9 * expected);
+    }
 
-    status = _rx_score(mean_sub, cov_inv, shape, temp, NULL);
+    status = _rx_score_tile_cholesky(NULL, n, EOS_FALSE, zs, chol_scores);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile_cholesky(chol, n, EOS_FALSE, NULL, chol_scores);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile_cholesky(chol, n, EOS_FALSE, zs, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile(NULL, n, EOS_FALSE, tile, product, scores);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile(cov_inv, n, EOS_FALSE, NULL, product, scores);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile(cov_inv, n, EOS_FALSE, tile, NULL, scores);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = _rx_score_tile(cov_inv, n, EOS_FALSE, tile, product, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    free(cov);
+    free(chol);
+    free(cov_inv);
+    free(packed_chol);
+    free(packed_inv);
+    free(V);
+    free(tile);
+    free(zs);
+    free(product);
 }
 
 void TestRxAnomalyDetection(CuTest *ct) {
@@ -224,13 +899,15 @@ void TestRxAnomalyDetection(CuTest *ct) {
     status = eos_init(&init_params, NULL, 0, NULL);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 
-    status = eos_mise_detect_anomaly_rx(shape1, data1, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape1, data1, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertIntEquals(ct, 2, n_results);
 
     // Test n_results = 0
     n_results = 0;
-    status = eos_mise_detect_anomaly_rx(shape1, data1, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape1, data1, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertIntEquals(ct, 0, n_results);
 
@@ -238,17 +915,32 @@ void TestRxAnomalyDetection(CuTest *ct) {
     EosObsShape shape2 = {1, 3, 2};
     uint16_t data2[6] = {1, 1, 2, 2, 100, 100};
     n_results = 1;
-    status = eos_mise_detect_anomaly_rx(shape2, data2, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape2, data2, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertIntEquals(ct, 1, n_results);
     CuAssertIntEquals(ct, 0, results[0].row);
     CuAssertIntEquals(ct, 2, results[0].col);
 
+    // Test full-rank background (Cholesky path) against a reference score
+    // for the most anomalous pixel (0, 3)
+    EosObsShape shape5 = {1, 4, 2};
+    uint16_t data5[8] = {1, 2, 3, 1, 2, 5, 10, 3};
+    n_results = 1;
+    status = eos_mise_detect_anomaly_rx(shape5, data5, EOS_MISE_BIP, 1,
+                                        &n_results, results);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 1, n_results);
+    CuAssertIntEquals(ct, 0, results[0].row);
+    CuAssertIntEquals(ct, 3, results[0].col);
+    CuAssertDblEquals(ct, 2.165807560137457, results[0].score, 1e-9);
+
     // Test zero-size input
     EosObsShape shape3 = {0, 3, 2};
     uint16_t data3[1] = {0};
     n_results = 1;
-    status = eos_mise_detect_anomaly_rx(shape3, data3, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape3, data3, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertIntEquals(ct, 0, n_results);
 
@@ -256,20 +948,24 @@ void TestRxAnomalyDetection(CuTest *ct) {
     EosObsShape shape4 = {1, 2, 0};
     uint16_t data4[1] = {0};
     n_results = 1;
-    status = eos_mise_detect_anomaly_rx(shape4, data4, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape4, data4, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
     CuAssertIntEquals(ct, 1, n_results);
     CuAssertDblEquals(ct, 0, results[0].score, 1e-9);
 
     // Test NULL pointer behavior
     n_results = 4;
-    status = eos_mise_detect_anomaly_rx(shape1, NULL, &n_results, results);
+    status = eos_mise_detect_anomaly_rx(shape1, NULL, EOS_MISE_BIP, 1,
+                                        &n_results, results);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
-    status = eos_mise_detect_anomaly_rx(shape1, data1, NULL, results);
+    status = eos_mise_detect_anomaly_rx(shape1, data1, EOS_MISE_BIP, 1, NULL,
+                                        results);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
-    status = eos_mise_detect_anomaly_rx(shape1, data1, &n_results, NULL);
+    status = eos_mise_detect_anomaly_rx(shape1, data1, EOS_MISE_BIP, 1,
+                                        &n_results, NULL);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
     // Clean up
@@ -277,67 +973,2852 @@ void TestRxAnomalyDetection(CuTest *ct) {
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 }
 
-void TestMiseInterface(CuTest *ct) {
+/*
+ * Sampled moments match those of the sampled pixels alone, for any number
+ * of workers
+ */
+void TestMomentsSampled(CuTest *ct) {
     EosStatus status;
-
-    // Set up library/algorithm params
     EosInitParams init_params;
+    const EosObsShape shape = {13, 11, 6};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 bands = shape.bands;
+    U16* data = malloc(sizeof(U16) * n_pixels * bands);
+    U16* sampled = malloc(sizeof(U16) * n_pixels * bands);
+    U16* gather = malloc(sizeof(U16) * 3 * mise_sample_gather_size(bands));
+    U64* scratch = malloc(sizeof(U64) * 2 * mise_moments_size(bands));
+    U64 sum[6], sum_sq[21], sum_e[6], sum_sq_e[21];
+    U64 n_sampled;
+    EosObsShape sample_shape = {1, 0, 6};
+    MiseSampling sampling;
+    U32 i, m, w, row, col;
+    const EosMiseSampling modes[2] = {EOS_MISE_SAMPLE_STRIDE,
+                                      EOS_MISE_SAMPLE_GRID};
+
+    for (i = 0; i < n_pixels * bands; i++) {
+        data[i] = (i * 7919 + (i / bands) * 31) % 4093;
+    }
     default_init_params_test(&init_params);
-    EosMiseParams params;
-    params.alg = EOS_MISE_RX;
+    init_params.mise_workers = 3;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
 
-    // Set up structure on stack for storing results
-    EosPixelDetection detections[10];
-    EosMiseDetectionResult result;
-    result.n_results = 10;
-    result.results = (EosPixelDetection*)(&detections);
+    for (m = 0; m < 2; m++) {
+        sampling.mode = modes[m];
+        sampling.step = 3;
+        sampling.seed = 0;
 
-    // Load data and initialize observation
-    void* data;
-    uint32_t size;
-    EosMiseObservation obs;
-    InitMiseObs(&obs, 10, 10, 5);
-    read_resource(ct, "mise/test_mise.mis", &data, &size);
+        sample_shape.cols = 0;
+        for (row = 0; row < shape.rows; row++) {
+            for (col = 0; col < shape.cols; col++) {
+                if ((modes[m] == EOS_MISE_SAMPLE_STRIDE
+                        && (row * shape.cols + col) % 3 == 0)
+                    || (modes[m] == EOS_MISE_SAMPLE_GRID
+                        && row % 3 == 0 && col % 3 == 0)) {
+                    memcpy(&(sampled[sample_shape.cols * bands]),
+                           &(data[(row * shape.cols + col) * bands]),
+                           sizeof(U16) * bands);
+                    sample_shape.cols++;
+                }
+            }
+        }
+        status = compute_moments(sampled, &sample_shape, EOS_MISE_BIP, sum_e,
+                                 sum_sq_e);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
 
-    // First test without initialization
-    status = eos_mise_detect_anomaly(&params, &obs, &result);
-    CuAssertIntEquals(ct, EOS_NOT_INITIALIZED, status);
+        for (w = 1; w <= 3; w++) {
+            status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                             &sampling, w,
+                scratch, gather, sum, sum_sq, &n_sampled);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            CuAssertIntEquals(ct, sample_shape.cols, (int) n_sampled);
+            for (i = 0; i < 6; i++) {
+                CuAssertTrue(ct, sum_e[i] == sum[i]);
+            }
+            for (i = 0; i < 21; i++) {
+                CuAssertTrue(ct, sum_sq_e[i] == sum_sq[i]);
+            }
+        }
+    }
 
-    // Initialize library
-    status = eos_init(&init_params, NULL, 0, NULL);
+    // The pseudo-random sample depends only on the seed, and has about
+    // 1 / step of the pixels
+    sampling.mode = EOS_MISE_SAMPLE_RANDOM;
+    sampling.step = 4;
+    sampling.seed = 17;
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 1,
+        scratch, gather, sum_e, sum_sq_e, &n_sampled);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, n_sampled > n_pixels / 8 && n_sampled < n_pixels / 2);
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 3,
+        scratch, gather, sum, sum_sq, &n_sampled);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 6; i++) {
+        CuAssertTrue(ct, sum_e[i] == sum[i]);
+    }
+    sampling.seed = 18;
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 1,
+        scratch, gather, sum, sum_sq, &n_sampled);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, sum_e[0] != sum[0]);
 
-    // Test with NULL arguments
-    status = eos_mise_detect_anomaly(NULL, &obs, &result);
-    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    // A step of one (or no sampling) uses all pixels
+    status = compute_moments(data, &shape, EOS_MISE_BIP, sum_e, sum_sq_e);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    sampling.step = 1;
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 2,
+        scratch, gather, sum, sum_sq, &n_sampled);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, n_pixels, (int) n_sampled);
+    for (i = 0; i < 21; i++) {
+        CuAssertTrue(ct, sum_sq_e[i] == sum_sq[i]);
+    }
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL, NULL, 2,
+        scratch, NULL, sum, sum_sq, &n_sampled);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, n_pixels, (int) n_sampled);
 
-    status = eos_mise_detect_anomaly(&params, NULL, &result);
+    // Bad arguments
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 1,
+        scratch, NULL, sum, sum_sq, &n_sampled);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
-
-    status = eos_mise_detect_anomaly(&params, &obs, NULL);
+    sampling.step = 0;
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 1,
+        scratch, gather, sum, sum_sq, &n_sampled);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL, NULL, 1,
+        scratch, NULL, sum, sum_sq, NULL);
     CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
 
-    // Nominal case
-    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    status = eos_teardown();
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+    free(sampled);
+    free(gather);
+    free(scratch);
+}
 
-    // Bad Algorithm
-    result.n_results = 10;
-    params.alg = 0xBAD;
-    status = eos_mise_detect_anomaly(&params, &obs, &result);
-    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+/*
+ * RX with a sampled background still scores every pixel, and finds an
+ * anomaly that stands out from the background
+ */
+void TestRxSampledAnomalyDetection(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    const EosObsShape shape = {40, 30, 8};
+    const U32 n_values = shape.rows * shape.cols * shape.bands;
+    U16* data = malloc(sizeof(U16) * n_values);
+    EosPixelDetection expected[5], results[5];
+    MiseSampling sampling;
+    U32 i, n_results, seed = 7;
+    const EosMiseSampling modes[3] = {EOS_MISE_SAMPLE_STRIDE,
+        EOS_MISE_SAMPLE_GRID, EOS_MISE_SAMPLE_RANDOM};
 
-    // Error within algorithm
-    params.alg = EOS_MISE_RX;
-    result.results = NULL;
-    status = eos_mise_detect_anomaly(&params, &obs, &result);
-    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    for (i = 0; i < n_values; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = 1000 + (seed >> 16) % 100;
+    }
+    for (i = 0; i < shape.bands; i++) {
+        data[(17 * shape.cols + 23) * shape.bands + i] += (i % 2) ? 300 : 0;
+    }
 
-    // Clean up
-    status = eos_teardown();
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = shape.bands;
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 5;
+    status = eos_init(&init_params, NULL, 0, NULL);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 
+    n_results = 5;
+    status = eos_mise_detect_anomaly_rx(shape, data, EOS_MISE_BIP, 2,
+                                        &n_results, expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    for (i = 0; i < 3; i++) {
+        sampling.mode = modes[i];
+        sampling.step = 4;
+        sampling.seed = 3;
+        n_results = 5;
+        status = eos_mise_detect_anomaly_rx_sampled(shape, data, EOS_MISE_BIP,
+                                                    NULL, 2,
+            &sampling, EOS_MISE_DOUBLE_PRECISION, &n_results, results, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 5, n_results);
+        CuAssertIntEquals(ct, 17, results[0].row);
+        CuAssertIntEquals(ct, 23, results[0].col);
+        CuAssertTrue(ct, results[0].score > 2 * results[1].score);
+    }
+
+    // A sample of a single pixel falls back to all pixels
+    sampling.mode = EOS_MISE_SAMPLE_GRID;
+    sampling.step = 100;
+    n_results = 5;
+    status = eos_mise_detect_anomaly_rx_sampled(shape, data, EOS_MISE_BIP, NULL,
+                                                2,
+        &sampling, EOS_MISE_DOUBLE_PRECISION, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, expected[i].row, results[i].row);
+        CuAssertIntEquals(ct, expected[i].col, results[i].col);
+        CuAssertDblEquals(ct, expected[i].score, results[i].score, 0);
+    }
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+}
+
+/*
+ * Scores computed in single precision agree with the double-precision
+ * scores (for both the Cholesky and the pseudo-inverse backgrounds)
+ */
+void TestRxSinglePrecision(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseObservation obs;
+    EosMiseDetectionResult result;
+    const EosObsShape shapes[3] = {{24, 20, 10},
+                                   {24, 20, 40},
+                                   {24, 20, 30}};
+    const F64 tolerances[3] = {1e-5, 1e-5, 1e-4};
+    U16* data = malloc(sizeof(U16) * 24 * 20 * 40);
+    EosPixelDetection expected[20], results[20];
+    U32 s, i, j, n_expected, n_results, n_values, seed = 17;
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = 40;
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 20;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    for (s = 0; s < 3; s++) {
+        n_values = shapes[s].rows * shapes[s].cols * shapes[s].bands;
+        for (i = 0; i < n_values; i++) {
+            seed = seed * 1103515245 + 12345;
+            /* A bright, correlated background with some noise */
+            data[i] = 20000 + 50 * (i / shapes[s].bands % 97)
+                      + 30 * (i % shapes[s].bands) + (seed >> 16) % 100;
+            /* The last shape repeats its bands, so the covariance is
+             * singular and the pseudo-inverse is used */
+            if (s == 2 && i % shapes[s].bands >= 15) {
+                data[i] = data[i - 15];
+            }
+        }
+        data[(n_values / shapes[s].bands / 2) * shapes[s].bands] += 500;
+
+        n_expected = 20;
+        status = eos_mise_detect_anomaly_rx_sampled(shapes[s], data,
+                                                    EOS_MISE_BIP, NULL, 2,
+            NULL, EOS_MISE_DOUBLE_PRECISION, &n_expected, expected, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        n_results = 20;
+        status = eos_mise_detect_anomaly_rx_sampled(shapes[s], data,
+                                                    EOS_MISE_BIP, NULL, 2,
+            NULL, EOS_MISE_SINGLE_PRECISION, &n_results, results, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, n_expected, n_results);
+
+        CuAssertIntEquals(ct, expected[0].row, results[0].row);
+        CuAssertIntEquals(ct, expected[0].col, results[0].col);
+        for (i = 0; i < n_results; i++) {
+            for (j = 0; j < n_expected; j++) {
+                if (expected[j].row == results[i].row &&
+                        expected[j].col == results[i].col) {
+                    CuAssertDblEquals(ct, expected[j].score, results[i].score,
+                                      tolerances[s] * expected[0].score);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Through the library interface
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    all_params.mise.precision = EOS_MISE_SINGLE_PRECISION;
+    obs.shape = shapes[2];
+    obs.data = data;
+    obs.layout = EOS_MISE_BIP;
+    obs.mask = NULL;
+    result.n_results = 20;
+    result.results = expected;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n_results; i++) {
+        CuAssertDblEquals(ct, results[i].score, expected[i].score, 0);
+    }
+    all_params.mise.precision = EOS_MISE_N_PRECISIONS;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+}
+
+/*
+ * The RX background is stored packed and factored in place. With only RX
+ * enabled at initialization, the arena needs less than the two dense
+ * covariance matrices it used to. A rank-deficient, sampled background (whose
+ * moments are accumulated again for the pseudo-inverse) gives the scores of
+ * the dense pseudo-inverse.
+ */
+void TestRxPackedBackground(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseObservation obs;
+    EosMiseDetectionResult result;
+    MiseSampling sampling;
+    const EosObsShape shape = {16, 12, 6};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 max_bands = 421;
+    U16* data = malloc(sizeof(U16) * n_pixels * shape.bands);
+    U16* gather = malloc(sizeof(U16) * mise_sample_gather_size(shape.bands));
+    U64 sum[6], sum_sq[21], n_sampled, all_size;
+    F64 mean_pixel[6], mean_sub[6], cov[36], cov_inv[36], w[6], V[36];
+    U32 buf[12];
+    EosPixelDetection results[10];
+    F64 expected;
+    U32 i, b, seed = 4321;
+
+    // The last band duplicates the one before it
+    for (i = 0; i < n_pixels * shape.bands; i++) {
+        if (i % shape.bands == shape.bands - 1) {
+            data[i] = data[i - 1];
+        } else {
+            seed = seed * 1103515245 + 12345;
+            data[i] = 800 + (seed >> 16) % 400;
+        }
+    }
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = max_bands;
+    CuAssertTrue(ct, eos_mise_detect_anomaly_rx_mreq(&init_params)
+                     < 2 * sizeof(F64) * max_bands * max_bands);
+    all_size = eos_memory_requirement(&init_params);
+    init_params.mise_algorithms = 1u << EOS_MISE_RX;
+    CuAssertTrue(ct, eos_memory_requirement(&init_params) < all_size);
+    init_params.mise_algorithms = 1u << EOS_MISE_N_ALGS;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    init_params.mise_max_bands = shape.bands;
+    init_params.mise_algorithms = 1u << EOS_MISE_RX;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    all_params.mise.precision = EOS_MISE_DOUBLE_PRECISION;
+    all_params.mise.background_sampling = EOS_MISE_SAMPLE_STRIDE;
+    all_params.mise.background_sample_step = 3;
+    obs.shape = shape;
+    obs.data = data;
+    obs.layout = EOS_MISE_BIP;
+    obs.mask = NULL;
+    result.n_results = 10;
+    result.results = results;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, result.n_results);
+
+    // Dense reference
+    sampling.mode = EOS_MISE_SAMPLE_STRIDE;
+    sampling.step = 3;
+    sampling.seed = all_params.mise.background_sample_seed;
+    status = compute_moments_sampled(data, &shape, EOS_MISE_BIP, NULL,
+                                     &sampling, 1, NULL,
+                                     gather, sum, sum_sq, &n_sampled);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = moments_to_mean_covariance(n_sampled, shape.bands, sum, sum_sq,
+                                        mean_pixel, cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = cholesky_decompose(shape.bands, cov, cov_inv);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    status = invert_sym_matrix(shape.bands, cov, cov_inv, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < result.n_results; i++) {
+        for (b = 0; b < shape.bands; b++) {
+            mean_sub[b] = data[(results[i].row * shape.cols + results[i].col)
+                               * shape.bands + b] - mean_pixel[b];
+        }
+        status = _rx_score(mean_sub, cov_inv, shape, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertDblEquals(ct, expected, results[i].score, 1e-9 * expected);
+    }
+
+    // Algorithms that were not enabled cannot be run
+    all_params.mise.alg = EOS_MISE_LOCAL_RX;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+    free(gather);
+}
+
+/*
+ * The truncated eigensolver finds the same leading eigenpairs as the full
+ * Jacobi solver
+ */
+void TestTopEigen(CuTest *ct) {
+    EosStatus status;
+    const U32 n = 12;
+    const U32 k = 3;
+    F64 B[144], A[144], Ac[144];
+    F64 w_full[12], V_full[144];
+    U32 buf_full[24], order[12];
+    F64 w[12], V[144];
+    F64* work = malloc(sizeof(F64) * mise_top_eigen_work_size(n, n));
+    U32 buf[36];
+    F64 dot;
+    U32 i, j, l, seed = 5;
+
+    for (i = 0; i < n * n; i++) {
+        seed = seed * 1103515245 + 12345;
+        B[i] = (F64) ((seed >> 16) % 1000) / 100.0 - 5.0;
+    }
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            A[i * n + j] = (i == j) ? 1.0 : 0.0;
+            for (l = 0; l < n; l++) {
+                A[i * n + j] += B[i * n + l] * B[j * n + l];
+            }
+        }
+    }
+    memcpy(Ac, A, sizeof(A));
+    status = get_eigen_symm(n, Ac, w_full, V_full, buf_full);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    _sort_eigen_desc(n, w_full, order);
+
+    CuAssertIntEquals(ct, 11, mise_top_eigen_block(n, k));
+    CuAssertIntEquals(ct, 12, mise_top_eigen_block(n, 6));
+
+    status = get_top_eigen_symm(n, A, k, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < k; i++) {
+        CuAssertDblEquals(ct, w_full[order[i]], w[i],
+                          1e-9 * w_full[order[0]]);
+        dot = 0.0;
+        for (j = 0; j < n; j++) {
+            dot += V[i * n + j] * V_full[order[i] * n + j];
+        }
+        CuAssertDblEquals(ct, 1.0, fabs(dot), 1e-6);
+        for (l = 0; l < k; l++) {
+            dot = 0.0;
+            for (j = 0; j < n; j++) {
+                dot += V[i * n + j] * V[l * n + j];
+            }
+            CuAssertDblEquals(ct, (i == l) ? 1.0 : 0.0, dot, 1e-9);
+        }
+    }
+
+    // Warm start from the basis found above
+    status = get_top_eigen_symm(n, A, k, EOS_TRUE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < k; i++) {
+        CuAssertDblEquals(ct, w_full[order[i]], w[i],
+                          1e-9 * w_full[order[0]]);
+    }
+
+    // All eigenpairs
+    status = get_top_eigen_symm(n, A, n, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n; i++) {
+        CuAssertDblEquals(ct, w_full[order[i]], w[i],
+                          1e-9 * w_full[order[0]]);
+    }
+
+    // A rank-2 matrix: the remaining eigenvalues are zero
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            A[i * n + j] = B[i] * B[j] + B[n + i] * B[n + j];
+        }
+    }
+    status = get_top_eigen_symm(n, A, 4, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, w[1] > 1.0);
+    CuAssertDblEquals(ct, 0.0, w[2], 1e-9 * w[0]);
+    CuAssertDblEquals(ct, 0.0, w[3], 1e-9 * w[0]);
+
+    // Bad arguments
+    status = get_top_eigen_symm(n, NULL, k, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = get_top_eigen_symm(n, A, 0, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = get_top_eigen_symm(n, A, n + 1, EOS_FALSE, w, V, work, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = get_top_eigen_symm(n, A, k, EOS_FALSE, w, V, NULL, buf);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    free(work);
+}
+
+/*
+ * PCA-reduced RX scores match a brute-force projection onto the leading
+ * eigenvectors of the covariance (and, in the complement, the rest of the
+ * RX score)
+ */
+void TestPcaRxAnomalyDetection(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseObservation obs;
+    EosMiseDetectionResult result;
+    const EosObsShape shape = {20, 15, 10};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 bands = shape.bands;
+    const U32 k = 3;
+    U16* data = malloc(sizeof(U16) * n_pixels * bands);
+    EosPixelDetection full[20], results[20];
+    F64 mean_pixel[10], cov[100], cov_c[100], cov_inv[100];
+    F64 w[10], V[100], mean_sub[10];
+    U32 buf[20], order[10];
+    F64 principal, rx_score, proj;
+    U32 i, b, c, n_results, complement, seed = 11;
+
+    for (i = 0; i < n_pixels * bands; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = 500 + (seed >> 16) % 200 + (i % bands) * (i / bands) % 97;
+    }
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = bands;
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 20;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = compute_mean_pixel(data, &shape, EOS_MISE_BIP, mean_pixel);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = compute_covariance(data, &shape, EOS_MISE_BIP, mean_pixel, cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = invert_sym_matrix(bands, cov, cov_inv, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    memcpy(cov_c, cov, sizeof(cov));
+    status = get_eigen_symm(bands, cov_c, w, V, buf);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    _sort_eigen_desc(bands, w, order);
+
+    for (complement = 0; complement <= 1; complement++) {
+        n_results = 20;
+        status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL,
+                                                2, NULL, k,
+            complement, NULL, &n_results, results, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 20, n_results);
+        for (i = 0; i < n_results; i++) {
+            for (b = 0; b < bands; b++) {
+                mean_sub[b] = data[(results[i].row * shape.cols
+                                    + results[i].col) * bands + b]
+                              - mean_pixel[b];
+            }
+            principal = 0.0;
+            for (c = 0; c < k; c++) {
+                proj = 0.0;
+                for (b = 0; b < bands; b++) {
+                    proj += V[order[c] * bands + b] * mean_sub[b];
+                }
+                principal += proj * proj / w[order[c]];
+            }
+            if (complement) {
+                status = _rx_score(mean_sub, cov_inv, shape, &rx_score);
+                CuAssertIntEquals(ct, EOS_SUCCESS, status);
+                CuAssertDblEquals(ct, rx_score - principal, results[i].score,
+                                  1e-6 * rx_score);
+            } else {
+                CuAssertDblEquals(ct, principal, results[i].score,
+                                  1e-6 * principal);
+            }
+            if (i > 0) {
+                CuAssertTrue(ct, results[i].score <= results[i - 1].score);
+            }
+        }
+    }
+
+    // All components: the principal score is the RX score, and nothing is
+    // left in the complement
+    n_results = 20;
+    status = eos_mise_detect_anomaly_rx(shape, data, EOS_MISE_BIP, 2,
+                                        &n_results, full);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 20;
+    status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL, 2,
+                                            NULL, bands,
+        EOS_FALSE, NULL, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, full[i].row, results[i].row);
+        CuAssertIntEquals(ct, full[i].col, results[i].col);
+        CuAssertDblEquals(ct, full[i].score, results[i].score,
+                          1e-6 * full[i].score);
+    }
+    n_results = 20;
+    status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL, 2,
+                                            NULL, bands,
+        EOS_TRUE, NULL, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertDblEquals(ct, 0.0, results[0].score, 1e-6 * full[0].score);
+
+    // Through the library interface
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    all_params.mise.alg = EOS_MISE_PCA_RX;
+    all_params.mise.pca_rx_components = k;
+    obs.shape = shape;
+    obs.data = data;
+    obs.layout = EOS_MISE_BIP;
+    obs.mask = NULL;
+    result.n_results = 20;
+    result.results = full;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 20;
+    status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL, 2,
+                                            NULL, k,
+        EOS_FALSE, NULL, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n_results; i++) {
+        CuAssertDblEquals(ct, results[i].score, full[i].score, 0);
+    }
+    all_params.mise.pca_rx_components = bands + 1;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    all_params.mise.pca_rx_components = 0;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // Bad arguments
+    n_results = 20;
+    status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL, 2,
+                                            NULL, 0,
+        EOS_FALSE, NULL, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_pca_rx(shape, NULL, EOS_MISE_BIP, NULL, 2,
+                                            NULL, k,
+        EOS_FALSE, NULL, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_pca_rx(shape, data, EOS_MISE_BIP, NULL, 2,
+                                            NULL, k,
+        EOS_FALSE, NULL, NULL, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+}
+
+/*
+ * PCA RX with a carried principal basis scores an observation as the
+ * stateless detection does, and starts the eigensolver for the next
+ * observation from the basis found
+ */
+void TestPcaBasisAnomalyDetection(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    EosMiseDetectionResult result, expected;
+    EosMisePcaBasisStateRequest req;
+    EosMisePcaBasisState state;
+    const EosObsShape shape = {20, 15, 40};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 bands = shape.bands;
+    const U32 k = 3;
+    U16* data = malloc(sizeof(U16) * n_pixels * bands);
+    EosPixelDetection detections[20], expected_detections[20];
+    U32 i, cold_iterations, seed = 11;
+
+    for (i = 0; i < n_pixels * bands; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = 500 + (seed >> 16) % 200 + (i % bands) * (i / bands) % 97;
+    }
+    obs.shape = shape;
+    obs.data = data;
+    obs.layout = EOS_MISE_BIP;
+    obs.mask = NULL;
+
+    // The basis size does not require initialization
+    status = eos_mise_pca_basis_state_request(bands, k, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 120, (int) req.basis_size);
+    state.basis = malloc(sizeof(double) * req.basis_size);
+
+    // Not initialized
+    status = eos_mise_pca_basis_init(bands, k, &state);
+    CuAssertIntEquals(ct, EOS_NOT_INITIALIZED, status);
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = bands;
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 20;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.alg = EOS_MISE_PCA_RX;
+    params.pca_rx_components = k;
+
+    status = eos_mise_pca_basis_init(bands, k, &state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 0, (int) state.n_observations);
+
+    expected.n_results = 20;
+    expected.results = expected_detections;
+    status = eos_mise_detect_anomaly(&params, &obs, &expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // The first observation starts without a basis, as the stateless
+    // detection does
+    result.n_results = 20;
+    result.results = detections;
+    status = eos_mise_detect_anomaly_pca_basis(&params, &state, &obs,
+                                               &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 1, (int) state.n_observations);
+    CuAssertIntEquals(ct, 20, result.n_results);
+    for (i = 0; i < result.n_results; i++) {
+        CuAssertIntEquals(ct, expected_detections[i].row, detections[i].row);
+        CuAssertIntEquals(ct, expected_detections[i].col, detections[i].col);
+        CuAssertDblEquals(ct, expected_detections[i].score,
+                          detections[i].score, 0);
+    }
+    cold_iterations = state.n_iterations;
+
+    // Starting from the converged basis takes fewer iterations for the same
+    // scores
+    result.n_results = 20;
+    status = eos_mise_detect_anomaly_pca_basis(&params, &state, &obs,
+                                               &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, (int) state.n_observations);
+    CuAssertTrue(ct, state.n_iterations < cold_iterations);
+    for (i = 0; i < result.n_results; i++) {
+        CuAssertIntEquals(ct, expected_detections[i].row, detections[i].row);
+        CuAssertIntEquals(ct, expected_detections[i].col, detections[i].col);
+        CuAssertDblEquals(ct, expected_detections[i].score,
+                          detections[i].score,
+                          1e-6 * expected_detections[i].score);
+    }
+
+    // Bad arguments
+    status = eos_mise_pca_basis_init(bands, 0, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_pca_basis_init(bands, bands + 1, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_pca_basis_init(bands + 1, k, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_pca_basis_state_request(bands, k, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    params.pca_rx_components = k + 1;
+    status = eos_mise_detect_anomaly_pca_basis(&params, &state, &obs,
+                                               &result);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    params.pca_rx_components = k;
+    params.alg = EOS_MISE_RX;
+    status = eos_mise_detect_anomaly_pca_basis(&params, &state, &obs,
+                                               &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_PCA_RX;
+    status = eos_mise_detect_anomaly_pca_basis(&params, NULL, &obs,
+                                               &result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(state.basis);
+    free(data);
+}
+
+/*
+ * Segmented RX scores each pixel against the background of its own class:
+ * on a scene of two materials, the scores match RX against each material
+ * alone, do not depend on the number of workers, and a single class is
+ * global RX
+ */
+void TestSegmentedRxAnomalyDetection(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseObservation obs;
+    EosMiseDetectionResult result;
+    const EosObsShape shape = {24, 20, 6};
+    const U32 n_pixels = shape.rows * shape.cols;
+    const U32 bands = shape.bands;
+    U16* data = malloc(sizeof(U16) * n_pixels * bands);
+    U16* material = malloc(sizeof(U16) * n_pixels * bands);
+    EosObsShape material_shape = {0, 1, 6};
+    EosPixelDetection full[10], results[10], single[10];
+    F64 mean_pixel[2][6], cov_inv[2][36], cov[36], w[6], V[36], mean_sub[6];
+    U32 buf[6];
+    F64 expected;
+    U32 i, b, m, p, n_results, seed = 5;
+
+    // Ice on the left half and terrain on the right half, with an anomaly
+    // that is unusual for ice but well within the spread of the whole scene
+    for (p = 0; p < n_pixels; p++) {
+        for (b = 0; b < bands; b++) {
+            seed = seed * 1103515245 + 12345;
+            if (p % shape.cols < shape.cols / 2) {
+                data[p * bands + b] = 500 + 10 * b + (seed >> 16) % 50;
+            } else {
+                data[p * bands + b] = 3000 - 50 * b + (seed >> 16) % 100;
+            }
+        }
+    }
+    data[(5 * shape.cols + 3) * bands + 1] += 60;
+    data[(5 * shape.cols + 3) * bands + 4] -= 60;
+
+    // Background of each material alone
+    for (m = 0; m < 2; m++) {
+        material_shape.rows = 0;
+        for (p = 0; p < n_pixels; p++) {
+            if ((p % shape.cols < shape.cols / 2) != (m == 0)) { continue; }
+            memcpy(&(material[material_shape.rows * bands]),
+                   &(data[p * bands]), sizeof(U16) * bands);
+            material_shape.rows++;
+        }
+        status = compute_mean_pixel(material, &material_shape, EOS_MISE_BIP,
+                                    mean_pixel[m]);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = compute_covariance(material, &material_shape, EOS_MISE_BIP,
+                                    mean_pixel[m], cov);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = invert_sym_matrix(bands, cov, cov_inv[m], w, V, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    }
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = bands;
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 10;
+    init_params.mise_max_clusters = 2;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(shape, data, EOS_MISE_BIP,
+                                                  NULL, 2, NULL,
+        2, 5, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, n_results);
+    CuAssertIntEquals(ct, 5, results[0].row);
+    CuAssertIntEquals(ct, 3, results[0].col);
+    for (i = 0; i < n_results; i++) {
+        m = (results[i].col < shape.cols / 2) ? 0 : 1;
+        p = results[i].row * shape.cols + results[i].col;
+        for (b = 0; b < bands; b++) {
+            mean_sub[b] = data[p * bands + b] - mean_pixel[m][b];
+        }
+        status = _rx_score(mean_sub, cov_inv[m], shape, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertDblEquals(ct, expected, results[i].score, 1e-6 * expected);
+        if (i > 0) {
+            CuAssertTrue(ct, results[i].score <= results[i - 1].score);
+        }
+    }
+
+    // The same classes and scores with a single worker
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(shape, data, EOS_MISE_BIP,
+                                                  NULL, 1, NULL,
+        2, 5, &n_results, single, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, n_results);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, results[i].row, single[i].row);
+        CuAssertIntEquals(ct, results[i].col, single[i].col);
+        CuAssertDblEquals(ct, results[i].score, single[i].score,
+                          1e-9 * results[i].score);
+    }
+
+    // A single class is the background of global RX
+    n_results = 10;
+    status = eos_mise_detect_anomaly_rx(shape, data, EOS_MISE_BIP, 2,
+                                        &n_results, full);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(shape, data, EOS_MISE_BIP,
+                                                  NULL, 2, NULL,
+        1, 5, &n_results, single, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, full[i].row, single[i].row);
+        CuAssertIntEquals(ct, full[i].col, single[i].col);
+        CuAssertDblEquals(ct, full[i].score, single[i].score,
+                          1e-6 * full[i].score);
+    }
+
+    // Classes too small for a covariance are dropped: the two pixels of a
+    // tiny observation each seed a class, so one class of both is used
+    material_shape.rows = 2;
+    material_shape.cols = 1;
+    n_results = 2;
+    status = eos_mise_detect_anomaly_segmented_rx(material_shape, data,
+                                                  EOS_MISE_BIP, NULL,
+        1, NULL, 2, 5, &n_results, single, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, n_results);
+
+    // A class of no more pixels than bands has a singular covariance: the
+    // second seed is the first of three bright pixels, which form a class
+    // of their own, so they are reassigned to the ice background and the
+    // scores are those of a single class
+    material_shape.rows = 10;
+    material_shape.cols = 10;
+    for (p = 0; p < 100; p++) {
+        for (b = 0; b < bands; b++) {
+            material[p * bands + b] = data[(p / 10 * shape.cols + p % 10)
+                                           * bands + b];
+        }
+    }
+    for (p = 75; p < 78; p++) {
+        for (b = 0; b < bands; b++) {
+            material[p * bands + b] += 2000;
+        }
+    }
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(material_shape, material,
+                                                  EOS_MISE_BIP,
+        NULL, 2, NULL, 1, 5, &n_results, full, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(material_shape, material,
+                                                  EOS_MISE_BIP,
+        NULL, 2, NULL, 2, 5, &n_results, single, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, n_results);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, full[i].row, single[i].row);
+        CuAssertIntEquals(ct, full[i].col, single[i].col);
+        CuAssertDblEquals(ct, full[i].score, single[i].score,
+                          1e-9 * full[i].score);
+    }
+
+    // Through the library interface, with the default sample of all pixels
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    all_params.mise.alg = EOS_MISE_SEGMENTED_RX;
+    all_params.mise.segmented_rx_clusters = 2;
+    obs.shape = shape;
+    obs.data = data;
+    obs.layout = EOS_MISE_BIP;
+    obs.mask = NULL;
+    result.n_results = 10;
+    result.results = full;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, result.n_results);
+    for (i = 0; i < result.n_results; i++) {
+        CuAssertDblEquals(ct, results[i].score, full[i].score,
+                          1e-9 * results[i].score);
+    }
+    all_params.mise.segmented_rx_clusters = 3;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    all_params.mise.segmented_rx_clusters = 0;
+    status = eos_mise_detect_anomaly(&all_params.mise, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // Bad arguments
+    n_results = 10;
+    status = eos_mise_detect_anomaly_segmented_rx(shape, data, EOS_MISE_BIP,
+                                                  NULL, 2, NULL,
+        0, 5, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_segmented_rx(shape, NULL, EOS_MISE_BIP,
+                                                  NULL, 2, NULL,
+        2, 5, &n_results, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_segmented_rx(shape, data, EOS_MISE_BIP,
+                                                  NULL, 2, NULL,
+        2, 5, NULL, results, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(material);
     free(data);
+}
+
+/*
+ * Removing the moments of some pixels leaves the moments of the rest
+ */
+void TestRemoveMoments(CuTest *ct) {
+    EosStatus status;
+    const U16 data[9] = {1, 2, 3, 4, 5, 6, UINT16_MAX, 8, UINT16_MAX};
+    EosObsShape shape = {3, 1, 3};
+    EosObsShape first = {1, 1, 3};
+    EosObsShape rest = {2, 1, 3};
+    U64 sum[3], sum_e[3];
+    U64 sum_sq[6], sum_sq_e[6];
+    U32 i;
+
+    status = compute_moments(data, &shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = remove_moments(data, &first, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = compute_moments(&(data[3]), &rest, EOS_MISE_BIP, sum_e, sum_sq_e);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 3; i++) {
+        CuAssertTrue(ct, sum_e[i] == sum[i]);
+    }
+    for (i = 0; i < 6; i++) {
+        CuAssertTrue(ct, sum_sq_e[i] == sum_sq[i]);
+    }
+
+    // Test NULL pointers
+    status = remove_moments(NULL, &shape, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = remove_moments(data, NULL, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = remove_moments(data, &shape, EOS_MISE_BIP, NULL, sum_sq);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = remove_moments(data, &shape, EOS_MISE_BIP, sum, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+void TestCholeskyInvert(CuTest *ct) {
+    EosStatus status;
+    F64 a[9] = {
+         4.0,  12.0, -16.0,
+        12.0,  37.0, -43.0,
+       -16.0, -43.0,  98.0
+    };
+    F64 l[9];
+    F64 a_inv[9];
+    F64 product;
+    U32 i, j, k;
+
+    status = cholesky_decompose(3, a, l);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = cholesky_invert(3, l, a_inv);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            product = 0.0;
+            for (k = 0; k < 3; k++) {
+                product += a[3*i + k] * a_inv[3*k + j];
+            }
+            CuAssertDblEquals(ct, (i == j) ? 1.0 : 0.0, product, 1e-9);
+        }
+    }
+
+    status = cholesky_invert(3, NULL, a_inv);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = cholesky_invert(3, l, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+void TestShermanMorrison(CuTest *ct) {
+    EosStatus status;
+    F64 a[9] = {
+         4.0,  12.0, -16.0,
+        12.0,  37.0, -43.0,
+       -16.0, -43.0,  98.0
+    };
+    F64 v[3] = {1.0, -2.0, 0.5};
+    F64 l[9], a_inv[9], updated[9], expected[9], original[9];
+    F64 u[3];
+    U32 i, j;
+
+    status = cholesky_decompose(3, a, l);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = cholesky_invert(3, l, a_inv);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    memcpy(original, a_inv, sizeof(a_inv));
+
+    // Update matches the inverse of the updated matrix
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            a[3*i + j] += 0.5 * v[i] * v[j];
+        }
+    }
+    status = cholesky_decompose(3, a, l);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = cholesky_invert(3, l, expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    memcpy(updated, a_inv, sizeof(a_inv));
+    status = sherman_morrison_update(3, updated, v, 0.5, u);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 9; i++) {
+        CuAssertDblEquals(ct, expected[i], updated[i], 1e-9);
+    }
+
+    // Downdate restores the original inverse
+    status = sherman_morrison_update(3, updated, v, -0.5, u);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 9; i++) {
+        CuAssertDblEquals(ct, original[i], updated[i], 1e-9);
+    }
+
+    // Downdate to a singular matrix is rejected and leaves the inverse as is
+    F64 identity[4] = {1.0, 0.0, 0.0, 1.0};
+    F64 e0[2] = {1.0, 0.0};
+    status = sherman_morrison_update(2, identity, e0, -1.0, u);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    CuAssertDblEquals(ct, 1.0, identity[0], 0);
+
+    status = sherman_morrison_update(3, NULL, v, 0.5, u);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = sherman_morrison_update(3, updated, NULL, 0.5, u);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = sherman_morrison_update(3, updated, v, 0.5, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+/*
+ * Local RX scores every pixel against the window of rows around it; compare
+ * against a brute-force computation of each window's background. The
+ * observation is long enough that the window is refactored periodically.
+ * Rows narrow against the bands are updated as the window slides, and wide
+ * rows are refactored at every slide.
+ */
+void TestLocalRxAnomalyDetection(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    const EosObsShape shapes[2] = {
+        {MISE_LOCAL_RX_REFACTOR_ROWS + 16, 2, 6},
+        {MISE_LOCAL_RX_REFACTOR_ROWS + 16, 5, 6}
+    };
+    const U32 window_rows = 5;
+    const U32 max_pixels = shapes[1].rows * shapes[1].cols;
+    U16* data = malloc(sizeof(U16) * max_pixels * shapes[1].bands);
+    EosPixelDetection* results =
+        malloc(sizeof(EosPixelDetection) * max_pixels);
+    EosPixelDetection global[3], local[3];
+    EosObsShape shape, slab;
+    F64 mean_pixel[6], mean_sub[6], cov[36], cov_inv[36];
+    F64 w[6], V[36];
+    U32 buf[12];
+    F64 expected;
+    U32 n_pixels, n_results, i, b, k, start;
+    U32 seed = 99;
+
+    // Terrain that changes along track
+    for (i = 0; i < max_pixels * shapes[1].bands; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (seed >> 16) % 1000 + (i / 30) * 7;
+    }
+
+    CuAssertIntEquals(ct, EOS_TRUE, mise_local_rx_updates(2, 6));
+    CuAssertIntEquals(ct, EOS_FALSE, mise_local_rx_updates(5, 6));
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = shapes[1].bands;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    for (k = 0; k < 2; k++) {
+        shape = shapes[k];
+        n_pixels = shape.rows * shape.cols;
+        n_results = n_pixels;
+        status = eos_mise_detect_anomaly_local_rx(shape, data, EOS_MISE_BIP,
+                                                  window_rows,
+                                                  &n_results, results, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, n_pixels, n_results);
+
+        slab = shape;
+        slab.rows = window_rows;
+        for (i = 0; i < n_results; i++) {
+            start = (results[i].row > window_rows / 2) ?
+                    results[i].row - window_rows / 2 : 0;
+            if (start > shape.rows - window_rows) {
+                start = shape.rows - window_rows;
+            }
+            status = compute_mean_pixel(
+                &(data[start * shape.cols * shape.bands]), &slab, EOS_MISE_BIP,
+                mean_pixel);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            status = compute_covariance(
+                &(data[start * shape.cols * shape.bands]), &slab, EOS_MISE_BIP,
+                mean_pixel, cov);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            status = invert_sym_matrix(shape.bands, cov, cov_inv, w, V, buf);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            for (b = 0; b < shape.bands; b++) {
+                mean_sub[b] = data[(results[i].row * shape.cols
+                                    + results[i].col) * shape.bands + b]
+                              - mean_pixel[b];
+            }
+            status = _rx_score(mean_sub, cov_inv, shape, &expected);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            CuAssertDblEquals(ct, expected, results[i].score,
+                              1e-8 * expected);
+            if (i > 0) {
+                CuAssertTrue(ct, results[i].score <= results[i - 1].score);
+            }
+        }
+    }
+    shape = shapes[0];
+    slab = shape;
+
+    // A window covering the whole observation is global RX
+    n_results = 3;
+    status = eos_mise_detect_anomaly_rx(shape, data, EOS_MISE_BIP, 1,
+                                        &n_results, global);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 3;
+    status = eos_mise_detect_anomaly_local_rx(shape, data, EOS_MISE_BIP,
+                                              shape.rows + 1,
+                                              &n_results, local, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, n_results);
+    for (i = 0; i < n_results; i++) {
+        CuAssertIntEquals(ct, global[i].row, local[i].row);
+        CuAssertIntEquals(ct, global[i].col, local[i].col);
+        CuAssertDblEquals(ct, global[i].score, local[i].score,
+                          1e-9 * global[i].score);
+    }
+
+    // A rank-deficient window (fewer pixels than bands) still gives scores
+    n_results = 3;
+    status = eos_mise_detect_anomaly_local_rx(shape, data, EOS_MISE_BIP, 1,
+                                              &n_results, local, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 3, n_results);
+
+    // Zero results, and zero-size observation
+    n_results = 0;
+    status = eos_mise_detect_anomaly_local_rx(shape, NULL, EOS_MISE_BIP,
+                                              window_rows,
+                                              &n_results, NULL, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    n_results = 3;
+    slab.rows = 0;
+    status = eos_mise_detect_anomaly_local_rx(slab, NULL, EOS_MISE_BIP,
+                                              window_rows,
+                                              &n_results, NULL, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 0, n_results);
+
+    // Bad arguments
+    n_results = 3;
+    status = eos_mise_detect_anomaly_local_rx(shape, data, EOS_MISE_BIP, 0,
+                                              &n_results, local, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_local_rx(shape, NULL, EOS_MISE_BIP,
+                                              window_rows,
+                                              &n_results, local, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_local_rx(shape, data, EOS_MISE_BIP,
+                                              window_rows, NULL, local, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(data);
+    free(results);
+}
+
+void TestMiseInterface(CuTest *ct) {
+    EosStatus status;
+
+    // Set up library/algorithm params
+    EosInitParams init_params;
+    default_init_params_test(&init_params);
+    EosParams all_params;
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    EosMiseParams params = all_params.mise;
+    params.alg = EOS_MISE_RX;
+
+    // Set up structure on stack for storing results
+    EosPixelDetection detections[10];
+    EosMiseDetectionResult result;
+    result.n_results = 10;
+    result.results = (EosPixelDetection*)(&detections);
+
+    // Load data and initialize observation
+    void* data;
+    uint32_t size;
+    EosMiseObservation obs;
+    InitMiseObs(&obs, 10, 10, 5);
+    read_resource(ct, "mise/test_mise.mis", &data, &size);
+
+    // First test without initialization
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_NOT_INITIALIZED, status);
+
+    // Initialize library
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // Test with NULL arguments
+    status = eos_mise_detect_anomaly(NULL, &obs, &result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_mise_detect_anomaly(&params, NULL, &result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_mise_detect_anomaly(&params, &obs, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    // Nominal case
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // Multiple workers give the same detections as a single worker, even
+    // when pixels in different rows tie (every 37th pixel repeats)
+    EosPixelDetection parallel_detections[10];
+    EosMiseDetectionResult parallel_result;
+    U32 i;
+    for (i = 0; i < (U32) (obs.shape.rows * obs.shape.cols * obs.shape.bands);
+            i++) {
+        obs.data[i] = ((i / obs.shape.bands) % 37 * 7919
+                       + (i % obs.shape.bands) * 131) % 1009;
+    }
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    init_params.mise_workers = 4;
+    init_params.mise_max_results = 10;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    parallel_result.n_results = 10;
+    parallel_result.results = parallel_detections;
+    status = eos_mise_detect_anomaly(&params, &obs, &parallel_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, result.n_results, parallel_result.n_results);
+    for (i = 0; i < result.n_results; i++) {
+        CuAssertIntEquals(ct, detections[i].row, parallel_detections[i].row);
+        CuAssertIntEquals(ct, detections[i].col, parallel_detections[i].col);
+        CuAssertDblEquals(ct, detections[i].score,
+                          parallel_detections[i].score, 0);
+    }
+
+    // More results than eos_init reserved for the additional workers
+    parallel_result.n_results = 11;
+    status = eos_mise_detect_anomaly(&params, &obs, &parallel_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.batch_pooled_background = EOS_TRUE;
+    status = eos_mise_detect_anomaly_batch(&params, 1, &obs,
+                                           &parallel_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.batch_pooled_background = EOS_FALSE;
+    init_params.mise_max_results = 0;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    parallel_result.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &obs, &parallel_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    parallel_result.n_results = 0;
+    status = eos_mise_detect_anomaly(&params, &obs, &parallel_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // Too many workers
+    init_params.mise_workers = EOS_MAX_WORKERS + 1;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    init_params.mise_workers = 1;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    // Bad Algorithm
+    result.n_results = 10;
+    params.alg = 0xBAD;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // Error within algorithm
+    params.alg = EOS_MISE_RX;
+    result.results = NULL;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    // Clean up
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    free(data);
+    FreeMiseObs(&obs);
+}
+
+/*
+ * Streaming an observation row by row gives the same detections as
+ * processing the whole observation at once
+ */
+void TestMiseStream(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    EosMiseStreamState state;
+    EosMiseStreamStateRequest req;
+    EosPixelDetection detections[10];
+    EosPixelDetection streamed[10];
+    EosMiseDetectionResult result, stream_result;
+    const U32 chunks[4] = {1, 2, 3, 4};
+    U32 i, k, row, n_rows;
+
+    default_init_params_test(&init_params);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.alg = EOS_MISE_RX;
+    InitMiseObs(&obs, 10, 7, 5);
+    for (i = 0; i < (U32) (obs.shape.rows * obs.shape.cols * obs.shape.bands);
+            i++) {
+        obs.data[i] = ((i / obs.shape.bands) % 23 * 7919
+                       + (i % obs.shape.bands) * 131) % 1009;
+    }
+
+    // The state size does not require initialization
+    status = eos_mise_stream_state_request(obs.shape.bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 5 + 15, (int) req.moments_size);
+
+    // Not initialized
+    status = eos_mise_stream_begin(obs.shape.cols, obs.shape.bands, &state);
+    CuAssertIntEquals(ct, EOS_NOT_INITIALIZED, status);
+
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    result.n_results = 10;
+    result.results = detections;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = eos_mise_stream_state_request(obs.shape.bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 5 + 15, (int) req.moments_size);
+    state.moments = malloc(sizeof(uint64_t) * req.moments_size);
+
+    // Push rows in chunks of various sizes
+    for (k = 0; k < 4; k++) {
+        status = eos_mise_stream_begin(obs.shape.cols, obs.shape.bands,
+                                       &state);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (row = 0; row < obs.shape.rows; row += n_rows) {
+            n_rows = (obs.shape.rows - row < chunks[k]) ?
+                     obs.shape.rows - row : chunks[k];
+            status = eos_mise_stream_push_rows(&state, n_rows,
+                &(obs.data[row * obs.shape.cols * obs.shape.bands]));
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        }
+        status = eos_mise_stream_push_rows(&state, 0, NULL);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, obs.shape.rows, state.shape.rows);
+
+        stream_result.n_results = 10;
+        stream_result.results = streamed;
+        status = eos_mise_stream_finalize(&params, &state, &obs,
+                                          &stream_result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, result.n_results, stream_result.n_results);
+        for (i = 0; i < result.n_results; i++) {
+            CuAssertIntEquals(ct, detections[i].row, streamed[i].row);
+            CuAssertIntEquals(ct, detections[i].col, streamed[i].col);
+            CuAssertDblEquals(ct, detections[i].score, streamed[i].score, 0);
+        }
+    }
+
+    // Observation does not match the streamed rows
+    obs.shape.rows--;
+    status = eos_mise_stream_finalize(&params, &state, &obs, &stream_result);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    obs.shape.rows++;
+
+    // Bad algorithm
+    params.alg = 0xBAD;
+    status = eos_mise_stream_finalize(&params, &state, &obs, &stream_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_RX;
+
+    // Too many bands
+    status = eos_mise_stream_begin(obs.shape.cols,
+                                   init_params.mise_max_bands + 1, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // NULL arguments
+    status = eos_mise_stream_state_request(obs.shape.bands, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_stream_begin(obs.shape.cols, obs.shape.bands, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_stream_push_rows(&state, 1, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_stream_finalize(&params, NULL, &obs, &stream_result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    free(state.moments);
+    state.moments = NULL;
+    status = eos_mise_stream_begin(obs.shape.cols, obs.shape.bands, &state);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    FreeMiseObs(&obs);
+}
+
+/*
+ * A persistent background pools the observations merged into it, and is
+ * factored again only when it drifts
+ */
+void TestMiseBackground(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs, other;
+    EosMiseBackgroundState state;
+    EosMiseBackgroundStateRequest req;
+    EosPixelDetection detections[10];
+    EosPixelDetection background_detections[10];
+    EosMiseDetectionResult result, background_result;
+    EosObsShape both;
+    U16* pooled;
+    U64 sum[5], sum_sq[15];
+    F64 mean_pixel[5], cov[25];
+    U32 i, n_values;
+
+    default_init_params_test(&init_params);
+    InitMiseObs(&obs, 10, 7, 5);
+    InitMiseObs(&other, 10, 7, 5);
+    n_values = obs.shape.rows * obs.shape.cols * obs.shape.bands;
+    for (i = 0; i < n_values; i++) {
+        obs.data[i] = ((i / obs.shape.bands) % 23 * 7919
+                       + (i % obs.shape.bands) * 131) % 1009;
+        other.data[i] = ((i / obs.shape.bands) % 19 * 6007
+                         + (i % obs.shape.bands) * 337) % 1013 + 50;
+    }
+
+    // The state size does not require initialization
+    status = eos_mise_background_state_request(obs.shape.bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 25, (int) req.matrix_size);
+
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    // The persistent background is scored in double precision
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+
+    status = eos_mise_background_state_request(obs.shape.bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 5, (int) req.vector_size);
+    CuAssertIntEquals(ct, 25, (int) req.matrix_size);
+    state.mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor_mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.factor_cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor = malloc(sizeof(double) * req.matrix_size);
+
+    // The first observation is scored against its own background, as RX
+    result.n_results = 10;
+    result.results = detections;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.background_forgetting = 1.0;
+    params.background_drift_tolerance = 0.0;
+    status = eos_mise_background_init(obs.shape.bands, &state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    background_result.n_results = 10;
+    background_result.results = background_detections;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 1, (int) state.n_observations);
+    CuAssertIntEquals(ct, 1, (int) state.n_factorizations);
+    CuAssertIntEquals(ct, result.n_results, background_result.n_results);
+    for (i = 0; i < result.n_results; i++) {
+        CuAssertIntEquals(ct, detections[i].row,
+                          background_detections[i].row);
+        CuAssertIntEquals(ct, detections[i].col,
+                          background_detections[i].col);
+        CuAssertDblEquals(ct, detections[i].score,
+                          background_detections[i].score, 0);
+    }
+
+    // Without forgetting, the background is that of both observations
+    status = eos_mise_detect_anomaly_background(&params, &state, &other,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 2, (int) state.n_observations);
+    CuAssertIntEquals(ct, 2, (int) state.n_factorizations);
+
+    pooled = malloc(sizeof(U16) * 2 * n_values);
+    memcpy(pooled, obs.data, sizeof(U16) * n_values);
+    memcpy(&(pooled[n_values]), other.data, sizeof(U16) * n_values);
+    both = obs.shape;
+    both.rows *= 2;
+    status = compute_moments(pooled, &both, EOS_MISE_BIP, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = moments_to_mean_covariance(both.rows * both.cols, both.bands,
+                                        sum, sum_sq, mean_pixel, cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 5; i++) {
+        CuAssertDblEquals(ct, mean_pixel[i], state.mean_pixel[i],
+                          1e-9 * mean_pixel[i]);
+        CuAssertDblEquals(ct, mean_pixel[i], state.factor_mean_pixel[i],
+                          1e-9 * mean_pixel[i]);
+    }
+    for (i = 0; i < 25; i++) {
+        CuAssertDblEquals(ct, cov[i], state.cov[i], 1e-9 * fabs(cov[i]));
+    }
+
+    // Merging the same observation again only changes the background
+    // through the (n - 1) normalization, which is within the tolerance
+    params.background_forgetting = 0.5;
+    params.background_drift_tolerance = 0.01;
+    status = eos_mise_background_init(obs.shape.bands, &state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < 3; i++) {
+        background_result.n_results = 10;
+        status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                    &background_result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    }
+    CuAssertIntEquals(ct, 3, (int) state.n_observations);
+    CuAssertIntEquals(ct, 1, (int) state.n_factorizations);
+    CuAssertDblEquals(ct, 70 * (1 + 0.5 + 0.25), state.weight, 1e-12);
+
+    // Drift within the tolerance keeps the factored background; the
+    // observation is still merged when no results are requested
+    params.background_drift_tolerance = 1e6;
+    background_result.n_results = 0;
+    status = eos_mise_detect_anomaly_background(&params, &state, &other,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 4, (int) state.n_observations);
+    CuAssertIntEquals(ct, 1, (int) state.n_factorizations);
+    CuAssertTrue(ct, state.mean_pixel[0] != state.factor_mean_pixel[0]);
+
+    // Bad parameters
+    background_result.n_results = 10;
+    params.background_forgetting = 0.0;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.background_forgetting = 1.5;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.background_forgetting = 1.0;
+    params.background_drift_tolerance = -1.0;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.background_drift_tolerance = 0.0;
+    params.alg = EOS_MISE_LOCAL_RX;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_RX;
+
+    // Observation does not match the background
+    state.bands--;
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    state.bands++;
+
+    // Too many bands
+    status = eos_mise_background_init(init_params.mise_max_bands + 1,
+                                      &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // NULL arguments
+    status = eos_mise_background_state_request(obs.shape.bands, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_background_init(obs.shape.bands, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_background(&params, NULL, &obs,
+                                                &background_result);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs, NULL);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    free(state.factor);
+    state.factor = NULL;
+    status = eos_mise_background_init(obs.shape.bands, &state);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(state.mean_pixel);
+    free(state.cov);
+    free(state.factor_mean_pixel);
+    free(state.factor_cov);
+    free(pooled);
+    FreeMiseObs(&obs);
+    FreeMiseObs(&other);
+}
+
+/* Copy BIP data into the given layout */
+static void _to_layout(const U16* bip, EosObsShape shape, EosMiseLayout layout,
+                       U16* out) {
+    U32 row, col, b;
+    U64 i;
+
+    for (row = 0; row < shape.rows; row++) {
+        for (col = 0; col < shape.cols; col++) {
+            for (b = 0; b < shape.bands; b++) {
+                if (layout == EOS_MISE_BIL) {
+                    i = ((U64) row * shape.bands + b) * shape.cols + col;
+                } else if (layout == EOS_MISE_BSQ) {
+                    i = ((U64) b * shape.rows + row) * shape.cols + col;
+                } else {
+                    i = ((U64) row * shape.cols + col) * shape.bands + b;
+                }
+                out[i] = bip[((U64) row * shape.cols + col) * shape.bands + b];
+            }
+        }
+    }
+}
+
+static void _assert_same_detections(CuTest *ct,
+                                    const EosMiseDetectionResult* expected,
+                                    const EosMiseDetectionResult* actual) {
+    U32 i;
+    CuAssertIntEquals(ct, expected->n_results, actual->n_results);
+    for (i = 0; i < expected->n_results; i++) {
+        CuAssertIntEquals(ct, expected->results[i].row,
+                          actual->results[i].row);
+        CuAssertIntEquals(ct, expected->results[i].col,
+                          actual->results[i].col);
+        CuAssertDblEquals(ct, expected->results[i].score,
+                          actual->results[i].score, 0);
+    }
+}
+
+/*
+ * BIL and BSQ observations give exactly the same moments, statistics, and
+ * detections as the same observation in BIP
+ */
+void TestMiseLayouts(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation bip, obs;
+    EosMiseStreamState stream;
+    EosMiseStreamStateRequest stream_req;
+    EosMiseBackgroundState state;
+    EosMiseBackgroundStateRequest req;
+    EosPixelDetection expected_detections[10], detections[10];
+    EosMiseDetectionResult expected, result;
+    MiseSampling sampling;
+    const EosMiseAlgorithm algs[3] = {
+        EOS_MISE_RX, EOS_MISE_LOCAL_RX, EOS_MISE_PCA_RX
+    };
+    const EosMiseLayout layouts[2] = {EOS_MISE_BIL, EOS_MISE_BSQ};
+    const U32 bands = 6;
+    U64 sum[6], sum_sq[21], layout_sum[6], layout_sum_sq[21];
+    U64 scratch[6 + 21];
+    U16 gather[2 * MISE_MOMENT_PIXEL_BLOCK * 6];
+    U64 n_sampled, layout_n_sampled;
+    F64 mean_pixel[6], cov[36], layout_mean_pixel[6], layout_cov[36];
+    U32 i, k, a, row, n_values;
+
+    default_init_params_test(&init_params);
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 10;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+    params.local_rx_window_rows = 5;
+    params.pca_rx_components = 3;
+
+    // More pixels than a moments block and than a scoring tile
+    InitMiseObs(&bip, 12, 11, bands);
+    InitMiseObs(&obs, 12, 11, bands);
+    n_values = bip.shape.rows * bip.shape.cols * bands;
+    for (i = 0; i < n_values; i++) {
+        bip.data[i] = ((i / bands) % 23 * 7919 + (i % bands) * 131) % 1009;
+    }
+    bip.data[5 * 11 * bands + 4 * bands + 2] = 3000;
+
+    status = compute_moments(bip.data, &(bip.shape), bip.layout, sum, sum_sq);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = compute_mean_pixel(bip.data, &(bip.shape), bip.layout, mean_pixel);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = compute_covariance(bip.data, &(bip.shape), bip.layout, mean_pixel,
+                                cov);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = eos_mise_background_state_request(bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    state.mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor_mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.factor_cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor = malloc(sizeof(double) * req.matrix_size);
+    status = eos_mise_stream_state_request(bands, &stream_req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    stream.moments = malloc(sizeof(uint64_t) * stream_req.moments_size);
+
+    expected.results = expected_detections;
+    result.results = detections;
+    for (k = 0; k < 2; k++) {
+        obs.layout = layouts[k];
+        _to_layout(bip.data, bip.shape, layouts[k], obs.data);
+
+        // Moments, in one piece and sampled by two workers
+        status = compute_moments(obs.data, &(obs.shape), obs.layout,
+                                 layout_sum, layout_sum_sq);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (i = 0; i < bands; i++) {
+            CuAssertTrue(ct, sum[i] == layout_sum[i]);
+        }
+        for (i = 0; i < 21; i++) {
+            CuAssertTrue(ct, sum_sq[i] == layout_sum_sq[i]);
+        }
+
+        sampling.mode = EOS_MISE_SAMPLE_GRID;
+        sampling.step = 2;
+        sampling.seed = 0;
+        status = compute_moments_sampled(bip.data, &(bip.shape), bip.layout,
+                                         NULL, &sampling, 2, scratch, gather,
+                                         sum, sum_sq, &n_sampled);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = compute_moments_sampled(obs.data, &(obs.shape), obs.layout,
+                                         NULL, &sampling, 2, scratch, gather,
+                                         layout_sum, layout_sum_sq,
+                                         &layout_n_sampled);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertTrue(ct, n_sampled == layout_n_sampled);
+        for (i = 0; i < bands; i++) {
+            CuAssertTrue(ct, sum[i] == layout_sum[i]);
+        }
+        for (i = 0; i < 21; i++) {
+            CuAssertTrue(ct, sum_sq[i] == layout_sum_sq[i]);
+        }
+        status = compute_moments(bip.data, &(bip.shape), bip.layout, sum,
+                                 sum_sq);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+        // Mean and covariance
+        status = compute_mean_pixel(obs.data, &(obs.shape), obs.layout,
+                                    layout_mean_pixel);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = compute_covariance(obs.data, &(obs.shape), obs.layout,
+                                    layout_mean_pixel, layout_cov);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (i = 0; i < bands; i++) {
+            CuAssertDblEquals(ct, mean_pixel[i], layout_mean_pixel[i], 0);
+        }
+        for (i = 0; i < bands * bands; i++) {
+            CuAssertDblEquals(ct, cov[i], layout_cov[i], 0);
+        }
+
+        // Detections
+        for (a = 0; a < 3; a++) {
+            params.alg = algs[a];
+            expected.n_results = 10;
+            status = eos_mise_detect_anomaly(&params, &bip, &expected);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            result.n_results = 10;
+            status = eos_mise_detect_anomaly(&params, &obs, &result);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            _assert_same_detections(ct, &expected, &result);
+        }
+        params.alg = EOS_MISE_RX;
+
+        status = eos_mise_background_init(bands, &state);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        expected.n_results = 10;
+        status = eos_mise_detect_anomaly_background(&params, &state, &bip,
+                                                    &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = eos_mise_background_init(bands, &state);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        result.n_results = 10;
+        status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                    &result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        _assert_same_detections(ct, &expected, &result);
+    }
+
+    // Rows streamed in BIL, with the observation in BSQ
+    expected.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &bip, &expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_mise_stream_begin(bip.shape.cols, bands, &stream);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, EOS_MISE_BIP, stream.layout);
+    stream.layout = EOS_MISE_BIL;
+    _to_layout(bip.data, bip.shape, EOS_MISE_BIL, obs.data);
+    for (row = 0; row < bip.shape.rows; row += 3) {
+        status = eos_mise_stream_push_rows(&stream, 3,
+            &(obs.data[row * bip.shape.cols * bands]));
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    }
+    obs.layout = EOS_MISE_BSQ;
+    _to_layout(bip.data, bip.shape, EOS_MISE_BSQ, obs.data);
+    result.n_results = 10;
+    status = eos_mise_stream_finalize(&params, &stream, &obs, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    _assert_same_detections(ct, &expected, &result);
+
+    // Invalid layouts
+    obs.layout = EOS_MISE_N_LAYOUTS;
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_stream_finalize(&params, &stream, &obs, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_detect_anomaly_background(&params, &state, &obs,
+                                                &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    stream.layout = EOS_MISE_N_LAYOUTS;
+    status = eos_mise_stream_push_rows(&stream, 1, bip.data);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(stream.moments);
+    free(state.mean_pixel);
+    free(state.cov);
+    free(state.factor_mean_pixel);
+    free(state.factor_cov);
+    free(state.factor);
+    FreeMiseObs(&bip);
+    FreeMiseObs(&obs);
+}
+
+/*
+ * A region of interest gives the same detections as the observation cropped
+ * to it, the same region given as a bitmask does too, and pixels outside the
+ * mask are never detected
+ */
+void TestMiseMask(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation bip, sub;
+    EosMiseBackgroundState state;
+    EosMiseBackgroundStateRequest req;
+    EosPixelDetection expected_detections[10], detections[10];
+    EosMiseDetectionResult expected, result;
+    EosPixelMask mask = {3, 0, 6, 0, NULL};
+    const EosMiseAlgorithm algs[2] = {EOS_MISE_RX, EOS_MISE_PCA_RX};
+    const U32 rows = 12, cols = 11, bands = 6;
+    U64 valid[EOS_PIXEL_MASK_WORDS(12, 11)];
+    U16* layout_data = malloc(sizeof(U16) * rows * cols * bands);
+    U16* bip_data;
+    U32 i, a, row, n_values;
+
+    default_init_params_test(&init_params);
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 10;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+    params.local_rx_window_rows = 5;
+    params.pca_rx_components = 3;
+
+    InitMiseObs(&bip, rows, cols, bands);
+    n_values = rows * cols * bands;
+    for (i = 0; i < n_values; i++) {
+        bip.data[i] = ((i / bands) % 23 * 7919 + (i % bands) * 131) % 1009;
+    }
+    // The strongest anomaly lies outside rows 3-8
+    bip.data[(10 * cols + 4) * bands + 2] = 5000;
+    bip.data[(5 * cols + 4) * bands + 2] = 3000;
+
+    // Rows 3-8, as a separate observation
+    sub = bip;
+    sub.shape.rows = 6;
+    sub.data = &(bip.data[3 * cols * bands]);
+
+    expected.results = expected_detections;
+    result.results = detections;
+    for (a = 0; a < 2; a++) {
+        params.alg = algs[a];
+        expected.n_results = 10;
+        status = eos_mise_detect_anomaly(&params, &sub, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (i = 0; i < expected.n_results; i++) {
+            expected_detections[i].row += 3;
+        }
+
+        // As a region of interest
+        bip.mask = &mask;
+        result.n_results = 10;
+        status = eos_mise_detect_anomaly(&params, &bip, &result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        _assert_same_detections(ct, &expected, &result);
+
+        // As a bitmask over the whole observation
+        memset(valid, 0, sizeof(valid));
+        for (i = 3 * cols; i < 9 * cols; i++) {
+            valid[i / 64] |= 1ull << (i % 64);
+        }
+        mask.row_start = 0;
+        mask.rows = 0;
+        mask.valid = valid;
+        result.n_results = 10;
+        status = eos_mise_detect_anomaly(&params, &bip, &result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        _assert_same_detections(ct, &expected, &result);
+
+        // Without the pixel of the other anomaly, in BSQ
+        i = 5 * cols + 4;
+        valid[i / 64] &= ~(1ull << (i % 64));
+        bip_data = bip.data;
+        _to_layout(bip_data, bip.shape, EOS_MISE_BSQ, layout_data);
+        bip.data = layout_data;
+        bip.layout = EOS_MISE_BSQ;
+        result.n_results = 10;
+        status = eos_mise_detect_anomaly(&params, &bip, &result);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 10, result.n_results);
+        for (i = 0; i < result.n_results; i++) {
+            row = detections[i].row;
+            CuAssertTrue(ct, row >= 3 && row < 9);
+            CuAssertTrue(ct, row != 5 || detections[i].col != 4);
+        }
+        bip.data = bip_data;
+        bip.layout = EOS_MISE_BIP;
+        mask.row_start = 3;
+        mask.rows = 6;
+        mask.valid = NULL;
+    }
+
+    // The background state only merges the valid pixels
+    params.alg = EOS_MISE_RX;
+    status = eos_mise_background_state_request(bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    state.mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor_mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.factor_cov = malloc(sizeof(double) * req.matrix_size);
+    state.factor = malloc(sizeof(double) * req.matrix_size);
+    status = eos_mise_background_init(bands, &state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    sub.mask = NULL;
+    expected.n_results = 10;
+    status = eos_mise_detect_anomaly_background(&params, &state, &sub,
+                                                &expected);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < expected.n_results; i++) {
+        expected_detections[i].row += 3;
+    }
+    status = eos_mise_background_init(bands, &state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly_background(&params, &state, &bip,
+                                                &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    _assert_same_detections(ct, &expected, &result);
+
+    // No valid pixels
+    memset(valid, 0, sizeof(valid));
+    mask.valid = valid;
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &bip, &result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 0, result.n_results);
+
+    // Unsupported by local RX, and a region outside the observation
+    params.alg = EOS_MISE_LOCAL_RX;
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly(&params, &bip, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_RX;
+    mask.rows = rows;
+    status = eos_mise_detect_anomaly(&params, &bip, &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    status = eos_mise_detect_anomaly_background(&params, &state, &bip,
+                                                &result);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    free(state.mean_pixel);
+    free(state.cov);
+    free(state.factor_mean_pixel);
+    free(state.factor_cov);
+    free(state.factor);
+    free(layout_data);
+    FreeMiseObs(&bip);
+}
+
+/* Collects the rows of a U16 score map passed to its function */
+typedef struct {
+    U16* values;
+    U32 cols;
+    U32 next_row;
+    U32 n_blocks;
+} MiseMapSink;
+
+static EosStatus _mise_map_sink(void* context, uint32_t row, uint32_t n_rows,
+                                const void* values) {
+    MiseMapSink* sink = (MiseMapSink*) context;
+    if (row != sink->next_row) { return EOS_VALUE_ERROR; }
+    memcpy(&(sink->values[row * sink->cols]), values,
+           sizeof(U16) * n_rows * sink->cols);
+    sink->next_row = row + n_rows;
+    sink->n_blocks++;
+    return EOS_SUCCESS;
+}
+
+/*
+ * Score maps hold the scores of the detections, the same map is produced a
+ * block at a time, and masked pixels have a score of zero
+ */
+void TestMiseScoreMap(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    EosPixelDetection detections[10];
+    EosMiseDetectionResult result;
+    const EosMiseAlgorithm algs[3] = {
+        EOS_MISE_RX, EOS_MISE_LOCAL_RX, EOS_MISE_PCA_RX
+    };
+    const U32 rows = 12, cols = 11, bands = 6;
+    F32 f32_map[12 * 11];
+    U16 u16_map[12 * 11], streamed[12 * 11], block[5 * 11];
+    EosScoreMap map = {EOS_SCORE_MAP_F32, 1.0, 0.0, NULL, 0, NULL, NULL};
+    EosPixelMask mask = {3, 0, 6, 0, NULL};
+    MiseMapSink sink;
+    F32 max_score;
+    U32 i, a, n_values;
+
+    default_init_params_test(&init_params);
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 10;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+    params.local_rx_window_rows = 5;
+    params.pca_rx_components = 3;
+
+    InitMiseObs(&obs, rows, cols, bands);
+    n_values = rows * cols * bands;
+    for (i = 0; i < n_values; i++) {
+        obs.data[i] = ((i / bands) % 23 * 7919 + (i % bands) * 131) % 1009;
+    }
+    obs.data[(5 * cols + 4) * bands + 2] = 3000;
+
+    result.results = detections;
+    for (a = 0; a < 3; a++) {
+        params.alg = algs[a];
+
+        // The whole map, in single precision
+        map.format = EOS_SCORE_MAP_F32;
+        map.values = f32_map;
+        map.function = NULL;
+        result.n_results = 10;
+        status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 10, result.n_results);
+        for (i = 0; i < result.n_results; i++) {
+            CuAssertDblEquals(ct, (F32) detections[i].score,
+                f32_map[detections[i].row * cols + detections[i].col], 0);
+        }
+        max_score = 0.0f;
+        for (i = 0; i < rows * cols; i++) {
+            max_score = (f32_map[i] > max_score) ? f32_map[i] : max_score;
+        }
+        CuAssertDblEquals(ct, (F32) detections[0].score, max_score, 0);
+
+        // Quantized, as a whole and a block of 5 rows at a time, with no
+        // results requested
+        map.format = EOS_SCORE_MAP_U16;
+        map.scale = detections[0].score / 60000.0;
+        map.offset = 0.0;
+        map.values = u16_map;
+        result.n_results = 0;
+        status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 60000, u16_map[5 * cols + 4]);
+
+        sink.values = streamed;
+        sink.cols = cols;
+        sink.next_row = 0;
+        sink.n_blocks = 0;
+        map.values = block;
+        map.block_rows = 5;
+        map.function = _mise_map_sink;
+        map.context = &sink;
+        status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 3, sink.n_blocks);
+        CuAssertIntEquals(ct, rows, sink.next_row);
+        for (i = 0; i < rows * cols; i++) {
+            CuAssertIntEquals(ct, u16_map[i], streamed[i]);
+        }
+    }
+
+    // Masked pixels have a score of zero
+    params.alg = EOS_MISE_RX;
+    obs.mask = &mask;
+    map.format = EOS_SCORE_MAP_F32;
+    map.values = f32_map;
+    map.function = NULL;
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < rows * cols; i++) {
+        if (i / cols >= 3 && i / cols < 9) {
+            CuAssertTrue(ct, f32_map[i] > 0.0f);
+        } else {
+            CuAssertDblEquals(ct, 0.0, f32_map[i], 0);
+        }
+    }
+    obs.mask = NULL;
+
+    // An error from the map function stops detection
+    sink.next_row = 1;
+    map.format = EOS_SCORE_MAP_U16;
+    map.values = block;
+    map.function = _mise_map_sink;
+    result.n_results = 10;
+    status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // An invalid map
+    map.block_rows = 0;
+    status = eos_mise_detect_anomaly_map(&params, &obs, &result, &map);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    FreeMiseObs(&obs);
+}
+
+/* Run a resumable RX job to completion, returning the number of steps */
+static U32 _run_rx_job(CuTest *ct, const EosMiseParams* params,
+                       const EosMiseObservation* obs,
+                       EosMiseDetectionResult* result,
+                       EosMiseRxJobState* state, U64 budget) {
+    EosStatus status;
+    U32 n_steps = 0;
+
+    status = eos_mise_rx_job_begin(params, obs, result, state);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    do {
+        status = eos_mise_rx_job_step(state, budget);
+        n_steps++;
+    } while (status == EOS_IN_PROGRESS);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    return n_steps;
+}
+
+/*
+ * A resumable RX job gives exactly the results of a single detection,
+ * whatever the budget of each step, with masks, sampling, and a
+ * rank-deficient background
+ */
+void TestMiseRxJob(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    EosMiseRxJobState state;
+    EosMiseRxJobStateRequest req;
+    EosPixelDetection expected_detections[10], detections[10];
+    EosMiseDetectionResult expected, result;
+    EosPixelMask mask = {2, 1, 8, 9, NULL};
+    const U64 budgets[3] = {0, 7, 1000000};
+    const U32 rows = 12, cols = 11, bands = 5;
+    U64 valid[EOS_PIXEL_MASK_WORDS(12, 11)];
+    U32 i, c, b, n_steps;
+
+    default_init_params_test(&init_params);
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 10;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.alg = EOS_MISE_RX;
+
+    status = eos_mise_rx_job_state_request(bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    // The pseudo-inverse costs at least a few pixels per band, depending on
+    // the eigensolver the library was built with
+    CuAssertTrue(ct, req.pseudo_inverse_pixels >= (U64) 8 * bands);
+    state.moments = malloc(sizeof(uint64_t) * req.moments_size);
+    state.mean_pixel = malloc(sizeof(double) * req.vector_size);
+    state.factor = malloc(sizeof(double) * req.factor_size);
+
+    InitMiseObs(&obs, rows, cols, bands);
+    for (i = 0; i < rows * cols * bands; i++) {
+        obs.data[i] = ((i / bands) % 23 * 7919 + (i % bands) * 131) % 1009;
+    }
+    obs.data[(5 * cols + 4) * bands + 2] = 3000;
+    for (i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+        valid[i] = 0x5DEECE66Dull * (i + 1);
+    }
+
+    expected.results = expected_detections;
+    result.results = detections;
+    for (c = 0; c < 5; c++) {
+        params.background_sampling = EOS_MISE_SAMPLE_ALL;
+        params.precision = EOS_MISE_DOUBLE_PRECISION;
+        obs.mask = NULL;
+        if (c == 1) {
+            obs.mask = &mask;
+        } else if (c == 2) {
+            mask.valid = valid;
+            obs.mask = &mask;
+        } else if (c == 3) {
+            params.background_sampling = EOS_MISE_SAMPLE_GRID;
+            params.background_sample_step = 2;
+            params.precision = EOS_MISE_SINGLE_PRECISION;
+        } else if (c == 4) {
+            // A constant band needs the pseudo-inverse
+            for (i = 0; i < rows * cols; i++) {
+                obs.data[i * bands + 1] = 100;
+            }
+        }
+
+        expected.n_results = 10;
+        status = eos_mise_detect_anomaly(&params, &obs, &expected);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (b = 0; b < 3; b++) {
+            memset(detections, 0, sizeof(detections));
+            result.n_results = 10;
+            n_steps = _run_rx_job(ct, &params, &obs, &result, &state,
+                                  budgets[b]);
+            _assert_same_detections(ct, &expected, &result);
+            // Background rows, the factorization, and the scoring
+            CuAssertTrue(ct, n_steps >= 3);
+            if (budgets[b] == 0 && c == 0) {
+                // The factorization of 5 bands takes two steps of a pixel's
+                // work (12.5 + 8 then 4.5 + 2 + 0.5 multiply-adds)
+                CuAssertIntEquals(ct, rows + 2 + rows * cols, n_steps);
+            }
+        }
+    }
+
+    // Further steps of a finished job do nothing
+    status = eos_mise_rx_job_step(&state, 1);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    _assert_same_detections(ct, &expected, &result);
+
+    // Nothing to do for an empty region of interest
+    mask.valid = NULL;
+    mask.col_start = cols;
+    mask.cols = 0;
+    obs.mask = &mask;
+    result.n_results = 10;
+    n_steps = _run_rx_job(ct, &params, &obs, &result, &state, 1);
+    CuAssertIntEquals(ct, 1, n_steps);
+    CuAssertIntEquals(ct, 0, result.n_results);
+
+    // Only RX is resumable
+    params.alg = EOS_MISE_LOCAL_RX;
+    obs.mask = NULL;
+    status = eos_mise_rx_job_begin(&params, &obs, &result, &state);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    FreeMiseObs(&obs);
+    free(state.moments);
+    free(state.mean_pixel);
+    free(state.factor);
+}
+
+/* Score of the pixel in the results, which must hold it */
+static F64 _detection_score(CuTest *ct, const EosMiseDetectionResult* result,
+                            U32 row, U32 col) {
+    U32 i;
+    for (i = 0; i < result->n_results; i++) {
+        if (result->results[i].row == row && result->results[i].col == col) {
+            return result->results[i].score;
+        }
+    }
+    CuFail(ct, "Pixel is not in the results");
+    return 0;
+}
+
+/*
+ * A batch gives exactly the results of detecting each observation in turn
+ * or, with a pooled background, of detecting the observations stacked into
+ * one
+ */
+void TestMiseBatch(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation stacked, observations[3];
+    EosPixelDetection batch_detections[3][60], detections[60];
+    EosPixelDetection stacked_detections[180];
+    EosMiseDetectionResult batch_results[3], result, stacked_result;
+    EosPixelMask empty = {0, 0, 0, 0, NULL};
+    const U32 rows = 6, cols = 10, bands = 4;
+    U32 i, k, p, s;
+
+    default_init_params_test(&init_params);
+    init_params.mise_workers = 2;
+    init_params.mise_max_results = 180;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.alg = EOS_MISE_RX;
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+
+    // Three cubes of the same pass, stacked along-track
+    InitMiseObs(&stacked, 3 * rows, cols, bands);
+    for (i = 0; i < 3 * rows * cols * bands; i++) {
+        stacked.data[i] = ((i / bands) % 29 * 7919 + (i % bands) * 131
+                           + (i / (rows * cols * bands)) * 37) % 1013;
+    }
+    stacked.data[(8 * cols + 3) * bands + 1] = 4000;
+    for (k = 0; k < 3; k++) {
+        observations[k] = stacked;
+        observations[k].shape.rows = rows;
+        observations[k].data = &(stacked.data[k * rows * cols * bands]);
+        batch_results[k].results = batch_detections[k];
+    }
+    result.results = detections;
+    stacked_result.results = stacked_detections;
+
+    // Each cube separately, including with sampling
+    for (s = 0; s < 2; s++) {
+        params.background_sampling = s ? EOS_MISE_SAMPLE_STRIDE
+                                       : EOS_MISE_SAMPLE_ALL;
+        params.background_sample_step = 3;
+        for (k = 0; k < 3; k++) {
+            batch_results[k].n_results = 10;
+        }
+        status = eos_mise_detect_anomaly_batch(&params, 3, observations,
+                                               batch_results);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        for (k = 0; k < 3; k++) {
+            result.n_results = 10;
+            status = eos_mise_detect_anomaly(&params, &(observations[k]),
+                                             &result);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            _assert_same_detections(ct, &result, &(batch_results[k]));
+        }
+    }
+
+    // Against the background of all the cubes
+    params.background_sampling = EOS_MISE_SAMPLE_ALL;
+    params.batch_pooled_background = EOS_TRUE;
+    stacked_result.n_results = 3 * rows * cols;
+    status = eos_mise_detect_anomaly(&params, &stacked, &stacked_result);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (k = 0; k < 3; k++) {
+        batch_results[k].n_results = rows * cols;
+    }
+    status = eos_mise_detect_anomaly_batch(&params, 3, observations,
+                                           batch_results);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (k = 0; k < 3; k++) {
+        CuAssertIntEquals(ct, rows * cols, batch_results[k].n_results);
+        for (p = 0; p < rows * cols; p++) {
+            CuAssertDblEquals(ct,
+                _detection_score(ct, &stacked_result,
+                                 k * rows + batch_detections[k][p].row,
+                                 batch_detections[k][p].col),
+                batch_detections[k][p].score, 0);
+        }
+    }
+    CuAssertIntEquals(ct, 2, batch_detections[1][0].row);
+    CuAssertIntEquals(ct, 3, batch_detections[1][0].col);
+
+    // A cube outside its region of interest has no results
+    empty.row_start = rows;
+    observations[1].mask = &empty;
+    for (k = 0; k < 3; k++) {
+        batch_results[k].n_results = 10;
+    }
+    status = eos_mise_detect_anomaly_batch(&params, 3, observations,
+                                           batch_results);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 10, batch_results[0].n_results);
+    CuAssertIntEquals(ct, 0, batch_results[1].n_results);
+    CuAssertIntEquals(ct, 10, batch_results[2].n_results);
+    observations[1].mask = NULL;
+
+    // A pooled background needs RX and the same bands
+    observations[2].shape.bands = 2;
+    status = eos_mise_detect_anomaly_batch(&params, 3, observations,
+                                           batch_results);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    observations[2].shape.bands = bands;
+    params.alg = EOS_MISE_LOCAL_RX;
+    status = eos_mise_detect_anomaly_batch(&params, 3, observations,
+                                           batch_results);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // An empty batch
+    params.alg = EOS_MISE_RX;
+    status = eos_mise_detect_anomaly_batch(&params, 0, NULL, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    FreeMiseObs(&stacked);
+}
+
+/* Matched filter or ACE score of a pixel against a target, given the
+ * (pseudo-)inverse background covariance */
+static F64 _target_score(EosMiseAlgorithm alg, U32 bands, const F64* cov_inv,
+                         const F64* mean_pixel, const F64* spectrum,
+                         const U16* pixel) {
+    F64 dx = 0.0, dd = 0.0, xx = 0.0;
+    F64 d1, x1, d2, x2;
+    U32 b1, b2;
+
+    for (b1 = 0; b1 < bands; b1++) {
+        d1 = spectrum[b1] - mean_pixel[b1];
+        x1 = pixel[b1] - mean_pixel[b1];
+        for (b2 = 0; b2 < bands; b2++) {
+            d2 = spectrum[b2] - mean_pixel[b2];
+            x2 = pixel[b2] - mean_pixel[b2];
+            dx += d1 * cov_inv[b1 * bands + b2] * x2;
+            dd += d1 * cov_inv[b1 * bands + b2] * d2;
+            xx += x1 * cov_inv[b1 * bands + b2] * x2;
+        }
+    }
+    if (alg == EOS_MISE_ACE) {
+        return (xx > 0.0) ? dx * dx / (dd * xx) : 0.0;
+    }
+    return dx / dd;
+}
+
+/*
+ * Target detection ranks the pixels holding each library spectrum first,
+ * with the matched filter and ACE scores of every pixel against the
+ * background (including a rank-deficient one), whatever the number of
+ * workers
+ */
+void TestMiseTargets(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    const U32 rows = 8, cols = 10, bands = 4;
+    const F64 spectra[2 * 4] = {3000, 500, 500, 2500,
+                                200, 2800, 2600, 300};
+    EosMiseTargetLibrary library = {2, 4, NULL};
+    EosPixelDetection detections[2][80], worker_detections[2][80];
+    EosMiseDetectionResult results[2], worker_results[2];
+    EosMiseAlgorithm alg;
+    F64 mean_pixel[4], cov[4 * 4], cov_inv[4 * 4], w[4], V[4 * 4];
+    U32 buf[2 * 4];
+    U32 i, k, b, singular;
+
+    library.spectra = spectra;
+    default_init_params_test(&init_params);
+    init_params.mise_max_results = rows * cols;
+    init_params.mise_max_targets = 2;
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+
+    InitMiseObs(&obs, rows, cols, bands);
+    for (singular = 0; singular < 2; singular++) {
+        for (i = 0; i < rows * cols * bands; i++) {
+            obs.data[i] = ((i / bands) % 29 * 7919 + (i % bands) * 131)
+                          % 1013;
+            // A constant band makes the covariance rank-deficient
+            if (singular && i % bands == 3) { obs.data[i] = 500; }
+        }
+        for (b = 0; b < bands; b++) {
+            obs.data[(2 * cols + 3) * bands + b] = (U16) spectra[b];
+            obs.data[(5 * cols + 7) * bands + b] = (U16) spectra[bands + b];
+        }
+        if (singular) {
+            obs.data[(2 * cols + 3) * bands + 3] = 500;
+            obs.data[(5 * cols + 7) * bands + 3] = 500;
+        }
+
+        status = compute_mean_pixel(obs.data, &(obs.shape), obs.layout,
+                                    mean_pixel);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = compute_covariance(obs.data, &(obs.shape), obs.layout,
+                                    mean_pixel, cov);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        status = invert_sym_matrix(bands, cov, cov_inv, w, V, buf);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+        for (alg = EOS_MISE_MATCHED_FILTER; alg <= EOS_MISE_ACE; alg++) {
+            params.alg = alg;
+            for (k = 0; k < 2; k++) {
+                init_params.mise_workers = k + 1;
+                status = eos_init(&init_params, NULL, 0, NULL);
+                CuAssertIntEquals(ct, EOS_SUCCESS, status);
+                for (i = 0; i < 2; i++) {
+                    worker_results[i].n_results = rows * cols;
+                    worker_results[i].results = worker_detections[i];
+                }
+                status = eos_mise_detect_targets(&params, &obs, &library,
+                                                 worker_results);
+                CuAssertIntEquals(ct, EOS_SUCCESS, status);
+                if (k == 0) {
+                    memcpy(detections, worker_detections, sizeof(detections));
+                    memcpy(results, worker_results, sizeof(results));
+                    results[0].results = detections[0];
+                    results[1].results = detections[1];
+                }
+                _assert_same_detections(ct, &(results[0]),
+                                        &(worker_results[0]));
+                _assert_same_detections(ct, &(results[1]),
+                                        &(worker_results[1]));
+            }
+
+            // Each target is found where it was implanted
+            CuAssertIntEquals(ct, 2, detections[0][0].row);
+            CuAssertIntEquals(ct, 3, detections[0][0].col);
+            CuAssertIntEquals(ct, 5, detections[1][0].row);
+            CuAssertIntEquals(ct, 7, detections[1][0].col);
+            if (alg == EOS_MISE_MATCHED_FILTER) {
+                CuAssertDblEquals(ct, 1.0, detections[0][0].score, 1e-9);
+            }
+            for (k = 0; k < 2; k++) {
+                CuAssertIntEquals(ct, rows * cols, results[k].n_results);
+                for (i = 0; i < rows * cols; i++) {
+                    CuAssertDblEquals(ct,
+                        _target_score(alg, bands, cov_inv, mean_pixel,
+                            &(spectra[k * bands]),
+                            &(obs.data[(detections[k][i].row * cols
+                                        + detections[k][i].col) * bands])),
+                        detections[k][i].score, 1e-9);
+                }
+            }
+        }
+    }
+
+    // A library must fit the reserved targets and match the observation
+    params.alg = EOS_MISE_ACE;
+    results[0].n_results = 5;
+    results[1].n_results = 5;
+    library.n_targets = 3;
+    status = eos_mise_detect_targets(&params, &obs, &library, results);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    library.n_targets = 2;
+    library.bands = 3;
+    status = eos_mise_detect_targets(&params, &obs, &library, results);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+    library.bands = bands;
+
+    // Targets are only detected through eos_mise_detect_targets
+    status = eos_mise_detect_anomaly(&params, &obs, &(results[0]));
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_RX;
+    status = eos_mise_detect_targets(&params, &obs, &library, results);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    // An empty library
+    params.alg = EOS_MISE_MATCHED_FILTER;
+    library.n_targets = 0;
+    status = eos_mise_detect_targets(&params, &obs, &library, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    FreeMiseObs(&obs);
+}
+
+/*
+ * The spectral angle mapper assigns each pixel to the library class with the
+ * smallest angle, within the largest angle, and the coarse pre-filter and
+ * the number of workers do not change the results
+ */
+void TestMiseSam(CuTest *ct) {
+    EosStatus status;
+    EosInitParams init_params;
+    EosParams all_params;
+    EosMiseParams params;
+    EosMiseObservation obs;
+    const U32 rows = 6, cols = 7, bands = 9, n_targets = 6;
+    const U32 expected_order[9] = {0, 3, 6, 1, 2, 4, 5, 7, 8};
+    F64 spectra[6 * 9];
+    EosMiseTargetLibrary library = {6, 9, NULL};
+    EosMiseSamIndexRequest req;
+    EosMiseSamIndex index;
+    U32 band_order[9];
+    F64 index_spectra[9 * 8], tail_norms[8];
+    EosPixelDetection detections[6][42], expected_detections[6][42];
+    EosMiseDetectionResult results[6], expected[6];
+    const U16* pixel;
+    F64 dot, norm, cos_angle, best_cos;
+    U32 i, e, b, p, best, step, k;
+    U32 n_classified = 0;
+
+    for (e = 0; e < n_targets; e++) {
+        for (b = 0; b < bands; b++) {
+            spectra[e * bands + b] = 100 + (e * 37 + b * (e + 3) * 53) % 400;
+        }
+    }
+    library.spectra = spectra;
+
+    default_init_params_test(&init_params);
+    init_params.mise_max_bands = bands;
+    init_params.mise_max_results = rows * cols;
+    init_params.mise_max_targets = n_targets;
+    status = eos_init(&init_params, NULL, 0, NULL);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    status = eos_init_default_params(&all_params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    params = all_params.mise;
+    params.alg = EOS_MISE_SAM;
+
+    status = eos_mise_sam_index_request(n_targets, bands, &req);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertTrue(ct, req.band_order_size == bands);
+    CuAssertTrue(ct, req.spectra_size == bands * 8);
+    CuAssertTrue(ct, req.tail_norms_size == 8);
+    index.band_order = band_order;
+    index.spectra = index_spectra;
+    index.tail_norms = tail_norms;
+
+    // Scaled, perturbed library spectra, and pixels of no class
+    InitMiseObs(&obs, rows, cols, bands);
+    for (p = 0; p < rows * cols; p++) {
+        e = (p * 5) % (n_targets + 1);
+        for (b = 0; b < bands; b++) {
+            obs.data[p * bands + b] = (e < n_targets) ?
+                (U16) ((1 + p % 3) * spectra[e * bands + b]
+                       + (p * 31 + b * 17) % 23) :
+                (U16) ((b == p % bands) ? 900 : 20);
+        }
+    }
+
+    // The expected classes from the angles with every library spectrum
+    for (e = 0; e < n_targets; e++) {
+        expected[e].n_results = 0;
+        expected[e].results = expected_detections[e];
+    }
+    for (p = 0; p < rows * cols; p++) {
+        pixel = &(obs.data[p * bands]);
+        best = 0;
+        best_cos = -2.0;
+        for (e = 0; e < n_targets; e++) {
+            dot = 0.0;
+            norm = 0.0;
+            for (b = 0; b < bands; b++) {
+                dot += pixel[b] * spectra[e * bands + b];
+                norm += spectra[e * bands + b] * spectra[e * bands + b];
+            }
+            cos_angle = dot / sqrt(norm);
+            if (cos_angle > best_cos) {
+                best = e;
+                best_cos = cos_angle;
+            }
+        }
+        norm = 0.0;
+        for (b = 0; b < bands; b++) {
+            norm += (F64) pixel[b] * pixel[b];
+        }
+        best_cos /= sqrt(norm);
+        if (best_cos >= cos(params.sam_max_angle)) {
+            expected_detections[best][expected[best].n_results].row =
+                p / cols;
+            expected_detections[best][expected[best].n_results].col =
+                p % cols;
+            expected_detections[best][expected[best].n_results].score =
+                best_cos;
+            expected[best].n_results++;
+            n_classified++;
+        }
+    }
+    CuAssertTrue(ct, n_classified > rows * cols / 2);
+    CuAssertTrue(ct, n_classified < rows * cols);
+
+    // Without and with the pre-filter, and with one and two workers
+    for (step = 1; step <= 3; step += 2) {
+        status = eos_mise_sam_index_build(&library, step, &index);
+        CuAssertIntEquals(ct, EOS_SUCCESS, status);
+        CuAssertIntEquals(ct, 8, index.stride);
+        CuAssertIntEquals(ct, (step == 1) ? bands : 3, index.n_coarse_bands);
+        if (step == 3) {
+            for (b = 0; b < bands; b++) {
+                CuAssertIntEquals(ct, expected_order[b], band_order[b]);
+            }
+        }
+        for (k = 1; k <= 2; k++) {
+            init_params.mise_workers = k;
+            status = eos_init(&init_params, NULL, 0, NULL);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            for (e = 0; e < n_targets; e++) {
+                results[e].n_results = rows * cols;
+                results[e].results = detections[e];
+            }
+            status = eos_mise_classify_sam(&params, &obs, &index, results);
+            CuAssertIntEquals(ct, EOS_SUCCESS, status);
+            for (e = 0; e < n_targets; e++) {
+                CuAssertIntEquals(ct, expected[e].n_results,
+                                  results[e].n_results);
+                for (i = 0; i < results[e].n_results; i++) {
+                    CuAssertDblEquals(ct,
+                        _detection_score(ct, &(expected[e]),
+                                         detections[e][i].row,
+                                         detections[e][i].col),
+                        detections[e][i].score, 1e-12);
+                }
+            }
+        }
+    }
+
+    // The top result of a class is one of its pixels
+    results[2].n_results = 1;
+    status = eos_mise_classify_sam(&params, &obs, &index, results);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 1, results[2].n_results);
+    CuAssertIntEquals(ct, 2,
+        ((detections[2][0].row * cols + detections[2][0].col) * 5)
+        % (n_targets + 1));
+
+    // A spectrum of zero has no angle
+    for (b = 0; b < bands; b++) {
+        spectra[4 * bands + b] = 0.0;
+    }
+    status = eos_mise_sam_index_build(&library, 3, &index);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // The index must fit the reserved targets and match the observation
+    index.n_targets = n_targets + 1;
+    status = eos_mise_classify_sam(&params, &obs, &index, results);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    index.n_targets = n_targets;
+    index.bands = bands - 1;
+    status = eos_mise_classify_sam(&params, &obs, &index, results);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // The spectral angle mapper only classifies through an index
+    status = eos_mise_detect_anomaly(&params, &obs, &(results[0]));
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.alg = EOS_MISE_RX;
+    status = eos_mise_classify_sam(&params, &obs, &index, results);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    status = eos_teardown();
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
     FreeMiseObs(&obs);
 }
 
@@ -347,15 +3828,45 @@ CuSuite* CuMiseGetSuite(void)
 
     // Public interface
     SUITE_ADD_TEST(suite, TestMiseInterface);
+    SUITE_ADD_TEST(suite, TestMiseStream);
+    SUITE_ADD_TEST(suite, TestMiseBackground);
+    SUITE_ADD_TEST(suite, TestMiseLayouts);
+    SUITE_ADD_TEST(suite, TestMiseMask);
+    SUITE_ADD_TEST(suite, TestMiseScoreMap);
+    SUITE_ADD_TEST(suite, TestMiseRxJob);
+    SUITE_ADD_TEST(suite, TestMiseBatch);
+    SUITE_ADD_TEST(suite, TestMiseTargets);
+    SUITE_ADD_TEST(suite, TestMiseSam);
 
     // Internal Function
     SUITE_ADD_TEST(suite, TestComputeMeanPixel);
     SUITE_ADD_TEST(suite, TestComputeCovariance);
+    SUITE_ADD_TEST(suite, TestComputeMoments);
+    SUITE_ADD_TEST(suite, TestMomentsMatchTwoPass);
+    SUITE_ADD_TEST(suite, TestMomentsParallel);
     SUITE_ADD_TEST(suite, TestPZeroInEigenPivot);
     SUITE_ADD_TEST(suite, TestEigen);
+    SUITE_ADD_TEST(suite, TestEigenJacobi);
+    SUITE_ADD_TEST(suite, TestEigenQl);
+    SUITE_ADD_TEST(suite, TestEigenQlRankDeficient);
     SUITE_ADD_TEST(suite, TestInvert);
+    SUITE_ADD_TEST(suite, TestCholesky);
+    SUITE_ADD_TEST(suite, TestRxScoreCholesky);
     SUITE_ADD_TEST(suite, TestRxScore);
+    SUITE_ADD_TEST(suite, TestRxScoreTile);
     SUITE_ADD_TEST(suite, TestRxAnomalyDetection);
+    SUITE_ADD_TEST(suite, TestMomentsSampled);
+    SUITE_ADD_TEST(suite, TestRxSampledAnomalyDetection);
+    SUITE_ADD_TEST(suite, TestRxSinglePrecision);
+    SUITE_ADD_TEST(suite, TestRxPackedBackground);
+    SUITE_ADD_TEST(suite, TestRemoveMoments);
+    SUITE_ADD_TEST(suite, TestCholeskyInvert);
+    SUITE_ADD_TEST(suite, TestShermanMorrison);
+    SUITE_ADD_TEST(suite, TestLocalRxAnomalyDetection);
+    SUITE_ADD_TEST(suite, TestTopEigen);
+    SUITE_ADD_TEST(suite, TestPcaRxAnomalyDetection);
+    SUITE_ADD_TEST(suite, TestPcaBasisAnomalyDetection);
+    SUITE_ADD_TEST(suite, TestSegmentedRxAnomalyDetection);
 
     return suite;
 }
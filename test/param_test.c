@@ -150,6 +150,74 @@ void TestMiseParamCheck(CuTest *ct) {
     EosMiseParams params;
 
     params.alg = EOS_MISE_RX;
+    params.background_sampling = EOS_MISE_SAMPLE_ALL;
+    params.batch_pooled_background = EOS_FALSE;
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.alg = EOS_MISE_LOCAL_RX;
+    params.local_rx_window_rows = 0;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    params.local_rx_window_rows = 16;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.alg = EOS_MISE_PCA_RX;
+    params.pca_rx_components = 0;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    params.pca_rx_components = 5;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.alg = EOS_MISE_RX;
+    params.background_sampling = EOS_MISE_SAMPLE_GRID;
+    params.background_sample_step = 0;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    params.background_sample_step = 4;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.background_sampling = EOS_MISE_N_SAMPLINGS;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.background_sampling = EOS_MISE_SAMPLE_ALL;
+
+    params.batch_pooled_background = 2;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.batch_pooled_background = EOS_TRUE;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.precision = EOS_MISE_SINGLE_PRECISION;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.precision = EOS_MISE_N_PRECISIONS;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.precision = EOS_MISE_DOUBLE_PRECISION;
+
+    params.alg = EOS_MISE_SAM;
+    params.sam_max_angle = -0.1;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.sam_max_angle = 0.1;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.alg = EOS_MISE_SEGMENTED_RX;
+    params.segmented_rx_clusters = 0;
+    status = mise_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+    params.segmented_rx_clusters = 2;
     status = mise_params_check(&params);
     CuAssertIntEquals(ct, EOS_SUCCESS, status);
 
@@ -158,6 +226,29 @@ void TestMiseParamCheck(CuTest *ct) {
     CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
 }
 
+void TestMiseBackgroundParamCheck(CuTest *ct) {
+    EosStatus status;
+    EosMiseParams params;
+
+    params.background_forgetting = 1.0;
+    params.background_drift_tolerance = 0.0;
+    status = mise_background_params_check(&params);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+
+    params.background_forgetting = 0.0;
+    status = mise_background_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    params.background_forgetting = 1.01;
+    status = mise_background_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+
+    params.background_forgetting = 0.5;
+    params.background_drift_tolerance = -0.1;
+    status = mise_background_params_check(&params);
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, status);
+}
+
 void TestPimsParamCheck(CuTest *ct) {
     EosStatus status;
     EosPimsParams pims_params;
@@ -223,6 +314,7 @@ CuSuite* CuParamGetSuite(void)
     SUITE_ADD_TEST(suite, TestParamGteoMacro);
     SUITE_ADD_TEST(suite, TestParamInRangeMacro);
     SUITE_ADD_TEST(suite, TestMiseParamCheck);
+    SUITE_ADD_TEST(suite, TestMiseBackgroundParamCheck);
     SUITE_ADD_TEST(suite, TestPimsParamCheck);
     SUITE_ADD_TEST(suite, TestCombinedParamCheck);
 
@@ -15,6 +15,10 @@ CuSuite *CuEosGetSuite();
 CuSuite *CuMiseGetSuite();
 CuSuite *CuPimsGetSuite();
 CuSuite *CuHeapGetSuite();
+CuSuite *CuThreadGetSuite();
+CuSuite *CuSimdGetSuite();
+CuSuite *CuMaskGetSuite();
+CuSuite *CuScoreMapGetSuite();
 
 unsigned int run_all(void)
 {
@@ -33,6 +37,10 @@ unsigned int run_all(void)
     suites[n_suites++] = CuMiseGetSuite();
     suites[n_suites++] = CuPimsGetSuite();
     suites[n_suites++] = CuHeapGetSuite();
+    suites[n_suites++] = CuThreadGetSuite();
+    suites[n_suites++] = CuSimdGetSuite();
+    suites[n_suites++] = CuMaskGetSuite();
+    suites[n_suites++] = CuScoreMapGetSuite();
 
     int i;
     for (i = 0; i < n_suites; i++) {
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include <eos_score_map.h>
+#include "CuTest.h"
+#include "util.h"
+
+typedef struct {
+    U32 n_calls;
+    U32 next_row;
+    U16 values[12];
+    EosStatus status;
+} ScoreMapSink;
+
+static EosStatus _sink_rows(void* context, uint32_t row, uint32_t n_rows,
+                            const void* values) {
+    ScoreMapSink* sink = (ScoreMapSink*) context;
+    U32 i;
+    sink->n_calls++;
+    if (row != sink->next_row) { return EOS_ERROR; }
+    for (i = 0; i < n_rows * 2; i++) {
+        sink->values[row * 2 + i] = ((const U16*) values)[i];
+    }
+    sink->next_row = row + n_rows;
+    return sink->status;
+}
+
+/* U16 maps round (score - offset) / scale and clamp it to the U16 range */
+void TestScoreMapQuantize(CuTest *ct) {
+    U16 values[6];
+    F32 f32_values[2];
+    EosScoreMap map = {EOS_SCORE_MAP_U16, 0.5, 10.0, values, 0, NULL, NULL};
+
+    eos_score_map_store(&map, 0, 10.0);
+    eos_score_map_store(&map, 1, 11.2);
+    eos_score_map_store(&map, 2, 11.3);
+    eos_score_map_store(&map, 3, 5.0);
+    eos_score_map_store(&map, 4, 1e9);
+    eos_score_map_store(&map, 5, NAN);
+    CuAssertIntEquals(ct, 0, values[0]);
+    CuAssertIntEquals(ct, 2, values[1]);
+    CuAssertIntEquals(ct, 3, values[2]);
+    CuAssertIntEquals(ct, 0, values[3]);
+    CuAssertIntEquals(ct, 65535, values[4]);
+    CuAssertIntEquals(ct, 0, values[5]);
+
+    // Cleared values have a score of zero
+    map.offset = -1.0;
+    eos_score_map_clear(&map, 6);
+    CuAssertIntEquals(ct, 2, values[0]);
+    CuAssertIntEquals(ct, 2, values[5]);
+
+    map.format = EOS_SCORE_MAP_F32;
+    map.values = f32_values;
+    eos_score_map_store(&map, 1, 1.25);
+    eos_score_map_clear(&map, 1);
+    CuAssertDblEquals(ct, 0.0, f32_values[0], 0);
+    CuAssertDblEquals(ct, 1.25, f32_values[1], 0);
+}
+
+/* A blank map is emitted a block at a time, in row order */
+void TestScoreMapBlocks(CuTest *ct) {
+    const EosObsShape shape = {6, 2, 1};
+    U16 block[4 * 2];
+    ScoreMapSink sink = {0, 0, {0}, EOS_SUCCESS};
+    EosScoreMap map = {EOS_SCORE_MAP_U16, 1.0, -7.0, block, 4,
+                       _sink_rows, &sink};
+    U32 i;
+
+    CuAssertIntEquals(ct, 6, eos_score_map_block_rows(NULL, 6));
+    CuAssertIntEquals(ct, 4, eos_score_map_block_rows(&map, 6));
+
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_blank(&map, &shape));
+    CuAssertIntEquals(ct, 2, sink.n_calls);
+    CuAssertIntEquals(ct, 6, sink.next_row);
+    for (i = 0; i < 12; i++) {
+        CuAssertIntEquals(ct, 7, sink.values[i]);
+    }
+
+    // The function's status stops the map
+    sink.n_calls = 0;
+    sink.next_row = 0;
+    sink.status = EOS_VALUE_ERROR;
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, eos_score_map_blank(&map, &shape));
+    CuAssertIntEquals(ct, 1, sink.n_calls);
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_blank(NULL, &shape));
+}
+
+/* Maps must have a valid format and scale, values, and nonempty blocks */
+void TestScoreMapCheck(CuTest *ct) {
+    U16 values[4];
+    EosScoreMap map = {EOS_SCORE_MAP_U16, 1.0, 0.0, values, 0, NULL, NULL};
+
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_check(NULL));
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_check(&map));
+
+    map.function = _sink_rows;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_score_map_check(&map));
+    map.block_rows = 1;
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_check(&map));
+
+    map.scale = 0.0;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_score_map_check(&map));
+    map.scale = NAN;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_score_map_check(&map));
+    map.format = EOS_SCORE_MAP_F32;
+    CuAssertIntEquals(ct, EOS_SUCCESS, eos_score_map_check(&map));
+    map.format = EOS_SCORE_MAP_N_FORMATS;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_score_map_check(&map));
+    map.format = EOS_SCORE_MAP_F32;
+    map.values = NULL;
+    CuAssertIntEquals(ct, EOS_PARAM_ERROR, eos_score_map_check(&map));
+}
+
+CuSuite* CuScoreMapGetSuite(void)
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, TestScoreMapQuantize);
+    SUITE_ADD_TEST(suite, TestScoreMapBlocks);
+    SUITE_ADD_TEST(suite, TestScoreMapCheck);
+    return suite;
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include <eos_simd.h>
+#include "CuTest.h"
+#include "util.h"
+
+#define SIMD_TEST_MAX_N 421
+
+/*
+ * Every available kernel level agrees with an extended-precision reference
+ * to within the documented bound, n * DBL_EPSILON * sum_i |a_i b_i|
+ */
+void TestDotKernels(CuTest *ct) {
+    F64* a = malloc(sizeof(F64) * SIMD_TEST_MAX_N);
+    F64* b = malloc(sizeof(F64) * SIMD_TEST_MAX_N);
+    EosSimdLevel level, selected;
+    U32 seed = 2024;
+    U32 i, n;
+    long double exact;
+    F64 abs_sum;
+
+    for (i = 0; i < SIMD_TEST_MAX_N; i++) {
+        seed = seed * 1103515245 + 12345;
+        a[i] = ((seed >> 16) % 20001) / 1000.0 - 10.0;
+        seed = seed * 1103515245 + 12345;
+        b[i] = ((seed >> 16) % 20001) / 1000.0 - 10.0;
+    }
+
+    for (level = EOS_SIMD_SCALAR; level <= EOS_SIMD_AVX512; level++) {
+        selected = eos_simd_set_level(level);
+        CuAssertTrue(ct, selected <= level);
+        CuAssertTrue(ct, selected <= eos_simd_supported());
+        if (selected != level) { continue; }
+
+        // Lengths around every vector width and unrolling factor
+        for (n = 0; n <= SIMD_TEST_MAX_N; n += (n < 40) ? 1 : 127) {
+            exact = 0.0L;
+            abs_sum = 0.0;
+            for (i = 0; i < n; i++) {
+                exact += (long double) a[i] * b[i];
+                abs_sum += fabs(a[i] * b[i]);
+            }
+            CuAssertDblEquals(ct, (F64) exact, eos_ddot(n, a, b),
+                              n * DBL_EPSILON * abs_sum);
+        }
+    }
+
+    eos_simd_init();
+    free(a);
+    free(b);
+}
+
+/*
+ * The symmetric quadratic form matches the dense product x' A x at every
+ * kernel level, and only reads the upper triangle
+ */
+void TestQuadFormSym(CuTest *ct) {
+    const U32 n = 37;
+    F64* A = malloc(sizeof(F64) * n * n);
+    F64 x[37];
+    EosSimdLevel level;
+    U32 seed = 7;
+    U32 i, j;
+    F64 expected = 0.0;
+    F64 row;
+
+    for (i = 0; i < n; i++) {
+        seed = seed * 1103515245 + 12345;
+        x[i] = ((seed >> 16) % 2001) / 100.0 - 10.0;
+        for (j = i; j < n; j++) {
+            seed = seed * 1103515245 + 12345;
+            A[i * n + j] = ((seed >> 16) % 2001) / 1000.0 - 1.0;
+            A[j * n + i] = A[i * n + j];
+        }
+        A[i * n + i] += n;
+    }
+    for (i = 0; i < n; i++) {
+        row = 0.0;
+        for (j = 0; j < n; j++) {
+            row += A[i * n + j] * x[j];
+        }
+        expected += x[i] * row;
+    }
+    // Poison the strict lower triangle
+    for (i = 1; i < n; i++) {
+        for (j = 0; j < i; j++) {
+            A[i * n + j] = NAN;
+        }
+    }
+
+    for (level = EOS_SIMD_SCALAR; level <= EOS_SIMD_AVX512; level++) {
+        if (eos_simd_set_level(level) != level) { continue; }
+        CuAssertDblEquals(ct, expected, eos_quad_form_sym(n, A, x),
+                          1e-12 * expected);
+    }
+    CuAssertDblEquals(ct, 0.0, eos_quad_form_sym(0, A, x), 0.0);
+
+    eos_simd_init();
+    free(A);
+}
+
+/*
+ * The row-combination kernels match the scalar sum at every kernel level,
+ * for widths around every vector width (including the pixel tile width)
+ */
+void TestAxpyRowsKernels(CuTest *ct) {
+    const U32 n = 67;
+    const U32 max_m = 70;
+    F64* X = malloc(sizeof(F64) * n * max_m);
+    F32* X_f32 = malloc(sizeof(F32) * n * max_m);
+    F64 a[67], y[71], expected[70];
+    F32 a_f32[67], y_f32[71];
+    EosSimdLevel level;
+    U32 seed = 99;
+    U32 i, p, m, rows;
+    F64 abs_sum;
+
+    for (i = 0; i < n * max_m; i++) {
+        seed = seed * 1103515245 + 12345;
+        X[i] = ((seed >> 16) % 20001) / 1000.0 - 10.0;
+        X_f32[i] = (F32) X[i];
+    }
+    for (i = 0; i < n; i++) {
+        seed = seed * 1103515245 + 12345;
+        a[i] = ((seed >> 16) % 20001) / 1000.0 - 10.0;
+        a_f32[i] = (F32) a[i];
+    }
+
+    for (level = EOS_SIMD_SCALAR; level <= EOS_SIMD_AVX512; level++) {
+        if (eos_simd_set_level(level) != level) { continue; }
+        for (m = 0; m <= max_m; m += (m < 40) ? 1 : 15) {
+            for (rows = 0; rows <= n; rows += 67) {
+                for (p = 0; p <= m; p++) {
+                    y[p] = (F64) p;
+                    y_f32[p] = (F32) p;
+                }
+                eos_daxpy_rows(rows, m, a, X, y);
+                eos_saxpy_rows(rows, m, a_f32, X_f32, y_f32);
+                for (p = 0; p < m; p++) {
+                    expected[p] = (F64) p;
+                    abs_sum = (F64) p;
+                    for (i = 0; i < rows; i++) {
+                        expected[p] += a[i] * X[i * m + p];
+                        abs_sum += fabs(a[i] * X[i * m + p]);
+                    }
+                    CuAssertDblEquals(ct, expected[p], y[p],
+                                      (rows + 1) * DBL_EPSILON * abs_sum);
+                    CuAssertDblEquals(ct, expected[p], y_f32[p],
+                                      (rows + 1) * 4 * FLT_EPSILON * abs_sum);
+                }
+                // Nothing past the end is written
+                CuAssertDblEquals(ct, (F64) m, y[m], 0);
+                CuAssertDblEquals(ct, (F64) m, y_f32[m], 0);
+            }
+        }
+    }
+
+    eos_simd_init();
+    free(X_f32);
+    free(X);
+}
+
+/*
+ * Every available kernel level decodes big-endian values exactly, from
+ * unaligned sources and for lengths around every vector width
+ */
+void TestDecodeKernels(CuTest *ct) {
+    uint8_t src[2 * SIMD_TEST_MAX_N + 1];
+    U16 dst[SIMD_TEST_MAX_N + 1];
+    EosSimdLevel level;
+    U32 i, n, offset;
+
+    for (i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t) (i * 37 + 11);
+    }
+
+    for (level = EOS_SIMD_SCALAR; level <= EOS_SIMD_AVX512; level++) {
+        if (eos_simd_set_level(level) != level) { continue; }
+        for (offset = 0; offset < 2; offset++) {
+            for (n = 0; n <= SIMD_TEST_MAX_N; n += (n < 40) ? 1 : 127) {
+                dst[n] = 0xABCD;
+                eos_decode_u16_be(n, &src[offset], dst);
+                for (i = 0; i < n; i++) {
+                    CuAssertIntEquals(ct, (src[offset + 2 * i] << 8)
+                                      | src[offset + 2 * i + 1], dst[i]);
+                }
+                // Nothing past the end is written
+                CuAssertIntEquals(ct, 0xABCD, dst[n]);
+            }
+        }
+    }
+
+    eos_simd_init();
+}
+
+CuSuite* CuSimdGetSuite(void)
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, TestDotKernels);
+    SUITE_ADD_TEST(suite, TestQuadFormSym);
+    SUITE_ADD_TEST(suite, TestAxpyRowsKernels);
+    SUITE_ADD_TEST(suite, TestDecodeKernels);
+    return suite;
+}
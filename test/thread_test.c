@@ -0,0 +1,55 @@
+#include <stdlib.h>
+
+#include <eos_thread.h>
+#include "CuTest.h"
+#include "util.h"
+
+static EosStatus _record_worker(void* context, U32 worker) {
+    U32* visited = (U32*) context;
+    visited[worker] += worker + 1;
+    return EOS_SUCCESS;
+}
+
+static EosStatus _failing_worker(void* context, U32 worker) {
+    (void) context;
+    if (worker == 2) { return EOS_VALUE_ERROR; }
+    if (worker == 3) { return EOS_ERROR; }
+    return EOS_SUCCESS;
+}
+
+void TestRunWorkers(CuTest *ct) {
+    EosStatus status;
+    U32 visited[EOS_MAX_WORKERS] = {0};
+    U32 i;
+
+    // Each worker runs exactly once
+    status = eos_run_workers(EOS_MAX_WORKERS, _record_worker, visited);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    for (i = 0; i < EOS_MAX_WORKERS; i++) {
+        CuAssertIntEquals(ct, i + 1, visited[i]);
+    }
+
+    // No workers is a no-op
+    status = eos_run_workers(0, _record_worker, visited);
+    CuAssertIntEquals(ct, EOS_SUCCESS, status);
+    CuAssertIntEquals(ct, 1, visited[0]);
+
+    // The status of the lowest-numbered failing worker is returned
+    status = eos_run_workers(5, _failing_worker, NULL);
+    CuAssertIntEquals(ct, EOS_VALUE_ERROR, status);
+
+    // Invalid arguments
+    status = eos_run_workers(EOS_MAX_WORKERS + 1, _record_worker, visited);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+    status = eos_run_workers(1, NULL, visited);
+    CuAssertIntEquals(ct, EOS_ASSERT_ERROR, status);
+}
+
+CuSuite* CuThreadGetSuite(void)
+{
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, TestRunWorkers);
+
+    return suite;
+}
@@ -38,6 +38,11 @@ void read_resource(CuTest *ct, char* filename, void **data_ptr, unsigned int *si
 
 void default_init_params_test(EosInitParams *init) {
     init->mise_max_bands = EOS_MISE_N_BANDS;
+    init->mise_workers = 1;
+    init->mise_max_results = 0;
+    init->mise_max_targets = 0;
+    init->mise_max_clusters = 0;
+    init->mise_algorithms = 0;
 }
 
 /*
@@ -53,6 +58,7 @@ void InitEthemisObsValue(EosEthemisObservation* obs,
     for (b=EOS_ETHEMIS_BAND_1; b < EOS_ETHEMIS_N_BANDS; b++) {
         obs->band_shape[b].rows = nrows;
         obs->band_shape[b].cols = ncols;
+        obs->band_mask[b] = NULL;
         obs->band_data[b] = (uint16_t*) malloc(sizeof(uint16_t) *
                                (nrows * ncols));
         int r, c;
@@ -97,6 +103,8 @@ void InitMiseObsValue(EosMiseObservation* obs,
     obs->shape.rows = nrows;
     obs->shape.cols = ncols;
     obs->shape.bands = nbands;
+    obs->layout = EOS_MISE_BIP;
+    obs->mask = NULL;
     obs->data = (uint16_t*) malloc(sizeof(uint16_t) * nentries);
     for (i = 0; i < nentries; i++) {
         obs->data[i] = default_value;
@@ -204,5 +212,10 @@ EosStatus default_init_params_pims(EosInitParams* init_params){
     }
     init_params -> pims_params = params.pims;
     init_params -> mise_max_bands = 0;
+    init_params -> mise_workers = 1;
+    init_params -> mise_max_results = 0;
+    init_params -> mise_max_targets = 0;
+    init_params -> mise_max_clusters = 0;
+    init_params -> mise_algorithms = 0;
     return EOS_SUCCESS;
 }
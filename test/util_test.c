@@ -113,6 +113,28 @@ void TestNorms(CuTest *ct) {
     CuAssertDblEquals(ct, -3, result, 1e-3);
 }
 
+void TestWideArithmetic(CuTest *ct) {
+    uint64_t hi, lo;
+
+    eos_umul128(3, 5, &hi, &lo);
+    CuAssertTrue(ct, hi == 0 && lo == 15);
+
+    // (2^64 - 1)^2 = 2^128 - 2^65 + 1
+    eos_umul128(UINT64_MAX, UINT64_MAX, &hi, &lo);
+    CuAssertTrue(ct, hi == UINT64_MAX - 1 && lo == 1);
+
+    // 2^32 * 2^40 = 2^72
+    eos_umul128(1ULL << 32, 1ULL << 40, &hi, &lo);
+    CuAssertTrue(ct, hi == (1ULL << 8) && lo == 0);
+
+    CuAssertDblEquals(ct, 10.0, eos_u128_diff(0, 15, 0, 5), 0);
+    CuAssertDblEquals(ct, -10.0, eos_u128_diff(0, 5, 0, 15), 0);
+    CuAssertDblEquals(ct, 1.0, eos_u128_diff(1, 0, 0, UINT64_MAX), 0);
+    CuAssertDblEquals(ct, -1.0, eos_u128_diff(0, UINT64_MAX, 1, 0), 0);
+    CuAssertDblEquals(ct, 18446744073709551616.0,
+                      eos_u128_diff(2, 7, 1, 7), 0);
+}
+
 CuSuite* CuUtilGetSuite(void)
 {
     CuSuite* suite = CuSuiteNew();
@@ -130,6 +152,7 @@ CuSuite* CuUtilGetSuite(void)
     SUITE_ADD_TEST(suite, TestCeil);
     SUITE_ADD_TEST(suite, TestNorms);
     SUITE_ADD_TEST(suite, TestByteOrderCorrection);
+    SUITE_ADD_TEST(suite, TestWideArithmetic);
 
     return suite;
 }